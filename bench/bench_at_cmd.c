@@ -0,0 +1,114 @@
+#include "at_cmd_cgdcont.h"
+#include "at_cmd_cops.h"
+#include "at_cmd_cpin.h"
+#include "at_cmd_csq.h"
+#include "at_cmd_handler.h"
+#include "at_cmd_qmtcfg.h"
+#include "at_cmd_qmtconn.h"
+#include "bench_harness.h"
+#include "bg95_raw_at.h"
+#include "bg95_status.h"
+
+#include <string.h>
+
+#define PARSER_ITERATIONS 2000
+#define FORMATTER_ITERATIONS 2000
+
+typedef struct
+{
+  const at_cmd_t* cmd;
+  at_cmd_type_t   type;
+  const char*     response;
+  void*           parsed_out;
+} parser_case_t;
+
+static void run_parser(void* ctx)
+{
+  parser_case_t* pc = (parser_case_t*) ctx;
+  pc->cmd->type_info[pc->type].parser(pc->response, pc->parsed_out);
+}
+
+static void run_base_parser(void* ctx)
+{
+  at_parsed_response_t parsed = {0};
+  at_cmd_parse_response((const char*) ctx, &parsed);
+}
+
+typedef struct
+{
+  const at_cmd_t* cmd;
+  const void*     params;
+  char            line[BG95_RAW_AT_CMD_MAX_LEN];
+} formatter_case_t;
+
+static void run_formatter(void* ctx)
+{
+  formatter_case_t* fc = (formatter_case_t*) ctx;
+  bg95_raw_at_format_cmd(fc->cmd, AT_CMD_TYPE_WRITE, fc->params, fc->line, sizeof(fc->line));
+}
+
+static void run_status_parse(void* ctx)
+{
+  bg95_status_snapshot_t snapshot;
+  bg95_status_snapshot_parse((const char*) ctx, 0, &snapshot);
+}
+
+static void bench_parsers(void)
+{
+  csq_execute_response_t  csq  = {0};
+  cpin_read_response_t    cpin = {0};
+  cops_read_response_t    cops = {0};
+  qmtconn_read_response_t conn = {0};
+
+  parser_case_t cases[] = {
+      {&AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, "\r\n+CSQ: 24,0\r\n\r\nOK\r\n", &csq},
+      {&AT_CMD_CPIN, AT_CMD_TYPE_READ, "\r\n+CPIN: READY\r\n\r\nOK\r\n", &cpin},
+      {&AT_CMD_COPS, AT_CMD_TYPE_READ, "\r\n+COPS: 0,0,\"Operator\",8\r\n\r\nOK\r\n", &cops},
+      {&AT_CMD_QMTCONN, AT_CMD_TYPE_READ, "\r\n+QMTCONN: 0,3\r\n\r\nOK\r\n", &conn},
+  };
+  const char* names[] = {"parse_csq", "parse_cpin", "parse_cops", "parse_qmtconn"};
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+  {
+    bench_run(names[i], PARSER_ITERATIONS, run_parser, &cases[i]);
+  }
+  bench_run("parse_basic_response",
+            PARSER_ITERATIONS,
+            run_base_parser,
+            "\r\n+CSQ: 24,0\r\n\r\nOK\r\n");
+  bench_run("parse_status_snapshot",
+            PARSER_ITERATIONS / 4,
+            run_status_parse,
+            "\r\n+CPIN: READY\r\n\r\n+CSQ: 24,0\r\n\r\n+COPS: 0,0,\"Operator\",8\r\n"
+            "\r\n+CGPADDR: 1,\"10.0.0.2\"\r\n\r\n+QMTCONN: 0,3\r\n\r\nOK\r\n");
+}
+
+static void bench_formatters(void)
+{
+  qmtcfg_write_params_t keepalive                        = {.type = QMTCFG_TYPE_KEEPALIVE};
+  keepalive.params.keepalive.client_idx                  = 0;
+  keepalive.params.keepalive.keep_alive_time             = 120;
+  keepalive.params.keepalive.present.has_keep_alive_time = true;
+
+  cgdcont_write_params_t cgdcont = {.cid = 1, .pdp_type = CGDCONT_PDP_TYPE_IP};
+  strcpy(cgdcont.apn, "internet");
+  cgdcont.present.has_cid      = true;
+  cgdcont.present.has_pdp_type = true;
+  cgdcont.present.has_apn      = true;
+
+  static formatter_case_t qmtcfg_case;
+  static formatter_case_t cgdcont_case;
+  qmtcfg_case.cmd     = &AT_CMD_QMTCFG;
+  qmtcfg_case.params  = &keepalive;
+  cgdcont_case.cmd    = &AT_CMD_CGDCONT;
+  cgdcont_case.params = &cgdcont;
+
+  bench_run("format_qmtcfg_keepalive", FORMATTER_ITERATIONS, run_formatter, &qmtcfg_case);
+  bench_run("format_cgdcont", FORMATTER_ITERATIONS, run_formatter, &cgdcont_case);
+}
+
+void run_bench_at_cmd_all(void)
+{
+  bench_parsers();
+  bench_formatters();
+}
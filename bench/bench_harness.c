@@ -0,0 +1,147 @@
+#include "bench_harness.h"
+
+#include "esp_cpu.h"
+#include "esp_timer.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define CALIBRATION_US 20000
+
+static atomic_uint alloc_count  = 0;
+static uint32_t    cycles_per_us = 0;
+
+// Allocation counting: the component links with -Wl,--wrap=<fn>, so every reference to the
+// heap_caps allocator in the image lands here first. Calls inside the heap component itself are
+// not wrapped, so an allocation is counted once whichever API it came through.
+void* __real_heap_caps_malloc(size_t size, uint32_t caps);
+void* __real_heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void* __real_heap_caps_realloc(void* ptr, size_t size, uint32_t caps);
+void* __real_heap_caps_malloc_default(size_t size);
+void* __real_heap_caps_realloc_default(void* ptr, size_t size);
+void* __real_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps);
+
+static inline void count_alloc(void)
+{
+  atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+}
+
+void* __wrap_heap_caps_malloc(size_t size, uint32_t caps)
+{
+  count_alloc();
+  return __real_heap_caps_malloc(size, caps);
+}
+
+void* __wrap_heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+  count_alloc();
+  return __real_heap_caps_calloc(n, size, caps);
+}
+
+void* __wrap_heap_caps_realloc(void* ptr, size_t size, uint32_t caps)
+{
+  count_alloc();
+  return __real_heap_caps_realloc(ptr, size, caps);
+}
+
+void* __wrap_heap_caps_malloc_default(size_t size)
+{
+  count_alloc();
+  return __real_heap_caps_malloc_default(size);
+}
+
+void* __wrap_heap_caps_realloc_default(void* ptr, size_t size)
+{
+  count_alloc();
+  return __real_heap_caps_realloc_default(ptr, size);
+}
+
+void* __wrap_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+  count_alloc();
+  return __real_heap_caps_aligned_alloc(alignment, size, caps);
+}
+
+uint32_t bench_alloc_count(void)
+{
+  return atomic_load_explicit(&alloc_count, memory_order_relaxed);
+}
+
+void bench_calibrate(void)
+{
+  int64_t  start_us     = esp_timer_get_time();
+  uint32_t start_cycles = esp_cpu_get_cycle_count();
+  int64_t  now_us;
+
+  while ((now_us = esp_timer_get_time()) - start_us < CALIBRATION_US)
+  {
+  }
+  uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles;
+
+  cycles_per_us = (uint32_t) (cycles / (uint64_t) (now_us - start_us));
+  if (cycles_per_us == 0)
+  {
+    cycles_per_us = 1;
+  }
+  bench_print_metric("cpu_cycles_per_us", cycles_per_us, "cycles/us");
+}
+
+uint32_t bench_cycles_to_ns(uint64_t cycles)
+{
+  return (uint32_t) (cycles * 1000 / (cycles_per_us == 0 ? 1 : cycles_per_us));
+}
+
+void bench_measure(
+    const char* name, uint32_t iterations, bench_fn_t fn, void* ctx, bench_result_t* result)
+{
+  for (uint32_t i = 0; i < BENCH_WARMUP_ITERATIONS; i++)
+  {
+    fn(ctx);
+  }
+
+  result->name         = name;
+  result->iterations   = iterations;
+  result->total_cycles = 0;
+  result->min_cycles   = UINT32_MAX;
+  result->max_cycles   = 0;
+
+  uint32_t allocs_before = bench_alloc_count();
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    uint32_t start  = esp_cpu_get_cycle_count();
+    fn(ctx);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start; // Wraps correctly for one call
+
+    result->total_cycles += cycles;
+    result->min_cycles = cycles < result->min_cycles ? cycles : result->min_cycles;
+    result->max_cycles = cycles > result->max_cycles ? cycles : result->max_cycles;
+  }
+  result->allocs = bench_alloc_count() - allocs_before;
+}
+
+void bench_run(const char* name, uint32_t iterations, bench_fn_t fn, void* ctx)
+{
+  bench_result_t result;
+  bench_measure(name, iterations, fn, ctx, &result);
+  bench_print(&result);
+}
+
+void bench_print(const bench_result_t* result)
+{
+  uint64_t avg = result->iterations == 0 ? 0 : result->total_cycles / result->iterations;
+
+  printf("BENCH,%s,%lu,%llu,%lu,%lu,%lu,%.2f\n",
+         result->name,
+         (unsigned long) result->iterations,
+         (unsigned long long) avg,
+         (unsigned long) result->min_cycles,
+         (unsigned long) result->max_cycles,
+         (unsigned long) bench_cycles_to_ns(avg),
+         result->iterations == 0 ? 0.0 : (double) result->allocs / result->iterations);
+}
+
+void bench_print_metric(const char* name, double value, const char* unit)
+{
+  printf("BENCH_METRIC,%s,%.3f,%s\n", name, value, unit);
+}
@@ -0,0 +1,49 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <stdint.h>
+
+// Minimal on-target benchmark harness.
+// Each case is timed per iteration with the CPU cycle counter (esp_cpu_get_cycle_count), so the
+// numbers are real Xtensa cycles, and allocations are counted through the linker wrapped
+// heap_caps allocator, which covers malloc as well as pvPortMalloc (see bench/CMakeLists.txt).
+//
+// Results are printed one per line so they can be grepped out of the monitor log:
+//   BENCH,<name>,<iterations>,<cycles_avg>,<cycles_min>,<cycles_max>,<ns_avg>,<allocs_per_op>
+//   BENCH_METRIC,<name>,<value>,<unit>
+
+#define BENCH_WARMUP_ITERATIONS 4
+
+typedef void (*bench_fn_t)(void* ctx);
+
+typedef struct
+{
+  const char* name;
+  uint32_t    iterations;
+  uint64_t    total_cycles;
+  uint32_t    min_cycles;
+  uint32_t    max_cycles;
+  uint32_t    allocs; // Over all measured iterations
+} bench_result_t;
+
+// Measure the cycle counter rate against esp_timer, call once before the first bench_run
+void bench_calibrate(void);
+
+// Run 'fn' BENCH_WARMUP_ITERATIONS times untimed, then 'iterations' times timed, and print it
+void bench_run(const char* name, uint32_t iterations, bench_fn_t fn, void* ctx);
+
+// Same as bench_run without printing, for cases that post-process the numbers
+void bench_measure(
+    const char* name, uint32_t iterations, bench_fn_t fn, void* ctx, bench_result_t* result);
+
+void bench_print(const bench_result_t* result);
+
+// Free form metric line for values that are not per-call timings
+void bench_print_metric(const char* name, double value, const char* unit);
+
+// Heap allocations made since boot, from malloc/calloc/realloc or pvPortMalloc
+uint32_t bench_alloc_count(void);
+
+uint32_t bench_cycles_to_ns(uint64_t cycles);
+
+#endif /* BENCH_HARNESS_H */
@@ -0,0 +1,81 @@
+#include "bench_harness.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <stdio.h>
+
+static const char* TAG = "Bench_Orchestrator";
+
+/* Forward declarations of all benchmark suites */
+void run_bench_at_cmd_all(void);
+void run_bench_raw_at_all(void);
+void run_bench_mqtt_all(void);
+void run_bench_pub_ring_all(void);
+void run_bench_uart_rx_all(void);
+
+typedef struct
+{
+  const char* name;
+  void (*bench_function)(void);
+} bench_suite_t;
+
+static const bench_suite_t bench_suites[] = {
+    {"AT CMD parser/formatter", run_bench_at_cmd_all},
+    {"RAW AT transport", run_bench_raw_at_all},
+    {"MQTT publish on simulated modem", run_bench_mqtt_all},
+    {"MPSC publish ring", run_bench_pub_ring_all},
+    {"UART RX wakeups", run_bench_uart_rx_all},
+};
+
+#define NUM_BENCH_SUITES (sizeof(bench_suites) / sizeof(bench_suite_t))
+#define BENCH_TASK_STACK_SIZE (8192)
+#define BENCH_TASK_PRIORITY (10) /* Above the helper tasks under test */
+
+static SemaphoreHandle_t bench_done;
+
+static void bench_task(void* pvParameters)
+{
+  bench_calibrate();
+
+  for (size_t i = 0; i < NUM_BENCH_SUITES; i++)
+  {
+    ESP_LOGI(TAG, "Starting bench suite: %s", bench_suites[i].name);
+    printf("\n===== %s =====\n", bench_suites[i].name);
+    bench_suites[i].bench_function();
+  }
+
+  xSemaphoreGive(bench_done);
+  vTaskDelete(NULL);
+}
+
+void app_main(void)
+{
+  bench_done = xSemaphoreCreateBinary();
+  if (bench_done == NULL)
+  {
+    ESP_LOGE(TAG, "Failed to create completion semaphore");
+    return;
+  }
+
+  printf("\n======== RUNNING ALL BENCHMARKS ========\n");
+  printf("BENCH,name,iterations,cycles_avg,cycles_min,cycles_max,ns_avg,allocs_per_op\n");
+
+  // Pinned to one core so the cycle counter of a single CPU times every call
+  if (xTaskCreatePinnedToCore(bench_task,
+                              "bench_task",
+                              BENCH_TASK_STACK_SIZE,
+                              NULL,
+                              BENCH_TASK_PRIORITY,
+                              NULL,
+                              0) != pdPASS)
+  {
+    ESP_LOGE(TAG, "Failed to create bench task");
+    return;
+  }
+
+  xSemaphoreTake(bench_done, portMAX_DELAY);
+  printf("\n======== ALL BENCHMARKS COMPLETED ========\n");
+  vSemaphoreDelete(bench_done);
+}
@@ -0,0 +1,159 @@
+#include "at_cmd_qmtpub.h"
+#include "bench_harness.h"
+#include "bg95_driver.h"
+#include "bg95_reconnect.h"
+#include "bg95_sim.h"
+
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// End-to-end publish benchmark: the real driver publishing to a simulated BG95.
+// Latency is publish call to +QMTPUB ack, the driver returns once the result URC is parsed.
+// With MQTT_BENCH_BROKER_HOST set the simulator bridges to that broker (e.g. a local mosquitto
+// next to a Linux build) and the ack is the broker's, otherwise it comes after the URC delay.
+
+#define MQTT_BENCH_RTT_MS 40
+#define MQTT_BENCH_URC_DELAY_MS 120
+#define MQTT_BENCH_BAUD 921600
+#define MQTT_BENCH_MESSAGES 50
+#define MQTT_BENCH_CLIENT_IDX 0
+#define MQTT_BENCH_TOPIC "bench/bg95"
+#define MQTT_BENCH_CLIENT_ID "bg95-bench"
+#define MQTT_BENCH_BROKER_HOST NULL // "127.0.0.1" to publish through a real broker
+#define MQTT_BENCH_BROKER_PORT 1883
+
+static const size_t payload_sizes[] = {16, 256, 1024, QMTPUB_MSG_MAX_LEN};
+
+static const qmtpub_qos_t qos_levels[] = {
+    QMTPUB_QOS_AT_MOST_ONCE, QMTPUB_QOS_AT_LEAST_ONCE, QMTPUB_QOS_EXACTLY_ONCE};
+
+static int compare_u32(const void* a, const void* b)
+{
+  uint32_t x = *(const uint32_t*) a;
+  uint32_t y = *(const uint32_t*) b;
+  return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of a sorted array
+static uint32_t percentile(const uint32_t* sorted, size_t count, uint32_t pct)
+{
+  size_t rank = (count * pct + 99) / 100;
+  return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+static void bench_publish_case(bg95_handle_t* handle,
+                               bg95_sim_t*    sim,
+                               qmtpub_qos_t   qos,
+                               const char*    payload,
+                               size_t         len)
+{
+  static uint32_t latency_us[MQTT_BENCH_MESSAGES];
+  size_t          acked = 0;
+
+  bg95_sim_reset_stats(sim);
+  int64_t start_us = esp_timer_get_time();
+  for (int i = 0; i < MQTT_BENCH_MESSAGES; i++)
+  {
+    qmtpub_write_response_t response = {0};
+    int                     msgid    = qos == QMTPUB_QOS_AT_MOST_ONCE ? 0 : 1 + i;
+    int64_t                 sent_us  = esp_timer_get_time();
+
+    esp_err_t err = bg95_mqtt_publish_fixed_length(handle,
+                                                   MQTT_BENCH_CLIENT_IDX,
+                                                   msgid,
+                                                   qos,
+                                                   QMTPUB_RETAIN_DISABLED,
+                                                   MQTT_BENCH_TOPIC,
+                                                   payload,
+                                                   len,
+                                                   &response);
+    if (err == ESP_OK)
+    {
+      latency_us[acked++] = (uint32_t) (esp_timer_get_time() - sent_us);
+    }
+  }
+  int64_t elapsed_us = esp_timer_get_time() - start_us;
+
+  char name[48];
+  int  prefix = snprintf(name, sizeof(name), "mqtt_qos%d_%u_", (int) qos, (unsigned) len);
+
+  snprintf(name + prefix, sizeof(name) - prefix, "acked");
+  bench_print_metric(name, (double) acked / MQTT_BENCH_MESSAGES, "ratio");
+  if (acked == 0)
+  {
+    return;
+  }
+  qsort(latency_us, acked, sizeof(latency_us[0]), compare_u32);
+
+  snprintf(name + prefix, sizeof(name) - prefix, "throughput");
+  bench_print_metric(name, (double) acked * 1000000.0 / (double) elapsed_us, "msg/s");
+  snprintf(name + prefix, sizeof(name) - prefix, "p50");
+  bench_print_metric(name, percentile(latency_us, acked, 50), "us");
+  snprintf(name + prefix, sizeof(name) - prefix, "p95");
+  bench_print_metric(name, percentile(latency_us, acked, 95), "us");
+  snprintf(name + prefix, sizeof(name) - prefix, "p99");
+  bench_print_metric(name, percentile(latency_us, acked, 99), "us");
+  snprintf(name + prefix, sizeof(name) - prefix, "uart_util");
+  bench_print_metric(name, bg95_sim_uart_utilization(sim), "ratio");
+}
+
+// Open and connect the client through the driver, as an application would
+static esp_err_t connect_broker(bg95_handle_t* handle)
+{
+  qmtopen_write_response_t open = {0};
+  qmtconn_write_response_t conn = {0};
+
+  esp_err_t err = bg95_mqtt_open_network(
+      handle, MQTT_BENCH_CLIENT_IDX, MQTT_BENCH_BROKER_HOST, MQTT_BENCH_BROKER_PORT, &open);
+  if (bg95_reconnect_classify_qmtopen(err, &open) != BG95_RECONNECT_CLASS_NONE)
+  {
+    return ESP_FAIL;
+  }
+  err = bg95_mqtt_connect(handle, MQTT_BENCH_CLIENT_IDX, MQTT_BENCH_CLIENT_ID, NULL, NULL, &conn);
+  if (bg95_reconnect_classify_qmtconn(err, &conn) != BG95_RECONNECT_CLASS_NONE)
+  {
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+void run_bench_mqtt_all(void)
+{
+  static bg95_sim_t    sim;
+  static bg95_handle_t handle;
+  static char          payload[QMTPUB_MSG_MAX_LEN];
+  bg95_sim_config_t    config = {.rtt_ms       = MQTT_BENCH_RTT_MS,
+                                 .urc_delay_ms = MQTT_BENCH_URC_DELAY_MS,
+                                 .baud         = MQTT_BENCH_BAUD,
+                                 .broker_host  = MQTT_BENCH_BROKER_HOST,
+                                 .broker_port  = MQTT_BENCH_BROKER_PORT};
+
+  memset(payload, 'x', sizeof(payload));
+  if (bg95_sim_init(&sim, &config) != ESP_OK || bg95_init(&handle, &sim.uart) != ESP_OK)
+  {
+    printf("BENCH mqtt: simulator or driver init failed\n");
+    return;
+  }
+  if (config.broker_host != NULL && connect_broker(&handle) != ESP_OK)
+  {
+    printf("BENCH mqtt: cannot connect to broker %s\n", config.broker_host);
+    bg95_sim_deinit(&sim);
+    return;
+  }
+
+  bench_print_metric("mqtt_sim_rtt", MQTT_BENCH_RTT_MS, "ms");
+  bench_print_metric("mqtt_sim_urc_delay", MQTT_BENCH_URC_DELAY_MS, "ms");
+  bench_print_metric("mqtt_sim_baud", MQTT_BENCH_BAUD, "bit/s");
+
+  for (size_t q = 0; q < sizeof(qos_levels) / sizeof(qos_levels[0]); q++)
+  {
+    for (size_t s = 0; s < sizeof(payload_sizes) / sizeof(payload_sizes[0]); s++)
+    {
+      bench_publish_case(&handle, &sim, qos_levels[q], payload, payload_sizes[s]);
+    }
+  }
+
+  bg95_sim_deinit(&sim);
+}
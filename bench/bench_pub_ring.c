@@ -0,0 +1,132 @@
+#include "bench_harness.h"
+#include "bg95_pub_ring.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#define HANDOFF_ITERATIONS 5000
+#define PRODUCERS 4
+#define PER_PRODUCER 5000
+#define PRODUCER_TASK_STACK_SIZE 2048
+#define PRODUCER_TASK_PRIORITY 5
+
+static const char* const topics[] = {"bench/ring"};
+
+// ----------- Single task handoff cost -------------------
+
+static void run_ring_handoff(void* ctx)
+{
+  bg95_pub_ring_t*      ring = (bg95_pub_ring_t*) ctx;
+  const bg95_pub_desc_t desc = {.topic_id = 0, .payload = "x", .len = 1};
+  bg95_pub_desc_t       out;
+
+  bg95_pub_ring_try_enqueue(ring, &desc);
+  bg95_pub_ring_dequeue(ring, &out);
+}
+
+typedef struct
+{
+  SemaphoreHandle_t lock;
+  bg95_pub_desc_t   slot;
+} locked_slot_t;
+
+// What a producer pays when every publish takes the lock guarding a shared queue
+static void run_mutex_handoff(void* ctx)
+{
+  locked_slot_t*        locked = (locked_slot_t*) ctx;
+  const bg95_pub_desc_t desc   = {.topic_id = 0, .payload = "x", .len = 1};
+
+  xSemaphoreTake(locked->lock, portMAX_DELAY);
+  locked->slot = desc;
+  xSemaphoreGive(locked->lock);
+}
+
+// ----------- Contended producers -------------------
+
+typedef struct
+{
+  bg95_pub_ring_t*  ring;
+  SemaphoreHandle_t done;
+} producer_ctx_t;
+
+static void producer_task(void* pvParameters)
+{
+  producer_ctx_t*       ctx  = (producer_ctx_t*) pvParameters;
+  const bg95_pub_desc_t desc = {.topic_id = 0, .payload = "x", .len = 1};
+
+  for (int i = 0; i < PER_PRODUCER; i++)
+  {
+    if (bg95_pub_ring_enqueue(ctx->ring, &desc, 1000) != ESP_OK)
+    {
+      break;
+    }
+  }
+  xSemaphoreGive(ctx->done);
+  vTaskDelete(NULL);
+}
+
+static esp_err_t discard(const char* topic, const bg95_pub_desc_t* desc, void* ctx)
+{
+  return ESP_OK;
+}
+
+static void bench_contended(bg95_pub_ring_t* ring)
+{
+  producer_ctx_t ctx      = {.ring = ring, .done = xSemaphoreCreateCounting(PRODUCERS, 0)};
+  size_t         drained  = 0;
+  int            finished = 0;
+
+  if (ctx.done == NULL)
+  {
+    return;
+  }
+
+  int64_t start_us = esp_timer_get_time();
+  for (int i = 0; i < PRODUCERS; i++)
+  {
+    xTaskCreate(producer_task,
+                "bench_producer",
+                PRODUCER_TASK_STACK_SIZE,
+                &ctx,
+                PRODUCER_TASK_PRIORITY,
+                NULL);
+  }
+  while (drained < PRODUCERS * PER_PRODUCER && bg95_pub_ring_wait(ring, 1000))
+  {
+    drained += bg95_pub_ring_drain(ring, discard, NULL, BG95_PUB_RING_SIZE);
+  }
+  int64_t elapsed_us = esp_timer_get_time() - start_us;
+  while (finished < PRODUCERS && xSemaphoreTake(ctx.done, pdMS_TO_TICKS(1000)))
+  {
+    finished++;
+  }
+
+  bg95_pub_ring_stats_t stats;
+  bg95_pub_ring_get_stats(ring, &stats);
+  bench_print_metric("pub_ring_mpsc_throughput",
+                     drained * 1000000.0 / (elapsed_us > 0 ? elapsed_us : 1),
+                     "desc/s");
+  bench_print_metric("pub_ring_mpsc_full_retries", stats.full, "attempts");
+  vSemaphoreDelete(ctx.done);
+}
+
+void run_bench_pub_ring_all(void)
+{
+  static bg95_pub_ring_t ring;
+  locked_slot_t          locked = {.lock = xSemaphoreCreateMutex()};
+
+  if (locked.lock == NULL || bg95_pub_ring_init(&ring, topics, 1) != ESP_OK)
+  {
+    return;
+  }
+
+  bench_run("pub_ring_enqueue_dequeue", HANDOFF_ITERATIONS, run_ring_handoff, &ring);
+  bench_run("mutex_handoff_baseline", HANDOFF_ITERATIONS, run_mutex_handoff, &locked);
+  bench_contended(&ring);
+
+  bg95_pub_ring_deinit(&ring);
+  vSemaphoreDelete(locked.lock);
+}
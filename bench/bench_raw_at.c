@@ -0,0 +1,170 @@
+#include "at_cmd_csq.h"
+#include "bench_harness.h"
+#include "bg95_raw_at.h"
+#include "bg95_urc_tap.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+
+#define DETECTOR_ITERATIONS 5000
+#define ROUND_TRIP_ITERATIONS 200
+#define WAKEUP_COMMANDS 20
+#define WAKEUP_CHUNK 8 // Bytes per UART read, roughly one RX FIFO timeout worth at 115200
+
+static const mock_uart_response_t verbose_responses[] = {
+    {.expected_cmd = "AT+CSQ", .cmd_response = "\r\n+CSQ: 24,0\r\n\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CPIN?", .cmd_response = "\r\n+CPIN: READY\r\n\r\nOK\r\n", .delay_ms = 0}};
+
+static const mock_uart_response_t numeric_responses[] = {
+    {.expected_cmd = "AT+CSQ", .cmd_response = "+CSQ: 24,0\r\n0\r", .delay_ms = 0},
+    {.expected_cmd = "AT+CPIN?", .cmd_response = "+CPIN: READY\r\n0\r", .delay_ms = 0}};
+
+#define RESPONSES_COUNT(r) (sizeof(r) / sizeof((r)[0]))
+
+// ----------- Final result detection -------------------
+
+static void run_final_result(void* ctx)
+{
+  bg95_raw_at_has_final_result((const char*) ctx, false);
+}
+
+static void run_numeric_result(void* ctx)
+{
+  bg95_raw_at_has_final_result((const char*) ctx, true);
+}
+
+static void bench_final_result_detection(void)
+{
+  bench_run("final_result_verbose",
+            DETECTOR_ITERATIONS,
+            run_final_result,
+            "\r\n+COPS: 0,0,\"Operator\",8\r\n\r\nOK\r\n");
+  bench_run("final_result_numeric",
+            DETECTOR_ITERATIONS,
+            run_numeric_result,
+            "+COPS: 0,0,\"Operator\",8\r\n0\r");
+  bench_run("final_result_verbose_incomplete",
+            DETECTOR_ITERATIONS,
+            run_final_result,
+            "\r\n+COPS: 0,0,\"Operator\",8\r\n");
+}
+
+// ----------- AT round trip against the mock UART -------------------
+
+static void run_round_trip(void* ctx)
+{
+  char response[64];
+  bg95_raw_at_send((bg95_uart_interface_t*) ctx, "AT+CSQ", response, sizeof(response), 100);
+}
+
+static void run_execute(void* ctx)
+{
+  csq_execute_response_t csq;
+  bg95_raw_at_execute((bg95_uart_interface_t*) ctx, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, NULL, &csq);
+}
+
+static void bench_round_trip(const char*                 name,
+                             const char*                 execute_name,
+                             const mock_uart_response_t* responses,
+                             size_t                      count,
+                             bool                        numeric)
+{
+  bg95_uart_interface_t uart = {0};
+  bg95_raw_at_link_t    link;
+  if (mock_uart_init(&uart, responses, count) != ESP_OK)
+  {
+    return;
+  }
+  if (bg95_raw_at_link_init(&link, &uart) != ESP_OK ||
+      bg95_raw_at_mark_numeric(&link, numeric) != ESP_OK)
+  {
+    mock_uart_deinit(&uart);
+    return;
+  }
+  bench_run(name, ROUND_TRIP_ITERATIONS, run_round_trip, &link.uart);
+  bench_run(execute_name, ROUND_TRIP_ITERATIONS, run_execute, &link.uart);
+  mock_uart_deinit(&uart);
+}
+
+// ----------- Driver wakeups through the URC tap -------------------
+
+// Hands the last reply out WAKEUP_CHUNK bytes per read, like a UART RX FIFO timeout would
+typedef struct
+{
+  const char* reply;
+  const char* pending;
+} chunked_uart_t;
+
+static esp_err_t chunked_write(const char* data, size_t len, void* context)
+{
+  chunked_uart_t* ctx = (chunked_uart_t*) context;
+  ctx->pending        = ctx->reply;
+  return ESP_OK;
+}
+
+static esp_err_t chunked_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  chunked_uart_t* ctx = (chunked_uart_t*) context;
+  *bytes_read         = 0;
+  if (ctx->pending == NULL || *ctx->pending == '\0')
+  {
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    return ESP_ERR_TIMEOUT;
+  }
+  vTaskDelay(1);
+  size_t len = strlen(ctx->pending);
+  len        = len < WAKEUP_CHUNK ? len : WAKEUP_CHUNK;
+  len        = len < max_len ? len : max_len;
+  memcpy(data, ctx->pending, len);
+  *bytes_read = len;
+  ctx->pending += len;
+  return ESP_OK;
+}
+
+static void bench_tap_wakeups(bg95_urc_tap_t* tap, bool wake_on_line, const char* metric)
+{
+  char response[128];
+
+  bg95_urc_tap_set_wake_on_line(tap, wake_on_line);
+  uint32_t before = tap->stats.read_wakeups + tap->stats.empty_wakeups;
+  for (int i = 0; i < WAKEUP_COMMANDS; i++)
+  {
+    bg95_raw_at_send(&tap->uart, "AT+COPS?", response, sizeof(response), 1000);
+  }
+  uint32_t wakeups = tap->stats.read_wakeups + tap->stats.empty_wakeups - before;
+  bench_print_metric(metric, (double) wakeups / WAKEUP_COMMANDS, "wakeups/cmd");
+}
+
+static void bench_urc_tap(void)
+{
+  static chunked_uart_t ctx  = {.reply = "\r\n+COPS: 0,0,\"Operator\",8\r\n\r\nOK\r\n"};
+  bg95_uart_interface_t phys = {.write = chunked_write, .read = chunked_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+
+  if (bg95_urc_tap_init(&tap, &phys) != ESP_OK)
+  {
+    return;
+  }
+  bench_tap_wakeups(&tap, false, "urc_tap_wakeups_per_chunk");
+  bench_tap_wakeups(&tap, true, "urc_tap_wakeups_per_line");
+  bg95_urc_tap_deinit(&tap);
+}
+
+void run_bench_raw_at_all(void)
+{
+  bench_final_result_detection();
+  bench_round_trip("round_trip_verbose",
+                   "execute_csq_verbose",
+                   verbose_responses,
+                   RESPONSES_COUNT(verbose_responses),
+                   false);
+  bench_round_trip("round_trip_numeric",
+                   "execute_csq_numeric",
+                   numeric_responses,
+                   RESPONSES_COUNT(numeric_responses),
+                   true);
+  bench_urc_tap();
+}
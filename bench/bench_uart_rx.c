@@ -0,0 +1,83 @@
+#include "bench_harness.h"
+#include "bg95_flow.h"
+#include "bg95_uart_hw.h"
+#include "bg95_urc_tap.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+
+static const char* TAG = "Bench_UART_RX";
+
+// A spare UART in internal loopback, no pins needed. Every line written comes straight back.
+#define RX_BENCH_PORT UART_NUM_1
+#define RX_BENCH_LINES 50
+#define RX_BENCH_MAX_READS 100 // Per line, so a lost line cannot hang the suite
+
+static const char rx_bench_line[] = "+QMTRECV: 0,1,\"topic\",\"{\\\"seq\\\":1}\"\r\n";
+
+// Write one line and read it back the way the URC tap reader does, with its timeout
+static void bench_line_reads(bg95_uart_hw_t* hw,
+                             const char*     latency_metric,
+                             const char*     reads_metric)
+{
+  const size_t line_len = strlen(rx_bench_line);
+  uint64_t     total_us = 0;
+  uint32_t     reads    = 0;
+  char         buf[BG95_URC_TAP_READ_CHUNK];
+
+  for (int i = 0; i < RX_BENCH_LINES; i++)
+  {
+    int64_t start = esp_timer_get_time();
+    hw->uart.write(rx_bench_line, line_len, hw->uart.context);
+
+    size_t got = 0;
+    for (int r = 0; r < RX_BENCH_MAX_READS && got < line_len; r++)
+    {
+      size_t bytes_read = 0;
+      hw->uart.read(buf, sizeof(buf), &bytes_read, BG95_URC_TAP_POLL_MS, hw->uart.context);
+      got += bytes_read;
+      reads++;
+    }
+    total_us += esp_timer_get_time() - start;
+  }
+
+  bench_print_metric(latency_metric, (double) total_us / RX_BENCH_LINES, "us/line");
+  bench_print_metric(reads_metric, (double) reads / RX_BENCH_LINES, "reads/line");
+}
+
+void run_bench_uart_rx_all(void)
+{
+  static bg95_uart_hw_t hw;
+  static bg95_flow_t    flow;
+
+  const bg95_uart_hw_config_t config = {.port_num    = RX_BENCH_PORT,
+                                        .tx_gpio_num = UART_PIN_NO_CHANGE,
+                                        .rx_gpio_num = UART_PIN_NO_CHANGE};
+  if (bg95_uart_hw_init(&hw, &config) != ESP_OK ||
+      uart_set_loop_back(RX_BENCH_PORT, true) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "No loopback UART, skipping");
+    bg95_uart_hw_deinit(&hw);
+    return;
+  }
+
+  // Nobody feeds the events: each read sits out its timeout, like a polling read
+  bench_line_reads(&hw, "uart_rx_polled_latency", "uart_rx_polled_reads");
+
+  // Events passed on from the watcher: reads return on the line end
+  xQueueReset(hw.event_queue);
+  if (bg95_flow_init(&flow) == ESP_OK &&
+      bg95_flow_set_event_fn(&flow, bg95_uart_hw_on_event, &hw) == ESP_OK &&
+      bg95_flow_watch_events(&flow, hw.event_queue) == ESP_OK)
+  {
+    bench_line_reads(&hw, "uart_rx_event_latency", "uart_rx_event_reads");
+  }
+
+  bg95_flow_deinit(&flow);
+  bg95_uart_hw_deinit(&hw);
+}
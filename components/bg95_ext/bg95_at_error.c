@@ -0,0 +1,299 @@
+#include "bg95_at_error.h"
+
+#include "bg95_raw_at.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+typedef struct
+{
+  uint16_t    code;
+  uint8_t     retry; // bg95_at_retry_t
+  const char* text;  // AT+CMEE=2 wording
+} at_error_entry_t;
+
+#define IMM BG95_AT_RETRY_IMMEDIATE
+#define BOFF BG95_AT_RETRY_BACKOFF
+#define NEVER BG95_AT_RETRY_NEVER
+
+// Sorted by code, looked up with bsearch
+static const at_error_entry_t cme_errors[] = {
+    {0, BOFF, "phone failure"},
+    {3, NEVER, "operation not allowed"},
+    {4, NEVER, "operation not supported"},
+    {10, NEVER, "SIM not inserted"},
+    {11, NEVER, "SIM PIN required"},
+    {12, NEVER, "SIM PUK required"},
+    {13, BOFF, "SIM failure"},
+    {14, IMM, "SIM busy"},
+    {15, NEVER, "SIM wrong"},
+    {16, NEVER, "incorrect password"},
+    {17, NEVER, "SIM PIN2 required"},
+    {18, NEVER, "SIM PUK2 required"},
+    {20, NEVER, "memory full"},
+    {21, NEVER, "invalid index"},
+    {22, NEVER, "not found"},
+    {23, BOFF, "memory failure"},
+    {24, NEVER, "text string too long"},
+    {25, NEVER, "invalid characters in text string"},
+    {26, NEVER, "dial string too long"},
+    {27, NEVER, "invalid characters in dial string"},
+    {30, BOFF, "no network service"},
+    {31, BOFF, "network timeout"},
+    {32, BOFF, "network not allowed - emergency calls only"},
+    {40, NEVER, "network personalization PIN required"},
+    {50, NEVER, "incorrect parameters"},
+    {100, BOFF, "unknown"},
+    {103, NEVER, "illegal MS"},
+    {106, NEVER, "illegal ME"},
+    {107, NEVER, "GPRS services not allowed"},
+    {111, NEVER, "PLMN not allowed"},
+    {112, BOFF, "location area not allowed"},
+    {113, BOFF, "roaming not allowed in this location area"},
+    {132, NEVER, "service option not supported"},
+    {133, NEVER, "requested service option not subscribed"},
+    {134, BOFF, "service option temporarily out of order"},
+    {148, BOFF, "unspecified GPRS error"},
+    {149, NEVER, "PDP authentication failure"},
+    {150, NEVER, "invalid mobile class"},
+    {550, BOFF, "unknown error"},
+    {551, IMM, "operation blocked"},
+    {552, NEVER, "invalid parameters"},
+    {553, BOFF, "memory not enough"},
+    {554, BOFF, "create socket failed"},
+    {555, NEVER, "operation not supported"},
+    {556, BOFF, "socket bind failed"},
+    {557, BOFF, "socket listen failed"},
+    {558, BOFF, "socket write failed"},
+    {559, BOFF, "socket read failed"},
+    {560, BOFF, "socket accept failed"},
+    {561, BOFF, "open PDP context failed"},
+    {562, BOFF, "close PDP context failed"},
+    {563, IMM, "socket identity has been used"},
+    {564, IMM, "DNS busy"},
+    {565, BOFF, "DNS parse failed"},
+    {566, BOFF, "socket connect failed"},
+    {567, BOFF, "socket has been closed"},
+    {568, IMM, "operation busy"},
+    {569, BOFF, "operation timeout"},
+    {570, BOFF, "PDP context broken down"},
+    {571, NEVER, "cancel send"},
+    {572, NEVER, "operation not allowed"},
+    {573, NEVER, "APN not configured"},
+    {574, BOFF, "port busy"},
+};
+
+static const at_error_entry_t cms_errors[] = {
+    {300, BOFF, "ME failure"},
+    {301, NEVER, "SMS ME reserved"},
+    {302, NEVER, "operation not allowed"},
+    {303, NEVER, "operation not supported"},
+    {304, NEVER, "invalid PDU mode"},
+    {305, NEVER, "invalid text mode"},
+    {310, NEVER, "SIM not inserted"},
+    {311, NEVER, "SIM pin necessary"},
+    {312, NEVER, "PH SIM pin necessary"},
+    {313, BOFF, "SIM failure"},
+    {314, IMM, "SIM busy"},
+    {315, NEVER, "SIM wrong"},
+    {316, NEVER, "SIM PUK required"},
+    {320, BOFF, "memory failure"},
+    {321, NEVER, "invalid memory index"},
+    {322, NEVER, "memory full"},
+    {330, NEVER, "SMSC address unknown"},
+    {331, BOFF, "no network"},
+    {332, BOFF, "network timeout"},
+    {500, BOFF, "unknown"},
+};
+
+#undef IMM
+#undef BOFF
+#undef NEVER
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+static int compare_entry(const void* key, const void* entry)
+{
+  return (int) *(const uint16_t*) key - (int) ((const at_error_entry_t*) entry)->code;
+}
+
+static const at_error_entry_t* table_for(bg95_at_error_kind_t kind, size_t* count)
+{
+  switch (kind)
+  {
+    case BG95_AT_ERROR_CME:
+      *count = COUNT_OF(cme_errors);
+      return cme_errors;
+    case BG95_AT_ERROR_CMS:
+      *count = COUNT_OF(cms_errors);
+      return cms_errors;
+    default:
+      *count = 0;
+      return NULL;
+  }
+}
+
+static const at_error_entry_t* lookup_code(bg95_at_error_kind_t kind, int code)
+{
+  size_t                  count;
+  const at_error_entry_t* table = table_for(kind, &count);
+  if (table == NULL || code < 0 || code > UINT16_MAX)
+  {
+    return NULL;
+  }
+  uint16_t key = (uint16_t) code;
+  return bsearch(&key, table, count, sizeof(table[0]), compare_entry);
+}
+
+// Verbose reports only, so a linear scan is fine
+static const at_error_entry_t* lookup_text(bg95_at_error_kind_t kind, const char* text)
+{
+  size_t                  count;
+  const at_error_entry_t* table = table_for(kind, &count);
+  for (size_t i = 0; i < count; i++)
+  {
+    if (strcasecmp(table[i].text, text) == 0)
+    {
+      return &table[i];
+    }
+  }
+  return NULL;
+}
+
+bg95_at_retry_t bg95_at_error_retry_class(bg95_at_error_kind_t kind, int code)
+{
+  const at_error_entry_t* entry = lookup_code(kind, code);
+  return entry != NULL ? (bg95_at_retry_t) entry->retry : BG95_AT_RETRY_BACKOFF;
+}
+
+bool bg95_at_error_parse_line(const char* line, bg95_at_error_t* error)
+{
+  if (line == NULL || error == NULL)
+  {
+    return false;
+  }
+
+  error->kind  = BG95_AT_ERROR_NONE;
+  error->code  = -1;
+  error->retry = BG95_AT_RETRY_BACKOFF;
+
+  if (strcmp(line, "ERROR") == 0)
+  {
+    error->kind = BG95_AT_ERROR_GENERIC;
+    return true;
+  }
+
+  if (strncmp(line, "+CME ERROR:", 11) == 0)
+  {
+    error->kind = BG95_AT_ERROR_CME;
+  }
+  else if (strncmp(line, "+CMS ERROR:", 11) == 0)
+  {
+    error->kind = BG95_AT_ERROR_CMS;
+  }
+  else
+  {
+    return false;
+  }
+
+  const char* value = line + 11;
+  while (*value == ' ')
+  {
+    value++;
+  }
+
+  const at_error_entry_t* entry = NULL;
+  if (isdigit((unsigned char) *value))
+  {
+    error->code = (int) strtol(value, NULL, 10);
+    entry       = lookup_code(error->kind, error->code);
+  }
+  else
+  {
+    entry = lookup_text(error->kind, value);
+    if (entry != NULL)
+    {
+      error->code = entry->code;
+    }
+  }
+  if (entry != NULL)
+  {
+    error->retry = (bg95_at_retry_t) entry->retry;
+  }
+  return true;
+}
+
+bool bg95_at_error_parse(const char* response, bg95_at_error_t* error)
+{
+  if (error == NULL)
+  {
+    return false;
+  }
+
+  error->kind  = BG95_AT_ERROR_NONE;
+  error->code  = -1;
+  error->retry = BG95_AT_RETRY_BACKOFF;
+  if (response == NULL)
+  {
+    return false;
+  }
+
+  char        line[64];
+  const char* start = response;
+  const char* eol;
+  while ((eol = strstr(start, "\r\n")) != NULL)
+  {
+    size_t len = (size_t) (eol - start);
+    if (len > 0 && len < sizeof(line))
+    {
+      memcpy(line, start, len);
+      line[len] = '\0';
+      if (bg95_at_error_parse_line(line, error))
+      {
+        return true;
+      }
+    }
+    start = eol + 2;
+  }
+
+  // ATV0: any numeric final but 0 is an error without further detail
+  int code;
+  if (bg95_raw_at_has_numeric_result(response, strlen(response), &code) &&
+      code != BG95_RAW_AT_NUMERIC_OK)
+  {
+    error->kind = BG95_AT_ERROR_GENERIC;
+    return true;
+  }
+  return false;
+}
+
+const char* bg95_at_error_to_str(const bg95_at_error_t* error)
+{
+  if (error == NULL || error->kind == BG95_AT_ERROR_NONE)
+  {
+    return "no error";
+  }
+  if (error->kind == BG95_AT_ERROR_GENERIC)
+  {
+    return "error";
+  }
+  const at_error_entry_t* entry = lookup_code(error->kind, error->code);
+  return entry != NULL ? entry->text : "unknown";
+}
+
+const char* bg95_at_retry_to_str(bg95_at_retry_t retry)
+{
+  switch (retry)
+  {
+    case BG95_AT_RETRY_IMMEDIATE:
+      return "IMMEDIATE";
+    case BG95_AT_RETRY_BACKOFF:
+      return "BACKOFF";
+    case BG95_AT_RETRY_NEVER:
+      return "NEVER";
+    default:
+      return "UNKNOWN";
+  }
+}
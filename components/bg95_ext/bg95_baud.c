@@ -0,0 +1,339 @@
+#include "bg95_baud.h"
+
+#include "bg95_raw_at.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "BG95_BAUD";
+
+// Fastest first, the default rate is the last resort when hunting
+static const uint32_t BAUD_RATES[] = {921600, 460800, 230400, BG95_BAUD_DEFAULT};
+
+#define BAUD_RATES_COUNT (sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]))
+#define BAUD_DRAIN_MS 10
+#define BAUD_DRAIN_MAX_READS 8
+
+static esp_err_t metered_write(const char* data, size_t len, void* context)
+{
+  bg95_baud_t* link = (bg95_baud_t*) context;
+
+  esp_err_t err = link->phys->write(data, len, link->phys->context);
+  if (err == ESP_OK)
+  {
+    link->stats.bytes_tx += len;
+  }
+  return err;
+}
+
+static esp_err_t metered_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  bg95_baud_t* link = (bg95_baud_t*) context;
+
+  esp_err_t err = link->phys->read(data, max_len, bytes_read, timeout_ms, link->phys->context);
+  link->stats.bytes_rx += *bytes_read;
+  return err;
+}
+
+// Drop whatever arrived garbled around a rate change
+static void drain_input(bg95_baud_t* link)
+{
+  char buf[64];
+  for (int i = 0; i < BAUD_DRAIN_MAX_READS; i++)
+  {
+    size_t bytes_read = 0;
+    link->phys->read(buf, sizeof(buf), &bytes_read, BAUD_DRAIN_MS, link->phys->context);
+    if (bytes_read == 0)
+    {
+      return;
+    }
+  }
+}
+
+static bool probe_once(bg95_baud_t* link)
+{
+  char response[32];
+  if (bg95_raw_at_send(
+          link->phys, "AT", response, sizeof(response), BG95_BAUD_PROBE_TIMEOUT_MS) == ESP_OK)
+  {
+    return true;
+  }
+  link->stats.probe_failures++;
+  return false;
+}
+
+esp_err_t bg95_baud_probe(bg95_baud_t* link)
+{
+  if (link == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (int i = 0; i < BG95_BAUD_PROBE_COUNT; i++)
+  {
+    if (!probe_once(link))
+    {
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+  }
+  return ESP_OK;
+}
+
+static esp_err_t set_host_baud(bg95_baud_t* link, uint32_t baud)
+{
+  esp_err_t err = link->set_baud(baud, link->set_baud_ctx);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Host UART refused %lu baud: %s", (unsigned long) baud, esp_err_to_name(err));
+    return err;
+  }
+  drain_input(link);
+  return ESP_OK;
+}
+
+static esp_err_t store_baud(uint32_t baud)
+{
+  nvs_handle_t nvs;
+  esp_err_t    err = nvs_open(BG95_BAUD_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  uint32_t stored = 0;
+  if (nvs_get_u32(nvs, BG95_BAUD_NVS_KEY, &stored) != ESP_OK || stored != baud)
+  {
+    err = nvs_set_u32(nvs, BG95_BAUD_NVS_KEY, baud);
+    if (err == ESP_OK)
+    {
+      err = nvs_commit(nvs);
+    }
+  }
+  nvs_close(nvs);
+  return err;
+}
+
+static bool load_baud(uint32_t* baud)
+{
+  nvs_handle_t nvs;
+  if (nvs_open(BG95_BAUD_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+  {
+    return false;
+  }
+  esp_err_t err = nvs_get_u32(nvs, BG95_BAUD_NVS_KEY, baud);
+  nvs_close(nvs);
+  return err == ESP_OK;
+}
+
+// Link lost: try every known rate on the host side until the modem passes the full probe, except
+// 'skip_baud' (0 for none) that just failed it. The rate found is stored for the next boot.
+static esp_err_t hunt(bg95_baud_t* link, uint32_t skip_baud)
+{
+  link->stats.hunts++;
+  ESP_LOGW(TAG, "Modem not answering at %lu baud, hunting", (unsigned long) link->stats.baud);
+
+  for (size_t i = 0; i < BAUD_RATES_COUNT; i++)
+  {
+    if (BAUD_RATES[i] == skip_baud)
+    {
+      continue;
+    }
+    if (set_host_baud(link, BAUD_RATES[i]) == ESP_OK && bg95_baud_probe(link) == ESP_OK)
+    {
+      link->stats.baud = BAUD_RATES[i];
+      ESP_LOGI(TAG, "Modem found at %lu baud", (unsigned long) BAUD_RATES[i]);
+      esp_err_t err = store_baud(BAUD_RATES[i]);
+      if (err != ESP_OK)
+      {
+        ESP_LOGW(TAG, "Failed to store baud rate: %s", esp_err_to_name(err));
+      }
+      return ESP_OK;
+    }
+  }
+
+  ESP_LOGE(TAG, "Modem not found at any rate");
+  return ESP_ERR_NOT_FOUND;
+}
+
+// Ask the modem for 'baud' with AT+IPR, follow on the host side and probe
+static esp_err_t switch_rate(bg95_baud_t* link, uint32_t baud)
+{
+  uint32_t old_baud = link->stats.baud;
+  char     cmd[32];
+  char     response[64];
+
+  snprintf(cmd, sizeof(cmd), "AT+IPR=%lu;&W", (unsigned long) baud);
+  esp_err_t err =
+      bg95_raw_at_send(link->phys, cmd, response, sizeof(response), BG95_BAUD_CMD_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Modem refused %s: %s", cmd, esp_err_to_name(err));
+    return err; // Still at the old rate
+  }
+
+  vTaskDelay(pdMS_TO_TICKS(BG95_BAUD_SWITCH_DELAY_MS));
+  if (set_host_baud(link, baud) == ESP_OK && bg95_baud_probe(link) == ESP_OK)
+  {
+    link->stats.baud = baud;
+    link->stats.negotiations++;
+    ESP_LOGI(TAG, "Link running at %lu baud", (unsigned long) baud);
+    return ESP_OK;
+  }
+
+  // The modem may have switched while the line does not carry the rate, take it back
+  link->stats.fallbacks++;
+  ESP_LOGW(TAG,
+           "Probe failed at %lu baud, falling back to %lu",
+           (unsigned long) baud,
+           (unsigned long) old_baud);
+
+  snprintf(cmd, sizeof(cmd), "AT+IPR=%lu;&W", (unsigned long) old_baud);
+  for (int i = 0; i < BG95_BAUD_PROBE_COUNT; i++)
+  {
+    // A marginal line still lets some commands through
+    if (bg95_raw_at_send(
+            link->phys, cmd, response, sizeof(response), BG95_BAUD_PROBE_TIMEOUT_MS) == ESP_OK)
+    {
+      break;
+    }
+  }
+  vTaskDelay(pdMS_TO_TICKS(BG95_BAUD_SWITCH_DELAY_MS));
+
+  if (set_host_baud(link, old_baud) == ESP_OK && probe_once(link))
+  {
+    link->stats.baud = old_baud;
+  }
+  else if (hunt(link, baud) != ESP_OK)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  return ESP_ERR_INVALID_RESPONSE;
+}
+
+esp_err_t bg95_baud_init(bg95_baud_t*           link,
+                         bg95_uart_interface_t* phys,
+                         uint32_t               initial_baud,
+                         bg95_baud_set_fn_t     set_baud,
+                         void*                  set_baud_ctx)
+{
+  if (link == NULL || phys == NULL || phys->write == NULL || phys->read == NULL ||
+      set_baud == NULL || initial_baud == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(link, 0, sizeof(*link));
+  link->phys           = phys;
+  link->set_baud       = set_baud;
+  link->set_baud_ctx   = set_baud_ctx;
+  link->stats.baud     = initial_baud;
+  link->stats.since_us = esp_timer_get_time();
+
+  link->uart.write   = metered_write;
+  link->uart.read    = metered_read;
+  link->uart.context = link;
+  return ESP_OK;
+}
+
+esp_err_t bg95_baud_sync(bg95_baud_t* link)
+{
+  if (link == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  uint32_t stored = 0;
+  if (load_baud(&stored) && stored != link->stats.baud && set_host_baud(link, stored) == ESP_OK)
+  {
+    link->stats.baud = stored;
+  }
+
+  if (probe_once(link))
+  {
+    return ESP_OK;
+  }
+
+  return hunt(link, 0);
+}
+
+esp_err_t bg95_baud_negotiate(bg95_baud_t* link, uint32_t target_baud)
+{
+  if (link == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (size_t i = 0; i < BAUD_RATES_COUNT; i++)
+  {
+    uint32_t baud = BAUD_RATES[i];
+    if (baud > target_baud || baud <= link->stats.baud)
+    {
+      continue;
+    }
+
+    esp_err_t err = switch_rate(link, baud);
+    if (err == ESP_OK)
+    {
+      err = store_baud(baud);
+      if (err != ESP_OK)
+      {
+        ESP_LOGW(TAG, "Failed to store baud rate: %s", esp_err_to_name(err));
+      }
+      bg95_baud_reset_counters(link);
+      return ESP_OK;
+    }
+    if (err == ESP_ERR_NOT_FOUND)
+    {
+      return err; // Modem lost, do not try any further rates
+    }
+  }
+
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+uint32_t bg95_baud_throughput_bps(const bg95_baud_t* link, int64_t now_us)
+{
+  if (link == NULL || now_us <= link->stats.since_us)
+  {
+    return 0;
+  }
+
+  uint64_t bits = (link->stats.bytes_tx + link->stats.bytes_rx) * 8;
+  return (uint32_t) (bits * 1000000ULL / (uint64_t) (now_us - link->stats.since_us));
+}
+
+void bg95_baud_reset_counters(bg95_baud_t* link)
+{
+  if (link == NULL)
+  {
+    return;
+  }
+  link->stats.bytes_tx = 0;
+  link->stats.bytes_rx = 0;
+  link->stats.since_us = esp_timer_get_time();
+}
+
+void bg95_baud_log_stats(const bg95_baud_t* link)
+{
+  if (link == NULL)
+  {
+    return;
+  }
+  ESP_LOGI(TAG,
+           "%lu baud, %lu bps effective, tx=%llu rx=%llu, negotiations=%lu fallbacks=%lu "
+           "hunts=%lu probe_failures=%lu",
+           (unsigned long) link->stats.baud,
+           (unsigned long) bg95_baud_throughput_bps(link, esp_timer_get_time()),
+           (unsigned long long) link->stats.bytes_tx,
+           (unsigned long long) link->stats.bytes_rx,
+           (unsigned long) link->stats.negotiations,
+           (unsigned long) link->stats.fallbacks,
+           (unsigned long) link->stats.hunts,
+           (unsigned long) link->stats.probe_failures);
+}
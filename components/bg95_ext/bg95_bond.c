@@ -0,0 +1,601 @@
+#include "bg95_bond.h"
+
+#include "bg95_publish.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "BG95_BOND";
+
+// ----------- Link selection (bond lock held) -------------------
+
+static int quality_weight(int quality)
+{
+  if (quality < 0 || quality > 31)
+  {
+    return 16; // Unknown, rank it like a middling signal
+  }
+  return quality + 1;
+}
+
+static size_t depth(const bg95_bond_link_t* link)
+{
+  return link->count + (link->in_flight >= 0 ? 1 : 0);
+}
+
+// Up link with the lowest (depth + 1) / weight, NULL when none is up
+static bg95_bond_link_t* pick_link(bg95_bond_t* bond)
+{
+  bg95_bond_link_t* best = NULL;
+
+  for (size_t i = 0; i < bond->num_links; i++)
+  {
+    bg95_bond_link_t* link = &bond->links[i];
+    if (!link->up)
+    {
+      continue;
+    }
+    if (best == NULL)
+    {
+      best = link;
+      continue;
+    }
+
+    // Cross-multiplied to stay in integers
+    uint32_t cost      = (uint32_t) (depth(link) + 1) * quality_weight(best->quality);
+    uint32_t best_cost = (uint32_t) (depth(best) + 1) * quality_weight(link->quality);
+    if (cost < best_cost ||
+        (cost == best_cost && quality_weight(link->quality) > quality_weight(best->quality)))
+    {
+      best = link;
+    }
+  }
+  return best;
+}
+
+static int64_t deadline_key(const bg95_bond_msg_t* msg)
+{
+  return msg->deadline_us == BG95_BOND_NO_DEADLINE ? INT64_MAX : msg->deadline_us;
+}
+
+static bool expired(const bg95_bond_msg_t* msg, int64_t now_us)
+{
+  return msg->deadline_us != BG95_BOND_NO_DEADLINE && now_us >= msg->deadline_us;
+}
+
+static uint8_t* queue_at(bg95_bond_link_t* link, size_t pos)
+{
+  return &link->queue[(link->head + pos) % BG95_BOND_MAX_MSGS];
+}
+
+// Behind every queued message due no later, so equal deadlines keep their arrival order
+static void push_ordered(bg95_bond_t* bond, bg95_bond_link_t* link, int msg)
+{
+  int64_t key = deadline_key(&bond->msgs[msg]);
+  size_t  pos = link->count;
+
+  while (pos > 0 && deadline_key(&bond->msgs[*queue_at(link, pos - 1)]) > key)
+  {
+    *queue_at(link, pos) = *queue_at(link, pos - 1);
+    pos--;
+  }
+  *queue_at(link, pos) = (uint8_t) msg;
+  link->count++;
+  xSemaphoreGive(link->wake);
+}
+
+static void push_front(bg95_bond_link_t* link, int msg)
+{
+  link->head              = (link->head + BG95_BOND_MAX_MSGS - 1) % BG95_BOND_MAX_MSGS;
+  link->queue[link->head] = (uint8_t) msg;
+  link->count++;
+  xSemaphoreGive(link->wake);
+}
+
+static int pop_front(bg95_bond_link_t* link)
+{
+  int msg    = link->queue[link->head];
+  link->head = (link->head + 1) % BG95_BOND_MAX_MSGS;
+  link->count--;
+  return msg;
+}
+
+// Hand the queue of a down link to the links that are up, oldest first
+static void move_queue(bg95_bond_t* bond, bg95_bond_link_t* from)
+{
+  while (from->count > 0)
+  {
+    bg95_bond_link_t* to = pick_link(bond);
+    if (to == NULL)
+    {
+      return; // Stays here until some link comes up
+    }
+    push_ordered(bond, to, pop_front(from));
+    from->stats.failovers++;
+  }
+}
+
+static void set_down(bg95_bond_t* bond, bg95_bond_link_t* link)
+{
+  if (!link->up)
+  {
+    return;
+  }
+  link->up = false;
+  link->stats.downs++;
+  ESP_LOGW(TAG, "Link %d down, moving %u queued messages", link->index, (unsigned) link->count);
+  move_queue(bond, link);
+}
+
+static void set_up(bg95_bond_t* bond, bg95_bond_link_t* link)
+{
+  if (link->up)
+  {
+    return;
+  }
+  link->up              = true;
+  link->failures_in_row = 0;
+  ESP_LOGI(TAG, "Link %d up", link->index);
+
+  // Messages left behind while no link was up
+  for (size_t i = 0; i < bond->num_links; i++)
+  {
+    if (!bond->links[i].up)
+    {
+      move_queue(bond, &bond->links[i]);
+    }
+  }
+  xSemaphoreGive(link->wake);
+}
+
+static void release(bg95_bond_t* bond, int msg)
+{
+  bond->used[msg] = false;
+  bond->pending--;
+  if (bond->pending == 0)
+  {
+    xSemaphoreGive(bond->idle);
+  }
+}
+
+// Release every queued message past its deadline, in flight ones finish their attempt
+static size_t drop_expired(bg95_bond_t* bond, int64_t now_us)
+{
+  size_t dropped = 0;
+
+  for (size_t i = 0; i < bond->num_links; i++)
+  {
+    bg95_bond_link_t* link = &bond->links[i];
+    size_t            kept = 0;
+    for (size_t pos = 0; pos < link->count; pos++)
+    {
+      int msg = *queue_at(link, pos);
+      if (expired(&bond->msgs[msg], now_us))
+      {
+        release(bond, msg);
+        dropped++;
+      }
+      else
+      {
+        *queue_at(link, kept++) = (uint8_t) msg;
+      }
+    }
+    link->count = kept;
+  }
+  bond->expired += dropped;
+  return dropped;
+}
+
+// ----------- Workers -------------------
+
+// The modem answered but refused this particular message, retrying it anywhere is pointless
+static bool is_rejection(esp_err_t err)
+{
+  return err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE;
+}
+
+static esp_err_t driver_publish(const bg95_bond_msg_t* msg, void* ctx)
+{
+  bg95_bond_link_t* link = (bg95_bond_link_t*) ctx;
+
+  return bg95_publish_fixed_length(link->config.handle,
+                                   link->config.sched,
+                                   link->config.rtt,
+                                   msg->deadline_us,
+                                   link->config.client_idx,
+                                   &link->next_msgid,
+                                   msg->qos,
+                                   msg->retain,
+                                   msg->topic,
+                                   msg->payload,
+                                   msg->len);
+}
+
+static void publish_one(bg95_bond_t* bond, bg95_bond_link_t* link, int msg)
+{
+  bg95_bond_publish_fn_t publish = link->config.publish ? link->config.publish : driver_publish;
+  void*                  ctx     = link->config.publish ? link->config.publish_ctx : link;
+
+  // The pool slot stays in use while in flight, no copy needed
+  esp_err_t err = publish(&bond->msgs[msg], ctx);
+
+  xSemaphoreTake(bond->lock, portMAX_DELAY);
+  link->in_flight = -1;
+  if (err == ESP_OK)
+  {
+    link->stats.published++;
+    link->failures_in_row = 0;
+    release(bond, msg);
+    xSemaphoreGive(bond->lock);
+    return;
+  }
+
+  // Ran out of time, e.g. queued behind other work on the modem, not the link's fault
+  if (err == ESP_ERR_TIMEOUT && expired(&bond->msgs[msg], esp_timer_get_time()))
+  {
+    bond->expired++;
+    release(bond, msg);
+    xSemaphoreGive(bond->lock);
+    return;
+  }
+
+  if (is_rejection(err))
+  {
+    ESP_LOGW(TAG, "Link %d rejected a message: %s", link->index, esp_err_to_name(err));
+    link->stats.rejected++;
+    bond->failed++;
+    release(bond, msg);
+    xSemaphoreGive(bond->lock);
+    return;
+  }
+
+  link->stats.failures++;
+  if (++link->failures_in_row >= BG95_BOND_LINK_DOWN_FAILURES)
+  {
+    set_down(bond, link);
+  }
+  if (++bond->msgs[msg].attempts >= BG95_BOND_MAX_ATTEMPTS)
+  {
+    ESP_LOGW(TAG, "Giving up on a message after %u attempts", (unsigned) BG95_BOND_MAX_ATTEMPTS);
+    bond->failed++;
+    release(bond, msg);
+    xSemaphoreGive(bond->lock);
+    return;
+  }
+
+  // Back to the head of the best queue, this link's own one if it is the only one left
+  bg95_bond_link_t* to = pick_link(bond);
+  if (to == NULL)
+  {
+    to = link;
+  }
+  if (to != link)
+  {
+    link->stats.failovers++;
+  }
+  push_front(to, msg);
+  xSemaphoreGive(bond->lock);
+
+  if (to == link && link->up)
+  {
+    vTaskDelay(pdMS_TO_TICKS(BG95_BOND_POLL_MS)); // Don't hammer a struggling modem
+  }
+}
+
+static void bond_link_task(void* pvParameters)
+{
+  bg95_bond_link_t* link = (bg95_bond_link_t*) pvParameters;
+  bg95_bond_t*      bond = link->bond;
+
+  while (bond->running)
+  {
+    xSemaphoreTake(link->wake, pdMS_TO_TICKS(BG95_BOND_POLL_MS));
+
+    for (;;)
+    {
+      xSemaphoreTake(bond->lock, portMAX_DELAY);
+      if (!bond->running || !link->up || link->count == 0)
+      {
+        xSemaphoreGive(bond->lock);
+        break;
+      }
+      int msg = pop_front(link);
+      if (expired(&bond->msgs[msg], esp_timer_get_time()))
+      {
+        // Too late to be useful, the modem never sees it
+        bond->expired++;
+        release(bond, msg);
+        xSemaphoreGive(bond->lock);
+        continue;
+      }
+      link->in_flight = msg;
+      xSemaphoreGive(bond->lock);
+
+      publish_one(bond, link, msg);
+    }
+  }
+
+  xSemaphoreGive(link->stopped);
+  vTaskDelete(NULL);
+}
+
+// ----------- API -------------------
+
+esp_err_t bg95_bond_init(bg95_bond_t*                   bond,
+                         const bg95_bond_link_config_t* links,
+                         size_t                         num_links)
+{
+  if (bond == NULL || links == NULL || num_links == 0 || num_links > BG95_BOND_MAX_LINKS)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (size_t i = 0; i < num_links; i++)
+  {
+    if (links[i].publish == NULL && links[i].handle == NULL)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+  }
+
+  memset(bond, 0, sizeof(*bond));
+  bond->lock = xSemaphoreCreateMutex();
+  bond->idle = xSemaphoreCreateBinary();
+  if (bond->lock == NULL || bond->idle == NULL)
+  {
+    bg95_bond_deinit(bond);
+    return ESP_ERR_NO_MEM;
+  }
+
+  const bg95_task_config_t task_config = {
+      .stack_size = BG95_BOND_TASK_STACK_SIZE,
+      .priority   = BG95_BOND_TASK_PRIORITY,
+      .core       = BG95_BOND_TASK_CORE,
+  };
+
+  bond->running = true;
+  for (size_t i = 0; i < num_links; i++)
+  {
+    bg95_bond_link_t* link = &bond->links[i];
+    link->bond             = bond;
+    link->index            = (int) i;
+    link->config           = links[i];
+    link->up               = true;
+    link->quality          = BG95_BOND_QUALITY_UNKNOWN;
+    link->in_flight        = -1;
+    link->wake             = xSemaphoreCreateBinary();
+    link->stopped          = xSemaphoreCreateBinary();
+    if (link->wake == NULL || link->stopped == NULL)
+    {
+      bg95_bond_deinit(bond);
+      return ESP_ERR_NO_MEM;
+    }
+
+    char name[16];
+    snprintf(name, sizeof(name), "bg95_bond_%d", (int) i);
+    if (bg95_task_create(bond_link_task, name, &task_config, link, &link->task) != pdPASS)
+    {
+      ESP_LOGE(TAG, "Failed to create worker for link %d", (int) i);
+      link->task = NULL;
+      bg95_bond_deinit(bond);
+      return ESP_ERR_NO_MEM;
+    }
+    bond->num_links++; // Only links with a running worker, deinit waits for these
+  }
+
+  return ESP_OK;
+}
+
+void bg95_bond_deinit(bg95_bond_t* bond)
+{
+  if (bond == NULL)
+  {
+    return;
+  }
+
+  bond->running = false;
+  for (size_t i = 0; i < bond->num_links; i++)
+  {
+    xSemaphoreGive(bond->links[i].wake);
+    xSemaphoreTake(bond->links[i].stopped, portMAX_DELAY);
+  }
+  for (size_t i = 0; i < BG95_BOND_MAX_LINKS; i++)
+  {
+    if (bond->links[i].wake != NULL)
+    {
+      vSemaphoreDelete(bond->links[i].wake);
+    }
+    if (bond->links[i].stopped != NULL)
+    {
+      vSemaphoreDelete(bond->links[i].stopped);
+    }
+  }
+  if (bond->lock != NULL)
+  {
+    vSemaphoreDelete(bond->lock);
+  }
+  if (bond->idle != NULL)
+  {
+    vSemaphoreDelete(bond->idle);
+  }
+  memset(bond, 0, sizeof(*bond));
+}
+
+esp_err_t bg95_bond_publish(bg95_bond_t*    bond,
+                            const char*     topic,
+                            const char*     payload,
+                            size_t          len,
+                            qmtpub_qos_t    qos,
+                            qmtpub_retain_t retain)
+{
+  return bg95_bond_publish_by(bond, topic, payload, len, qos, retain, BG95_BOND_NO_DEADLINE);
+}
+
+esp_err_t bg95_bond_publish_by(bg95_bond_t*    bond,
+                               const char*     topic,
+                               const char*     payload,
+                               size_t          len,
+                               qmtpub_qos_t    qos,
+                               qmtpub_retain_t retain,
+                               int64_t         deadline_us)
+{
+  if (bond == NULL || bond->lock == NULL || topic == NULL || (payload == NULL && len > 0))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (strlen(topic) >= BG95_BOND_TOPIC_MAX_LEN || len > BG95_BOND_PAYLOAD_MAX_LEN)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  int64_t now_us = esp_timer_get_time();
+  xSemaphoreTake(bond->lock, portMAX_DELAY);
+  if (deadline_us != BG95_BOND_NO_DEADLINE && now_us >= deadline_us)
+  {
+    bond->expired++;
+    xSemaphoreGive(bond->lock);
+    return ESP_ERR_TIMEOUT;
+  }
+
+  int slot = -1;
+  for (int attempt = 0; attempt < 2 && slot < 0; attempt++)
+  {
+    // Make room from expired messages before turning the caller away
+    if (attempt == 1 && drop_expired(bond, now_us) == 0)
+    {
+      break;
+    }
+    for (int i = 0; i < BG95_BOND_MAX_MSGS; i++)
+    {
+      if (!bond->used[i])
+      {
+        slot = i;
+        break;
+      }
+    }
+  }
+  if (slot < 0)
+  {
+    xSemaphoreGive(bond->lock);
+    return ESP_ERR_NO_MEM;
+  }
+
+  bg95_bond_msg_t* msg = &bond->msgs[slot];
+  strcpy(msg->topic, topic);
+  if (len > 0)
+  {
+    memcpy(msg->payload, payload, len);
+  }
+  msg->len         = len;
+  msg->qos         = qos;
+  msg->retain      = retain;
+  msg->attempts    = 0;
+  msg->deadline_us = deadline_us;
+  bond->used[slot] = true;
+  if (bond->pending++ == 0)
+  {
+    xSemaphoreTake(bond->idle, 0); // Drop a stale idle signal from the previous burst
+  }
+
+  // With every link down the message waits on the first one until a link comes up
+  bg95_bond_link_t* link = pick_link(bond);
+  push_ordered(bond, link != NULL ? link : &bond->links[0], slot);
+  xSemaphoreGive(bond->lock);
+  return ESP_OK;
+}
+
+esp_err_t bg95_bond_set_link_up(bg95_bond_t* bond, int link, bool up)
+{
+  if (bond == NULL || link < 0 || (size_t) link >= bond->num_links)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(bond->lock, portMAX_DELAY);
+  if (up)
+  {
+    set_up(bond, &bond->links[link]);
+  }
+  else
+  {
+    set_down(bond, &bond->links[link]);
+  }
+  xSemaphoreGive(bond->lock);
+  return ESP_OK;
+}
+
+esp_err_t bg95_bond_set_quality(bg95_bond_t* bond, int link, int csq_rssi)
+{
+  if (bond == NULL || link < 0 || (size_t) link >= bond->num_links)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(bond->lock, portMAX_DELAY);
+  bond->links[link].quality =
+      csq_rssi >= 0 && csq_rssi <= 31 ? csq_rssi : BG95_BOND_QUALITY_UNKNOWN;
+  xSemaphoreGive(bond->lock);
+  return ESP_OK;
+}
+
+size_t bg95_bond_link_depth(bg95_bond_t* bond, int link)
+{
+  if (bond == NULL || link < 0 || (size_t) link >= bond->num_links)
+  {
+    return 0;
+  }
+
+  xSemaphoreTake(bond->lock, portMAX_DELAY);
+  size_t result = depth(&bond->links[link]);
+  xSemaphoreGive(bond->lock);
+  return result;
+}
+
+esp_err_t bg95_bond_wait_idle(bg95_bond_t* bond, uint32_t timeout_ms)
+{
+  if (bond == NULL || bond->lock == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  TickType_t start = xTaskGetTickCount();
+  TickType_t limit = pdMS_TO_TICKS(timeout_ms);
+  for (;;)
+  {
+    xSemaphoreTake(bond->lock, portMAX_DELAY);
+    bool idle = bond->pending == 0;
+    xSemaphoreGive(bond->lock);
+    if (idle)
+    {
+      return ESP_OK;
+    }
+
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed >= limit)
+    {
+      return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreTake(bond->idle, limit - elapsed);
+  }
+}
+
+void bg95_bond_urc_handler(const char* line, bool solicited, void* ctx)
+{
+  bg95_bond_link_t* link       = (bg95_bond_link_t*) ctx;
+  int               client_idx = -1;
+
+  if (solicited || link == NULL || strncmp(line, "+QMTSTAT:", 9) != 0)
+  {
+    return;
+  }
+  if (sscanf(line + 9, "%d", &client_idx) != 1 || client_idx != link->config.client_idx)
+  {
+    return;
+  }
+
+  xSemaphoreTake(link->bond->lock, portMAX_DELAY);
+  set_down(link->bond, link);
+  xSemaphoreGive(link->bond->lock);
+}
@@ -0,0 +1,325 @@
+#include "bg95_boot.h"
+
+#include "bg95_reconnect.h"
+#include "bg95_status.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "BG95_BOOT";
+
+static const char* const PHASE_NAMES[BG95_BOOT_PHASE_MAX] = {
+    [BG95_BOOT_PHASE_UART]          = "uart",
+    [BG95_BOOT_PHASE_DRIVER_INIT]   = "driver_init",
+    [BG95_BOOT_PHASE_URC_SETUP]     = "urc_setup",
+    [BG95_BOOT_PHASE_STATUS]        = "status",
+    [BG95_BOOT_PHASE_CONFIG]        = "config",
+    [BG95_BOOT_PHASE_ATTACH]        = "attach",
+    [BG95_BOOT_PHASE_PDP]           = "pdp",
+    [BG95_BOOT_PHASE_MQTT_OPEN]     = "mqtt_open",
+    [BG95_BOOT_PHASE_MQTT_CONNECT]  = "mqtt_connect",
+    [BG95_BOOT_PHASE_FIRST_PUBLISH] = "first_publish",
+};
+
+void bg95_boot_timing_init(bg95_boot_timing_t* timing)
+{
+  if (timing == NULL)
+  {
+    return;
+  }
+  memset(timing, 0, sizeof(*timing));
+  // Counting from 0 rather than now attributes everything before app_main to the first phase
+  timing->last_mark_us = 0;
+}
+
+void bg95_boot_mark(bg95_boot_timing_t* timing, bg95_boot_phase_t phase, bool skipped)
+{
+  if (timing == NULL || phase >= BG95_BOOT_PHASE_MAX)
+  {
+    return;
+  }
+
+  int64_t now_us          = esp_timer_get_time();
+  timing->phase_us[phase] = now_us - timing->last_mark_us;
+  timing->skipped[phase]  = skipped;
+  timing->done[phase]     = true;
+  timing->last_mark_us    = now_us;
+
+  if (phase == BG95_BOOT_PHASE_FIRST_PUBLISH)
+  {
+    timing->first_publish_us = now_us;
+  }
+}
+
+uint32_t bg95_boot_time_to_first_publish_ms(const bg95_boot_timing_t* timing)
+{
+  if (timing == NULL)
+  {
+    return 0;
+  }
+  return (uint32_t) (timing->first_publish_us / 1000);
+}
+
+// True when the snapshot shows 'client_idx' connected to the broker already, e.g. after an
+// ESP32 reset that left the modem up
+static bool mqtt_already_connected(const bg95_status_snapshot_t* snapshot, int client_idx)
+{
+  return snapshot->present.has_qmtconn && snapshot->qmtconn.client_idx == client_idx &&
+         snapshot->qmtconn.state == QMTCONN_STATE_CONNECTED;
+}
+
+static esp_err_t begin(const bg95_boot_config_t* config)
+{
+  if (config->sched == NULL)
+  {
+    return ESP_OK;
+  }
+  return bg95_sched_acquire(config->sched, BG95_SCHED_LANE_NORMAL, BG95_SCHED_WAIT_FOREVER);
+}
+
+static void end(const bg95_boot_config_t* config)
+{
+  if (config->sched != NULL)
+  {
+    bg95_sched_release(config->sched);
+  }
+}
+
+static void arm_result_wait(const bg95_boot_config_t* config, const char* prefix)
+{
+  if (config->urc_tap != NULL)
+  {
+    bg95_urc_tap_arm_wait(config->urc_tap, prefix);
+  }
+}
+
+// The modem takes the next MQTT command only once the result URC of the previous one is out.
+// Wakes on that URC (armed before the command) and stores its <result> in 'result'. False when
+// no URC came, which is not an error, the driver already saw the "OK".
+static bool wait_result(const bg95_boot_config_t* config, const char* prefix, int* result)
+{
+  char line[BG95_URC_TAP_LINE_MAX_LEN];
+
+  if (config->urc_tap == NULL)
+  {
+    return false;
+  }
+  if (bg95_urc_tap_wait(config->urc_tap, line, sizeof(line), config->result_timeout_ms) != ESP_OK)
+  {
+    ESP_LOGW(TAG, "No %s URC within %lu ms", prefix, (unsigned long) config->result_timeout_ms);
+    return false;
+  }
+
+  int client_idx = 0;
+  if (sscanf(line + strlen(prefix), "%d,%d", &client_idx, result) != 2)
+  {
+    return false;
+  }
+  if (*result != 0)
+  {
+    ESP_LOGW(TAG, "%s", line);
+  }
+  return true;
+}
+
+esp_err_t bg95_boot_run(const bg95_boot_config_t* config, bg95_boot_timing_t* timing)
+{
+  if (config == NULL || timing == NULL || config->handle == NULL || config->uart == NULL ||
+      config->net_reg == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // URC_SETUP: from here on attach and PDP changes arrive as events
+  esp_err_t err = begin(config);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  err = bg95_net_reg_enable_urcs(config->net_reg, config->uart);
+  end(config);
+  if (err != ESP_OK)
+  {
+    // Not fatal, the waits below just run into their timeouts instead of waking early
+    ESP_LOGW(TAG, "Registration URCs unavailable: %s", esp_err_to_name(err));
+  }
+  bg95_boot_mark(timing, BG95_BOOT_PHASE_URC_SETUP, false);
+
+  // STATUS: one round trip tells which of the remaining phases can be skipped
+  bg95_status_snapshot_t snapshot = {0};
+  err = bg95_status_snapshot_read(
+      config->uart, config->sched, config->cid, config->client_idx, &snapshot);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Status snapshot incomplete: %s", esp_err_to_name(err));
+  }
+  if (snapshot.present.has_cpin && snapshot.cpin.status != CPIN_STATUS_READY)
+  {
+    ESP_LOGE(TAG, "SIM not ready");
+    bg95_boot_mark(timing, BG95_BOOT_PHASE_STATUS, false);
+    return ESP_ERR_INVALID_STATE;
+  }
+  bool already_connected = mqtt_already_connected(&snapshot, config->client_idx);
+  if (snapshot.pdp_active)
+  {
+    bg95_net_reg_set_pdp_active(config->net_reg, true);
+  }
+  bg95_boot_mark(timing, BG95_BOOT_PHASE_STATUS, false);
+
+  // CONFIG: runs while the modem attaches on its own, nothing here needs the network
+  if (config->configure != NULL && !already_connected)
+  {
+    err = config->configure(config->configure_ctx);
+    if (err != ESP_OK)
+    {
+      ESP_LOGE(TAG, "Configuration failed: %s", esp_err_to_name(err));
+      bg95_boot_mark(timing, BG95_BOOT_PHASE_CONFIG, false);
+      return err;
+    }
+    bg95_boot_mark(timing, BG95_BOOT_PHASE_CONFIG, false);
+  }
+  else
+  {
+    bg95_boot_mark(timing, BG95_BOOT_PHASE_CONFIG, true);
+  }
+
+  // ATTACH: wake on the +CEREG/+CGREG URC instead of polling
+  bg95_net_reg_state_t state = {0};
+  bg95_net_reg_get_state(config->net_reg, &state);
+  bool attached = state.registered;
+  if (!attached)
+  {
+    err = bg95_net_reg_wait(
+        config->net_reg, BG95_NET_REG_REGISTERED_BIT, config->attach_timeout_ms);
+    if (err != ESP_OK)
+    {
+      // Let bg95_connect_to_network drive the attach, it has its own wait
+      ESP_LOGW(TAG, "No registration URC within %lu ms", (unsigned long) config->attach_timeout_ms);
+    }
+  }
+  bg95_boot_mark(timing, BG95_BOOT_PHASE_ATTACH, attached);
+
+  // PDP
+  bg95_net_reg_get_state(config->net_reg, &state);
+  if (state.pdp_active)
+  {
+    bg95_boot_mark(timing, BG95_BOOT_PHASE_PDP, true);
+  }
+  else
+  {
+    err = begin(config);
+    if (err == ESP_OK)
+    {
+      err = bg95_connect_to_network(config->handle);
+      end(config);
+    }
+    bg95_boot_mark(timing, BG95_BOOT_PHASE_PDP, false);
+    if (err != ESP_OK)
+    {
+      ESP_LOGE(TAG, "PDP activation failed: %s", esp_err_to_name(err));
+      return err;
+    }
+    bg95_net_reg_set_pdp_active(config->net_reg, true);
+  }
+
+  if (already_connected)
+  {
+    bg95_boot_mark(timing, BG95_BOOT_PHASE_MQTT_OPEN, true);
+    bg95_boot_mark(timing, BG95_BOOT_PHASE_MQTT_CONNECT, true);
+    return ESP_OK;
+  }
+
+  // MQTT_OPEN, the wait for the result URC counts towards the phase it follows
+  qmtopen_write_response_t open_response = {0};
+  int                      result        = 0;
+  err = begin(config);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  arm_result_wait(config, "+QMTOPEN:");
+  err = bg95_mqtt_open_network(
+      config->handle, config->client_idx, config->host, config->port, &open_response);
+  bool opened = bg95_reconnect_classify_qmtopen(err, &open_response) == BG95_RECONNECT_CLASS_NONE;
+  if (opened && !open_response.present.has_result && wait_result(config, "+QMTOPEN:", &result))
+  {
+    // Classified like a result the driver parsed, "+QMTOPEN: <idx>,2" means the client is open
+    open_response.result             = (qmtopen_result_t) result;
+    open_response.present.has_result = true;
+    opened = bg95_reconnect_classify_qmtopen(ESP_OK, &open_response) == BG95_RECONNECT_CLASS_NONE;
+    err    = opened ? ESP_OK : ESP_FAIL;
+  }
+  end(config);
+  bg95_boot_mark(timing, BG95_BOOT_PHASE_MQTT_OPEN, false);
+  if (!opened)
+  {
+    ESP_LOGE(TAG, "QMTOPEN failed: %s", esp_err_to_name(err));
+    return err != ESP_OK ? err : ESP_FAIL;
+  }
+
+  // MQTT_CONNECT
+  qmtconn_write_response_t conn_response = {0};
+  err = begin(config);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  arm_result_wait(config, "+QMTCONN:");
+  err = bg95_mqtt_connect(config->handle,
+                          config->client_idx,
+                          config->client_id,
+                          config->username,
+                          config->password,
+                          &conn_response);
+  bool connected = err == ESP_OK && (!conn_response.present.has_result ||
+                                     conn_response.result == QMTCONN_RESULT_SUCCESS);
+  if (connected && !conn_response.present.has_result && wait_result(config, "+QMTCONN:", &result))
+  {
+    connected = result == QMTCONN_RESULT_SUCCESS;
+    err       = connected ? ESP_OK : ESP_FAIL;
+  }
+  end(config);
+  bg95_boot_mark(timing, BG95_BOOT_PHASE_MQTT_CONNECT, false);
+  if (!connected)
+  {
+    ESP_LOGE(TAG, "QMTCONN failed: %s", esp_err_to_name(err));
+    return err != ESP_OK ? err : ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+void bg95_boot_log(const bg95_boot_timing_t* timing)
+{
+  if (timing == NULL)
+  {
+    return;
+  }
+
+  int64_t total_us = 0;
+  for (int phase = 0; phase < BG95_BOOT_PHASE_MAX; phase++)
+  {
+    if (!timing->done[phase])
+    {
+      continue;
+    }
+    total_us += timing->phase_us[phase];
+    ESP_LOGI(TAG,
+             "%-14s %7lu ms%s",
+             PHASE_NAMES[phase],
+             (unsigned long) (timing->phase_us[phase] / 1000),
+             timing->skipped[phase] ? " (skipped)" : "");
+  }
+  ESP_LOGI(TAG, "total          %7lu ms", (unsigned long) (total_us / 1000));
+}
+
+const char* bg95_boot_phase_to_str(bg95_boot_phase_t phase)
+{
+  if (phase >= BG95_BOOT_PHASE_MAX)
+  {
+    return "unknown";
+  }
+  return PHASE_NAMES[phase];
+}
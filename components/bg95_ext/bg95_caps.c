@@ -0,0 +1,258 @@
+#include "bg95_caps.h"
+
+#include "bg95_raw_at.h"
+
+#include <esp_log.h>
+#include <nvs.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "BG95_CAPS";
+
+// Used only until the modem has been probed, the driver's own parameter limits
+#define CAPS_FALLBACK_CLIENT_IDX_MIN QMTSUB_CLIENT_IDX_MIN
+#define CAPS_FALLBACK_CLIENT_IDX_MAX QMTSUB_CLIENT_IDX_MAX
+#define CAPS_FALLBACK_KEEPALIVE_MIN QMTCFG_KEEP_ALIVE_TIME_MIN
+#define CAPS_FALLBACK_KEEPALIVE_MAX QMTCFG_KEEP_ALIVE_TIME_MAX
+#define CAPS_FALLBACK_PDP_CID_MIN QMTCFG_PDP_CID_MIN
+#define CAPS_FALLBACK_PDP_CID_MAX QMTCFG_PDP_CID_MAX
+#define CAPS_FALLBACK_MSGID_MIN QMTSUB_MSGID_MIN
+#define CAPS_FALLBACK_MSGID_MAX QMTSUB_MSGID_MAX
+#define CAPS_FALLBACK_QOS_MIN QMTSUB_QOS_AT_MOST_ONCE
+#define CAPS_FALLBACK_QOS_MAX QMTSUB_QOS_EXACTLY_ONCE
+
+bool bg95_caps_is_valid(const bg95_caps_t* caps)
+{
+  return caps != NULL && caps->magic == BG95_CAPS_MAGIC &&
+         caps->version == BG95_CAPS_BLOB_VERSION && caps->size == sizeof(bg95_caps_t);
+}
+
+bool bg95_caps_is_complete(const bg95_caps_t* caps)
+{
+  return caps != NULL && caps->present.has_qmtcfg && caps->present.has_csq &&
+         caps->present.has_qmtsub && caps->present.has_qmtconn;
+}
+
+esp_err_t bg95_caps_read_fw_rev(bg95_uart_interface_t* uart, char* fw_rev, size_t fw_rev_size)
+{
+  if (uart == NULL || fw_rev == NULL || fw_rev_size == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  char      response[128];
+  esp_err_t err =
+      bg95_raw_at_send(uart, "AT+CGMR", response, sizeof(response), BG95_CAPS_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  // First line that is neither blank, the echo nor the final result code
+  const char* line = response;
+  const char* eol;
+  while ((eol = strstr(line, "\r\n")) != NULL)
+  {
+    size_t len = (size_t) (eol - line);
+    bool is_ok = len == 2 && strncmp(line, "OK", 2) == 0;
+    if (len > 0 && !is_ok && strncmp(line, "AT", 2) != 0)
+    {
+      if (len >= fw_rev_size)
+      {
+        len = fw_rev_size - 1;
+      }
+      memcpy(fw_rev, line, len);
+      fw_rev[len] = '\0';
+      return ESP_OK;
+    }
+    line = eol + 2;
+  }
+  return ESP_ERR_INVALID_RESPONSE;
+}
+
+esp_err_t bg95_caps_probe(bg95_uart_interface_t* uart, const char* fw_rev, bg95_caps_t* caps)
+{
+  if (uart == NULL || fw_rev == NULL || caps == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(caps, 0, sizeof(*caps));
+  caps->magic   = BG95_CAPS_MAGIC;
+  caps->version = BG95_CAPS_BLOB_VERSION;
+  caps->size    = sizeof(bg95_caps_t);
+  strncpy(caps->fw_rev, fw_rev, sizeof(caps->fw_rev) - 1);
+
+  // Each probe is independent, a firmware lacking one test command still yields the others
+  caps->present.has_qmtcfg =
+      bg95_raw_at_execute(uart, &AT_CMD_QMTCFG, AT_CMD_TYPE_TEST, NULL, &caps->qmtcfg) == ESP_OK;
+  caps->present.has_csq =
+      bg95_raw_at_execute(uart, &AT_CMD_CSQ, AT_CMD_TYPE_TEST, NULL, &caps->csq) == ESP_OK;
+  caps->present.has_qmtsub =
+      bg95_raw_at_execute(uart, &AT_CMD_QMTSUB, AT_CMD_TYPE_TEST, NULL, &caps->qmtsub) == ESP_OK;
+  caps->present.has_qmtconn =
+      bg95_raw_at_execute(uart, &AT_CMD_QMTCONN, AT_CMD_TYPE_TEST, NULL, &caps->qmtconn) == ESP_OK;
+
+  if (!caps->present.has_qmtcfg && !caps->present.has_csq && !caps->present.has_qmtsub &&
+      !caps->present.has_qmtconn)
+  {
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t caps_load(bg95_caps_t* caps)
+{
+  nvs_handle_t nvs;
+  esp_err_t    err = nvs_open(BG95_CAPS_NVS_NAMESPACE, NVS_READONLY, &nvs);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  size_t size = sizeof(*caps);
+  err         = nvs_get_blob(nvs, BG95_CAPS_NVS_KEY, caps, &size);
+  nvs_close(nvs);
+  if (err == ESP_OK && (size != sizeof(*caps) || !bg95_caps_is_valid(caps)))
+  {
+    err = ESP_ERR_NOT_FOUND;
+  }
+  return err;
+}
+
+static esp_err_t caps_store(const bg95_caps_t* caps)
+{
+  nvs_handle_t nvs;
+  esp_err_t    err = nvs_open(BG95_CAPS_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  err = nvs_set_blob(nvs, BG95_CAPS_NVS_KEY, caps, sizeof(*caps));
+  if (err == ESP_OK)
+  {
+    err = nvs_commit(nvs);
+  }
+  nvs_close(nvs);
+  return err;
+}
+
+esp_err_t bg95_caps_load_or_probe(bg95_uart_interface_t* uart, bg95_caps_t* caps, bool* probed)
+{
+  if (uart == NULL || caps == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (probed != NULL)
+  {
+    *probed = false;
+  }
+
+  char      fw_rev[BG95_CAPS_FW_REV_MAX_LEN];
+  esp_err_t err = bg95_caps_read_fw_rev(uart, fw_rev, sizeof(fw_rev));
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to read firmware revision: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  if (caps_load(caps) == ESP_OK && strcmp(caps->fw_rev, fw_rev) == 0)
+  {
+    ESP_LOGI(TAG, "Using cached capabilities for %s", fw_rev);
+    return ESP_OK;
+  }
+
+  ESP_LOGI(TAG, "Probing capabilities of %s", fw_rev);
+  err = bg95_caps_probe(uart, fw_rev, caps);
+  if (probed != NULL)
+  {
+    *probed = true;
+  }
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  if (!bg95_caps_is_complete(caps))
+  {
+    // Usable for this boot with fallbacks for the missing sections, probed again on the next
+    ESP_LOGW(TAG, "Incomplete capability probe, not caching it");
+    return ESP_OK;
+  }
+
+  err = caps_store(caps);
+  if (err != ESP_OK)
+  {
+    // Still usable for this boot, the next one just probes again
+    ESP_LOGW(TAG, "Failed to store capabilities: %s", esp_err_to_name(err));
+  }
+  return ESP_OK;
+}
+
+static bool in_range(int value, int min, int max)
+{
+  return value >= min && value <= max;
+}
+
+bool bg95_caps_check_client_idx(const bg95_caps_t* caps, int client_idx)
+{
+  if (caps != NULL && caps->present.has_qmtcfg)
+  {
+    return in_range(client_idx, caps->qmtcfg.client_idx_min, caps->qmtcfg.client_idx_max);
+  }
+  if (caps != NULL && caps->present.has_qmtconn)
+  {
+    return in_range(client_idx, caps->qmtconn.client_idx_min, caps->qmtconn.client_idx_max);
+  }
+  return in_range(client_idx, CAPS_FALLBACK_CLIENT_IDX_MIN, CAPS_FALLBACK_CLIENT_IDX_MAX);
+}
+
+bool bg95_caps_check_keepalive(const bg95_caps_t* caps, uint16_t keep_alive_s)
+{
+  if (caps != NULL && caps->present.has_qmtcfg)
+  {
+    return in_range(keep_alive_s, caps->qmtcfg.keep_alive_min, caps->qmtcfg.keep_alive_max);
+  }
+  return in_range(keep_alive_s, CAPS_FALLBACK_KEEPALIVE_MIN, CAPS_FALLBACK_KEEPALIVE_MAX);
+}
+
+bool bg95_caps_check_pdp_cid(const bg95_caps_t* caps, int pdp_cid)
+{
+  if (caps != NULL && caps->present.has_qmtcfg)
+  {
+    return in_range(pdp_cid, caps->qmtcfg.pdp_cid_min, caps->qmtcfg.pdp_cid_max);
+  }
+  return in_range(pdp_cid, CAPS_FALLBACK_PDP_CID_MIN, CAPS_FALLBACK_PDP_CID_MAX);
+}
+
+bool bg95_caps_check_mqtt_version(const bg95_caps_t* caps, qmtcfg_version_t version)
+{
+  if (caps != NULL && caps->present.has_qmtcfg)
+  {
+    for (size_t i = 0; i < caps->qmtcfg.num_supported_versions; i++)
+    {
+      if (caps->qmtcfg.supported_versions[i] == version)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+  return version == QMTCFG_VERSION_MQTT_3_1 || version == QMTCFG_VERSION_MQTT_3_1_1;
+}
+
+bool bg95_caps_check_msgid(const bg95_caps_t* caps, int msgid)
+{
+  if (caps != NULL && caps->present.has_qmtsub)
+  {
+    return in_range(msgid, caps->qmtsub.msgid_min, caps->qmtsub.msgid_max);
+  }
+  return in_range(msgid, CAPS_FALLBACK_MSGID_MIN, CAPS_FALLBACK_MSGID_MAX);
+}
+
+bool bg95_caps_check_sub_qos(const bg95_caps_t* caps, int qos)
+{
+  if (caps != NULL && caps->present.has_qmtsub)
+  {
+    return in_range(qos, caps->qmtsub.qos_min, caps->qmtsub.qos_max);
+  }
+  return in_range(qos, CAPS_FALLBACK_QOS_MIN, CAPS_FALLBACK_QOS_MAX);
+}
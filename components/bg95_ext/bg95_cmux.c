@@ -0,0 +1,790 @@
+#include "bg95_cmux.h"
+
+#include "bg95_raw_at.h"
+
+#include <esp_log.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "BG95_CMUX";
+
+#define CMUX_FCS_INIT 0xFF
+#define CMUX_FCS_GOOD 0xCF // Receiver residue over header + FCS
+#define CMUX_FCS_POLY 0xE0 // x^8 + x^2 + x + 1, reflected
+
+static uint8_t fcs_step(uint8_t fcs, uint8_t byte)
+{
+  fcs ^= byte;
+  for (int i = 0; i < 8; i++)
+  {
+    fcs = (fcs & 0x01) ? (uint8_t) ((fcs >> 1) ^ CMUX_FCS_POLY) : (uint8_t) (fcs >> 1);
+  }
+  return fcs;
+}
+
+uint8_t bg95_cmux_fcs(const uint8_t* data, size_t len)
+{
+  uint8_t fcs = CMUX_FCS_INIT;
+  for (size_t i = 0; i < len; i++)
+  {
+    fcs = fcs_step(fcs, data[i]);
+  }
+  return (uint8_t) (0xFF - fcs);
+}
+
+size_t bg95_cmux_encode_frame(uint8_t        dlci,
+                              bool           cr,
+                              uint8_t        control,
+                              const uint8_t* info,
+                              size_t         len,
+                              uint8_t*       out,
+                              size_t         out_size)
+{
+  if (out == NULL || (info == NULL && len > 0) || len > 0x7FFF)
+  {
+    return 0;
+  }
+
+  size_t header_len = (len > 127) ? 4 : 3;
+  size_t frame_len  = 1 + header_len + len + 2;
+  if (frame_len > out_size)
+  {
+    return 0;
+  }
+
+  uint8_t* header = out + 1;
+  out[0]          = BG95_CMUX_FLAG;
+  header[0]       = (uint8_t) ((dlci << 2) | (cr ? BG95_CMUX_CR : 0) | BG95_CMUX_EA);
+  header[1]       = control;
+  if (len > 127)
+  {
+    header[2] = (uint8_t) ((len & 0x7F) << 1);
+    header[3] = (uint8_t) (len >> 7);
+  }
+  else
+  {
+    header[2] = (uint8_t) ((len << 1) | BG95_CMUX_EA);
+  }
+
+  if (len > 0)
+  {
+    memcpy(header + header_len, info, len);
+  }
+
+  // UIH frames only protect the header, UI and control frames cover the info field too
+  bool   uih     = (control & ~BG95_CMUX_PF) == BG95_CMUX_UIH;
+  size_t fcs_len = uih ? header_len : header_len + len;
+
+  out[1 + header_len + len] = bg95_cmux_fcs(header, fcs_len);
+  out[frame_len - 1]        = BG95_CMUX_FLAG;
+  return frame_len;
+}
+
+void bg95_cmux_decoder_init(bg95_cmux_decoder_t* decoder, bg95_cmux_frame_cb_t on_frame, void* ctx)
+{
+  memset(decoder, 0, sizeof(*decoder));
+  decoder->state    = BG95_CMUX_RX_FLAG;
+  decoder->on_frame = on_frame;
+  decoder->ctx      = ctx;
+}
+
+static bool decoder_covers_info(const bg95_cmux_decoder_t* decoder)
+{
+  return (decoder->control & ~BG95_CMUX_PF) != BG95_CMUX_UIH;
+}
+
+void bg95_cmux_decoder_feed(bg95_cmux_decoder_t* decoder, const uint8_t* data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    uint8_t b = data[i];
+
+    switch (decoder->state)
+    {
+      case BG95_CMUX_RX_FLAG:
+        if (b == BG95_CMUX_FLAG)
+        {
+          decoder->state = BG95_CMUX_RX_ADDR;
+        }
+        break;
+
+      case BG95_CMUX_RX_ADDR:
+        if (b == BG95_CMUX_FLAG)
+        {
+          break; // Back-to-back flags between frames
+        }
+        if ((b & BG95_CMUX_EA) == 0)
+        {
+          decoder->state = BG95_CMUX_RX_FLAG; // Extended addresses are not used in basic mode
+          break;
+        }
+        decoder->addr  = b;
+        decoder->fcs   = fcs_step(CMUX_FCS_INIT, b);
+        decoder->state = BG95_CMUX_RX_CTRL;
+        break;
+
+      case BG95_CMUX_RX_CTRL:
+        decoder->control = b;
+        decoder->fcs     = fcs_step(decoder->fcs, b);
+        decoder->state   = BG95_CMUX_RX_LEN;
+        break;
+
+      case BG95_CMUX_RX_LEN:
+        decoder->fcs = fcs_step(decoder->fcs, b);
+        decoder->len = b >> 1;
+        decoder->pos = 0;
+        if ((b & BG95_CMUX_EA) == 0)
+        {
+          decoder->state = BG95_CMUX_RX_LEN2;
+        }
+        else
+        {
+          decoder->state = decoder->len > 0 ? BG95_CMUX_RX_INFO : BG95_CMUX_RX_FCS;
+        }
+        break;
+
+      case BG95_CMUX_RX_LEN2:
+        decoder->fcs = fcs_step(decoder->fcs, b);
+        decoder->len |= (size_t) b << 7;
+        decoder->state = decoder->len > 0 ? BG95_CMUX_RX_INFO : BG95_CMUX_RX_FCS;
+        break;
+
+      case BG95_CMUX_RX_INFO:
+        if (decoder->pos < BG95_CMUX_N1)
+        {
+          decoder->info[decoder->pos] = b;
+        }
+        if (decoder_covers_info(decoder))
+        {
+          decoder->fcs = fcs_step(decoder->fcs, b);
+        }
+        if (++decoder->pos == decoder->len)
+        {
+          decoder->state = BG95_CMUX_RX_FCS;
+        }
+        break;
+
+      case BG95_CMUX_RX_FCS:
+        decoder->fcs   = fcs_step(decoder->fcs, b);
+        decoder->state = BG95_CMUX_RX_END;
+        break;
+
+      case BG95_CMUX_RX_END:
+        if (b != BG95_CMUX_FLAG)
+        {
+          decoder->fcs_errors++; // Lost sync, hunt for the next flag
+          decoder->state = BG95_CMUX_RX_FLAG;
+          break;
+        }
+        if (decoder->fcs != CMUX_FCS_GOOD)
+        {
+          decoder->fcs_errors++;
+        }
+        else if (decoder->len > BG95_CMUX_N1)
+        {
+          decoder->oversized++;
+        }
+        else if (decoder->on_frame != NULL)
+        {
+          decoder->on_frame((uint8_t) (decoder->addr >> 2),
+                            decoder->control,
+                            decoder->info,
+                            decoder->len,
+                            decoder->ctx);
+        }
+        // The closing flag doubles as the opening flag of the next frame
+        decoder->state = BG95_CMUX_RX_ADDR;
+        break;
+    }
+  }
+}
+
+// Reader task side of the channel ring, never blocks
+static size_t ring_push(bg95_cmux_channel_t* ch, const uint8_t* data, size_t len)
+{
+  size_t head  = atomic_load_explicit(&ch->head, memory_order_relaxed);
+  size_t tail  = atomic_load_explicit(&ch->tail, memory_order_acquire);
+  size_t space = BG95_CMUX_RING_SIZE - (head - tail);
+  size_t n     = len < space ? len : space;
+
+  for (size_t i = 0; i < n; i++)
+  {
+    ch->ring[(head + i) & (BG95_CMUX_RING_SIZE - 1)] = data[i];
+  }
+  atomic_store_explicit(&ch->head, head + n, memory_order_release);
+  return n;
+}
+
+// Channel reader side of the ring
+static size_t ring_pop(bg95_cmux_channel_t* ch, uint8_t* data, size_t max_len)
+{
+  size_t tail  = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+  size_t head  = atomic_load_explicit(&ch->head, memory_order_acquire);
+  size_t avail = head - tail;
+  size_t n     = max_len < avail ? max_len : avail;
+
+  for (size_t i = 0; i < n; i++)
+  {
+    data[i] = ch->ring[(tail + i) & (BG95_CMUX_RING_SIZE - 1)];
+  }
+  atomic_store_explicit(&ch->tail, tail + n, memory_order_release);
+  return n;
+}
+
+// 'cr' is set on commands and data, we are the initiator. Responses to the modem's commands
+// carry C/R = 0 (27.010 5.2.1.2).
+static esp_err_t send_frame(bg95_cmux_t*   mux,
+                            uint8_t        dlci,
+                            bool           cr,
+                            uint8_t        control,
+                            const uint8_t* info,
+                            size_t         len)
+{
+  uint8_t frame[BG95_CMUX_FRAME_MAX_LEN];
+  size_t  frame_len = bg95_cmux_encode_frame(dlci, cr, control, info, len, frame, sizeof(frame));
+  if (frame_len == 0)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  xSemaphoreTake(mux->tx_lock, portMAX_DELAY);
+  esp_err_t err = mux->phys->write((const char*) frame, frame_len, mux->phys->context);
+  if (err == ESP_OK)
+  {
+    mux->stats.frames_tx++;
+  }
+  xSemaphoreGive(mux->tx_lock);
+  return err;
+}
+
+// Send SABM or DISC on 'dlci' and wait for the modem's UA
+static esp_err_t control_exchange(bg95_cmux_t* mux, uint8_t dlci, uint8_t control)
+{
+  bg95_cmux_channel_t* ch = &mux->channels[dlci];
+
+  xSemaphoreTake(ch->ctrl_reply, 0); // Drop a stale reply
+  esp_err_t err = send_frame(mux, dlci, true, control | BG95_CMUX_PF, NULL, 0);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  if (xSemaphoreTake(ch->ctrl_reply, pdMS_TO_TICKS(BG95_CMUX_CTRL_TIMEOUT_MS)) != pdTRUE)
+  {
+    ESP_LOGW(TAG, "No reply to control frame 0x%02X on DLCI %d", control, dlci);
+    return ESP_ERR_TIMEOUT;
+  }
+  return atomic_load(&ch->ctrl_type) == BG95_CMUX_UA ? ESP_OK : ESP_FAIL;
+}
+
+// Send a DLCI 0 control message of 'type' (command or response form) with 'len' value octets
+static esp_err_t send_control_msg(bg95_cmux_t* mux, uint8_t type, const uint8_t* value, size_t len)
+{
+  uint8_t msg[2 + BG95_CMUX_CTRL_VALUE_MAX_LEN];
+  if (len > BG95_CMUX_CTRL_VALUE_MAX_LEN)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  msg[0] = type;
+  msg[1] = (uint8_t) ((len << 1) | BG95_CMUX_EA);
+  if (len > 0)
+  {
+    memcpy(msg + 2, value, len);
+  }
+  return send_frame(mux, 0, true, BG95_CMUX_UIH, msg, 2 + len);
+}
+
+static bool flow_held(const bg95_cmux_channel_t* ch)
+{
+  return atomic_load(&ch->mux->flow_off) || (atomic_load(&ch->modem_v24) & BG95_CMUX_V24_FC);
+}
+
+// Wake writers held back by flow control so they re-check
+static void release_flow(bg95_cmux_t* mux)
+{
+  for (uint8_t dlci = 1; dlci <= BG95_CMUX_MAX_DLCI; dlci++)
+  {
+    xSemaphoreGive(mux->channels[dlci].tx_ready);
+  }
+}
+
+// DLCI 0 control message from the modem (27.010 5.4.6), runs on the reader task
+static void handle_control_msg(bg95_cmux_t* mux, const uint8_t* info, size_t len)
+{
+  if (len < 2 || (info[1] & BG95_CMUX_EA) == 0 || 2 + (size_t) (info[1] >> 1) > len)
+  {
+    return; // Two octet lengths never carry anything we act on
+  }
+
+  uint8_t        type      = info[0];
+  const uint8_t* value     = info + 2;
+  size_t         value_len = info[1] >> 1;
+  mux->stats.control_msgs++;
+
+  if ((type & BG95_CMUX_CR) == 0)
+  {
+    // Response to one of ours, only the close-down is waited for
+    if ((type | BG95_CMUX_CR) == BG95_CMUX_MSG_CLD)
+    {
+      atomic_store(&mux->channels[0].ctrl_type, BG95_CMUX_MSG_CLD);
+      xSemaphoreGive(mux->channels[0].ctrl_reply);
+    }
+    return;
+  }
+
+  switch (type)
+  {
+    case BG95_CMUX_MSG_MSC:
+      if (value_len >= 2 && (value[0] >> 2) >= 1 && (value[0] >> 2) <= BG95_CMUX_MAX_DLCI)
+      {
+        bg95_cmux_channel_t* ch = &mux->channels[value[0] >> 2];
+        atomic_store(&ch->modem_v24, value[1]);
+        if ((value[1] & BG95_CMUX_V24_FC) == 0)
+        {
+          xSemaphoreGive(ch->tx_ready);
+        }
+      }
+      break;
+
+    case BG95_CMUX_MSG_FCOFF:
+      atomic_store(&mux->flow_off, true);
+      break;
+
+    case BG95_CMUX_MSG_FCON:
+      atomic_store(&mux->flow_off, false);
+      release_flow(mux);
+      break;
+
+    case BG95_CMUX_MSG_CLD:
+      // The modem leaves mux mode on its own, every channel is gone
+      for (uint8_t dlci = 0; dlci <= BG95_CMUX_MAX_DLCI; dlci++)
+      {
+        atomic_store(&mux->channels[dlci].open, false);
+      }
+      break;
+
+    default:
+      send_control_msg(mux, BG95_CMUX_MSG_NSC, &type, 1);
+      return;
+  }
+
+  // Acknowledge with the same message in response form
+  send_control_msg(mux, type & ~BG95_CMUX_CR, value, value_len);
+}
+
+static void mux_on_frame(uint8_t dlci, uint8_t control, const uint8_t* info, size_t len, void* ctx)
+{
+  bg95_cmux_t* mux = (bg95_cmux_t*) ctx;
+
+  mux->stats.frames_rx++;
+  if (dlci > BG95_CMUX_MAX_DLCI)
+  {
+    mux->stats.unknown_dlci++;
+    return;
+  }
+
+  bg95_cmux_channel_t* ch = &mux->channels[dlci];
+  switch (control & ~BG95_CMUX_PF)
+  {
+    case BG95_CMUX_UA:
+    case BG95_CMUX_DM:
+      atomic_store(&ch->ctrl_type, control & ~BG95_CMUX_PF);
+      xSemaphoreGive(ch->ctrl_reply);
+      break;
+
+    case BG95_CMUX_DISC:
+      atomic_store(&ch->open, false);
+      send_frame(mux, dlci, false, BG95_CMUX_UA | BG95_CMUX_PF, NULL, 0);
+      break;
+
+    case BG95_CMUX_UIH:
+    case BG95_CMUX_UI:
+      if (dlci == 0)
+      {
+        handle_control_msg(mux, info, len);
+        break;
+      }
+      if (!atomic_load(&ch->open))
+      {
+        mux->stats.dropped_bytes += len;
+        break;
+      }
+      {
+        size_t pushed = ring_push(ch, info, len);
+        if (pushed < len)
+        {
+          mux->stats.dropped_bytes += len - pushed;
+        }
+        xSemaphoreGive(ch->rx_ready);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void cmux_task(void* pvParameters)
+{
+  bg95_cmux_t* mux = (bg95_cmux_t*) pvParameters;
+  uint8_t      buf[BG95_CMUX_READ_CHUNK];
+
+  while (mux->running)
+  {
+    size_t    bytes_read = 0;
+    esp_err_t err        = mux->phys->read(
+        (char*) buf, sizeof(buf), &bytes_read, BG95_CMUX_POLL_MS, mux->phys->context);
+    if (bytes_read == 0)
+    {
+      if (err != ESP_OK && err != ESP_ERR_TIMEOUT)
+      {
+        vTaskDelay(pdMS_TO_TICKS(BG95_CMUX_POLL_MS));
+      }
+      continue;
+    }
+    bg95_cmux_decoder_feed(&mux->decoder, buf, bytes_read);
+  }
+
+  xSemaphoreGive(mux->stopped);
+  vTaskDelete(NULL);
+}
+
+// Hold a write back while the modem has flow control on for this DLCI or the whole mux
+static esp_err_t wait_flow(bg95_cmux_channel_t* ch)
+{
+  if (!flow_held(ch))
+  {
+    return ESP_OK;
+  }
+
+  TickType_t start = xTaskGetTickCount();
+  TickType_t limit = pdMS_TO_TICKS(BG95_CMUX_FLOW_TIMEOUT_MS);
+  ch->mux->stats.flow_waits++;
+  while (flow_held(ch))
+  {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed >= limit)
+    {
+      ESP_LOGW(TAG, "DLCI %d flow controlled for %d ms", ch->dlci, BG95_CMUX_FLOW_TIMEOUT_MS);
+      return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreTake(ch->tx_ready, limit - elapsed);
+  }
+  return ESP_OK;
+}
+
+static esp_err_t channel_write(const char* data, size_t len, void* context)
+{
+  bg95_cmux_channel_t* ch = (bg95_cmux_channel_t*) context;
+
+  if (!atomic_load(&ch->open))
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // Long writes (QMTPUB payloads) go out as several frames
+  while (len > 0)
+  {
+    size_t    chunk = len > BG95_CMUX_N1 ? BG95_CMUX_N1 : len;
+    esp_err_t err   = wait_flow(ch);
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+    err = send_frame(ch->mux, ch->dlci, true, BG95_CMUX_UIH, (const uint8_t*) data, chunk);
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+    data += chunk;
+    len -= chunk;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t channel_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  bg95_cmux_channel_t* ch    = (bg95_cmux_channel_t*) context;
+  TickType_t           start = xTaskGetTickCount();
+  TickType_t           limit = pdMS_TO_TICKS(timeout_ms);
+
+  *bytes_read = ring_pop(ch, (uint8_t*) data, max_len);
+  while (*bytes_read == 0)
+  {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed >= limit)
+    {
+      break;
+    }
+    xSemaphoreTake(ch->rx_ready, limit - elapsed);
+    *bytes_read = ring_pop(ch, (uint8_t*) data, max_len);
+  }
+  return ESP_OK;
+}
+
+// AT+CMUX <port_speed> code for the rate the link already runs at
+static int cmux_port_speed(uint32_t baud)
+{
+  switch (baud)
+  {
+    case 9600:
+      return 1;
+    case 19200:
+      return 2;
+    case 38400:
+      return 3;
+    case 57600:
+      return 4;
+    case 230400:
+      return 6;
+    case 460800:
+      return 7;
+    case 921600:
+      return 8;
+    case 115200:
+    default:
+      return 5;
+  }
+}
+
+static esp_err_t enter_cmux_mode(bg95_uart_interface_t* phys, uint32_t baud)
+{
+  char cmd[32];
+  char response[64];
+  snprintf(cmd, sizeof(cmd), "AT+CMUX=0,0,%d,%d", cmux_port_speed(baud), BG95_CMUX_N1);
+
+  esp_err_t err =
+      bg95_raw_at_send(phys, cmd, response, sizeof(response), BG95_CMUX_CTRL_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Modem refused %s: %s", cmd, esp_err_to_name(err));
+  }
+  return err;
+}
+
+esp_err_t bg95_cmux_init(bg95_cmux_t* mux, bg95_uart_interface_t* phys, uint32_t baud)
+{
+  if (mux == NULL || phys == NULL || phys->write == NULL || phys->read == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(mux, 0, sizeof(*mux));
+  mux->phys    = phys;
+  mux->tx_lock = xSemaphoreCreateMutex();
+  mux->stopped = xSemaphoreCreateBinary();
+  if (mux->tx_lock == NULL || mux->stopped == NULL)
+  {
+    bg95_cmux_deinit(mux);
+    return ESP_ERR_NO_MEM;
+  }
+
+  for (uint8_t dlci = 0; dlci <= BG95_CMUX_MAX_DLCI; dlci++)
+  {
+    bg95_cmux_channel_t* ch = &mux->channels[dlci];
+    ch->mux                 = mux;
+    ch->dlci                = dlci;
+    ch->uart.write          = channel_write;
+    ch->uart.read           = channel_read;
+    ch->uart.context        = ch;
+    atomic_init(&ch->open, false);
+    atomic_init(&ch->head, 0);
+    atomic_init(&ch->tail, 0);
+    atomic_init(&ch->ctrl_type, 0);
+
+    atomic_init(&ch->modem_v24, 0);
+
+    ch->rx_ready   = xSemaphoreCreateBinary();
+    ch->ctrl_reply = xSemaphoreCreateBinary();
+    ch->tx_ready   = xSemaphoreCreateBinary();
+    if (ch->rx_ready == NULL || ch->ctrl_reply == NULL || ch->tx_ready == NULL)
+    {
+      bg95_cmux_deinit(mux);
+      return ESP_ERR_NO_MEM;
+    }
+  }
+
+  atomic_init(&mux->flow_off, false);
+
+  esp_err_t err = enter_cmux_mode(phys, baud);
+  if (err != ESP_OK)
+  {
+    bg95_cmux_deinit(mux);
+    return err;
+  }
+  mux->muxing = true;
+
+  bg95_cmux_decoder_init(&mux->decoder, mux_on_frame, mux);
+
+  mux->running = true;
+  const bg95_task_config_t task_config = {
+      .stack_size = BG95_CMUX_TASK_STACK_SIZE,
+      .priority   = BG95_CMUX_TASK_PRIORITY,
+      .core       = BG95_CMUX_TASK_CORE,
+  };
+  if (bg95_task_create(cmux_task, "bg95_cmux", &task_config, mux, &mux->task) != pdPASS)
+  {
+    ESP_LOGE(TAG, "Failed to create CMUX task");
+    mux->running = false;
+    return bg95_cmux_deinit(mux) != ESP_OK ? ESP_ERR_INVALID_STATE : ESP_ERR_NO_MEM;
+  }
+
+  err = control_exchange(mux, 0, BG95_CMUX_SABM);
+  if (err != ESP_OK)
+  {
+    // The modem is in mux mode already, leave it again before anyone falls back to plain AT
+    ESP_LOGE(TAG, "Failed to open control channel: %s", esp_err_to_name(err));
+    return bg95_cmux_deinit(mux) != ESP_OK ? ESP_ERR_INVALID_STATE : err;
+  }
+  atomic_store(&mux->channels[0].open, true);
+
+  ESP_LOGI(TAG, "CMUX basic mode active, N1=%d", BG95_CMUX_N1);
+  return ESP_OK;
+}
+
+// Leave mux mode. CLD is the regular close-down; a DISC on DLCI 0 also closes the mux
+// (27.010 5.8.2) and is what a modem whose control channel never opened still acts on.
+// Without the reader task the frames go out blind and the waits run into their timeouts.
+static void close_down(bg95_cmux_t* mux)
+{
+  bg95_cmux_channel_t* ctrl = &mux->channels[0];
+
+  if (atomic_load(&ctrl->open))
+  {
+    for (uint8_t dlci = 1; dlci <= BG95_CMUX_MAX_DLCI; dlci++)
+    {
+      if (atomic_load(&mux->channels[dlci].open))
+      {
+        bg95_cmux_close_channel(mux, dlci);
+      }
+    }
+  }
+
+  xSemaphoreTake(ctrl->ctrl_reply, 0);
+  bool closed = false;
+  if (send_control_msg(mux, BG95_CMUX_MSG_CLD, NULL, 0) == ESP_OK &&
+      xSemaphoreTake(ctrl->ctrl_reply, pdMS_TO_TICKS(BG95_CMUX_CTRL_TIMEOUT_MS)) == pdTRUE)
+  {
+    closed = atomic_load(&ctrl->ctrl_type) == BG95_CMUX_MSG_CLD;
+  }
+  if (!closed)
+  {
+    control_exchange(mux, 0, BG95_CMUX_DISC);
+  }
+  atomic_store(&ctrl->open, false);
+  mux->muxing = false;
+}
+
+// The modem must answer plain AT once it left mux mode, any final result will do
+static esp_err_t check_at_mode(bg95_uart_interface_t* phys)
+{
+  char      response[32];
+  esp_err_t err =
+      bg95_raw_at_send(phys, "AT", response, sizeof(response), BG95_CMUX_CTRL_TIMEOUT_MS);
+  if (err != ESP_OK && err != ESP_FAIL)
+  {
+    ESP_LOGE(TAG, "Modem does not answer plain AT after leaving CMUX: %s", esp_err_to_name(err));
+    return ESP_ERR_INVALID_STATE;
+  }
+  return ESP_OK;
+}
+
+esp_err_t bg95_cmux_deinit(bg95_cmux_t* mux)
+{
+  if (mux == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  bool was_muxing = mux->muxing;
+  if (was_muxing)
+  {
+    close_down(mux);
+  }
+
+  if (mux->running)
+  {
+    mux->running = false;
+    xSemaphoreTake(mux->stopped, portMAX_DELAY);
+  }
+
+  // The reader task is gone, the physical link is ours again
+  esp_err_t err = was_muxing ? check_at_mode(mux->phys) : ESP_OK;
+
+  for (uint8_t dlci = 0; dlci <= BG95_CMUX_MAX_DLCI; dlci++)
+  {
+    if (mux->channels[dlci].rx_ready != NULL)
+    {
+      vSemaphoreDelete(mux->channels[dlci].rx_ready);
+    }
+    if (mux->channels[dlci].ctrl_reply != NULL)
+    {
+      vSemaphoreDelete(mux->channels[dlci].ctrl_reply);
+    }
+    if (mux->channels[dlci].tx_ready != NULL)
+    {
+      vSemaphoreDelete(mux->channels[dlci].tx_ready);
+    }
+  }
+  if (mux->tx_lock != NULL)
+  {
+    vSemaphoreDelete(mux->tx_lock);
+  }
+  if (mux->stopped != NULL)
+  {
+    vSemaphoreDelete(mux->stopped);
+  }
+  memset(mux, 0, sizeof(*mux));
+  return err;
+}
+
+esp_err_t bg95_cmux_open_channel(bg95_cmux_t* mux, uint8_t dlci, bg95_uart_interface_t** uart)
+{
+  if (mux == NULL || uart == NULL || dlci == 0 || dlci > BG95_CMUX_MAX_DLCI)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  bg95_cmux_channel_t* ch = &mux->channels[dlci];
+  if (!atomic_load(&ch->open))
+  {
+    esp_err_t err = control_exchange(mux, dlci, BG95_CMUX_SABM);
+    if (err != ESP_OK)
+    {
+      ESP_LOGE(TAG, "Failed to open DLCI %d: %s", dlci, esp_err_to_name(err));
+      return err;
+    }
+    atomic_store(&ch->tail, atomic_load(&ch->head)); // Start with an empty ring
+    atomic_store(&ch->open, true);
+  }
+
+  *uart = &ch->uart;
+  return ESP_OK;
+}
+
+esp_err_t bg95_cmux_close_channel(bg95_cmux_t* mux, uint8_t dlci)
+{
+  if (mux == NULL || dlci == 0 || dlci > BG95_CMUX_MAX_DLCI)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  bg95_cmux_channel_t* ch = &mux->channels[dlci];
+  if (!atomic_load(&ch->open))
+  {
+    return ESP_OK;
+  }
+
+  esp_err_t err = control_exchange(mux, dlci, BG95_CMUX_DISC);
+  atomic_store(&ch->open, false);
+  return err;
+}
+
+uint8_t bg95_cmux_modem_signals(const bg95_cmux_t* mux, uint8_t dlci)
+{
+  if (mux == NULL || dlci > BG95_CMUX_MAX_DLCI)
+  {
+    return 0;
+  }
+  return (uint8_t) atomic_load(&mux->channels[dlci].modem_v24);
+}
@@ -0,0 +1,387 @@
+#include "bg95_config.h"
+
+#include "bg95_raw_at.h"
+
+#include <ctype.h>
+#include <esp_log.h>
+#include <nvs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "BG95_CONFIG";
+
+// <type> strings as used by AT+QMTCFG, indexed by qmtcfg_type_t
+static const char* const QMTCFG_TYPE_NAMES[QMTCFG_TYPE_MAX] = {
+    [QMTCFG_TYPE_VERSION]   = "version",
+    [QMTCFG_TYPE_PDPCID]    = "pdpcid",
+    [QMTCFG_TYPE_SSL]       = "ssl",
+    [QMTCFG_TYPE_KEEPALIVE] = "keepalive",
+    [QMTCFG_TYPE_SESSION]   = "session",
+    [QMTCFG_TYPE_TIMEOUT]   = "timeout",
+    [QMTCFG_TYPE_WILL]      = "will",
+    [QMTCFG_TYPE_RECV_MODE] = "recv/mode",
+};
+
+void bg95_config_init(bg95_config_t* config)
+{
+  if (config == NULL)
+  {
+    return;
+  }
+  memset(config, 0, sizeof(*config));
+  config->magic   = BG95_CONFIG_MAGIC;
+  config->version = BG95_CONFIG_BLOB_VERSION;
+  config->size    = sizeof(bg95_config_t);
+}
+
+bool bg95_config_is_valid(const bg95_config_t* config)
+{
+  return config != NULL && config->magic == BG95_CONFIG_MAGIC &&
+         config->version == BG95_CONFIG_BLOB_VERSION && config->size == sizeof(bg95_config_t);
+}
+
+esp_err_t bg95_config_set_qmtcfg(bg95_config_t* config, const qmtcfg_write_params_t* params)
+{
+  if (config == NULL || params == NULL || params->type >= QMTCFG_TYPE_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  config->qmtcfg[params->type]     = *params;
+  config->has_qmtcfg[params->type] = true;
+  return ESP_OK;
+}
+
+esp_err_t bg95_config_set_cgdcont(bg95_config_t* config, const cgdcont_write_params_t* params)
+{
+  if (config == NULL || params == NULL || !params->present.has_cid ||
+      !params->present.has_pdp_type)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  config->cgdcont     = *params;
+  config->has_cgdcont = true;
+  return ESP_OK;
+}
+
+esp_err_t bg95_config_load(bg95_config_t* config)
+{
+  if (config == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  nvs_handle_t nvs;
+  esp_err_t    err = nvs_open(BG95_CONFIG_NVS_NAMESPACE, NVS_READONLY, &nvs);
+  if (err != ESP_OK)
+  {
+    return err == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : err;
+  }
+
+  size_t size = sizeof(*config);
+  err         = nvs_get_blob(nvs, BG95_CONFIG_NVS_KEY, config, &size);
+  nvs_close(nvs);
+
+  if (err == ESP_ERR_NVS_NOT_FOUND)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (err != ESP_OK)
+  {
+    // A blob from an older, larger layout does not fit and is treated as absent
+    ESP_LOGW(TAG, "Stored config unreadable: %s", esp_err_to_name(err));
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (size != sizeof(*config) || !bg95_config_is_valid(config))
+  {
+    ESP_LOGW(TAG, "Stored config has an incompatible layout, ignoring it");
+    return ESP_ERR_NOT_FOUND;
+  }
+  return ESP_OK;
+}
+
+bool bg95_config_is_stored(const bg95_config_t* config)
+{
+  if (!bg95_config_is_valid(config))
+  {
+    return false;
+  }
+
+  bg95_config_t* stored = malloc(sizeof(*stored));
+  if (stored == NULL)
+  {
+    return false;
+  }
+  bool same = bg95_config_load(stored) == ESP_OK && memcmp(stored, config, sizeof(*stored)) == 0;
+  free(stored);
+  return same;
+}
+
+esp_err_t bg95_config_save(const bg95_config_t* config)
+{
+  if (!bg95_config_is_valid(config))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // Skip the flash write when nothing changed
+  if (bg95_config_is_stored(config))
+  {
+    return ESP_OK;
+  }
+
+  nvs_handle_t nvs;
+  esp_err_t    err = nvs_open(BG95_CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  err = nvs_set_blob(nvs, BG95_CONFIG_NVS_KEY, config, sizeof(*config));
+  if (err == ESP_OK)
+  {
+    err = nvs_commit(nvs);
+  }
+  nvs_close(nvs);
+  return err;
+}
+
+// Query form of a QMTCFG setting: only type and client index, no values
+static void qmtcfg_query_params(const qmtcfg_write_params_t* desired, qmtcfg_write_params_t* query)
+{
+  memset(query, 0, sizeof(*query));
+  query->type = desired->type;
+  switch (desired->type)
+  {
+    case QMTCFG_TYPE_VERSION:
+      query->params.version.client_idx = desired->params.version.client_idx;
+      break;
+    case QMTCFG_TYPE_PDPCID:
+      query->params.pdpcid.client_idx = desired->params.pdpcid.client_idx;
+      break;
+    case QMTCFG_TYPE_SSL:
+      query->params.ssl.client_idx = desired->params.ssl.client_idx;
+      break;
+    case QMTCFG_TYPE_KEEPALIVE:
+      query->params.keepalive.client_idx = desired->params.keepalive.client_idx;
+      break;
+    case QMTCFG_TYPE_SESSION:
+      query->params.session.client_idx = desired->params.session.client_idx;
+      break;
+    case QMTCFG_TYPE_TIMEOUT:
+      query->params.timeout.client_idx = desired->params.timeout.client_idx;
+      break;
+    case QMTCFG_TYPE_WILL:
+      query->params.will.client_idx = desired->params.will.client_idx;
+      break;
+    case QMTCFG_TYPE_RECV_MODE:
+      query->params.recv_mode.client_idx = desired->params.recv_mode.client_idx;
+      break;
+    default:
+      break;
+  }
+}
+
+// Values part of a formatted QMTCFG write, '="keepalive",0,120' -> '120'
+static const char* qmtcfg_write_values(const char* formatted)
+{
+  const char* p = strchr(formatted, ',');
+  if (p == NULL)
+  {
+    return "";
+  }
+  p++;
+  while (isdigit((unsigned char) *p))
+  {
+    p++;
+  }
+  return *p == ',' ? p + 1 : p;
+}
+
+// The modem's read back (may carry extra trailing fields) matches 'desired' when it starts with
+// it and continues with a field separator or ends
+static bool values_match(const char* desired, const char* actual, size_t actual_len)
+{
+  size_t len = strlen(desired);
+  if (len > actual_len || strncmp(desired, actual, len) != 0)
+  {
+    return false;
+  }
+  return len == actual_len || actual[len] == ',';
+}
+
+// Find "<prefix><values>\r\n" in 'response' and return the values and their length
+static const char* find_line_values(const char* response, const char* prefix, size_t* len)
+{
+  const char* line = strstr(response, prefix);
+  if (line == NULL)
+  {
+    return NULL;
+  }
+  const char* values = line + strlen(prefix);
+  const char* eol    = strstr(values, "\r\n");
+  *len               = eol != NULL ? (size_t) (eol - values) : strlen(values);
+  return values;
+}
+
+static esp_err_t format_write(const at_cmd_t* cmd, const void* params, char* buf, size_t size)
+{
+  return cmd->type_info[AT_CMD_TYPE_WRITE].formatter(params, buf, size);
+}
+
+esp_err_t bg95_config_apply(bg95_uart_interface_t*     uart,
+                            const bg95_config_t*       config,
+                            bg95_config_apply_stats_t* stats)
+{
+  if (uart == NULL || !bg95_config_is_valid(config))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  bg95_config_apply_stats_t local_stats = {0};
+  if (stats == NULL)
+  {
+    stats = &local_stats;
+  }
+  memset(stats, 0, sizeof(*stats));
+
+  // 1. One concatenated query line for every configured setting
+  char   query[BG95_RAW_AT_CMD_MAX_LEN] = "AT";
+  size_t query_len                      = 2;
+  for (int type = 0; type < QMTCFG_TYPE_MAX; type++)
+  {
+    if (!config->has_qmtcfg[type])
+    {
+      continue;
+    }
+    qmtcfg_write_params_t query_params;
+    qmtcfg_query_params(&config->qmtcfg[type], &query_params);
+
+    char      suffix[64];
+    esp_err_t err = format_write(&AT_CMD_QMTCFG, &query_params, suffix, sizeof(suffix));
+    int       written   = snprintf(query + query_len,
+                           sizeof(query) - query_len,
+                           "%s+QMTCFG%s",
+                           query_len > 2 ? ";" : "",
+                           suffix);
+    if (err != ESP_OK || written < 0 || (size_t) written >= sizeof(query) - query_len)
+    {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    query_len += (size_t) written;
+  }
+  if (config->has_cgdcont)
+  {
+    int written = snprintf(
+        query + query_len, sizeof(query) - query_len, "%s+CGDCONT?", query_len > 2 ? ";" : "");
+    if (written < 0 || (size_t) written >= sizeof(query) - query_len)
+    {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    query_len += (size_t) written;
+  }
+  if (query_len == 2)
+  {
+    return ESP_OK;
+  }
+
+  // A rejected query aborts the rest of the line, whatever came back is still compared and
+  // anything missing is simply written
+  char      response[BG95_RAW_AT_RESPONSE_MAX_LEN];
+  esp_err_t err =
+      bg95_raw_at_send(uart, query, response, sizeof(response), BG95_CONFIG_TIMEOUT_MS);
+  if (err != ESP_OK && err != ESP_FAIL)
+  {
+    ESP_LOGW(TAG, "Config read back failed: %s", esp_err_to_name(err));
+    response[0] = '\0';
+  }
+
+  // 2. Write only what differs
+  esp_err_t result = ESP_OK;
+  for (int type = 0; type < QMTCFG_TYPE_MAX; type++)
+  {
+    if (!config->has_qmtcfg[type])
+    {
+      continue;
+    }
+
+    char formatted[BG95_CONFIG_VALUE_MAX_LEN];
+    err = format_write(&AT_CMD_QMTCFG, &config->qmtcfg[type], formatted, sizeof(formatted));
+    if (err != ESP_OK)
+    {
+      ESP_LOGE(TAG, "Cannot format QMTCFG \"%s\"", QMTCFG_TYPE_NAMES[type]);
+      result = err;
+      continue;
+    }
+
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "+QMTCFG: \"%s\",", QMTCFG_TYPE_NAMES[type]);
+    size_t      actual_len = 0;
+    const char* actual     = find_line_values(response, prefix, &actual_len);
+    if (actual != NULL)
+    {
+      stats->read_back++;
+      if (values_match(qmtcfg_write_values(formatted), actual, actual_len))
+      {
+        stats->unchanged++;
+        continue;
+      }
+    }
+
+    ESP_LOGI(TAG, "Writing QMTCFG%s", formatted);
+    stats->writes_sent++;
+    err = bg95_raw_at_execute(uart, &AT_CMD_QMTCFG, AT_CMD_TYPE_WRITE, &config->qmtcfg[type], NULL);
+    if (err != ESP_OK)
+    {
+      ESP_LOGE(TAG,
+               "QMTCFG \"%s\" write failed: %s",
+               QMTCFG_TYPE_NAMES[type],
+               esp_err_to_name(err));
+      stats->writes_failed++;
+      result = err;
+    }
+  }
+
+  if (config->has_cgdcont)
+  {
+    char formatted[BG95_CONFIG_VALUE_MAX_LEN];
+    err = format_write(&AT_CMD_CGDCONT, &config->cgdcont, formatted, sizeof(formatted));
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+
+    // Each context is its own "+CGDCONT: <cid>,..." line
+    char prefix[24];
+    snprintf(prefix, sizeof(prefix), "+CGDCONT: %d,", config->cgdcont.cid);
+    size_t      actual_len = 0;
+    const char* actual     = find_line_values(response, prefix, &actual_len);
+    const char* desired    = strchr(formatted, ',');
+    if (actual != NULL)
+    {
+      stats->read_back++;
+    }
+    if (actual != NULL && desired != NULL && values_match(desired + 1, actual, actual_len))
+    {
+      stats->unchanged++;
+    }
+    else
+    {
+      ESP_LOGI(TAG, "Writing CGDCONT%s", formatted);
+      stats->writes_sent++;
+      err = bg95_raw_at_execute(uart, &AT_CMD_CGDCONT, AT_CMD_TYPE_WRITE, &config->cgdcont, NULL);
+      if (err != ESP_OK)
+      {
+        ESP_LOGE(TAG, "CGDCONT write failed: %s", esp_err_to_name(err));
+        stats->writes_failed++;
+        result = err;
+      }
+    }
+  }
+
+  ESP_LOGI(TAG,
+           "Config applied: %lu unchanged, %lu written, %lu failed",
+           (unsigned long) stats->unchanged,
+           (unsigned long) stats->writes_sent,
+           (unsigned long) stats->writes_failed);
+  return result;
+}
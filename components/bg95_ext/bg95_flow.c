@@ -0,0 +1,223 @@
+#include "bg95_flow.h"
+
+#include "bg95_raw_at.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BG95_FLOW";
+
+// AT+IFC=<dce_by_dte>,<dte_by_dce>: 2 is RTS/CTS, 0 is none
+#define FLOW_CMD_RTS_CTS "AT+IFC=2,2"
+#define FLOW_CMD_NONE "AT+IFC=0,0"
+
+static esp_err_t send_ifc(bg95_uart_interface_t* uart, const char* cmd)
+{
+  char response[32];
+  return bg95_raw_at_send(uart, cmd, response, sizeof(response), BG95_FLOW_CMD_TIMEOUT_MS);
+}
+
+esp_err_t bg95_flow_init(bg95_flow_t* flow)
+{
+  if (flow == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(flow, 0, sizeof(*flow));
+  flow->stopped = xSemaphoreCreateBinary();
+  if (flow->stopped == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+void bg95_flow_deinit(bg95_flow_t* flow)
+{
+  if (flow == NULL)
+  {
+    return;
+  }
+
+  if (flow->running)
+  {
+    flow->running = false;
+    xSemaphoreTake(flow->stopped, portMAX_DELAY);
+  }
+  if (flow->stopped != NULL)
+  {
+    vSemaphoreDelete(flow->stopped);
+  }
+  memset(flow, 0, sizeof(*flow));
+}
+
+esp_err_t bg95_flow_enable(bg95_flow_t*           flow,
+                           bg95_uart_interface_t* uart,
+                           bg95_flow_set_fn_t     set_flow,
+                           void*                  set_flow_ctx)
+{
+  if (flow == NULL || uart == NULL || set_flow == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t err = send_ifc(uart, FLOW_CMD_RTS_CTS);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Modem refused %s: %s", FLOW_CMD_RTS_CTS, esp_err_to_name(err));
+    return err;
+  }
+
+  err = set_flow(true, set_flow_ctx);
+  if (err == ESP_OK)
+  {
+    char response[32];
+    err = bg95_raw_at_send(uart, "AT", response, sizeof(response), BG95_FLOW_CMD_TIMEOUT_MS);
+  }
+  if (err != ESP_OK)
+  {
+    // Handshake lines not wired or host refused, put both ends back
+    ESP_LOGW(TAG, "No link with RTS/CTS (%s), disabling flow control", esp_err_to_name(err));
+    set_flow(false, set_flow_ctx);
+    send_ifc(uart, FLOW_CMD_NONE);
+    flow->enabled = false;
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+
+  flow->enabled = true;
+  ESP_LOGI(TAG, "RTS/CTS flow control enabled");
+  return ESP_OK;
+}
+
+esp_err_t bg95_flow_disable(bg95_flow_t*           flow,
+                            bg95_uart_interface_t* uart,
+                            bg95_flow_set_fn_t     set_flow,
+                            void*                  set_flow_ctx)
+{
+  if (flow == NULL || uart == NULL || set_flow == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t err = send_ifc(uart, FLOW_CMD_NONE);
+  set_flow(false, set_flow_ctx);
+  flow->enabled = false;
+  return err;
+}
+
+void bg95_flow_record_event(bg95_flow_t* flow, uart_event_type_t type)
+{
+  if (flow == NULL)
+  {
+    return;
+  }
+
+  switch (type)
+  {
+    case UART_FIFO_OVF:
+      flow->stats.fifo_overflows++;
+      break;
+    case UART_BUFFER_FULL:
+      flow->stats.buffer_full++;
+      break;
+    case UART_FRAME_ERR:
+      flow->stats.framing_errors++;
+      break;
+    case UART_PARITY_ERR:
+      flow->stats.parity_errors++;
+      break;
+    case UART_BREAK:
+      flow->stats.breaks++;
+      break;
+    default:
+      break;
+  }
+}
+
+static void flow_event_task(void* pvParameters)
+{
+  bg95_flow_t* flow = (bg95_flow_t*) pvParameters;
+  uart_event_t event;
+
+  while (flow->running)
+  {
+    if (xQueueReceive(flow->event_queue, &event, pdMS_TO_TICKS(BG95_FLOW_EVENT_POLL_MS)) == pdTRUE)
+    {
+      bg95_flow_record_event(flow, event.type);
+      if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL)
+      {
+        // The events queued behind it describe input the callback is about to flush
+        ESP_LOGW(TAG, "UART RX overrun (%s)", event.type == UART_FIFO_OVF ? "fifo" : "buffer");
+        xQueueReset(flow->event_queue);
+      }
+      if (flow->on_event != NULL)
+      {
+        flow->on_event(&event, flow->on_event_ctx);
+      }
+    }
+  }
+
+  xSemaphoreGive(flow->stopped);
+  vTaskDelete(NULL);
+}
+
+esp_err_t bg95_flow_watch_events(bg95_flow_t* flow, QueueHandle_t event_queue)
+{
+  if (flow == NULL || event_queue == NULL || flow->running)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  flow->event_queue = event_queue;
+  flow->running     = true;
+  const bg95_task_config_t task_config = {
+      .stack_size = BG95_FLOW_TASK_STACK_SIZE,
+      .priority   = BG95_FLOW_TASK_PRIORITY,
+      .core       = BG95_FLOW_TASK_CORE,
+  };
+  if (bg95_task_create(flow_event_task, "bg95_flow", &task_config, flow, &flow->task) != pdPASS)
+  {
+    ESP_LOGE(TAG, "Failed to create UART event task");
+    flow->running = false;
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+esp_err_t bg95_flow_set_event_fn(bg95_flow_t* flow, bg95_flow_event_fn_t fn, void* ctx)
+{
+  if (flow == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (flow->running)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  flow->on_event     = fn;
+  flow->on_event_ctx = ctx;
+  return ESP_OK;
+}
+
+bool bg95_flow_has_rx_loss(const bg95_flow_t* flow)
+{
+  return flow != NULL && (flow->stats.fifo_overflows > 0 || flow->stats.buffer_full > 0 ||
+                          flow->stats.framing_errors > 0 || flow->stats.parity_errors > 0);
+}
+
+void bg95_flow_log_stats(const bg95_flow_t* flow)
+{
+  if (flow == NULL)
+  {
+    return;
+  }
+  ESP_LOGI(TAG,
+           "RTS/CTS %s, fifo_overflows=%lu buffer_full=%lu framing=%lu parity=%lu breaks=%lu",
+           flow->enabled ? "on" : "off",
+           (unsigned long) flow->stats.fifo_overflows,
+           (unsigned long) flow->stats.buffer_full,
+           (unsigned long) flow->stats.framing_errors,
+           (unsigned long) flow->stats.parity_errors,
+           (unsigned long) flow->stats.breaks);
+}
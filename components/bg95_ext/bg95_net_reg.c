@@ -0,0 +1,332 @@
+#include "bg95_net_reg.h"
+
+#include "bg95_raw_at.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "BG95_NET_REG";
+
+#define NET_REG_MAX_FIELDS 6
+#define NET_REG_FIELD_MAX_LEN 16
+
+typedef struct
+{
+  const char*           prefix;
+  bg95_net_reg_domain_t domain;
+} net_reg_prefix_t;
+
+static const net_reg_prefix_t NET_REG_PREFIXES[] = {
+    {"+CREG: ", BG95_NET_REG_DOMAIN_CS},
+    {"+CGREG: ", BG95_NET_REG_DOMAIN_PS},
+    {"+CEREG: ", BG95_NET_REG_DOMAIN_EPS},
+};
+
+#define NET_REG_PREFIXES_COUNT (sizeof(NET_REG_PREFIXES) / sizeof(NET_REG_PREFIXES[0]))
+
+// Split a comma separated parameter list, stripping quotes. Returns the field count.
+static size_t split_fields(const char* params,
+                           char        fields[NET_REG_MAX_FIELDS][NET_REG_FIELD_MAX_LEN],
+                           bool        quoted[NET_REG_MAX_FIELDS])
+{
+  size_t count = 0;
+  size_t len   = 0;
+  bool   in_q  = false;
+
+  memset(quoted, 0, sizeof(bool) * NET_REG_MAX_FIELDS);
+  fields[0][0] = '\0';
+
+  for (const char* p = params; *p != '\0' && count < NET_REG_MAX_FIELDS; p++)
+  {
+    if (*p == '"')
+    {
+      in_q          = !in_q;
+      quoted[count] = true;
+    }
+    else if (*p == ',' && !in_q)
+    {
+      fields[count][len] = '\0';
+      count++;
+      len = 0;
+      if (count < NET_REG_MAX_FIELDS)
+      {
+        fields[count][0] = '\0';
+      }
+    }
+    else if (*p != ' ' && len < NET_REG_FIELD_MAX_LEN - 1)
+    {
+      fields[count][len++] = *p;
+    }
+  }
+
+  if (count < NET_REG_MAX_FIELDS)
+  {
+    fields[count][len] = '\0';
+    count++;
+  }
+  return count;
+}
+
+static bool is_registered_stat(bg95_net_reg_stat_t stat)
+{
+  return stat == BG95_NET_REG_STAT_REGISTERED_HOME || stat == BG95_NET_REG_STAT_REGISTERED_ROAMING;
+}
+
+// Recompute the summary flags and event bits. Must be called with reg->lock held.
+static void update_summary(bg95_net_reg_t* reg)
+{
+  bg95_net_reg_state_t* state = &reg->state;
+
+  bool registered =
+      (state->domains[BG95_NET_REG_DOMAIN_PS].present.has_stat &&
+       is_registered_stat(state->domains[BG95_NET_REG_DOMAIN_PS].stat)) ||
+      (state->domains[BG95_NET_REG_DOMAIN_EPS].present.has_stat &&
+       is_registered_stat(state->domains[BG95_NET_REG_DOMAIN_EPS].stat));
+
+  bool lost = state->registered && !registered;
+
+  if (registered != state->registered)
+  {
+    state->registered    = registered;
+    state->changed_at_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Network %s", registered ? "registered" : "lost");
+  }
+  if (lost && state->pdp_active)
+  {
+    // Losing packet domain registration takes the PDP context with it. A context activated
+    // before any registration was reported is kept, registration URCs may be off or late.
+    state->pdp_active    = false;
+    state->changed_at_us = esp_timer_get_time();
+  }
+
+  if (state->registered)
+  {
+    xEventGroupSetBits(reg->events, BG95_NET_REG_REGISTERED_BIT);
+  }
+  else
+  {
+    xEventGroupClearBits(reg->events, BG95_NET_REG_REGISTERED_BIT);
+  }
+  if (state->pdp_active)
+  {
+    xEventGroupSetBits(reg->events, BG95_NET_REG_PDP_ACTIVE_BIT);
+  }
+  else
+  {
+    xEventGroupClearBits(reg->events, BG95_NET_REG_PDP_ACTIVE_BIT);
+  }
+}
+
+static void handle_registration(bg95_net_reg_t*       reg,
+                                bg95_net_reg_domain_t domain,
+                                const char*           params)
+{
+  char   fields[NET_REG_MAX_FIELDS][NET_REG_FIELD_MAX_LEN];
+  bool   quoted[NET_REG_MAX_FIELDS];
+  size_t count = split_fields(params, fields, quoted);
+  size_t first = 0;
+
+  if (count == 0 || fields[0][0] == '\0')
+  {
+    return;
+  }
+  // Read form leads with <n>: "+CEREG: <n>,<stat>[,...]" - a second unquoted number
+  if (count >= 2 && !quoted[1] && fields[1][0] >= '0' && fields[1][0] <= '9')
+  {
+    first = 1;
+  }
+
+  bg95_net_reg_domain_state_t update = {0};
+  update.stat                        = (bg95_net_reg_stat_t) atoi(fields[first]);
+  update.present.has_stat            = true;
+  if (count > first + 2 && fields[first + 1][0] != '\0')
+  {
+    strncpy(update.area, fields[first + 1], sizeof(update.area) - 1);
+    strncpy(update.cell, fields[first + 2], sizeof(update.cell) - 1);
+    update.present.has_area = true;
+    update.present.has_cell = true;
+  }
+  if (count > first + 3 && fields[first + 3][0] != '\0')
+  {
+    update.act             = atoi(fields[first + 3]);
+    update.present.has_act = true;
+  }
+
+  xSemaphoreTake(reg->lock, portMAX_DELAY);
+  reg->state.domains[domain] = update;
+  update_summary(reg);
+  xSemaphoreGive(reg->lock);
+}
+
+esp_err_t bg95_net_reg_init(bg95_net_reg_t* reg)
+{
+  if (reg == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(reg, 0, sizeof(*reg));
+  reg->lock   = xSemaphoreCreateMutex();
+  reg->events = xEventGroupCreate();
+  if (reg->lock == NULL || reg->events == NULL)
+  {
+    bg95_net_reg_deinit(reg);
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+void bg95_net_reg_deinit(bg95_net_reg_t* reg)
+{
+  if (reg == NULL)
+  {
+    return;
+  }
+  if (reg->lock != NULL)
+  {
+    vSemaphoreDelete(reg->lock);
+  }
+  if (reg->events != NULL)
+  {
+    vEventGroupDelete(reg->events);
+  }
+  memset(reg, 0, sizeof(*reg));
+}
+
+void bg95_net_reg_handle_line(const char* line, bool solicited, void* ctx)
+{
+  bg95_net_reg_t* reg = (bg95_net_reg_t*) ctx;
+  (void) solicited; // Read responses carry the same state as URCs
+
+  if (reg == NULL || line == NULL)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < NET_REG_PREFIXES_COUNT; i++)
+  {
+    size_t prefix_len = strlen(NET_REG_PREFIXES[i].prefix);
+    if (strncmp(line, NET_REG_PREFIXES[i].prefix, prefix_len) == 0)
+    {
+      handle_registration(reg, NET_REG_PREFIXES[i].domain, line + prefix_len);
+      return;
+    }
+  }
+
+  // Packet domain events, DEACT must be checked before ACT
+  if (strncmp(line, "+CGEV: ", 7) == 0)
+  {
+    if (strstr(line, "DEACT") != NULL || strstr(line, "DETACH") != NULL)
+    {
+      bg95_net_reg_set_pdp_active(reg, false);
+    }
+    else if (strstr(line, "ACT") != NULL)
+    {
+      bg95_net_reg_set_pdp_active(reg, true);
+    }
+    return;
+  }
+  if (strncmp(line, "+QIURC: \"pdpdeact\"", 18) == 0)
+  {
+    bg95_net_reg_set_pdp_active(reg, false);
+  }
+}
+
+void bg95_net_reg_set_pdp_active(bg95_net_reg_t* reg, bool active)
+{
+  if (reg == NULL)
+  {
+    return;
+  }
+
+  xSemaphoreTake(reg->lock, portMAX_DELAY);
+  if (reg->state.pdp_active != active)
+  {
+    reg->state.pdp_active    = active;
+    reg->state.changed_at_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "PDP context %s", active ? "active" : "inactive");
+  }
+  update_summary(reg);
+  xSemaphoreGive(reg->lock);
+}
+
+void bg95_net_reg_get_state(bg95_net_reg_t* reg, bg95_net_reg_state_t* state)
+{
+  if (reg == NULL || state == NULL)
+  {
+    return;
+  }
+  xSemaphoreTake(reg->lock, portMAX_DELAY);
+  *state = reg->state;
+  xSemaphoreGive(reg->lock);
+}
+
+esp_err_t bg95_net_reg_wait(bg95_net_reg_t* reg, EventBits_t bits, uint32_t timeout_ms)
+{
+  if (reg == NULL || bits == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  EventBits_t set =
+      xEventGroupWaitBits(reg->events, bits, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+  return ((set & bits) == bits) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// Parse every line of a response buffer, for transports that bypass the URC tap
+static void handle_response_lines(bg95_net_reg_t* reg, const char* response)
+{
+  char        line[BG95_RAW_AT_CMD_MAX_LEN];
+  const char* start = response;
+  const char* eol;
+
+  while ((eol = strstr(start, "\r\n")) != NULL)
+  {
+    size_t len = (size_t) (eol - start);
+    if (len > 0 && len < sizeof(line))
+    {
+      memcpy(line, start, len);
+      line[len] = '\0';
+      bg95_net_reg_handle_line(line, true, reg);
+    }
+    start = eol + 2;
+  }
+}
+
+esp_err_t bg95_net_reg_enable_urcs(bg95_net_reg_t* reg, bg95_uart_interface_t* uart)
+{
+  if (reg == NULL || uart == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  char      response[BG95_RAW_AT_RESPONSE_MAX_LEN];
+  esp_err_t err = bg95_raw_at_send(
+      uart, "AT+CREG=2;+CGREG=2;+CEREG=2", response, sizeof(response), BG95_NET_REG_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to enable registration URCs: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  // Packet domain event reporting is optional, PDP state then comes from set_pdp_active only
+  err = bg95_raw_at_send(
+      uart, "AT+CGEREP=2,1", response, sizeof(response), BG95_NET_REG_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "+CGEV reporting not enabled: %s", esp_err_to_name(err));
+  }
+
+  err = bg95_raw_at_send(
+      uart, "AT+CREG?;+CGREG?;+CEREG?", response, sizeof(response), BG95_NET_REG_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Failed to read initial registration state: %s", esp_err_to_name(err));
+    return err;
+  }
+  handle_response_lines(reg, response);
+
+  return ESP_OK;
+}
@@ -0,0 +1,714 @@
+#include "bg95_poll.h"
+
+#include <esp_log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "BG95_POLL";
+
+#define IDLE_READ_CHUNK 64
+
+esp_err_t bg95_poll_init(bg95_poll_t*           poll,
+                         bg95_uart_interface_t* uart,
+                         bg95_poll_urc_fn_t     urc,
+                         void*                  urc_ctx)
+{
+  if (poll == NULL || uart == NULL || uart->write == NULL || uart->read == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(poll, 0, sizeof(*poll));
+  poll->uart    = uart;
+  poll->urc     = urc;
+  poll->urc_ctx = urc_ctx;
+  poll->state   = BG95_POLL_STATE_IDLE;
+  return ESP_OK;
+}
+
+esp_err_t bg95_poll_set_sched(bg95_poll_t* poll, bg95_sched_t* sched)
+{
+  if (poll == NULL || poll->uart == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (poll->state != BG95_POLL_STATE_IDLE)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // A request queued for a command that has not been written yet
+  bg95_sched_cancel_pending(poll->sched);
+  poll->sched = sched;
+  return ESP_OK;
+}
+
+// ----------- Queue -------------------
+
+static bg95_poll_cmd_t* queue_slot(bg95_poll_t* poll, const char* cmd, esp_err_t* err)
+{
+  if (poll == NULL || poll->uart == NULL || cmd == NULL)
+  {
+    *err = ESP_ERR_INVALID_ARG;
+    return NULL;
+  }
+  if (poll->closing)
+  {
+    *err = ESP_ERR_INVALID_STATE;
+    return NULL;
+  }
+  if (poll->count >= BG95_POLL_MAX_CMDS)
+  {
+    *err = ESP_ERR_NO_MEM;
+    return NULL;
+  }
+
+  bg95_poll_cmd_t* slot = &poll->queue[(poll->head + poll->count) % BG95_POLL_MAX_CMDS];
+  memset(slot, 0, sizeof(*slot));
+
+  int len = snprintf(slot->cmd_line, sizeof(slot->cmd_line), "%s\r\n", cmd);
+  if (len < 0 || (size_t) len >= sizeof(slot->cmd_line))
+  {
+    ESP_LOGE(TAG, "Command line too long");
+    *err = ESP_ERR_INVALID_SIZE;
+    return NULL;
+  }
+  slot->cmd_len = (size_t) len;
+  *err          = ESP_OK;
+  return slot;
+}
+
+esp_err_t bg95_poll_submit(bg95_poll_t*        poll,
+                           const char*         cmd,
+                           uint32_t            timeout_ms,
+                           bg95_poll_done_fn_t done,
+                           void*               done_ctx)
+{
+  return bg95_poll_submit_data(poll, cmd, NULL, 0, timeout_ms, done, done_ctx);
+}
+
+esp_err_t bg95_poll_submit_data(bg95_poll_t*        poll,
+                                const char*         cmd,
+                                const char*         data,
+                                size_t              len,
+                                uint32_t            timeout_ms,
+                                bg95_poll_done_fn_t done,
+                                void*               done_ctx)
+{
+  esp_err_t        err;
+  bg95_poll_cmd_t* slot = queue_slot(poll, cmd, &err);
+  if (slot == NULL)
+  {
+    return err;
+  }
+  if (data == NULL && len > 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  slot->data       = len > 0 ? data : NULL;
+  slot->data_len   = len;
+  slot->timeout_ms = timeout_ms;
+  slot->done       = done;
+  slot->done_ctx   = done_ctx;
+  poll->count++;
+  return ESP_OK;
+}
+
+esp_err_t bg95_poll_submit_cmd(bg95_poll_t*        poll,
+                               const at_cmd_t*     cmd,
+                               at_cmd_type_t       type,
+                               const void*         params,
+                               void*               parsed_out,
+                               bg95_poll_done_fn_t done,
+                               void*               done_ctx)
+{
+  char      cmd_line[BG95_RAW_AT_CMD_MAX_LEN];
+  esp_err_t err = bg95_raw_at_format_cmd(cmd, type, params, cmd_line, sizeof(cmd_line));
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  bg95_poll_cmd_t* slot = queue_slot(poll, cmd_line, &err);
+  if (slot == NULL)
+  {
+    return err;
+  }
+
+  slot->timeout_ms = cmd->timeout_ms;
+  slot->cmd        = cmd;
+  slot->type       = type;
+  slot->parsed_out = parsed_out;
+  slot->done       = done;
+  slot->done_ctx   = done_ctx;
+  poll->count++;
+  return ESP_OK;
+}
+
+size_t bg95_poll_pending(const bg95_poll_t* poll)
+{
+  return poll != NULL ? poll->count : 0;
+}
+
+// Pop the in flight command and report 'result'. The slot is released before 'done' runs, so the
+// callback can submit again.
+static void complete(bg95_poll_t* poll, esp_err_t result)
+{
+  bg95_poll_cmd_t cmd = poll->queue[poll->head];
+
+  // A failed MQTT outcome is parsed as well, its result code tells why
+  const bool outcome = poll->state == BG95_POLL_STATE_WAIT_URC && result == ESP_FAIL;
+
+  poll->head  = (poll->head + 1) % BG95_POLL_MAX_CMDS;
+  poll->count--;
+  poll->state = BG95_POLL_STATE_IDLE;
+  if (poll->sched_held)
+  {
+    bg95_sched_release(poll->sched);
+    poll->sched_held = false;
+  }
+
+  if ((result == ESP_OK || outcome) && cmd.cmd != NULL)
+  {
+    esp_err_t err = bg95_raw_at_parse(
+        cmd.cmd, cmd.type, poll->response, sizeof(poll->response), cmd.parsed_out);
+    result = result == ESP_OK ? err : result;
+  }
+
+  if (result == ESP_OK)
+  {
+    poll->stats.completed++;
+  }
+  else if (result == ESP_ERR_TIMEOUT)
+  {
+    poll->stats.timeouts++;
+  }
+  else
+  {
+    poll->stats.failed++;
+  }
+
+  if (cmd.done != NULL)
+  {
+    cmd.done(result, poll->response, cmd.done_ctx);
+  }
+}
+
+void bg95_poll_deinit(bg95_poll_t* poll)
+{
+  if (poll == NULL)
+  {
+    return;
+  }
+  // A 'done' callback that submits again would otherwise keep the queue from ever draining
+  poll->closing = true;
+  while (poll->count > 0)
+  {
+    complete(poll, ESP_ERR_INVALID_STATE);
+  }
+  bg95_sched_cancel_pending(poll->sched);
+  memset(poll, 0, sizeof(*poll));
+}
+
+// ----------- Idle: URC lines -------------------
+
+static void dispatch_urc(bg95_poll_t* poll, const char* line)
+{
+  poll->stats.urc_lines++;
+  if (poll->urc != NULL)
+  {
+    poll->urc(line, poll->urc_ctx);
+  }
+}
+
+static void idle_byte(bg95_poll_t* poll, char c)
+{
+  if (c == '\n' && poll->line_len > 0 && poll->line[poll->line_len - 1] == '\r')
+  {
+    poll->line[poll->line_len - 1] = '\0';
+    if (poll->line_len > 1)
+    {
+      dispatch_urc(poll, poll->line);
+    }
+    poll->line_len = 0;
+    return;
+  }
+
+  if (poll->line_len < sizeof(poll->line) - 1)
+  {
+    poll->line[poll->line_len++] = c;
+  }
+  else if (c == '\r')
+  {
+    // Keep the end of an overlong line detectable, the rest of it is dropped
+    if (poll->line[poll->line_len - 1] != '\r')
+    {
+      poll->stats.long_lines++;
+    }
+    poll->line[poll->line_len - 1] = '\r';
+  }
+}
+
+static void read_idle(bg95_poll_t* poll)
+{
+  char chunk[IDLE_READ_CHUNK];
+
+  for (int i = 0; i < BG95_POLL_MAX_READS; i++)
+  {
+    size_t    bytes_read = 0;
+    esp_err_t err = poll->uart->read(chunk, sizeof(chunk), &bytes_read, 0, poll->uart->context);
+    if ((err != ESP_OK && err != ESP_ERR_TIMEOUT) || bytes_read == 0)
+    {
+      return;
+    }
+    for (size_t j = 0; j < bytes_read; j++)
+    {
+      idle_byte(poll, chunk[j]);
+    }
+  }
+}
+
+// ----------- In flight command -------------------
+
+// Grant for the next command, false while another user holds the modem
+static bool grant_next(bg95_poll_t* poll)
+{
+  if (poll->sched == NULL)
+  {
+    return true;
+  }
+
+  const bg95_poll_cmd_t*  cmd  = &poll->queue[poll->head];
+  const bg95_sched_lane_t lane = cmd->data != NULL ? bg95_sched_publish_lane(cmd->data_len)
+                                                   : bg95_sched_cmd_lane(cmd->cmd_line);
+  if (bg95_sched_acquire_pending(poll->sched, lane) != ESP_OK)
+  {
+    return false;
+  }
+  poll->sched_held = true;
+  return true;
+}
+
+static esp_err_t start_next(bg95_poll_t* poll, uint32_t now_ms)
+{
+  bg95_poll_cmd_t* cmd = &poll->queue[poll->head];
+
+  // A partial unsolicited line belongs in front of the response, where a blocking read after
+  // the write would have found it
+  memcpy(poll->response, poll->line, poll->line_len);
+  poll->response_len             = poll->line_len;
+  poll->response[poll->line_len] = '\0';
+  poll->scan_len                 = 0;
+  poll->line_len                 = 0;
+
+  esp_err_t err = poll->uart->write(cmd->cmd_line, cmd->cmd_len, poll->uart->context);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to write command: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  poll->started_ms = now_ms;
+  poll->state = cmd->data != NULL ? BG95_POLL_STATE_WAIT_PROMPT : BG95_POLL_STATE_WAIT_RESULT;
+  return ESP_OK;
+}
+
+// The modem sends nothing after its prompt until the data arrived, so it is always the tail
+static bool has_prompt(const bg95_poll_t* poll)
+{
+  return poll->response_len >= 2 &&
+         memcmp(poll->response + poll->response_len - 2, "> ", 2) == 0;
+}
+
+// ----------- Response lines -------------------
+
+// MQTT commands that answer "OK" on acceptance and report their outcome in a later "+QMTxxx:"
+// line. The first 'keys' parameters (client index, message id) tie that line to the command, the
+// 'checks' parameters after them are result codes that have to be 0. A first result code equal to
+// 'retransmit' reports a packet retransmission, the outcome is still to come.
+typedef struct
+{
+  const char* name;
+  int         keys;
+  int         checks;
+  int         retransmit; // NO_RETRANSMIT when the command has no such report
+} mqtt_result_t;
+
+#define NO_RETRANSMIT (-2) // Not a result code of any MQTT command
+
+static const mqtt_result_t mqtt_results[] = {
+    {"QMTOPEN", 1, 1, NO_RETRANSMIT},
+    {"QMTCLOSE", 1, 1, NO_RETRANSMIT},
+    {"QMTCONN", 1, 2, 1}, // <result>,<ret_code>
+    {"QMTDISC", 1, 1, NO_RETRANSMIT},
+    {"QMTSUB", 2, 1, 1},
+    {"QMTUNS", 2, 1, 1},
+    {"QMTPUB", 2, 1, 1},
+    {"QMTPUBEX", 2, 1, 1},
+};
+
+// The entry for a write of one of the commands above, NULL for anything else
+static const mqtt_result_t* mqtt_result_of(const char* cmd_line)
+{
+  if (strncmp(cmd_line, "AT+", 3) != 0)
+  {
+    return NULL;
+  }
+  for (size_t i = 0; i < sizeof(mqtt_results) / sizeof(mqtt_results[0]); i++)
+  {
+    size_t name_len = strlen(mqtt_results[i].name);
+    if (strncmp(cmd_line + 3, mqtt_results[i].name, name_len) == 0 && cmd_line[3 + name_len] == '=')
+    {
+      return &mqtt_results[i];
+    }
+  }
+  return NULL;
+}
+
+// Whether a "+NAME:" line carries the name of one of the commands in 'cmd_line'
+// ("AT+CPIN?;+CSQ" -> "CPIN", "CSQ")
+static bool names_line(const char* cmd_line, const char* line, size_t len)
+{
+  const char* name = cmd_line + 2; // Skip "AT"
+  while (*name == '+')
+  {
+    name++;
+    size_t name_len = strcspn(name, "=?;\r");
+    if (name_len > 0 && 1 + name_len < len && strncmp(line + 1, name, name_len) == 0 &&
+        line[1 + name_len] == ':')
+    {
+      return true;
+    }
+    name += strcspn(name, ";");
+    if (*name == ';')
+    {
+      name++;
+    }
+  }
+  return false;
+}
+
+// The result line of 'result' for the command in 'cmd_line' with its keys matched. Returns the
+// position of the first result code in 'line', NULL when the line is not it.
+static const char* match_result(const mqtt_result_t* result,
+                                const char*          cmd_line,
+                                const char*          line,
+                                size_t               len)
+{
+  const char* end      = line + len;
+  size_t      name_len = strlen(result->name);
+  if (len < name_len + 2 || line[0] != '+' || strncmp(line + 1, result->name, name_len) != 0 ||
+      line[1 + name_len] != ':')
+  {
+    return NULL;
+  }
+
+  const char* p = line + name_len + 2;
+  while (p < end && *p == ' ')
+  {
+    p++;
+  }
+  const char* key = strchr(cmd_line, '=') + 1;
+  for (int i = 0; i < result->keys; i++)
+  {
+    size_t key_len = strcspn(key, ",\r");
+    if ((size_t) (end - p) <= key_len || strncmp(p, key, key_len) != 0 || p[key_len] != ',')
+    {
+      return NULL;
+    }
+    p += key_len + 1;
+    key += key_len;
+    if (*key == ',')
+    {
+      key++;
+    }
+  }
+  return p;
+}
+
+static bool is_final_line(const char* line, size_t len)
+{
+  if ((len == 2 && strncmp(line, "OK", 2) == 0) || (len == 5 && strncmp(line, "ERROR", 5) == 0))
+  {
+    return true;
+  }
+  return len >= 11 &&
+         (strncmp(line, "+CME ERROR:", 11) == 0 || strncmp(line, "+CMS ERROR:", 11) == 0);
+}
+
+// A numeric final result code at a line start, see bg95_raw_at_has_numeric_result()
+static bool is_numeric_final(const char* line, size_t len)
+{
+  return len >= 2 && line[0] >= '0' && line[0] <= '9' && line[1] == '\r' &&
+         (len == 2 || line[2] != '\n');
+}
+
+static const char* find_line_end(const char* line, size_t len)
+{
+  const char* end = line + len;
+  const char* cr  = line;
+  while ((cr = memchr(cr, '\r', (size_t) (end - cr))) != NULL && cr + 1 < end)
+  {
+    if (cr[1] == '\n')
+    {
+      return cr;
+    }
+    cr++;
+  }
+  return NULL;
+}
+
+// Hand the 'len' byte line at the scan position to the URC callback and cut it out of the
+// response, together with the empty line framing it
+static void cut_urc(bg95_poll_t* poll, size_t len)
+{
+  char   urc[BG95_POLL_LINE_MAX_LEN];
+  char*  line = poll->response + poll->scan_len;
+  size_t copy = len < sizeof(urc) - 1 ? len : sizeof(urc) - 1;
+
+  if (copy < len)
+  {
+    poll->stats.long_lines++;
+  }
+  memcpy(urc, line, copy);
+  urc[copy] = '\0';
+
+  size_t from = poll->scan_len;
+  if (from >= 2 && memcmp(poll->response + from - 2, "\r\n", 2) == 0 &&
+      (from == 2 || poll->response[from - 3] == '\n'))
+  {
+    from -= 2;
+  }
+  size_t to = poll->scan_len + len + 2;
+  memmove(poll->response + from, poll->response + to, poll->response_len - to + 1);
+  poll->response_len -= to - from;
+  poll->scan_len = from;
+
+  dispatch_urc(poll, urc);
+}
+
+// Result codes of an MQTT result line. Returns false for a retransmission report, which is a URC.
+static bool mqtt_outcome(const mqtt_result_t* result, const char* codes, esp_err_t* err)
+{
+  *err = ESP_OK;
+  for (int i = 0; i < result->checks && codes != NULL; i++)
+  {
+    char* next;
+    long  code = strtol(codes, &next, 10);
+    if (next == codes)
+    {
+      *err = ESP_FAIL;
+      return true;
+    }
+    if (i == 0 && code == result->retransmit)
+    {
+      return false;
+    }
+    if (code != 0)
+    {
+      *err = ESP_FAIL;
+      return true;
+    }
+    codes = *next == ',' ? next + 1 : NULL;
+  }
+  return true;
+}
+
+// The command ends at the scan position. Whatever follows is idle input again.
+static void finish(bg95_poll_t* poll)
+{
+  for (size_t i = poll->scan_len; i < poll->response_len; i++)
+  {
+    idle_byte(poll, poll->response[i]);
+  }
+  poll->response_len                 = poll->scan_len;
+  poll->response[poll->response_len] = '\0';
+}
+
+// A final result code arrived. Returns true once the command finished, with its result in
+// 'result'; an MQTT command that was accepted waits for its result line instead.
+static bool final_result(bg95_poll_t* poll, bool ok, esp_err_t* result)
+{
+  if (ok && mqtt_result_of(poll->queue[poll->head].cmd_line) != NULL)
+  {
+    poll->state = BG95_POLL_STATE_WAIT_URC;
+    return false;
+  }
+  *result = ok ? ESP_OK : ESP_FAIL;
+  finish(poll);
+  return true;
+}
+
+// Go through the complete lines received since the last call. The command's own lines stay in
+// the response, URCs go to the callback. Returns true once the command finished, with its
+// result in 'result'.
+static bool split_lines(bg95_poll_t* poll, esp_err_t* result)
+{
+  const bg95_poll_cmd_t* cmd     = &poll->queue[poll->head];
+  const bool             numeric = bg95_raw_at_is_numeric(poll->uart);
+
+  while (poll->scan_len < poll->response_len)
+  {
+    const char* line = poll->response + poll->scan_len;
+    size_t      rest = poll->response_len - poll->scan_len;
+
+    if (numeric && poll->state != BG95_POLL_STATE_WAIT_URC && is_numeric_final(line, rest))
+    {
+      poll->scan_len += 2;
+      if (final_result(poll, line[0] - '0' == BG95_RAW_AT_NUMERIC_OK, result))
+      {
+        return true;
+      }
+      continue;
+    }
+
+    const char* eol = find_line_end(line, rest);
+    if (eol == NULL)
+    {
+      return false;
+    }
+    size_t len  = (size_t) (eol - line);
+    size_t next = poll->scan_len + len + 2;
+
+    if (poll->state == BG95_POLL_STATE_WAIT_URC)
+    {
+      // Past the "OK" only the result line belongs to the command
+      if (len == 0)
+      {
+        poll->scan_len = next;
+        continue;
+      }
+      const mqtt_result_t* mqtt  = mqtt_result_of(cmd->cmd_line);
+      const char*          codes = match_result(mqtt, cmd->cmd_line, line, len);
+      if (codes == NULL || !mqtt_outcome(mqtt, codes < eol ? codes : NULL, result))
+      {
+        cut_urc(poll, len);
+        continue;
+      }
+      poll->scan_len = next;
+      finish(poll);
+      return true;
+    }
+
+    if (is_final_line(line, len))
+    {
+      poll->scan_len = next;
+      if (final_result(poll, len == 2, result))
+      {
+        return true;
+      }
+      continue;
+    }
+    if (line[0] == '+' && !names_line(cmd->cmd_line, line, len))
+    {
+      cut_urc(poll, len);
+      continue;
+    }
+    poll->scan_len = next;
+  }
+  return false;
+}
+
+// Read what is buffered into the response. Returns true once the command finished, with its
+// result in 'result'.
+static bool read_response(bg95_poll_t* poll, uint32_t now_ms, esp_err_t* result)
+{
+  bg95_poll_cmd_t* cmd = &poll->queue[poll->head];
+
+  for (int i = 0; i < BG95_POLL_MAX_READS; i++)
+  {
+    if (split_lines(poll, result))
+    {
+      return true;
+    }
+    if (poll->state == BG95_POLL_STATE_WAIT_PROMPT && has_prompt(poll))
+    {
+      esp_err_t err = poll->uart->write(cmd->data, cmd->data_len, poll->uart->context);
+      if (err != ESP_OK)
+      {
+        ESP_LOGE(TAG, "Failed to write data: %s", esp_err_to_name(err));
+        *result = err;
+        return true;
+      }
+      poll->state = BG95_POLL_STATE_WAIT_RESULT;
+    }
+    if (poll->response_len >= sizeof(poll->response) - 1)
+    {
+      ESP_LOGE(TAG, "Response buffer full before final result code");
+      *result = ESP_ERR_INVALID_SIZE;
+      return true;
+    }
+
+    char*     dst        = poll->response + poll->response_len;
+    size_t    room       = sizeof(poll->response) - 1 - poll->response_len;
+    size_t    bytes_read = 0;
+    esp_err_t err        = poll->uart->read(dst, room, &bytes_read, 0, poll->uart->context);
+    if (err != ESP_OK && err != ESP_ERR_TIMEOUT)
+    {
+      ESP_LOGE(TAG, "UART read failed: %s", esp_err_to_name(err));
+      *result = err;
+      return true;
+    }
+    poll->response_len += bytes_read;
+    poll->response[poll->response_len] = '\0';
+    if (bytes_read == 0)
+    {
+      break;
+    }
+  }
+
+  if (split_lines(poll, result))
+  {
+    return true;
+  }
+  if (now_ms - poll->started_ms >= cmd->timeout_ms)
+  {
+    ESP_LOGW(TAG, "Timeout waiting for response to '%.*s'", (int) cmd->cmd_len - 2, cmd->cmd_line);
+    *result = ESP_ERR_TIMEOUT;
+    return true;
+  }
+  return false;
+}
+
+bool bg95_poll(bg95_poll_t* poll, uint32_t now_ms)
+{
+  if (poll == NULL || poll->uart == NULL)
+  {
+    return false;
+  }
+
+  // Each pass completes a command or leaves it waiting for more bytes. Commands that 'done'
+  // callbacks keep submitting wait for the next call once a queue's worth finished.
+  for (int i = 0; i < BG95_POLL_MAX_CMDS; i++)
+  {
+    esp_err_t result;
+    if (poll->state == BG95_POLL_STATE_IDLE)
+    {
+      read_idle(poll);
+      if (poll->count == 0)
+      {
+        return false;
+      }
+      if (!grant_next(poll))
+      {
+        return true;
+      }
+
+      result = start_next(poll, now_ms);
+      if (result != ESP_OK)
+      {
+        complete(poll, result);
+        continue;
+      }
+    }
+
+    if (!read_response(poll, now_ms, &result))
+    {
+      return true;
+    }
+    complete(poll, result);
+  }
+  return poll->count > 0;
+}
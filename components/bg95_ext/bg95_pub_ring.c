@@ -0,0 +1,272 @@
+#include "bg95_pub_ring.h"
+
+#include "bg95_publish.h"
+#include "freertos/task.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BG95_PUB_RING";
+
+#define RING_MASK (BG95_PUB_RING_SIZE - 1)
+
+_Static_assert((BG95_PUB_RING_SIZE & RING_MASK) == 0, "BG95_PUB_RING_SIZE must be a power of two");
+
+typedef struct
+{
+  bg95_pub_ring_t*      ring;
+  bg95_handle_t*        handle;
+  bg95_sched_t*         sched;
+  bg95_rtt_estimator_t* rtt;
+  int                   client_idx;
+} driver_ctx_t;
+
+esp_err_t bg95_pub_ring_init(bg95_pub_ring_t* ring, const char* const* topics, size_t num_topics)
+{
+  if (ring == NULL || topics == NULL || num_topics == 0 || num_topics > UINT16_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(ring, 0, sizeof(*ring));
+  ring->topics     = topics;
+  ring->num_topics = num_topics;
+  ring->ready      = xSemaphoreCreateBinary();
+  if (ring->ready == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  for (uint32_t i = 0; i < BG95_PUB_RING_SIZE; i++)
+  {
+    atomic_init(&ring->cells[i].seq, i);
+  }
+  atomic_init(&ring->tail, 0);
+  atomic_init(&ring->consumer_waiting, false);
+  atomic_init(&ring->enqueued, 0);
+  atomic_init(&ring->full, 0);
+  return ESP_OK;
+}
+
+void bg95_pub_ring_deinit(bg95_pub_ring_t* ring)
+{
+  if (ring == NULL)
+  {
+    return;
+  }
+  if (ring->ready != NULL)
+  {
+    vSemaphoreDelete(ring->ready);
+  }
+  memset(ring, 0, sizeof(*ring));
+}
+
+esp_err_t bg95_pub_ring_try_enqueue(bg95_pub_ring_t* ring, const bg95_pub_desc_t* desc)
+{
+  if (ring == NULL || ring->ready == NULL || desc == NULL || (desc->payload == NULL && desc->len))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  bg95_pub_ring_cell_t* cell;
+  unsigned int          pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  for (;;)
+  {
+    cell              = &ring->cells[pos & RING_MASK];
+    unsigned int seq  = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    int32_t      diff = (int32_t) (seq - pos);
+    if (diff == 0)
+    {
+      // Free for this lap, claim it. A failed exchange reloads 'pos' and tries again.
+      if (atomic_compare_exchange_weak_explicit(
+              &ring->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (diff < 0)
+    {
+      // Still holding the previous lap's descriptor, the consumer is a full ring behind
+      atomic_fetch_add_explicit(&ring->full, 1, memory_order_relaxed);
+      return ESP_ERR_NO_MEM;
+    }
+    else
+    {
+      pos = atomic_load_explicit(&ring->tail, memory_order_relaxed); // Another producer won
+    }
+  }
+
+  cell->desc = *desc;
+  atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+  atomic_fetch_add_explicit(&ring->enqueued, 1, memory_order_relaxed);
+
+  // Pairs with the fence in wait(): the seq store must be visible before the flag is read, or
+  // both sides can miss each other and the consumer sleeps on a queued descriptor
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_exchange(&ring->consumer_waiting, false))
+  {
+    xSemaphoreGive(ring->ready);
+  }
+  return ESP_OK;
+}
+
+esp_err_t bg95_pub_ring_enqueue(bg95_pub_ring_t*       ring,
+                                const bg95_pub_desc_t* desc,
+                                uint32_t               timeout_ms)
+{
+  TickType_t start = xTaskGetTickCount();
+  TickType_t limit = pdMS_TO_TICKS(timeout_ms);
+
+  for (;;)
+  {
+    esp_err_t err = bg95_pub_ring_try_enqueue(ring, desc);
+    if (err != ESP_ERR_NO_MEM)
+    {
+      return err;
+    }
+    if (xTaskGetTickCount() - start >= limit)
+    {
+      return ESP_ERR_TIMEOUT;
+    }
+    vTaskDelay(1);
+  }
+}
+
+bool bg95_pub_ring_dequeue(bg95_pub_ring_t* ring, bg95_pub_desc_t* desc)
+{
+  if (ring == NULL || desc == NULL)
+  {
+    return false;
+  }
+
+  bg95_pub_ring_cell_t* cell = &ring->cells[ring->head & RING_MASK];
+  unsigned int          seq  = atomic_load_explicit(&cell->seq, memory_order_acquire);
+  if ((int32_t) (seq - (ring->head + 1)) < 0)
+  {
+    return false; // Empty, or a producer claimed the cell and is still copying
+  }
+
+  *desc = cell->desc;
+  atomic_store_explicit(&cell->seq, ring->head + BG95_PUB_RING_SIZE, memory_order_release);
+  ring->head++;
+  return true;
+}
+
+static bool has_queued(bg95_pub_ring_t* ring)
+{
+  bg95_pub_ring_cell_t* cell = &ring->cells[ring->head & RING_MASK];
+  unsigned int          seq  = atomic_load_explicit(&cell->seq, memory_order_acquire);
+  return (int32_t) (seq - (ring->head + 1)) >= 0;
+}
+
+bool bg95_pub_ring_wait(bg95_pub_ring_t* ring, uint32_t timeout_ms)
+{
+  if (ring == NULL || ring->ready == NULL)
+  {
+    return false;
+  }
+  if (has_queued(ring))
+  {
+    return true;
+  }
+
+  // Announce the sleep, then look again: a producer that filled a cell before the flag was set
+  // is caught by the second check, one after it gives 'ready'
+  xSemaphoreTake(ring->ready, 0);
+  atomic_store(&ring->consumer_waiting, true);
+  atomic_thread_fence(memory_order_seq_cst); // Flag store before the seq re-check, see enqueue
+  if (!has_queued(ring))
+  {
+    xSemaphoreTake(ring->ready, pdMS_TO_TICKS(timeout_ms));
+  }
+  atomic_store(&ring->consumer_waiting, false);
+  return has_queued(ring);
+}
+
+size_t bg95_pub_ring_drain(bg95_pub_ring_t*           ring,
+                           bg95_pub_ring_publish_fn_t publish,
+                           void*                      ctx,
+                           size_t                     max)
+{
+  bg95_pub_desc_t desc;
+  size_t          drained = 0;
+
+  if (publish == NULL)
+  {
+    return 0;
+  }
+
+  while (drained < max && bg95_pub_ring_dequeue(ring, &desc))
+  {
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    if (desc.topic_id < ring->num_topics)
+    {
+      err = publish(ring->topics[desc.topic_id], &desc, ctx);
+    }
+    else
+    {
+      ESP_LOGW(TAG, "Unknown topic id %u", (unsigned) desc.topic_id);
+    }
+
+    if (err == ESP_OK)
+    {
+      ring->published++;
+    }
+    else
+    {
+      ring->failed++;
+    }
+    if (desc.done != NULL)
+    {
+      desc.done(&desc, err, desc.done_ctx);
+    }
+    drained++;
+  }
+  return drained;
+}
+
+static esp_err_t driver_publish(const char* topic, const bg95_pub_desc_t* desc, void* ctx)
+{
+  driver_ctx_t* driver = (driver_ctx_t*) ctx;
+
+  return bg95_publish_fixed_length(driver->handle,
+                                   driver->sched,
+                                   driver->rtt,
+                                   BG95_SCHED_NO_DEADLINE,
+                                   driver->client_idx,
+                                   &driver->ring->next_msgid,
+                                   desc->qos,
+                                   desc->retain,
+                                   topic,
+                                   desc->payload,
+                                   desc->len);
+}
+
+size_t bg95_pub_ring_drain_to_driver(bg95_pub_ring_t*      ring,
+                                     bg95_handle_t*        handle,
+                                     bg95_sched_t*         sched,
+                                     bg95_rtt_estimator_t* rtt,
+                                     int                   client_idx,
+                                     size_t                max)
+{
+  driver_ctx_t ctx = {
+      .ring = ring, .handle = handle, .sched = sched, .rtt = rtt, .client_idx = client_idx};
+
+  if (ring == NULL || handle == NULL)
+  {
+    return 0;
+  }
+  return bg95_pub_ring_drain(ring, driver_publish, &ctx, max);
+}
+
+void bg95_pub_ring_get_stats(bg95_pub_ring_t* ring, bg95_pub_ring_stats_t* stats)
+{
+  if (ring == NULL || stats == NULL)
+  {
+    return;
+  }
+  stats->enqueued  = atomic_load_explicit(&ring->enqueued, memory_order_relaxed);
+  stats->full      = atomic_load_explicit(&ring->full, memory_order_relaxed);
+  stats->published = ring->published;
+  stats->failed    = ring->failed;
+}
@@ -0,0 +1,58 @@
+#include "bg95_publish.h"
+
+#include "at_cmd_qmtpub.h"
+
+#include <esp_timer.h>
+
+esp_err_t bg95_publish_fixed_length(bg95_handle_t*        handle,
+                                    bg95_sched_t*         sched,
+                                    bg95_rtt_estimator_t* rtt,
+                                    int64_t               deadline_us,
+                                    int                   client_idx,
+                                    uint16_t*             next_msgid,
+                                    qmtpub_qos_t          qos,
+                                    qmtpub_retain_t       retain,
+                                    const char*           topic,
+                                    const char*           payload,
+                                    size_t                len)
+{
+  qmtpub_write_response_t response = {0};
+  int                     msgid    = 0;
+
+  if (sched != NULL)
+  {
+    esp_err_t err = bg95_sched_acquire_by(sched, bg95_sched_publish_lane(len), deadline_us);
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+  }
+
+  if (qos != QMTPUB_QOS_AT_MOST_ONCE)
+  {
+    *next_msgid = *next_msgid == 0 || *next_msgid == UINT16_MAX ? 1 : *next_msgid + 1;
+    msgid       = *next_msgid;
+  }
+
+  int64_t   start_us = esp_timer_get_time();
+  esp_err_t err      = bg95_mqtt_publish_fixed_length(
+      handle, client_idx, msgid, qos, retain, topic, payload, len, &response);
+  bg95_rtt_estimator_observe(rtt,
+                             &AT_CMD_QMTPUB,
+                             AT_CMD_TYPE_WRITE,
+                             err,
+                             (uint32_t) ((esp_timer_get_time() - start_us) / 1000));
+  if (sched != NULL)
+  {
+    bg95_sched_release(sched);
+  }
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  if (!response.present.has_result || response.result != QMTPUB_RESULT_SUCCESS)
+  {
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
@@ -0,0 +1,286 @@
+#include "bg95_query_cache.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+
+static const char* TAG = "BG95_QUERY_CACHE";
+
+#define ENTRY_BIT(id) (1u << (id))
+
+typedef struct
+{
+  const at_cmd_t* cmd;
+  at_cmd_type_t   type;
+  size_t          value_size;
+} cache_entry_info_t;
+
+static const cache_entry_info_t CACHE_ENTRY_INFO[BG95_QUERY_CACHE_ENTRY_MAX] = {
+    [BG95_QUERY_CACHE_CPIN_READ]    = {&AT_CMD_CPIN,
+                                       AT_CMD_TYPE_READ,
+                                       sizeof(cpin_read_response_t)},
+    [BG95_QUERY_CACHE_COPS_READ]    = {&AT_CMD_COPS,
+                                       AT_CMD_TYPE_READ,
+                                       sizeof(cops_read_response_t)},
+    [BG95_QUERY_CACHE_CGDCONT_READ] = {&AT_CMD_CGDCONT,
+                                       AT_CMD_TYPE_READ,
+                                       sizeof(cgdcont_read_response_t)},
+    [BG95_QUERY_CACHE_QMTCFG_TEST]  = {&AT_CMD_QMTCFG,
+                                       AT_CMD_TYPE_TEST,
+                                       sizeof(qmtcfg_test_response_t)},
+    [BG95_QUERY_CACHE_QMTOPEN_READ] = {&AT_CMD_QMTOPEN,
+                                       AT_CMD_TYPE_READ,
+                                       sizeof(qmtopen_read_response_t)},
+    [BG95_QUERY_CACHE_QMTCONN_READ] = {&AT_CMD_QMTCONN,
+                                       AT_CMD_TYPE_READ,
+                                       sizeof(qmtconn_read_response_t)},
+};
+
+typedef struct
+{
+  const char* prefix;
+  uint32_t    entries;
+} cache_urc_rule_t;
+
+// Which cached results each URC makes stale
+static const cache_urc_rule_t CACHE_URC_RULES[] = {
+    {"+CPIN:", ENTRY_BIT(BG95_QUERY_CACHE_CPIN_READ) | ENTRY_BIT(BG95_QUERY_CACHE_COPS_READ)},
+    {"+CREG:", ENTRY_BIT(BG95_QUERY_CACHE_COPS_READ) | ENTRY_BIT(BG95_QUERY_CACHE_CGDCONT_READ)},
+    {"+CGREG:", ENTRY_BIT(BG95_QUERY_CACHE_COPS_READ) | ENTRY_BIT(BG95_QUERY_CACHE_CGDCONT_READ)},
+    {"+CEREG:", ENTRY_BIT(BG95_QUERY_CACHE_COPS_READ) | ENTRY_BIT(BG95_QUERY_CACHE_CGDCONT_READ)},
+    {"+QMTSTAT:",
+     ENTRY_BIT(BG95_QUERY_CACHE_QMTOPEN_READ) | ENTRY_BIT(BG95_QUERY_CACHE_QMTCONN_READ)},
+    {"+QMTOPEN:", ENTRY_BIT(BG95_QUERY_CACHE_QMTOPEN_READ)},
+    {"+QMTCLOSE:", ENTRY_BIT(BG95_QUERY_CACHE_QMTOPEN_READ)},
+    {"+QMTCONN:", ENTRY_BIT(BG95_QUERY_CACHE_QMTCONN_READ)},
+    {"+QMTDISC:", ENTRY_BIT(BG95_QUERY_CACHE_QMTCONN_READ)},
+    {"RDY", 0xFFFFFFFFu}, // Modem restarted, nothing cached is valid anymore
+};
+
+#define CACHE_URC_RULES_COUNT (sizeof(CACHE_URC_RULES) / sizeof(CACHE_URC_RULES[0]))
+
+static int find_entry(const at_cmd_t* cmd, at_cmd_type_t type)
+{
+  for (int id = 0; id < BG95_QUERY_CACHE_ENTRY_MAX; id++)
+  {
+    if (CACHE_ENTRY_INFO[id].cmd == cmd && CACHE_ENTRY_INFO[id].type == type)
+    {
+      return id;
+    }
+  }
+  return -1;
+}
+
+// Must be called with cache->lock held
+static void invalidate_entries(bg95_query_cache_t* cache, uint32_t entries)
+{
+  for (int id = 0; id < BG95_QUERY_CACHE_ENTRY_MAX; id++)
+  {
+    if ((entries & ENTRY_BIT(id)) == 0)
+    {
+      continue;
+    }
+    cache->entries[id].generation++;
+    if (cache->entries[id].valid)
+    {
+      cache->entries[id].valid = false;
+      cache->stats.invalidations++;
+    }
+  }
+}
+
+esp_err_t bg95_query_cache_init(bg95_query_cache_t*              cache,
+                                bg95_single_flight_t*            sf,
+                                const bg95_query_cache_config_t* config)
+{
+  if (cache == NULL || sf == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(cache, 0, sizeof(*cache));
+  cache->sf = sf;
+  if (config != NULL)
+  {
+    cache->config = *config;
+  }
+  else
+  {
+    cache->config = (bg95_query_cache_config_t) BG95_QUERY_CACHE_DEFAULT_CONFIG();
+  }
+
+  cache->lock = xSemaphoreCreateMutex();
+  if (cache->lock == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+void bg95_query_cache_deinit(bg95_query_cache_t* cache)
+{
+  if (cache == NULL)
+  {
+    return;
+  }
+  if (cache->lock != NULL)
+  {
+    vSemaphoreDelete(cache->lock);
+  }
+  memset(cache, 0, sizeof(*cache));
+}
+
+esp_err_t bg95_query_cache_execute(bg95_query_cache_t* cache,
+                                   const at_cmd_t*     cmd,
+                                   at_cmd_type_t       type,
+                                   void*               parsed_out,
+                                   size_t              parsed_size)
+{
+  if (cache == NULL || cmd == NULL || parsed_out == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  int id = find_entry(cmd, type);
+  if (id < 0 || cache->config.ttl_ms[id] == 0 || CACHE_ENTRY_INFO[id].value_size != parsed_size)
+  {
+    return bg95_single_flight_execute(cache->sf, cmd, type, parsed_out, parsed_size);
+  }
+
+  bg95_query_cache_entry_t* entry = &cache->entries[id];
+  uint32_t                  ttl   = cache->config.ttl_ms[id];
+
+  xSemaphoreTake(cache->lock, portMAX_DELAY);
+  int64_t age_ms = (esp_timer_get_time() - entry->stored_at_us) / 1000;
+  if (entry->valid && (ttl == UINT32_MAX || age_ms < (int64_t) ttl))
+  {
+    memcpy(parsed_out, &entry->value, parsed_size);
+    cache->stats.hits++;
+    xSemaphoreGive(cache->lock);
+    return ESP_OK;
+  }
+  cache->stats.misses++;
+  // The generation tells us if a URC or write raced with this query
+  uint32_t generation = entry->generation;
+  xSemaphoreGive(cache->lock);
+
+  esp_err_t err = bg95_single_flight_execute(cache->sf, cmd, type, parsed_out, parsed_size);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  xSemaphoreTake(cache->lock, portMAX_DELAY);
+  if (entry->generation == generation)
+  {
+    memcpy(&entry->value, parsed_out, parsed_size);
+    entry->stored_at_us = esp_timer_get_time();
+    entry->valid        = true;
+  }
+  else
+  {
+    ESP_LOGD(TAG, "Not caching %s, invalidated while in flight", cmd->name);
+  }
+  xSemaphoreGive(cache->lock);
+
+  return ESP_OK;
+}
+
+void bg95_query_cache_invalidate(bg95_query_cache_t* cache, const at_cmd_t* cmd)
+{
+  if (cache == NULL || cmd == NULL)
+  {
+    return;
+  }
+
+  uint32_t entries = 0;
+  for (int id = 0; id < BG95_QUERY_CACHE_ENTRY_MAX; id++)
+  {
+    if (CACHE_ENTRY_INFO[id].cmd == cmd)
+    {
+      entries |= ENTRY_BIT(id);
+    }
+  }
+
+  xSemaphoreTake(cache->lock, portMAX_DELAY);
+  invalidate_entries(cache, entries);
+  xSemaphoreGive(cache->lock);
+}
+
+void bg95_query_cache_handle_cmd(const char* cmd_line, size_t len, void* ctx)
+{
+  bg95_query_cache_t* cache = (bg95_query_cache_t*) ctx;
+  if (cache == NULL || cmd_line == NULL || len < 3)
+  {
+    return;
+  }
+
+  // Factory defaults or a profile reload can change anything
+  uint32_t entries = 0;
+  if (cmd_line[2] == 'Z' || (len >= 4 && strncmp(cmd_line + 2, "&F", 2) == 0))
+  {
+    entries = 0xFFFFFFFFu;
+  }
+
+  // Every "+NAME=" of the ';' concatenated commands, except "+NAME=?"
+  size_t i = 2; // Skip "AT"
+  while (i < len && cmd_line[i] == '+')
+  {
+    const char* name     = cmd_line + ++i;
+    size_t      name_len = 0;
+    while (i < len && cmd_line[i] != '=' && cmd_line[i] != '?' && cmd_line[i] != ';' &&
+           cmd_line[i] != '\r')
+    {
+      i++;
+      name_len++;
+    }
+    bool write = i + 1 < len && cmd_line[i] == '=' && cmd_line[i + 1] != '?';
+    for (int id = 0; write && id < BG95_QUERY_CACHE_ENTRY_MAX; id++)
+    {
+      const char* cached = CACHE_ENTRY_INFO[id].cmd->name;
+      if (strlen(cached) == name_len && strncmp(cached, name, name_len) == 0)
+      {
+        entries |= ENTRY_BIT(id);
+      }
+    }
+
+    // Advance to the next concatenated command, if any
+    while (i < len && cmd_line[i] != ';')
+    {
+      i++;
+    }
+    if (i < len)
+    {
+      i++;
+    }
+  }
+
+  if (entries != 0)
+  {
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    invalidate_entries(cache, entries);
+    xSemaphoreGive(cache->lock);
+  }
+}
+
+void bg95_query_cache_handle_urc(const char* urc_line, bool solicited, void* ctx)
+{
+  bg95_query_cache_t* cache = (bg95_query_cache_t*) ctx;
+
+  // A solicited "+CPIN: READY" is the answer to a read, not a change of state
+  if (cache == NULL || urc_line == NULL || solicited)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < CACHE_URC_RULES_COUNT; i++)
+  {
+    if (strncmp(urc_line, CACHE_URC_RULES[i].prefix, strlen(CACHE_URC_RULES[i].prefix)) == 0)
+    {
+      xSemaphoreTake(cache->lock, portMAX_DELAY);
+      invalidate_entries(cache, CACHE_URC_RULES[i].entries);
+      xSemaphoreGive(cache->lock);
+      return;
+    }
+  }
+}
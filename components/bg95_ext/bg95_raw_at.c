@@ -0,0 +1,507 @@
+#include "bg95_raw_at.h"
+
+#include "at_cmd_handler.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "BG95_RAW_AT";
+
+// Checks a single line (without its "\r\n") against the final result codes
+static bool is_final_result_line(const char* line, size_t len)
+{
+  if ((len == 2 && strncmp(line, "OK", 2) == 0) || (len == 5 && strncmp(line, "ERROR", 5) == 0))
+  {
+    return true;
+  }
+  if (len >= 11 && (strncmp(line, "+CME ERROR:", 11) == 0 || strncmp(line, "+CMS ERROR:", 11) == 0))
+  {
+    return true;
+  }
+  return false;
+}
+
+// Finds a numeric final result code: one digit at a line start followed by a "\r" that does not
+// start a "\r\n". Returns its position or NULL.
+static const char* find_numeric_result(const char* response, size_t len)
+{
+  const char* end = response + len;
+  const char* cr  = response;
+
+  while ((cr = memchr(cr, '\r', (size_t) (end - cr))) != NULL)
+  {
+    if (cr > response && cr[-1] >= '0' && cr[-1] <= '9' &&
+        (cr - 1 == response || cr[-2] == '\n') && (cr + 1 == end || cr[1] != '\n'))
+    {
+      return cr - 1;
+    }
+    cr++;
+  }
+  return NULL;
+}
+
+bool bg95_raw_at_has_numeric_result(const char* response, size_t len, int* code)
+{
+  if (response == NULL)
+  {
+    return false;
+  }
+
+  const char* result = find_numeric_result(response, len);
+  if (result == NULL)
+  {
+    return false;
+  }
+  if (code != NULL)
+  {
+    *code = *result - '0';
+  }
+  return true;
+}
+
+bool bg95_raw_at_has_final_result(const char* response, bool numeric)
+{
+  if (response == NULL)
+  {
+    return false;
+  }
+
+  // Numeric fast path first, the verbose scan is the fallback
+  if (numeric && find_numeric_result(response, strlen(response)) != NULL)
+  {
+    return true;
+  }
+
+  const char* line = response;
+  const char* eol;
+  while ((eol = strstr(line, "\r\n")) != NULL)
+  {
+    if (is_final_result_line(line, (size_t) (eol - line)))
+    {
+      return true;
+    }
+    line = eol + 2;
+  }
+  return false;
+}
+
+// Checks whether the final result code in a terminated response is "OK" (or numeric 0)
+static bool final_result_is_ok(const char* response, bool numeric)
+{
+  int code;
+  if (numeric && bg95_raw_at_has_numeric_result(response, strlen(response), &code))
+  {
+    return code == BG95_RAW_AT_NUMERIC_OK;
+  }
+
+  const char* line = response;
+  const char* eol;
+  while ((eol = strstr(line, "\r\n")) != NULL)
+  {
+    size_t len = (size_t) (eol - line);
+    if (is_final_result_line(line, len))
+    {
+      return len == 2;
+    }
+    line = eol + 2;
+  }
+  return false;
+}
+
+esp_err_t bg95_raw_at_final_result(const char* response, bool numeric)
+{
+  return final_result_is_ok(response, numeric) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t link_write(const char* data, size_t len, void* context)
+{
+  bg95_raw_at_link_t* link = (bg95_raw_at_link_t*) context;
+  return link->inner->write(data, len, link->inner->context);
+}
+
+static esp_err_t link_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  bg95_raw_at_link_t* link = (bg95_raw_at_link_t*) context;
+  return link->inner->read(data, max_len, bytes_read, timeout_ms, link->inner->context);
+}
+
+esp_err_t bg95_raw_at_link_init(bg95_raw_at_link_t* link, bg95_uart_interface_t* inner)
+{
+  if (link == NULL || inner == NULL || inner->write == NULL || inner->read == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(link, 0, sizeof(*link));
+  link->inner        = inner;
+  link->uart.write   = link_write;
+  link->uart.read    = link_read;
+  link->uart.context = link;
+  return ESP_OK;
+}
+
+bool bg95_raw_at_is_numeric(const bg95_uart_interface_t* uart)
+{
+  // Only a link's own interface carries the flag, everything else is verbose
+  if (uart == NULL || uart->write != link_write)
+  {
+    return false;
+  }
+  return ((const bg95_raw_at_link_t*) uart->context)->numeric;
+}
+
+esp_err_t bg95_raw_at_mark_numeric(bg95_raw_at_link_t* link, bool numeric)
+{
+  if (link == NULL || link->inner == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  link->numeric = numeric;
+  return ESP_OK;
+}
+
+esp_err_t bg95_raw_at_link_set_urc_handler(bg95_raw_at_link_t*  link,
+                                           bg95_raw_at_urc_fn_t fn,
+                                           void*                ctx)
+{
+  if (link == NULL || link->inner == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  link->urc_fn  = fn;
+  link->urc_ctx = ctx;
+  return ESP_OK;
+}
+
+// Offset just past the last final result code in 'buf', 0 when there is none
+static size_t after_last_final_result(const char* buf, size_t len, bool numeric)
+{
+  size_t      last = 0;
+  const char* line = buf;
+  const char* eol;
+
+  while ((eol = strstr(line, "\r\n")) != NULL)
+  {
+    if (is_final_result_line(line, (size_t) (eol - line)))
+    {
+      last = (size_t) (eol + 2 - buf);
+    }
+    line = eol + 2;
+  }
+
+  const char* result;
+  size_t      pos = 0;
+  while (numeric && (result = find_numeric_result(buf + pos, len - pos)) != NULL)
+  {
+    pos  = (size_t) (result + 2 - buf); // Past the digit and its "\r"
+    last = pos > last ? pos : last;
+  }
+  return last;
+}
+
+// Hands the complete "+<name>:" lines after the last final result code in 'buf' to the link's
+// URC handler. Returns how many of the bytes it handed on.
+static size_t deliver_urcs(bg95_uart_interface_t* uart, char* buf, size_t len)
+{
+  if (uart->write != link_write)
+  {
+    return 0;
+  }
+  const bg95_raw_at_link_t* link = (const bg95_raw_at_link_t*) uart->context;
+  if (link->urc_fn == NULL)
+  {
+    return 0;
+  }
+
+  size_t delivered = 0;
+  char*  line      = buf + after_last_final_result(buf, len, link->numeric);
+  char*  eol;
+  while ((eol = strstr(line, "\r\n")) != NULL)
+  {
+    *eol = '\0';
+    if (line[0] == '+' && strchr(line, ':') != NULL)
+    {
+      link->urc_fn(line, link->urc_ctx);
+      delivered += (size_t) (eol + 2 - line);
+    }
+    line = eol + 2;
+  }
+  return delivered;
+}
+
+// Read off whatever is already buffered into 'buf' so the late final result of a command that
+// timed out cannot be taken as the answer to the next command. URCs behind it are handed on.
+static void discard_stale_input(bg95_uart_interface_t* uart, char* buf, size_t size)
+{
+  size_t len       = 0;
+  size_t discarded = 0;
+
+  buf[0] = '\0';
+  for (int i = 0; i < BG95_RAW_AT_FLUSH_MAX_READS; i++)
+  {
+    size_t    bytes_read = 0;
+    esp_err_t err = uart->read(buf + len, size - 1 - len, &bytes_read, 0, uart->context);
+    if ((err != ESP_OK && err != ESP_ERR_TIMEOUT) || bytes_read == 0)
+    {
+      break;
+    }
+    len += bytes_read;
+    buf[len] = '\0';
+    if (len == size - 1)
+    {
+      // Buffer full: hand on what is complete and start over, a line cut here is lost
+      discarded += len - deliver_urcs(uart, buf, len);
+      len    = 0;
+      buf[0] = '\0';
+    }
+  }
+  discarded += len - deliver_urcs(uart, buf, len);
+  buf[0] = '\0';
+
+  if (discarded > 0)
+  {
+    ESP_LOGW(TAG, "Discarded %u stale bytes before command", (unsigned) discarded);
+  }
+}
+
+esp_err_t bg95_raw_at_send(bg95_uart_interface_t* uart,
+                           const char*            cmd,
+                           char*                  response,
+                           size_t                 response_size,
+                           uint32_t               timeout_ms)
+{
+  if (uart == NULL || uart->write == NULL || uart->read == NULL || cmd == NULL ||
+      response == NULL || response_size < 2)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  char cmd_line[BG95_RAW_AT_CMD_MAX_LEN];
+  int  cmd_len = snprintf(cmd_line, sizeof(cmd_line), "%s\r\n", cmd);
+  if (cmd_len < 0 || (size_t) cmd_len >= sizeof(cmd_line))
+  {
+    ESP_LOGE(TAG, "Command line too long");
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  discard_stale_input(uart, response, response_size);
+
+  esp_err_t err = uart->write(cmd_line, (size_t) cmd_len, uart->context);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to write command: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  const int64_t deadline_us = esp_timer_get_time() + (int64_t) timeout_ms * 1000;
+  const bool    numeric     = bg95_raw_at_is_numeric(uart);
+  size_t        total       = 0;
+
+  while (!bg95_raw_at_has_final_result(response, numeric))
+  {
+    int64_t now_us = esp_timer_get_time();
+    if (now_us >= deadline_us)
+    {
+      ESP_LOGW(TAG, "Timeout waiting for response to '%s'", cmd);
+      return ESP_ERR_TIMEOUT;
+    }
+    if (total >= response_size - 1)
+    {
+      ESP_LOGE(TAG, "Response buffer full before final result code");
+      return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t wait_ms = (uint32_t) ((deadline_us - now_us) / 1000);
+    if (wait_ms > BG95_RAW_AT_READ_CHUNK_MS)
+    {
+      wait_ms = BG95_RAW_AT_READ_CHUNK_MS;
+    }
+
+    size_t bytes_read = 0;
+    err = uart->read(
+        response + total, response_size - 1 - total, &bytes_read, wait_ms, uart->context);
+    if (err != ESP_OK && err != ESP_ERR_TIMEOUT)
+    {
+      ESP_LOGE(TAG, "UART read failed: %s", esp_err_to_name(err));
+      return err;
+    }
+
+    total += bytes_read;
+    response[total] = '\0';
+  }
+
+  return bg95_raw_at_final_result(response, numeric);
+}
+
+esp_err_t bg95_raw_at_set_numeric(bg95_raw_at_link_t* link, bool numeric)
+{
+  if (link == NULL || link->inner == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // The switch is answered in either format, so both detectors run until it is done
+  bool was_numeric = link->numeric;
+  link->numeric    = true;
+
+  char      response[32];
+  esp_err_t err = bg95_raw_at_send(&link->uart,
+                                   numeric ? "ATE0V0+CMEE=1" : "ATV1+CMEE=2",
+                                   response,
+                                   sizeof(response),
+                                   BG95_RAW_AT_SETUP_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG,
+             "Failed to switch to %s result codes: %s",
+             numeric ? "numeric" : "verbose",
+             esp_err_to_name(err));
+    link->numeric = was_numeric;
+    return err;
+  }
+
+  link->numeric = numeric;
+  return ESP_OK;
+}
+
+// Rewrite a numeric final result code into the verbose line the driver parsers look for
+static esp_err_t numeric_to_verbose(char* response, size_t response_size)
+{
+  size_t      len    = strlen(response);
+  const char* result = find_numeric_result(response, len);
+  if (result == NULL)
+  {
+    return ESP_OK;
+  }
+
+  size_t      pos     = (size_t) (result - response);
+  const char* verbose = *result - '0' == BG95_RAW_AT_NUMERIC_OK ? "\r\nOK\r\n" : "\r\nERROR\r\n";
+  size_t      tail    = len - pos - 2; // Whatever followed "<digit>\r"
+  size_t      vlen    = strlen(verbose);
+  if (pos + vlen + tail >= response_size)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  memmove(response + pos + vlen, result + 2, tail + 1);
+  memcpy(response + pos, verbose, vlen);
+  return ESP_OK;
+}
+
+esp_err_t bg95_raw_at_format_cmd(const at_cmd_t* cmd,
+                                 at_cmd_type_t   type,
+                                 const void*     params,
+                                 char*           cmd_line,
+                                 size_t          cmd_line_size)
+{
+  if (cmd == NULL || cmd_line == NULL || type >= AT_CMD_TYPE_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  int written = 0;
+  switch (type)
+  {
+    case AT_CMD_TYPE_TEST:
+      written = snprintf(cmd_line, cmd_line_size, "AT+%s=?", cmd->name);
+      break;
+    case AT_CMD_TYPE_READ:
+      written = snprintf(cmd_line, cmd_line_size, "AT+%s?", cmd->name);
+      break;
+    case AT_CMD_TYPE_EXECUTE:
+      written = snprintf(cmd_line, cmd_line_size, "AT+%s", cmd->name);
+      break;
+    case AT_CMD_TYPE_WRITE:
+    {
+      if (cmd->type_info[type].formatter == NULL || params == NULL)
+      {
+        return ESP_ERR_INVALID_ARG;
+      }
+      written = snprintf(cmd_line, cmd_line_size, "AT+%s", cmd->name);
+      if (written < 0 || (size_t) written >= cmd_line_size)
+      {
+        return ESP_ERR_INVALID_SIZE;
+      }
+      return cmd->type_info[type].formatter(
+          params, cmd_line + written, cmd_line_size - (size_t) written);
+    }
+    default:
+      return ESP_ERR_INVALID_ARG;
+  }
+
+  if (written < 0 || (size_t) written >= cmd_line_size)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  return ESP_OK;
+}
+
+esp_err_t bg95_raw_at_parse(const at_cmd_t* cmd,
+                            at_cmd_type_t   type,
+                            char*           response,
+                            size_t          response_size,
+                            void*           parsed_out)
+{
+  if (cmd == NULL || response == NULL || type >= AT_CMD_TYPE_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (parsed_out == NULL || cmd->type_info[type].parser == NULL)
+  {
+    return ESP_OK;
+  }
+
+  esp_err_t err = numeric_to_verbose(response, response_size);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  at_parsed_response_t parsed_base = {0};
+  err                              = at_cmd_parse_response(response, &parsed_base);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  return parse_at_cmd_specific_data_response(cmd, type, response, &parsed_base, parsed_out);
+}
+
+esp_err_t bg95_raw_at_execute(bg95_uart_interface_t* uart,
+                              const at_cmd_t*        cmd,
+                              at_cmd_type_t          type,
+                              const void*            params,
+                              void*                  parsed_out)
+{
+  if (cmd == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return bg95_raw_at_execute_with_timeout(uart, cmd, type, params, parsed_out, cmd->timeout_ms);
+}
+
+esp_err_t bg95_raw_at_execute_with_timeout(bg95_uart_interface_t* uart,
+                                           const at_cmd_t*        cmd,
+                                           at_cmd_type_t          type,
+                                           const void*            params,
+                                           void*                  parsed_out,
+                                           uint32_t               timeout_ms)
+{
+  char      cmd_line[BG95_RAW_AT_CMD_MAX_LEN];
+  esp_err_t err = bg95_raw_at_format_cmd(cmd, type, params, cmd_line, sizeof(cmd_line));
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  char response[BG95_RAW_AT_RESPONSE_MAX_LEN];
+  err = bg95_raw_at_send(uart, cmd_line, response, sizeof(response), timeout_ms);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  return bg95_raw_at_parse(cmd, type, response, sizeof(response), parsed_out);
+}
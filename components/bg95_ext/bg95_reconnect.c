@@ -0,0 +1,217 @@
+#include "bg95_reconnect.h"
+
+#include <esp_log.h>
+#include <esp_random.h>
+#include <string.h>
+
+static const char* TAG = "BG95_RECONNECT";
+
+// Caps the shift so base_delay_ms << exp cannot overflow before the max_delay_ms clamp
+#define RECONNECT_MAX_BACKOFF_EXP 16
+
+esp_err_t bg95_reconnect_init(bg95_reconnect_t* sched, const bg95_reconnect_config_t* config)
+{
+  if (sched == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(sched, 0, sizeof(*sched));
+  if (config != NULL)
+  {
+    sched->config = *config;
+  }
+  else
+  {
+    bg95_reconnect_config_t defaults = BG95_RECONNECT_DEFAULT_CONFIG();
+    sched->config                    = defaults;
+  }
+
+  if (sched->config.base_delay_ms == 0 || sched->config.max_delay_ms < sched->config.min_delay_ms)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return ESP_OK;
+}
+
+bg95_reconnect_class_t bg95_reconnect_classify_qmtopen(esp_err_t                       err,
+                                                       const qmtopen_write_response_t* response)
+{
+  if (response == NULL || !response->present.has_result)
+  {
+    // No result URC, the command itself failed or timed out
+    return err == ESP_OK ? BG95_RECONNECT_CLASS_NONE : BG95_RECONNECT_CLASS_BACKOFF;
+  }
+
+  switch (response->result)
+  {
+    case QMTOPEN_RESULT_OPEN_SUCCESS:
+      return err == ESP_OK ? BG95_RECONNECT_CLASS_NONE : BG95_RECONNECT_CLASS_BACKOFF;
+    case QMTOPEN_RESULT_MQTT_ID_OCCUPIED:
+      // The client index already has an open network, carry on with QMTCONN. Retrying the
+      // open would keep failing the same way.
+      return BG95_RECONNECT_CLASS_NONE;
+    case QMTOPEN_RESULT_FAILED_TO_OPEN:
+      // Socket setup hiccup, usually clears on the next attempt
+      return BG95_RECONNECT_CLASS_TRANSIENT;
+    case QMTOPEN_RESULT_FAILED_ACTIVATE_PDP:
+      return BG95_RECONNECT_CLASS_NETWORK;
+    case QMTOPEN_RESULT_FAILED_PARSE_DOMAIN:
+    case QMTOPEN_RESULT_NETWORK_CONN_ERROR:
+      return BG95_RECONNECT_CLASS_BACKOFF;
+    case QMTOPEN_RESULT_WRONG_PARAMETER:
+      return BG95_RECONNECT_CLASS_FATAL;
+    default:
+      return BG95_RECONNECT_CLASS_BACKOFF;
+  }
+}
+
+bg95_reconnect_class_t bg95_reconnect_classify_qmtconn(esp_err_t                       err,
+                                                       const qmtconn_write_response_t* response)
+{
+  if (response == NULL || !response->present.has_result)
+  {
+    return err == ESP_OK ? BG95_RECONNECT_CLASS_NONE : BG95_RECONNECT_CLASS_BACKOFF;
+  }
+
+  if (response->present.has_ret_code)
+  {
+    switch (response->ret_code)
+    {
+      case QMTCONN_RET_CODE_ACCEPTED:
+        break;
+      case QMTCONN_RET_CODE_SERVER_UNAVAILABLE:
+        // Broker is shedding load, the one case that must never be retried right away
+        return BG95_RECONNECT_CLASS_BACKOFF;
+      case QMTCONN_RET_CODE_UNACCEPTABLE_PROTOCOL:
+      case QMTCONN_RET_CODE_IDENTIFIER_REJECTED:
+      case QMTCONN_RET_CODE_BAD_CREDENTIALS:
+      case QMTCONN_RET_CODE_NOT_AUTHORIZED:
+        return BG95_RECONNECT_CLASS_FATAL;
+      default:
+        return BG95_RECONNECT_CLASS_BACKOFF;
+    }
+  }
+
+  switch (response->result)
+  {
+    case QMTCONN_RESULT_SUCCESS:
+      return err == ESP_OK ? BG95_RECONNECT_CLASS_NONE : BG95_RECONNECT_CLASS_BACKOFF;
+    case QMTCONN_RESULT_RETRANSMISSION:
+      return BG95_RECONNECT_CLASS_TRANSIENT;
+    case QMTCONN_RESULT_FAILED_TO_SEND:
+    default:
+      return BG95_RECONNECT_CLASS_BACKOFF;
+  }
+}
+
+bg95_reconnect_class_t bg95_reconnect_classify_at_error(const bg95_at_error_t* error)
+{
+  if (error == NULL || error->kind == BG95_AT_ERROR_NONE)
+  {
+    return BG95_RECONNECT_CLASS_NONE;
+  }
+
+  switch (error->retry)
+  {
+    case BG95_AT_RETRY_IMMEDIATE:
+      return BG95_RECONNECT_CLASS_TRANSIENT;
+    case BG95_AT_RETRY_NEVER:
+      return BG95_RECONNECT_CLASS_FATAL;
+    case BG95_AT_RETRY_BACKOFF:
+    default:
+      return BG95_RECONNECT_CLASS_BACKOFF;
+  }
+}
+
+// Full jitter: uniform in [min_delay_ms, cap_ms]
+static uint32_t full_jitter_ms(const bg95_reconnect_config_t* config, uint32_t cap_ms)
+{
+  uint32_t span = cap_ms - config->min_delay_ms;
+  return config->min_delay_ms + (span == 0 ? 0 : esp_random() % (span + 1));
+}
+
+static uint32_t jittered_backoff_ms(bg95_reconnect_t* sched)
+{
+  const bg95_reconnect_config_t* config = &sched->config;
+
+  uint64_t cap_ms = (uint64_t) config->base_delay_ms << sched->backoff_exp;
+  if (cap_ms > config->max_delay_ms)
+  {
+    cap_ms = config->max_delay_ms;
+  }
+  if (cap_ms < config->min_delay_ms)
+  {
+    cap_ms = config->min_delay_ms;
+  }
+  if (sched->backoff_exp < RECONNECT_MAX_BACKOFF_EXP)
+  {
+    sched->backoff_exp++;
+  }
+  return full_jitter_ms(config, (uint32_t) cap_ms);
+}
+
+uint32_t bg95_reconnect_next_delay_ms(bg95_reconnect_t* sched, bg95_reconnect_class_t cls)
+{
+  if (sched == NULL || cls == BG95_RECONNECT_CLASS_NONE)
+  {
+    return 0;
+  }
+
+  sched->stats.failures++;
+
+  uint32_t delay_ms;
+  if (cls == BG95_RECONNECT_CLASS_TRANSIENT &&
+      sched->fast_retries_used < sched->config.fast_retries)
+  {
+    sched->fast_retries_used++;
+    sched->stats.immediate_retries++;
+    delay_ms = 0;
+  }
+  else if (cls == BG95_RECONNECT_CLASS_FATAL)
+  {
+    // Jittered as well, a fleet sharing a bad SIM batch or credentials must not retry in step
+    delay_ms = full_jitter_ms(&sched->config, sched->config.max_delay_ms);
+  }
+  else
+  {
+    delay_ms = jittered_backoff_ms(sched);
+  }
+
+  sched->stats.total_delay_ms += delay_ms;
+  ESP_LOGI(TAG,
+           "%s failure #%lu, retrying in %lu ms",
+           bg95_reconnect_class_to_str(cls),
+           (unsigned long) sched->stats.failures,
+           (unsigned long) delay_ms);
+  return delay_ms;
+}
+
+void bg95_reconnect_success(bg95_reconnect_t* sched)
+{
+  if (sched == NULL)
+  {
+    return;
+  }
+  sched->backoff_exp       = 0;
+  sched->fast_retries_used = 0;
+}
+
+const char* bg95_reconnect_class_to_str(bg95_reconnect_class_t cls)
+{
+  switch (cls)
+  {
+    case BG95_RECONNECT_CLASS_NONE:
+      return "NONE";
+    case BG95_RECONNECT_CLASS_TRANSIENT:
+      return "TRANSIENT";
+    case BG95_RECONNECT_CLASS_BACKOFF:
+      return "BACKOFF";
+    case BG95_RECONNECT_CLASS_NETWORK:
+      return "NETWORK";
+    case BG95_RECONNECT_CLASS_FATAL:
+      return "FATAL";
+    default:
+      return "UNKNOWN";
+  }
+}
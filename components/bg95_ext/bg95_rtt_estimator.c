@@ -0,0 +1,321 @@
+#include "bg95_rtt_estimator.h"
+
+#include "bg95_raw_at.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+
+static const char* TAG = "BG95_RTT";
+
+#define RTT_MAX_BACKOFF_SHIFT 6
+
+static const char* const CONDITION_NAMES[BG95_RTT_COND_MAX] = {
+    [BG95_RTT_COND_UNKNOWN] = "unknown",
+    [BG95_RTT_COND_GOOD]    = "good",
+    [BG95_RTT_COND_FAIR]    = "fair",
+    [BG95_RTT_COND_POOR]    = "poor",
+};
+
+esp_err_t bg95_rtt_estimator_init(bg95_rtt_estimator_t*              est,
+                                  const bg95_rtt_estimator_config_t* config)
+{
+  if (est == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(est, 0, sizeof(*est));
+  if (config != NULL)
+  {
+    est->config = *config;
+  }
+  else
+  {
+    bg95_rtt_estimator_config_t defaults = BG95_RTT_ESTIMATOR_DEFAULT_CONFIG();
+    est->config                          = defaults;
+  }
+
+  est->lock = xSemaphoreCreateMutex();
+  if (est->lock == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+void bg95_rtt_estimator_deinit(bg95_rtt_estimator_t* est)
+{
+  if (est == NULL)
+  {
+    return;
+  }
+  if (est->lock != NULL)
+  {
+    vSemaphoreDelete(est->lock);
+  }
+  memset(est, 0, sizeof(*est));
+}
+
+bg95_rtt_condition_t bg95_rtt_condition_from_csq(int rssi)
+{
+  // rssi 0-31 maps to -113..-51 dBm in 2 dB steps
+  if (rssi < 0 || rssi > 31)
+  {
+    return BG95_RTT_COND_UNKNOWN;
+  }
+  if (rssi >= 20) // >= -73 dBm
+  {
+    return BG95_RTT_COND_GOOD;
+  }
+  if (rssi >= 10) // >= -93 dBm
+  {
+    return BG95_RTT_COND_FAIR;
+  }
+  return BG95_RTT_COND_POOR;
+}
+
+void bg95_rtt_estimator_set_condition(bg95_rtt_estimator_t* est, bg95_rtt_condition_t cond)
+{
+  if (est == NULL || cond >= BG95_RTT_COND_MAX)
+  {
+    return;
+  }
+  est->condition = cond;
+}
+
+// Must be called with est->lock held. Creates the entry when 'create' is set and there is room.
+static bg95_rtt_entry_t*
+find_entry(bg95_rtt_estimator_t* est, const at_cmd_t* cmd, at_cmd_type_t type, bool create)
+{
+  for (size_t i = 0; i < est->entry_count; i++)
+  {
+    if (est->entries[i].cmd == cmd && est->entries[i].type == type)
+    {
+      return &est->entries[i];
+    }
+  }
+  if (!create)
+  {
+    return NULL;
+  }
+  if (est->entry_count >= BG95_RTT_ESTIMATOR_MAX_ENTRIES)
+  {
+    ESP_LOGW(TAG, "No free entry for %s, using static timeout", cmd->name);
+    return NULL;
+  }
+
+  bg95_rtt_entry_t* entry = &est->entries[est->entry_count++];
+  memset(entry, 0, sizeof(*entry));
+  entry->cmd  = cmd;
+  entry->type = type;
+  return entry;
+}
+
+static uint32_t compute_timeout(const bg95_rtt_estimator_config_t* config,
+                                const bg95_rtt_stats_t*            stats,
+                                uint32_t                           ceiling_ms)
+{
+  if (stats->samples < config->min_samples)
+  {
+    return ceiling_ms;
+  }
+
+  uint32_t var_term = 4 * stats->rttvar_ms;
+  if (var_term < config->granularity_ms)
+  {
+    var_term = config->granularity_ms;
+  }
+
+  uint64_t timeout_ms = ((uint64_t) stats->srtt_ms + var_term) << stats->backoff_shift;
+  if (timeout_ms < config->min_timeout_ms)
+  {
+    timeout_ms = config->min_timeout_ms;
+  }
+  if (timeout_ms > ceiling_ms)
+  {
+    timeout_ms = ceiling_ms;
+  }
+  return (uint32_t) timeout_ms;
+}
+
+uint32_t bg95_rtt_estimator_timeout_ms(bg95_rtt_estimator_t* est,
+                                       const at_cmd_t*       cmd,
+                                       at_cmd_type_t         type)
+{
+  if (cmd == NULL)
+  {
+    return 0;
+  }
+  if (est == NULL || est->lock == NULL)
+  {
+    return cmd->timeout_ms;
+  }
+
+  uint32_t timeout_ms = cmd->timeout_ms;
+  xSemaphoreTake(est->lock, portMAX_DELAY);
+  bg95_rtt_entry_t* entry = find_entry(est, cmd, type, false);
+  if (entry != NULL)
+  {
+    timeout_ms = compute_timeout(&est->config, &entry->stats[est->condition], cmd->timeout_ms);
+  }
+  xSemaphoreGive(est->lock);
+  return timeout_ms;
+}
+
+void bg95_rtt_estimator_record(bg95_rtt_estimator_t* est,
+                               const at_cmd_t*       cmd,
+                               at_cmd_type_t         type,
+                               uint32_t              rtt_ms,
+                               bool                  timed_out)
+{
+  if (est == NULL || est->lock == NULL || cmd == NULL)
+  {
+    return;
+  }
+
+  xSemaphoreTake(est->lock, portMAX_DELAY);
+  bg95_rtt_entry_t* entry = find_entry(est, cmd, type, true);
+  if (entry == NULL)
+  {
+    xSemaphoreGive(est->lock);
+    return;
+  }
+
+  bg95_rtt_stats_t* stats = &entry->stats[est->condition];
+  if (timed_out)
+  {
+    stats->timeouts++;
+    if (stats->backoff_shift < RTT_MAX_BACKOFF_SHIFT)
+    {
+      stats->backoff_shift++;
+    }
+    xSemaphoreGive(est->lock);
+    return;
+  }
+
+  if (stats->samples == 0)
+  {
+    // RFC 6298 (2.2): SRTT = R, RTTVAR = R / 2
+    stats->srtt_ms   = rtt_ms;
+    stats->rttvar_ms = rtt_ms / 2;
+  }
+  else
+  {
+    // RFC 6298 (2.3) with alpha = 1/8, beta = 1/4
+    int32_t delta    = (int32_t) rtt_ms - (int32_t) stats->srtt_ms;
+    int32_t abs_diff = delta < 0 ? -delta : delta;
+    stats->rttvar_ms = (uint32_t) ((3 * (int32_t) stats->rttvar_ms + abs_diff) / 4);
+    stats->srtt_ms   = (uint32_t) ((int32_t) stats->srtt_ms + delta / 8);
+  }
+
+  stats->samples++;
+  stats->last_rtt_ms   = rtt_ms;
+  stats->backoff_shift = 0;
+  if (rtt_ms > stats->max_rtt_ms)
+  {
+    stats->max_rtt_ms = rtt_ms;
+  }
+  xSemaphoreGive(est->lock);
+}
+
+void bg95_rtt_estimator_observe(bg95_rtt_estimator_t* est,
+                                const at_cmd_t*       cmd,
+                                at_cmd_type_t         type,
+                                esp_err_t             err,
+                                uint32_t              rtt_ms)
+{
+  // Error result codes are still a complete round trip, only a missing answer is a timeout
+  if (err == ESP_ERR_TIMEOUT)
+  {
+    bg95_rtt_estimator_record(est, cmd, type, rtt_ms, true);
+  }
+  else if (err != ESP_ERR_INVALID_ARG && err != ESP_ERR_INVALID_SIZE)
+  {
+    bg95_rtt_estimator_record(est, cmd, type, rtt_ms, false);
+  }
+}
+
+esp_err_t bg95_rtt_estimator_get(bg95_rtt_estimator_t* est,
+                                 const at_cmd_t*       cmd,
+                                 at_cmd_type_t         type,
+                                 bg95_rtt_condition_t  cond,
+                                 bg95_rtt_stats_t*     stats)
+{
+  if (est == NULL || est->lock == NULL || cmd == NULL || stats == NULL || cond >= BG95_RTT_COND_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t err = ESP_ERR_NOT_FOUND;
+  xSemaphoreTake(est->lock, portMAX_DELAY);
+  bg95_rtt_entry_t* entry = find_entry(est, cmd, type, false);
+  if (entry != NULL)
+  {
+    *stats = entry->stats[cond];
+    err    = ESP_OK;
+  }
+  xSemaphoreGive(est->lock);
+  return err;
+}
+
+void bg95_rtt_estimator_log(bg95_rtt_estimator_t* est)
+{
+  if (est == NULL || est->lock == NULL)
+  {
+    return;
+  }
+
+  xSemaphoreTake(est->lock, portMAX_DELAY);
+  for (size_t i = 0; i < est->entry_count; i++)
+  {
+    const bg95_rtt_entry_t* entry = &est->entries[i];
+    for (int cond = 0; cond < BG95_RTT_COND_MAX; cond++)
+    {
+      const bg95_rtt_stats_t* stats = &entry->stats[cond];
+      if (stats->samples == 0 && stats->timeouts == 0)
+      {
+        continue;
+      }
+      ESP_LOGI(TAG,
+               "%s/%d (%s): srtt=%lu rttvar=%lu max=%lu n=%lu timeouts=%lu rto=%lu/%lu ms",
+               entry->cmd->name,
+               (int) entry->type,
+               CONDITION_NAMES[cond],
+               (unsigned long) stats->srtt_ms,
+               (unsigned long) stats->rttvar_ms,
+               (unsigned long) stats->max_rtt_ms,
+               (unsigned long) stats->samples,
+               (unsigned long) stats->timeouts,
+               (unsigned long) compute_timeout(&est->config, stats, entry->cmd->timeout_ms),
+               (unsigned long) entry->cmd->timeout_ms);
+    }
+  }
+  xSemaphoreGive(est->lock);
+}
+
+esp_err_t bg95_rtt_execute(bg95_rtt_estimator_t*  est,
+                           bg95_uart_interface_t* uart,
+                           const at_cmd_t*        cmd,
+                           at_cmd_type_t          type,
+                           const void*            params,
+                           void*                  parsed_out)
+{
+  if (cmd == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  uint32_t  timeout_ms = bg95_rtt_estimator_timeout_ms(est, cmd, type);
+  int64_t   start_us   = esp_timer_get_time();
+  esp_err_t err =
+      bg95_raw_at_execute_with_timeout(uart, cmd, type, params, parsed_out, timeout_ms);
+  uint32_t rtt_ms = (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+
+  if (err == ESP_ERR_TIMEOUT)
+  {
+    ESP_LOGW(TAG, "%s timed out after %lu ms", cmd->name, (unsigned long) timeout_ms);
+  }
+  bg95_rtt_estimator_observe(est, cmd, type, err, rtt_ms);
+  return err;
+}
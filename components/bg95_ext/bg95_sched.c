@@ -0,0 +1,431 @@
+#include "bg95_sched.h"
+
+#include "freertos/task.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+
+static const char* TAG = "BG95_SCHED";
+
+static const char* LANE_NAMES[BG95_SCHED_NUM_LANES] = {"control", "normal", "bulk"};
+
+// Arrival order that survives the sequence counter wrapping
+static bool arrived_before(uint32_t a, uint32_t b)
+{
+  return (int32_t) (a - b) < 0;
+}
+
+static int64_t deadline_key(int64_t deadline_us)
+{
+  return deadline_us == BG95_SCHED_NO_DEADLINE ? INT64_MAX : deadline_us;
+}
+
+static bool expired(int64_t deadline_us, int64_t now_us)
+{
+  return deadline_us != BG95_SCHED_NO_DEADLINE && now_us >= deadline_us;
+}
+
+// Earliest deadline first, then arrival order
+static bool runs_before(const bg95_sched_waiter_t* a, const bg95_sched_waiter_t* b)
+{
+  int64_t key_a = deadline_key(a->deadline_us);
+  int64_t key_b = deadline_key(b->deadline_us);
+  if (key_a != key_b)
+  {
+    return key_a < key_b;
+  }
+  return arrived_before(a->seq, b->seq);
+}
+
+// Must be called with sched->lock held. Expired waiters are skipped, they time out on their own.
+static bg95_sched_waiter_t* pick_next(bg95_sched_t* sched, int64_t now_us, bool* promoted)
+{
+  bg95_sched_waiter_t* best    = NULL;
+  bg95_sched_waiter_t* starved = NULL;
+
+  for (size_t i = 0; i < BG95_SCHED_NUM_SLOTS; i++)
+  {
+    bg95_sched_waiter_t* w = &sched->waiters[i];
+    if (!w->used || w->granted || expired(w->deadline_us, now_us))
+    {
+      continue;
+    }
+    if (w->bypassed >= BG95_SCHED_MAX_BYPASS &&
+        (starved == NULL || arrived_before(w->seq, starved->seq)))
+    {
+      starved = w;
+    }
+    if (best == NULL || w->lane < best->lane || (w->lane == best->lane && runs_before(w, best)))
+    {
+      best = w;
+    }
+  }
+
+  *promoted = starved != NULL && starved != best;
+  return *promoted ? starved : best;
+}
+
+// Must be called with sched->lock held
+static void grant(bg95_sched_t* sched, bg95_sched_waiter_t* next, bool promoted)
+{
+  bg95_sched_lane_stats_t* stats   = &sched->stats[next->lane];
+  uint32_t                 wait_ms = (xTaskGetTickCount() - next->since) * portTICK_PERIOD_MS;
+
+  next->granted = true;
+  sched->busy   = true;
+  stats->depth--;
+  stats->granted++;
+  stats->promoted += promoted ? 1 : 0;
+  stats->wait_ms_total += wait_ms;
+  if (wait_ms > stats->wait_ms_max)
+  {
+    stats->wait_ms_max = wait_ms;
+  }
+
+  // Lower lanes still waiting were passed over once more
+  for (size_t i = 0; i < BG95_SCHED_NUM_SLOTS; i++)
+  {
+    bg95_sched_waiter_t* w = &sched->waiters[i];
+    if (w->used && !w->granted && w->lane > next->lane)
+    {
+      w->bypassed++;
+    }
+  }
+
+  // The pending slot has nobody blocked on it, its grant is latched until collected
+  if (next->grant != NULL)
+  {
+    xSemaphoreGive(next->grant);
+  }
+}
+
+// Must be called with sched->lock held
+static void enqueue(bg95_sched_t*        sched,
+                    bg95_sched_waiter_t* w,
+                    bg95_sched_lane_t    lane,
+                    int64_t              deadline_us)
+{
+  w->used        = true;
+  w->granted     = false;
+  w->lane        = lane;
+  w->seq         = sched->next_seq++;
+  w->bypassed    = 0;
+  w->since       = xTaskGetTickCount();
+  w->deadline_us = deadline_us;
+  if (++sched->stats[lane].depth > sched->stats[lane].depth_max)
+  {
+    sched->stats[lane].depth_max = sched->stats[lane].depth;
+  }
+}
+
+esp_err_t bg95_sched_init(bg95_sched_t* sched)
+{
+  if (sched == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(sched, 0, sizeof(*sched));
+  sched->lock = xSemaphoreCreateMutex();
+  if (sched->lock == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  for (size_t i = 0; i < BG95_SCHED_MAX_WAITERS; i++)
+  {
+    sched->waiters[i].grant = xSemaphoreCreateBinary();
+    if (sched->waiters[i].grant == NULL)
+    {
+      bg95_sched_deinit(sched);
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  return ESP_OK;
+}
+
+void bg95_sched_deinit(bg95_sched_t* sched)
+{
+  if (sched == NULL)
+  {
+    return;
+  }
+  for (size_t i = 0; i < BG95_SCHED_MAX_WAITERS; i++)
+  {
+    if (sched->waiters[i].grant != NULL)
+    {
+      vSemaphoreDelete(sched->waiters[i].grant);
+    }
+  }
+  if (sched->lock != NULL)
+  {
+    vSemaphoreDelete(sched->lock);
+  }
+  memset(sched, 0, sizeof(*sched));
+}
+
+static esp_err_t acquire(bg95_sched_t*     sched,
+                         bg95_sched_lane_t lane,
+                         TickType_t        timeout,
+                         int64_t           deadline_us)
+{
+  xSemaphoreTake(sched->lock, portMAX_DELAY);
+  if (!sched->busy)
+  {
+    // Idle modem, release hands over directly so nobody can be waiting
+    sched->busy = true;
+    sched->stats[lane].granted++;
+    xSemaphoreGive(sched->lock);
+    return ESP_OK;
+  }
+
+  bg95_sched_waiter_t* w = NULL;
+  for (size_t i = 0; i < BG95_SCHED_MAX_WAITERS; i++)
+  {
+    if (!sched->waiters[i].used)
+    {
+      w = &sched->waiters[i];
+      break;
+    }
+  }
+  if (w == NULL)
+  {
+    xSemaphoreGive(sched->lock);
+    return ESP_ERR_NO_MEM;
+  }
+
+  enqueue(sched, w, lane, deadline_us);
+  xSemaphoreTake(w->grant, 0); // Stale grant of a previous waiter that timed out
+  xSemaphoreGive(sched->lock);
+
+  xSemaphoreTake(w->grant, timeout);
+
+  // Granted is checked under the lock, a grant racing the timeout still counts
+  xSemaphoreTake(sched->lock, portMAX_DELAY);
+  esp_err_t err = ESP_OK;
+  if (!w->granted)
+  {
+    sched->stats[lane].depth--;
+    if (deadline_us != BG95_SCHED_NO_DEADLINE)
+    {
+      sched->stats[lane].deadline_misses++;
+    }
+    else
+    {
+      sched->stats[lane].timeouts++;
+    }
+    err = ESP_ERR_TIMEOUT;
+  }
+  w->used = false;
+  xSemaphoreGive(sched->lock);
+  return err;
+}
+
+esp_err_t bg95_sched_acquire(bg95_sched_t* sched, bg95_sched_lane_t lane, uint32_t timeout_ms)
+{
+  if (sched == NULL || sched->lock == NULL || lane >= BG95_SCHED_NUM_LANES)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return acquire(sched,
+                 lane,
+                 timeout_ms == BG95_SCHED_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms),
+                 BG95_SCHED_NO_DEADLINE);
+}
+
+esp_err_t bg95_sched_acquire_by(bg95_sched_t* sched, bg95_sched_lane_t lane, int64_t deadline_us)
+{
+  if (sched == NULL || sched->lock == NULL || lane >= BG95_SCHED_NUM_LANES)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (deadline_us == BG95_SCHED_NO_DEADLINE)
+  {
+    return acquire(sched, lane, portMAX_DELAY, BG95_SCHED_NO_DEADLINE);
+  }
+
+  int64_t now_us = esp_timer_get_time();
+  if (expired(deadline_us, now_us))
+  {
+    xSemaphoreTake(sched->lock, portMAX_DELAY);
+    sched->stats[lane].deadline_misses++;
+    xSemaphoreGive(sched->lock);
+    return ESP_ERR_TIMEOUT;
+  }
+
+  // One tick more, so the waiter never wakes before its deadline while still grantable
+  TickType_t timeout = pdMS_TO_TICKS((deadline_us - now_us + 999) / 1000) + 1;
+  return acquire(sched, lane, timeout, deadline_us);
+}
+
+esp_err_t bg95_sched_try_acquire(bg95_sched_t* sched, bg95_sched_lane_t lane)
+{
+  if (sched == NULL || sched->lock == NULL || lane >= BG95_SCHED_NUM_LANES)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(sched->lock, portMAX_DELAY);
+  esp_err_t err = ESP_ERR_TIMEOUT;
+  if (!sched->busy)
+  {
+    sched->busy = true;
+    sched->stats[lane].granted++;
+    err = ESP_OK;
+  }
+  xSemaphoreGive(sched->lock);
+  return err;
+}
+
+esp_err_t bg95_sched_acquire_pending(bg95_sched_t* sched, bg95_sched_lane_t lane)
+{
+  if (sched == NULL || sched->lock == NULL || lane >= BG95_SCHED_NUM_LANES)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  // Held only for short bookkeeping elsewhere, the next call simply tries again
+  if (xSemaphoreTake(sched->lock, 0) != pdTRUE)
+  {
+    return ESP_ERR_TIMEOUT;
+  }
+
+  bg95_sched_waiter_t* w   = &sched->waiters[BG95_SCHED_PENDING_SLOT];
+  esp_err_t            err = ESP_ERR_TIMEOUT;
+  if (w->used && w->granted)
+  {
+    w->used = false;
+    err     = ESP_OK;
+  }
+  else if (!w->used && !sched->busy)
+  {
+    sched->busy = true;
+    sched->stats[lane].granted++;
+    err = ESP_OK;
+  }
+  else if (!w->used)
+  {
+    enqueue(sched, w, lane, BG95_SCHED_NO_DEADLINE);
+  }
+  xSemaphoreGive(sched->lock);
+  return err;
+}
+
+void bg95_sched_cancel_pending(bg95_sched_t* sched)
+{
+  if (sched == NULL || sched->lock == NULL)
+  {
+    return;
+  }
+
+  xSemaphoreTake(sched->lock, portMAX_DELAY);
+  bg95_sched_waiter_t* w       = &sched->waiters[BG95_SCHED_PENDING_SLOT];
+  bool                 granted = w->used && w->granted;
+  if (w->used && !w->granted)
+  {
+    sched->stats[w->lane].depth--;
+    sched->stats[w->lane].timeouts++;
+  }
+  w->used = false;
+  xSemaphoreGive(sched->lock);
+
+  // A grant nobody collected still holds the modem, pass it on
+  if (granted)
+  {
+    bg95_sched_release(sched);
+  }
+}
+
+void bg95_sched_release(bg95_sched_t* sched)
+{
+  if (sched == NULL || sched->lock == NULL)
+  {
+    return;
+  }
+
+  xSemaphoreTake(sched->lock, portMAX_DELAY);
+  bool                 promoted = false;
+  bg95_sched_waiter_t* next     = pick_next(sched, esp_timer_get_time(), &promoted);
+  if (next != NULL)
+  {
+    grant(sched, next, promoted);
+  }
+  else
+  {
+    sched->busy = false;
+  }
+  xSemaphoreGive(sched->lock);
+}
+
+bg95_sched_lane_t bg95_sched_publish_lane(size_t len)
+{
+  return len > BG95_SCHED_BULK_PUBLISH_LEN ? BG95_SCHED_LANE_BULK : BG95_SCHED_LANE_NORMAL;
+}
+
+bg95_sched_lane_t bg95_sched_cmd_lane(const char* cmd_line)
+{
+  static const char* const control_cmds[] = {"AT+QMTDISC",
+                                             "AT+CSQ",
+                                             "AT+CPIN?",
+                                             "AT+COPS?",
+                                             "AT+CREG?",
+                                             "AT+CEREG?",
+                                             "AT+CGREG?",
+                                             "AT+QMTCONN?",
+                                             "AT+QMTOPEN?"};
+
+  if (cmd_line == NULL)
+  {
+    return BG95_SCHED_LANE_NORMAL;
+  }
+  if (strncmp(cmd_line, "AT+QMTRECV", 10) == 0)
+  {
+    return BG95_SCHED_LANE_BULK;
+  }
+  for (size_t i = 0; i < sizeof(control_cmds) / sizeof(control_cmds[0]); i++)
+  {
+    if (strncmp(cmd_line, control_cmds[i], strlen(control_cmds[i])) == 0)
+    {
+      return BG95_SCHED_LANE_CONTROL;
+    }
+  }
+  return BG95_SCHED_LANE_NORMAL;
+}
+
+esp_err_t bg95_sched_get_stats(bg95_sched_t*            sched,
+                               bg95_sched_lane_t        lane,
+                               bg95_sched_lane_stats_t* stats)
+{
+  if (sched == NULL || sched->lock == NULL || lane >= BG95_SCHED_NUM_LANES || stats == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(sched->lock, portMAX_DELAY);
+  *stats = sched->stats[lane];
+  xSemaphoreGive(sched->lock);
+  return ESP_OK;
+}
+
+void bg95_sched_log_stats(bg95_sched_t* sched)
+{
+  for (int lane = 0; lane < BG95_SCHED_NUM_LANES; lane++)
+  {
+    bg95_sched_lane_stats_t s;
+    if (bg95_sched_get_stats(sched, lane, &s) != ESP_OK)
+    {
+      return;
+    }
+    ESP_LOGI(TAG,
+             "Lane %s: granted=%lu depth=%lu/%lu wait avg=%lu ms max=%lu ms "
+             "timeouts=%lu deadline_misses=%lu promoted=%lu",
+             LANE_NAMES[lane],
+             (unsigned long) s.granted,
+             (unsigned long) s.depth,
+             (unsigned long) s.depth_max,
+             (unsigned long) (s.granted ? s.wait_ms_total / s.granted : 0),
+             (unsigned long) s.wait_ms_max,
+             (unsigned long) s.timeouts,
+             (unsigned long) s.deadline_misses,
+             (unsigned long) s.promoted);
+  }
+}
@@ -0,0 +1,241 @@
+#include "bg95_single_flight.h"
+
+#include "at_cmd_cgdcont.h"
+#include "at_cmd_cops.h"
+#include "at_cmd_cpin.h"
+#include "at_cmd_csq.h"
+#include "at_cmd_qmtconn.h"
+#include "at_cmd_qmtopen.h"
+#include "bg95_raw_at.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BG95_SINGLE_FLIGHT";
+
+#define CALL_DONE_BIT (1 << 0)
+
+typedef struct
+{
+  const at_cmd_t* cmd;
+  at_cmd_type_t   type;
+} idempotent_cmd_t;
+
+static const idempotent_cmd_t IDEMPOTENT_CMDS[] = {
+    {&AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE},
+    {&AT_CMD_COPS, AT_CMD_TYPE_READ},
+    {&AT_CMD_CPIN, AT_CMD_TYPE_READ},
+    {&AT_CMD_CGDCONT, AT_CMD_TYPE_READ},
+    {&AT_CMD_QMTOPEN, AT_CMD_TYPE_READ},
+    {&AT_CMD_QMTCONN, AT_CMD_TYPE_READ},
+};
+
+#define IDEMPOTENT_CMDS_COUNT (sizeof(IDEMPOTENT_CMDS) / sizeof(IDEMPOTENT_CMDS[0]))
+
+esp_err_t bg95_single_flight_init(bg95_single_flight_t*  sf,
+                                  bg95_uart_interface_t* uart,
+                                  bg95_sched_t*          sched)
+{
+  if (sf == NULL || uart == NULL || sched == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(sf, 0, sizeof(*sf));
+  sf->uart  = uart;
+  sf->sched = sched;
+  sf->lock  = xSemaphoreCreateMutex();
+  if (sf->lock == NULL)
+  {
+    bg95_single_flight_deinit(sf);
+    return ESP_ERR_NO_MEM;
+  }
+
+  for (size_t i = 0; i < BG95_SINGLE_FLIGHT_MAX_CALLS; i++)
+  {
+    sf->calls[i].done_event = xEventGroupCreate();
+    if (sf->calls[i].done_event == NULL)
+    {
+      bg95_single_flight_deinit(sf);
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  return ESP_OK;
+}
+
+void bg95_single_flight_deinit(bg95_single_flight_t* sf)
+{
+  if (sf == NULL)
+  {
+    return;
+  }
+  for (size_t i = 0; i < BG95_SINGLE_FLIGHT_MAX_CALLS; i++)
+  {
+    if (sf->calls[i].done_event != NULL)
+    {
+      vEventGroupDelete(sf->calls[i].done_event);
+    }
+  }
+  if (sf->lock != NULL)
+  {
+    vSemaphoreDelete(sf->lock);
+  }
+  memset(sf, 0, sizeof(*sf));
+}
+
+void bg95_single_flight_set_rtt_estimator(bg95_single_flight_t* sf, bg95_rtt_estimator_t* rtt)
+{
+  if (sf == NULL)
+  {
+    return;
+  }
+  sf->rtt = rtt;
+}
+
+bool bg95_single_flight_is_idempotent(const at_cmd_t* cmd, at_cmd_type_t type)
+{
+  if (cmd == NULL)
+  {
+    return false;
+  }
+  if (type == AT_CMD_TYPE_TEST)
+  {
+    return true;
+  }
+  for (size_t i = 0; i < IDEMPOTENT_CMDS_COUNT; i++)
+  {
+    if (IDEMPOTENT_CMDS[i].cmd == cmd && IDEMPOTENT_CMDS[i].type == type)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static esp_err_t execute_locked(bg95_single_flight_t* sf,
+                                const at_cmd_t*       cmd,
+                                at_cmd_type_t         type,
+                                void*                 parsed_out)
+{
+  char              cmd_line[BG95_RAW_AT_CMD_MAX_LEN];
+  bg95_sched_lane_t lane = BG95_SCHED_LANE_NORMAL;
+  if (bg95_raw_at_format_cmd(cmd, type, NULL, cmd_line, sizeof(cmd_line)) == ESP_OK)
+  {
+    lane = bg95_sched_cmd_lane(cmd_line);
+  }
+
+  esp_err_t err = bg95_sched_acquire(sf->sched, lane, BG95_SCHED_WAIT_FOREVER);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  if (sf->rtt != NULL)
+  {
+    err = bg95_rtt_execute(sf->rtt, sf->uart, cmd, type, NULL, parsed_out);
+  }
+  else
+  {
+    err = bg95_raw_at_execute(sf->uart, cmd, type, NULL, parsed_out);
+  }
+  bg95_sched_release(sf->sched);
+  return err;
+}
+
+// Must be called with sf->lock held
+static void release_call(bg95_single_flight_call_t* call)
+{
+  call->refs--;
+  if (call->refs == 0)
+  {
+    call->key[0] = '\0';
+    call->done   = false;
+    xEventGroupClearBits(call->done_event, CALL_DONE_BIT);
+  }
+}
+
+esp_err_t bg95_single_flight_execute(bg95_single_flight_t* sf,
+                                     const at_cmd_t*       cmd,
+                                     at_cmd_type_t         type,
+                                     void*                 parsed_out,
+                                     size_t                parsed_size)
+{
+  if (sf == NULL || cmd == NULL || parsed_out == NULL || type == AT_CMD_TYPE_WRITE)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (!bg95_single_flight_is_idempotent(cmd, type) ||
+      parsed_size > BG95_SINGLE_FLIGHT_RESULT_MAX_LEN)
+  {
+    return execute_locked(sf, cmd, type, parsed_out);
+  }
+
+  char      key[BG95_SINGLE_FLIGHT_KEY_MAX_LEN];
+  esp_err_t err = bg95_raw_at_format_cmd(cmd, type, NULL, key, sizeof(key));
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  xSemaphoreTake(sf->lock, portMAX_DELAY);
+
+  // Join a flight for the same command line that has not finished yet
+  for (size_t i = 0; i < BG95_SINGLE_FLIGHT_MAX_CALLS; i++)
+  {
+    bg95_single_flight_call_t* call = &sf->calls[i];
+    if (call->refs > 0 && !call->done && call->result_size == parsed_size &&
+        strcmp(call->key, key) == 0)
+    {
+      call->refs++;
+      sf->joined_count++;
+      xSemaphoreGive(sf->lock);
+
+      ESP_LOGD(TAG, "Joining in-flight %s", key);
+      xEventGroupWaitBits(call->done_event, CALL_DONE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+
+      xSemaphoreTake(sf->lock, portMAX_DELAY);
+      memcpy(parsed_out, call->result, parsed_size);
+      err = call->err;
+      release_call(call);
+      xSemaphoreGive(sf->lock);
+      return err;
+    }
+  }
+
+  // Otherwise lead a new flight
+  bg95_single_flight_call_t* call = NULL;
+  for (size_t i = 0; i < BG95_SINGLE_FLIGHT_MAX_CALLS; i++)
+  {
+    if (sf->calls[i].refs == 0)
+    {
+      call = &sf->calls[i];
+      break;
+    }
+  }
+
+  if (call == NULL)
+  {
+    // All slots busy, run without de-duplication rather than block
+    xSemaphoreGive(sf->lock);
+    return execute_locked(sf, cmd, type, parsed_out);
+  }
+
+  strcpy(call->key, key);
+  call->result_size = parsed_size;
+  call->refs        = 1;
+  call->done        = false;
+  xSemaphoreGive(sf->lock);
+
+  err = execute_locked(sf, cmd, type, parsed_out);
+
+  xSemaphoreTake(sf->lock, portMAX_DELAY);
+  memcpy(call->result, parsed_out, parsed_size);
+  call->err  = err;
+  call->done = true;
+  xEventGroupSetBits(call->done_event, CALL_DONE_BIT);
+  release_call(call);
+  xSemaphoreGive(sf->lock);
+
+  return err;
+}
@@ -0,0 +1,220 @@
+#include "bg95_status.h"
+
+#include "bg95_raw_at.h"
+
+#include <esp_log.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "BG95_STATUS";
+
+// Copy every line starting with 'prefix' into 'section' and terminate it with "OK" so the
+// result looks exactly like the single command response the driver parsers expect.
+// Returns the number of lines collected.
+static size_t collect_section(const char* response,
+                              const char* prefix,
+                              char*       section,
+                              size_t      section_size)
+{
+  size_t      prefix_len = strlen(prefix);
+  size_t      used       = 0;
+  size_t      lines      = 0;
+  const char* line       = response;
+  const char* eol;
+
+  section[0] = '\0';
+
+  while ((eol = strstr(line, "\r\n")) != NULL)
+  {
+    size_t len = (size_t) (eol - line);
+    if (len >= prefix_len && strncmp(line, prefix, prefix_len) == 0)
+    {
+      int written =
+          snprintf(section + used, section_size - used, "\r\n%.*s", (int) len, line);
+      if (written < 0 || (size_t) written >= section_size - used)
+      {
+        ESP_LOGW(TAG, "Section %s truncated", prefix);
+        break;
+      }
+      used += (size_t) written;
+      lines++;
+    }
+    line = eol + 2;
+  }
+
+  if (lines > 0)
+  {
+    int written = snprintf(section + used, section_size - used, "\r\nOK\r\n");
+    if (written < 0 || (size_t) written >= section_size - used)
+    {
+      return 0;
+    }
+  }
+
+  return lines;
+}
+
+// Run one section of the combined response through the command's own parser
+static bool demux_section(const char*     response,
+                          const char*     prefix,
+                          const at_cmd_t* cmd,
+                          at_cmd_type_t   type,
+                          void*           parsed_out)
+{
+  char section[BG95_STATUS_SECTION_MAX_LEN];
+
+  if (collect_section(response, prefix, section, sizeof(section)) == 0)
+  {
+    return false;
+  }
+  if (cmd->type_info[type].parser == NULL)
+  {
+    return false;
+  }
+
+  esp_err_t err = cmd->type_info[type].parser(section, parsed_out);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Failed to parse %s section: %s", prefix, esp_err_to_name(err));
+    return false;
+  }
+  return true;
+}
+
+// +QMTCONN? answers with one line per client that is not idle. Each line goes through the
+// parser on its own, the one for 'client_idx' is kept.
+static bool demux_qmtconn(const char* response, int client_idx, qmtconn_read_response_t* out)
+{
+  const char* line = response;
+  const char* eol;
+
+  while ((eol = strstr(line, "\r\n")) != NULL)
+  {
+    size_t len = (size_t) (eol - line);
+    if (len > 0 && strncmp(line, "+QMTCONN:", 9) == 0)
+    {
+      char                    single[BG95_STATUS_SECTION_MAX_LEN];
+      qmtconn_read_response_t parsed = {0};
+
+      int written = snprintf(single, sizeof(single), "\r\n%.*s\r\nOK\r\n", (int) len, line);
+      if (written > 0 && (size_t) written < sizeof(single) &&
+          AT_CMD_QMTCONN.type_info[AT_CMD_TYPE_READ].parser != NULL &&
+          AT_CMD_QMTCONN.type_info[AT_CMD_TYPE_READ].parser(single, &parsed) == ESP_OK &&
+          parsed.present.has_client_idx && parsed.client_idx == client_idx)
+      {
+        *out = parsed;
+        return true;
+      }
+    }
+    line = eol + 2;
+  }
+  return false;
+}
+
+// +CGPADDR: <cid>[,"<addr>"] - the context is active when it has a non zero address
+static bool parse_cgpaddr(const char* response, char* addr, size_t addr_size)
+{
+  char section[BG95_STATUS_SECTION_MAX_LEN];
+
+  addr[0] = '\0';
+  if (collect_section(response, "+CGPADDR:", section, sizeof(section)) == 0)
+  {
+    return false;
+  }
+
+  const char* open_quote = strchr(section, '"');
+  if (open_quote == NULL)
+  {
+    return true; // Context defined but no address assigned
+  }
+  const char* close_quote = strchr(open_quote + 1, '"');
+  if (close_quote == NULL)
+  {
+    return false;
+  }
+
+  size_t len = (size_t) (close_quote - open_quote - 1);
+  if (len >= addr_size)
+  {
+    return false;
+  }
+  memcpy(addr, open_quote + 1, len);
+  addr[len] = '\0';
+  return true;
+}
+
+esp_err_t bg95_status_snapshot_parse(const char*             response,
+                                     int                     client_idx,
+                                     bg95_status_snapshot_t* snapshot)
+{
+  if (response == NULL || snapshot == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(snapshot, 0, sizeof(*snapshot));
+
+  snapshot->present.has_cpin =
+      demux_section(response, "+CPIN:", &AT_CMD_CPIN, AT_CMD_TYPE_READ, &snapshot->cpin);
+  snapshot->present.has_csq =
+      demux_section(response, "+CSQ:", &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, &snapshot->csq);
+  snapshot->present.has_cops =
+      demux_section(response, "+COPS:", &AT_CMD_COPS, AT_CMD_TYPE_READ, &snapshot->cops);
+  snapshot->present.has_qmtconn = demux_qmtconn(response, client_idx, &snapshot->qmtconn);
+
+  snapshot->present.has_pdp_addr =
+      parse_cgpaddr(response, snapshot->pdp_addr, sizeof(snapshot->pdp_addr));
+  snapshot->pdp_active = snapshot->present.has_pdp_addr && snapshot->pdp_addr[0] != '\0' &&
+                         strcmp(snapshot->pdp_addr, "0.0.0.0") != 0;
+
+  return ESP_OK;
+}
+
+esp_err_t bg95_status_snapshot_read(bg95_uart_interface_t*  uart,
+                                    bg95_sched_t*           sched,
+                                    int                     cid,
+                                    int                     client_idx,
+                                    bg95_status_snapshot_t* snapshot)
+{
+  if (uart == NULL || snapshot == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  char cmd[BG95_RAW_AT_CMD_MAX_LEN];
+  snprintf(cmd, sizeof(cmd), "AT+CPIN?;+CSQ;+COPS?;+CGPADDR=%d;+QMTCONN?", cid);
+
+  if (sched != NULL)
+  {
+    esp_err_t err = bg95_sched_acquire(sched, BG95_SCHED_LANE_CONTROL, BG95_SCHED_WAIT_FOREVER);
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+  }
+
+  char      response[BG95_RAW_AT_RESPONSE_MAX_LEN];
+  esp_err_t err =
+      bg95_raw_at_send(uart, cmd, response, sizeof(response), BG95_STATUS_TIMEOUT_MS);
+  if (sched != NULL)
+  {
+    bg95_sched_release(sched);
+  }
+  if (err != ESP_OK && err != ESP_FAIL)
+  {
+    return err;
+  }
+
+  // Parse whatever came back, even when a later command in the line failed
+  esp_err_t parse_err = bg95_status_snapshot_parse(response, client_idx, snapshot);
+  if (parse_err != ESP_OK)
+  {
+    return parse_err;
+  }
+
+  if (err == ESP_FAIL)
+  {
+    ESP_LOGW(TAG, "Status line aborted by modem error, snapshot is partial");
+  }
+  return err;
+}
@@ -0,0 +1,29 @@
+#include "bg95_task.h"
+
+#include <esp_log.h>
+
+static const char* TAG = "BG95_TASK";
+
+BaseType_t bg95_task_create(TaskFunction_t            fn,
+                            const char*               name,
+                            const bg95_task_config_t* config,
+                            void*                     arg,
+                            TaskHandle_t*             task)
+{
+  BaseType_t core = tskNO_AFFINITY;
+
+#ifndef CONFIG_FREERTOS_UNICORE
+  if (config->core >= 0)
+  {
+    core = (BaseType_t) config->core;
+  }
+#endif
+
+  ESP_LOGD(TAG,
+           "%s: stack %u, priority %u, core %d",
+           name,
+           (unsigned) config->stack_size,
+           (unsigned) config->priority,
+           config->core);
+  return xTaskCreatePinnedToCore(fn, name, config->stack_size, arg, config->priority, task, core);
+}
@@ -0,0 +1,174 @@
+#include "bg95_uart_hw.h"
+
+#include "freertos/task.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BG95_UART_HW";
+
+static esp_err_t uart_hw_write(const char* data, size_t len, void* context)
+{
+  bg95_uart_hw_t* hw = (bg95_uart_hw_t*) context;
+
+  int written = uart_write_bytes(hw->port_num, data, len);
+  return written == (int) len ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t uart_hw_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  bg95_uart_hw_t* hw       = (bg95_uart_hw_t*) context;
+  TickType_t      start    = xTaskGetTickCount();
+  TickType_t      limit    = pdMS_TO_TICKS(timeout_ms);
+  size_t          buffered = 0;
+
+  *bytes_read = 0;
+
+  // Wait for an RX event. A wakeup left over from bytes an earlier read already took finds
+  // nothing buffered and waits again.
+  uart_get_buffered_data_len(hw->port_num, &buffered);
+  while (buffered == 0 && !atomic_load(&hw->rx_lost))
+  {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed >= limit)
+    {
+      return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreTake(hw->rx_ready, limit - elapsed);
+    uart_get_buffered_data_len(hw->port_num, &buffered);
+  }
+  if (atomic_exchange(&hw->rx_lost, false))
+  {
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+
+  int len = uart_read_bytes(hw->port_num, data, buffered < max_len ? buffered : max_len, 0);
+
+  // Line end positions are not used, keep the driver's position queue from filling up
+  while (uart_pattern_pop_pos(hw->port_num) != -1)
+  {
+  }
+
+  if (len < 0)
+  {
+    return ESP_FAIL;
+  }
+  *bytes_read = (size_t) len;
+  return len > 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void bg95_uart_hw_on_event(const uart_event_t* event, void* ctx)
+{
+  bg95_uart_hw_t* hw = (bg95_uart_hw_t*) ctx;
+  if (hw == NULL || event == NULL || hw->rx_ready == NULL)
+  {
+    return;
+  }
+
+  switch (event->type)
+  {
+    case UART_BUFFER_FULL:
+    case UART_FIFO_OVF:
+      // Bytes are missing somewhere in what is buffered, drop all of it
+      uart_flush_input(hw->port_num);
+      atomic_store(&hw->rx_lost, true);
+      xSemaphoreGive(hw->rx_ready);
+      break;
+    case UART_DATA:
+    case UART_PATTERN_DET:
+      xSemaphoreGive(hw->rx_ready);
+      break;
+    default:
+      break;
+  }
+}
+
+esp_err_t bg95_uart_hw_init(bg95_uart_hw_t* hw, const bg95_uart_hw_config_t* config)
+{
+  if (hw == NULL || config == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(hw, 0, sizeof(*hw));
+  hw->port_num = config->port_num;
+  atomic_init(&hw->rx_lost, false);
+  hw->rx_ready = xSemaphoreCreateBinary();
+  if (hw->rx_ready == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  const uart_config_t uart_config = {
+      .baud_rate  = BG95_UART_HW_BAUD,
+      .data_bits  = UART_DATA_8_BITS,
+      .parity     = UART_PARITY_DISABLE,
+      .stop_bits  = UART_STOP_BITS_1,
+      .flow_ctrl  = UART_HW_FLOWCTRL_DISABLE,
+      .source_clk = UART_SCLK_DEFAULT,
+  };
+
+  esp_err_t err = uart_driver_install(config->port_num,
+                                      BG95_UART_HW_RX_BUFFER_SIZE,
+                                      BG95_UART_HW_TX_BUFFER_SIZE,
+                                      BG95_UART_HW_EVENT_QUEUE_LEN,
+                                      &hw->event_queue,
+                                      0);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to install UART driver: %s", esp_err_to_name(err));
+    bg95_uart_hw_deinit(hw);
+    return err;
+  }
+  hw->installed = true;
+
+  err = uart_param_config(config->port_num, &uart_config);
+  if (err == ESP_OK)
+  {
+    err = uart_set_pin(config->port_num,
+                       config->tx_gpio_num,
+                       config->rx_gpio_num,
+                       UART_PIN_NO_CHANGE,
+                       UART_PIN_NO_CHANGE);
+  }
+  if (err == ESP_OK)
+  {
+    err = uart_enable_pattern_det_baud_intr(
+        config->port_num, '\n', 1, BG95_UART_HW_PATTERN_CHR_TOUT, 0, 0);
+  }
+  if (err == ESP_OK)
+  {
+    err = uart_pattern_queue_reset(config->port_num, BG95_UART_HW_PATTERN_QUEUE_LEN);
+  }
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to configure UART: %s", esp_err_to_name(err));
+    bg95_uart_hw_deinit(hw);
+    return err;
+  }
+
+  hw->uart.write   = uart_hw_write;
+  hw->uart.read    = uart_hw_read;
+  hw->uart.context = hw;
+  return ESP_OK;
+}
+
+void bg95_uart_hw_deinit(bg95_uart_hw_t* hw)
+{
+  if (hw == NULL)
+  {
+    return;
+  }
+
+  // Deleting the driver frees the event queue, stop its reader first
+  if (hw->installed)
+  {
+    uart_driver_delete(hw->port_num);
+  }
+  if (hw->rx_ready != NULL)
+  {
+    vSemaphoreDelete(hw->rx_ready);
+  }
+  memset(hw, 0, sizeof(*hw));
+}
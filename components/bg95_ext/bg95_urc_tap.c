@@ -0,0 +1,696 @@
+#include "bg95_urc_tap.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char* TAG = "BG95_URC_TAP";
+
+typedef struct
+{
+  char line[BG95_URC_TAP_LINE_MAX_LEN];
+  bool solicited;
+} dispatch_item_t;
+
+static bool is_final_result_line(const char* line)
+{
+  return strcmp(line, "OK") == 0 || strcmp(line, "ERROR") == 0 ||
+         strncmp(line, "+CME ERROR:", 11) == 0 || strncmp(line, "+CMS ERROR:", 11) == 0;
+}
+
+// Record the command names of a written line ("AT+CPIN?;+CSQ" -> "CPIN", "CSQ").
+// Must be called with tap->lock held.
+static void track_command_names(bg95_urc_tap_t* tap, const char* data, size_t len)
+{
+  tap->num_cmd_names = 0;
+
+  size_t i = 2; // Skip "AT"
+  while (i < len && tap->num_cmd_names < BG95_URC_TAP_MAX_CMD_NAMES)
+  {
+    if (data[i] != '+')
+    {
+      break;
+    }
+    i++;
+
+    char*  name     = tap->cmd_names[tap->num_cmd_names];
+    size_t name_len = 0;
+    while (i < len && data[i] != '=' && data[i] != '?' && data[i] != ';' && data[i] != '\r' &&
+           data[i] != '\n' && name_len < BG95_URC_TAP_CMD_NAME_MAX_LEN - 1)
+    {
+      name[name_len++] = data[i++];
+    }
+    name[name_len] = '\0';
+    if (name_len > 0)
+    {
+      tap->num_cmd_names++;
+    }
+
+    // Advance to the next concatenated command, if any
+    while (i < len && data[i] != ';')
+    {
+      i++;
+    }
+    if (i < len)
+    {
+      i++;
+    }
+  }
+}
+
+// Must be called with tap->lock held
+static bool is_solicited(const bg95_urc_tap_t* tap, const char* line)
+{
+  if (!tap->in_command || line[0] != '+')
+  {
+    return false;
+  }
+  for (size_t i = 0; i < tap->num_cmd_names; i++)
+  {
+    size_t name_len = strlen(tap->cmd_names[i]);
+    if (strncmp(line + 1, tap->cmd_names[i], name_len) == 0 && line[1 + name_len] == ':')
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void run_handlers(bg95_urc_tap_t* tap, const char* line, bool solicited)
+{
+  bg95_urc_tap_handler_t handlers[BG95_URC_TAP_MAX_HANDLERS];
+  size_t                 num_handlers;
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  num_handlers = tap->num_handlers;
+  memcpy(handlers, tap->handlers, sizeof(handlers));
+  xSemaphoreGive(tap->lock);
+
+  if (tap->dispatch_lock != NULL)
+  {
+    xSemaphoreTake(tap->dispatch_lock, portMAX_DELAY);
+  }
+  for (size_t i = 0; i < num_handlers; i++)
+  {
+    handlers[i].fn(line, solicited, handlers[i].ctx);
+  }
+  if (tap->dispatch_lock != NULL)
+  {
+    xSemaphoreGive(tap->dispatch_lock);
+  }
+}
+
+// Classify a line and run the handlers. Lines from the reader task are queued for the dispatch
+// task when there is one, and their final results were already decoded by push_chunk().
+static void dispatch_line(bg95_urc_tap_t* tap, const char* line, bool from_reader)
+{
+  if (line[0] == '\0' || strncmp(line, "AT", 2) == 0) // Blank or echo
+  {
+    return;
+  }
+
+  bool solicited;
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  if (is_final_result_line(line))
+  {
+    tap->in_command = false;
+    if (!from_reader)
+    {
+      bg95_at_error_parse_line(line, &tap->last_error);
+    }
+    xSemaphoreGive(tap->lock);
+    return;
+  }
+  if (tap->wait_armed && !tap->wait_hit &&
+      strncmp(line, tap->wait_prefix, strlen(tap->wait_prefix)) == 0)
+  {
+    strncpy(tap->wait_line, line, sizeof(tap->wait_line) - 1);
+    tap->wait_line[sizeof(tap->wait_line) - 1] = '\0';
+    tap->wait_hit                              = true;
+    xSemaphoreGive(tap->wait_done);
+  }
+  solicited = is_solicited(tap, line);
+  if (solicited)
+  {
+    tap->stats.response_lines++;
+  }
+  else
+  {
+    tap->stats.urc_lines++;
+  }
+  xSemaphoreGive(tap->lock);
+
+  if (!from_reader || tap->dispatch_queue == NULL)
+  {
+    run_handlers(tap, line, solicited);
+    return;
+  }
+
+  dispatch_item_t item;
+  strncpy(item.line, line, sizeof(item.line) - 1);
+  item.line[sizeof(item.line) - 1] = '\0';
+  item.solicited                   = solicited;
+
+  // A full queue blocks the reader rather than dropping the line or running it out of order.
+  // Only the physical read stalls meanwhile, the UART driver buffers the bytes behind it and the
+  // driver side already has everything pushed so far. Waits in slices so deinit is never stuck.
+  if (xQueueSend(tap->dispatch_queue, &item, 0) == pdTRUE)
+  {
+    return;
+  }
+  tap->stats.queue_waits++;
+  while (tap->running)
+  {
+    if (xQueueSend(tap->dispatch_queue, &item, pdMS_TO_TICKS(BG95_URC_TAP_DISPATCH_WAIT_MS)) ==
+        pdTRUE)
+    {
+      return;
+    }
+  }
+}
+
+static void feed_lines(bg95_urc_tap_t* tap, const char* data, size_t len, bool from_reader)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    char c = data[i];
+    if (c == '\n')
+    {
+      if (tap->line_len > 0 && tap->line[tap->line_len - 1] == '\r')
+      {
+        tap->line_len--;
+      }
+      tap->line[tap->line_len] = '\0';
+      if (tap->line_truncated)
+      {
+        tap->stats.long_lines++;
+      }
+      dispatch_line(tap, tap->line, from_reader);
+      tap->line_len       = 0;
+      tap->line_truncated = false;
+    }
+    else if (tap->line_len < BG95_URC_TAP_LINE_MAX_LEN - 1)
+    {
+      tap->line[tap->line_len++] = c;
+    }
+    else
+    {
+      tap->line_truncated = true;
+    }
+  }
+}
+
+void bg95_urc_tap_feed(bg95_urc_tap_t* tap, const char* data, size_t len)
+{
+  feed_lines(tap, data, len, false);
+}
+
+// Decode the final result codes in a chunk into 'last_error'. Only the first bytes of each line
+// are kept, final result lines are short. Must be called with tap->lock held.
+static void decode_final_results(bg95_urc_tap_t* tap, const char* data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    if (data[i] != '\n')
+    {
+      if (tap->result_len < sizeof(tap->result_line) - 1)
+      {
+        tap->result_line[tap->result_len] = data[i];
+      }
+      if (tap->result_len < sizeof(tap->result_line))
+      {
+        tap->result_len++; // Reaches the buffer size once the line is too long to be a result
+      }
+      continue;
+    }
+
+    size_t line_len = tap->result_len;
+    tap->result_len = 0;
+    if (line_len >= sizeof(tap->result_line))
+    {
+      continue;
+    }
+    if (line_len > 0 && tap->result_line[line_len - 1] == '\r')
+    {
+      line_len--;
+    }
+    tap->result_line[line_len] = '\0';
+    if (is_final_result_line(tap->result_line))
+    {
+      bg95_at_error_parse_line(tap->result_line, &tap->last_error);
+    }
+  }
+}
+
+// Push a chunk to rx_stream and wake the driver side if it completed a line or a "> " prompt.
+// Runs under the lock so a command write cannot flush the stream between the push and the
+// accounting, and so 'last_error' already matches a final result the driver can read.
+// Returns the number of bytes pushed.
+static size_t push_chunk(bg95_urc_tap_t* tap, const char* data, size_t len)
+{
+  size_t boundary = 0; // Bytes up to and including the last line end in 'data'
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  decode_final_results(tap, data, len);
+  len = xStreamBufferSend(tap->rx_stream, data, len, 0);
+  for (size_t i = 0; i < len; i++)
+  {
+    if (data[i] == '\n' || (data[i] == ' ' && tap->last_byte == '>'))
+    {
+      boundary = i + 1;
+    }
+    tap->last_byte = data[i];
+  }
+
+  if (boundary > 0)
+  {
+    tap->ready_bytes += tap->partial_bytes + boundary;
+    tap->partial_bytes = len - boundary;
+    xSemaphoreGive(tap->line_ready);
+  }
+  else
+  {
+    tap->partial_bytes += len;
+  }
+  xSemaphoreGive(tap->lock);
+  return len;
+}
+
+// The physical read reported lost input (bg95_uart_hw flushes its RX buffer on an overflow).
+// What is buffered of the response has a hole in it, so it goes, and the command in flight fails
+// on its next read instead of parsing it.
+static void drop_damaged_input(bg95_urc_tap_t* tap)
+{
+  tap->line_len       = 0;
+  tap->line_truncated = false;
+  tap->result_len     = 0;
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  xStreamBufferReset(tap->rx_stream);
+  tap->ready_bytes   = 0;
+  tap->partial_bytes = 0;
+  tap->last_byte     = '\0';
+  tap->rx_lost       = tap->in_command;
+  xSemaphoreGive(tap->lock);
+  xSemaphoreGive(tap->line_ready);
+}
+
+static void urc_tap_task(void* pvParameters)
+{
+  bg95_urc_tap_t* tap = (bg95_urc_tap_t*) pvParameters;
+  char            buf[BG95_URC_TAP_READ_CHUNK];
+
+  while (tap->running)
+  {
+    size_t    bytes_read = 0;
+    esp_err_t err        = tap->phys->read(
+        buf, sizeof(buf), &bytes_read, BG95_URC_TAP_POLL_MS, tap->phys->context);
+    if (bytes_read == 0)
+    {
+      if (err == ESP_ERR_INVALID_RESPONSE)
+      {
+        drop_damaged_input(tap);
+      }
+      else if (err != ESP_OK && err != ESP_ERR_TIMEOUT)
+      {
+        vTaskDelay(pdMS_TO_TICKS(BG95_URC_TAP_POLL_MS));
+      }
+      continue;
+    }
+
+    size_t sent = push_chunk(tap, buf, bytes_read);
+    if (sent < bytes_read)
+    {
+      tap->stats.dropped_bytes += bytes_read - sent;
+    }
+    feed_lines(tap, buf, bytes_read, true);
+  }
+
+  xSemaphoreGive(tap->stopped);
+  vTaskDelete(NULL);
+}
+
+#ifdef CONFIG_BG95_EXT_URC_DISPATCH_TASK
+static void urc_dispatch_task(void* pvParameters)
+{
+  bg95_urc_tap_t* tap = (bg95_urc_tap_t*) pvParameters;
+  dispatch_item_t item;
+
+  while (tap->running)
+  {
+    if (xQueueReceive(tap->dispatch_queue, &item, pdMS_TO_TICKS(BG95_URC_TAP_POLL_MS)) == pdTRUE)
+    {
+      run_handlers(tap, item.line, item.solicited);
+    }
+  }
+
+  xSemaphoreGive(tap->dispatch_stopped);
+  vTaskDelete(NULL);
+}
+
+static esp_err_t start_dispatch_task(bg95_urc_tap_t* tap)
+{
+  const bg95_task_config_t task_config = {
+      .stack_size = BG95_URC_TAP_DISPATCH_TASK_STACK_SIZE,
+      .priority   = BG95_URC_TAP_DISPATCH_TASK_PRIORITY,
+      .core       = BG95_URC_TAP_DISPATCH_TASK_CORE,
+  };
+
+  tap->dispatch_queue   = xQueueCreate(BG95_URC_TAP_DISPATCH_QUEUE_LEN, sizeof(dispatch_item_t));
+  tap->dispatch_stopped = xSemaphoreCreateBinary();
+  tap->dispatch_lock    = xSemaphoreCreateMutex();
+  if (tap->dispatch_queue == NULL || tap->dispatch_stopped == NULL || tap->dispatch_lock == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  if (bg95_task_create(
+          urc_dispatch_task, "bg95_urc_disp", &task_config, tap, &tap->dispatch_task) != pdPASS)
+  {
+    ESP_LOGE(TAG, "Failed to create URC dispatch task");
+    tap->dispatch_task = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+#endif
+
+static esp_err_t urc_tap_write(const char* data, size_t len, void* context)
+{
+  bg95_urc_tap_t* tap = (bg95_urc_tap_t*) context;
+
+  if (len >= 2 && strncmp(data, "AT", 2) == 0)
+  {
+    xSemaphoreTake(tap->lock, portMAX_DELAY);
+    xStreamBufferReset(tap->rx_stream); // Drop anything stale before the new response
+    tap->ready_bytes   = 0;
+    tap->partial_bytes = 0;
+    tap->last_byte     = '\0';
+    tap->rx_lost       = false;
+    xSemaphoreTake(tap->line_ready, 0);
+    track_command_names(tap, data, len);
+    tap->in_command = true;
+
+    bg95_urc_tap_cmd_observer_t observers[BG95_URC_TAP_MAX_CMD_OBSERVERS];
+    size_t                      num_observers = tap->num_cmd_observers;
+    memcpy(observers, tap->cmd_observers, sizeof(observers));
+    xSemaphoreGive(tap->lock);
+
+    for (size_t i = 0; i < num_observers; i++)
+    {
+      observers[i].fn(data, len, observers[i].ctx);
+    }
+  }
+
+  return tap->phys->write(data, len, tap->phys->context);
+}
+
+static esp_err_t urc_tap_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  bg95_urc_tap_t* tap  = (bg95_urc_tap_t*) context;
+  bool            lost = false;
+
+  if (!tap->wake_on_line)
+  {
+    *bytes_read = xStreamBufferReceive(tap->rx_stream, data, max_len, pdMS_TO_TICKS(timeout_ms));
+    xSemaphoreTake(tap->lock, portMAX_DELAY);
+    lost         = tap->rx_lost;
+    tap->rx_lost = false;
+    xSemaphoreGive(tap->lock);
+  }
+  else
+  {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t limit = pdMS_TO_TICKS(timeout_ms);
+
+    xSemaphoreTake(tap->lock, portMAX_DELAY);
+    while (tap->ready_bytes == 0 && !tap->rx_lost)
+    {
+      TickType_t elapsed = xTaskGetTickCount() - start;
+      if (elapsed >= limit)
+      {
+        break;
+      }
+      xSemaphoreGive(tap->lock);
+      xSemaphoreTake(tap->line_ready, limit - elapsed);
+      xSemaphoreTake(tap->lock, portMAX_DELAY);
+    }
+
+    // Complete lines first; on timeout hand out the partial tail so callers still see it
+    size_t want = tap->ready_bytes > 0 && tap->ready_bytes < max_len ? tap->ready_bytes : max_len;
+    *bytes_read = xStreamBufferReceive(tap->rx_stream, data, want, 0);
+    if (*bytes_read <= tap->ready_bytes)
+    {
+      tap->ready_bytes -= *bytes_read;
+    }
+    else
+    {
+      size_t tail        = *bytes_read - tap->ready_bytes;
+      tap->partial_bytes = tail < tap->partial_bytes ? tap->partial_bytes - tail : 0;
+      tap->ready_bytes   = 0;
+    }
+    lost         = tap->rx_lost;
+    tap->rx_lost = false;
+    xSemaphoreGive(tap->lock);
+  }
+
+  if (lost)
+  {
+    *bytes_read = 0; // Part of the response was lost on the physical link
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+
+  if (*bytes_read > 0)
+  {
+    tap->stats.read_wakeups++;
+  }
+  else
+  {
+    tap->stats.empty_wakeups++;
+  }
+  return ESP_OK;
+}
+
+bool bg95_urc_tap_last_error(bg95_urc_tap_t* tap, bg95_at_error_t* error)
+{
+  if (tap == NULL || error == NULL)
+  {
+    return false;
+  }
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  *error = tap->last_error;
+  xSemaphoreGive(tap->lock);
+  return error->kind != BG95_AT_ERROR_NONE;
+}
+
+void bg95_urc_tap_set_wake_on_line(bg95_urc_tap_t* tap, bool enable)
+{
+  if (tap == NULL)
+  {
+    return;
+  }
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  tap->wake_on_line = enable;
+  // The counters drift while reads bypass them, hand out whatever is buffered right away
+  tap->ready_bytes   = xStreamBufferBytesAvailable(tap->rx_stream);
+  tap->partial_bytes = 0;
+  xSemaphoreGive(tap->lock);
+  xSemaphoreGive(tap->line_ready); // Let a reader blocked in the old mode re-check
+}
+
+esp_err_t bg95_urc_tap_arm_wait(bg95_urc_tap_t* tap, const char* prefix)
+{
+  if (tap == NULL || prefix == NULL || prefix[0] == '\0' ||
+      strlen(prefix) >= BG95_URC_TAP_WAIT_PREFIX_MAX_LEN)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  strcpy(tap->wait_prefix, prefix);
+  tap->wait_line[0] = '\0';
+  tap->wait_hit     = false;
+  tap->wait_armed   = true;
+  xSemaphoreTake(tap->wait_done, 0); // Drop a hit of a previous wait nobody collected
+  xSemaphoreGive(tap->lock);
+  return ESP_OK;
+}
+
+esp_err_t bg95_urc_tap_wait(bg95_urc_tap_t* tap, char* line, size_t line_size, uint32_t timeout_ms)
+{
+  if (tap == NULL || (line != NULL && line_size == 0))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  bool armed = tap->wait_armed;
+  xSemaphoreGive(tap->lock);
+  if (!armed)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(tap->wait_done, pdMS_TO_TICKS(timeout_ms));
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  bool hit        = tap->wait_hit;
+  tap->wait_armed = false;
+  tap->wait_hit   = false;
+  if (hit && line != NULL)
+  {
+    strncpy(line, tap->wait_line, line_size - 1);
+    line[line_size - 1] = '\0';
+  }
+  xSemaphoreTake(tap->wait_done, 0);
+  xSemaphoreGive(tap->lock);
+  return hit ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t bg95_urc_tap_init(bg95_urc_tap_t* tap, bg95_uart_interface_t* phys)
+{
+  if (tap == NULL || phys == NULL || phys->write == NULL || phys->read == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(tap, 0, sizeof(*tap));
+  tap->phys = phys;
+
+  tap->rx_stream    = xStreamBufferCreate(BG95_URC_TAP_STREAM_SIZE, 1);
+  tap->lock         = xSemaphoreCreateMutex();
+  tap->stopped      = xSemaphoreCreateBinary();
+  tap->line_ready   = xSemaphoreCreateBinary();
+  tap->wait_done    = xSemaphoreCreateBinary();
+  tap->wake_on_line = true;
+  if (tap->rx_stream == NULL || tap->lock == NULL || tap->stopped == NULL ||
+      tap->line_ready == NULL || tap->wait_done == NULL)
+  {
+    bg95_urc_tap_deinit(tap);
+    return ESP_ERR_NO_MEM;
+  }
+
+  tap->uart.write   = urc_tap_write;
+  tap->uart.read    = urc_tap_read;
+  tap->uart.context = tap;
+
+  tap->running = true;
+#ifdef CONFIG_BG95_EXT_URC_DISPATCH_TASK
+  if (start_dispatch_task(tap) != ESP_OK)
+  {
+    tap->running = false;
+    bg95_urc_tap_deinit(tap);
+    return ESP_ERR_NO_MEM;
+  }
+#endif
+
+  const bg95_task_config_t task_config = {
+      .stack_size = BG95_URC_TAP_TASK_STACK_SIZE,
+      .priority   = BG95_URC_TAP_TASK_PRIORITY,
+      .core       = BG95_URC_TAP_TASK_CORE,
+  };
+  if (bg95_task_create(urc_tap_task, "bg95_urc_tap", &task_config, tap, &tap->task) != pdPASS)
+  {
+    ESP_LOGE(TAG, "Failed to create URC tap task");
+    tap->task    = NULL;
+    tap->running = false;
+    bg95_urc_tap_deinit(tap);
+    return ESP_ERR_NO_MEM;
+  }
+
+  return ESP_OK;
+}
+
+void bg95_urc_tap_deinit(bg95_urc_tap_t* tap)
+{
+  if (tap == NULL)
+  {
+    return;
+  }
+
+  // Tasks exit once they see 'running' cleared, each gives its own semaphore
+  tap->running = false;
+  if (tap->task != NULL)
+  {
+    xSemaphoreTake(tap->stopped, portMAX_DELAY);
+  }
+  if (tap->dispatch_task != NULL)
+  {
+    xSemaphoreTake(tap->dispatch_stopped, portMAX_DELAY);
+  }
+  if (tap->dispatch_queue != NULL)
+  {
+    vQueueDelete(tap->dispatch_queue);
+  }
+  if (tap->dispatch_stopped != NULL)
+  {
+    vSemaphoreDelete(tap->dispatch_stopped);
+  }
+  if (tap->dispatch_lock != NULL)
+  {
+    vSemaphoreDelete(tap->dispatch_lock);
+  }
+  if (tap->rx_stream != NULL)
+  {
+    vStreamBufferDelete(tap->rx_stream);
+  }
+  if (tap->lock != NULL)
+  {
+    vSemaphoreDelete(tap->lock);
+  }
+  if (tap->stopped != NULL)
+  {
+    vSemaphoreDelete(tap->stopped);
+  }
+  if (tap->line_ready != NULL)
+  {
+    vSemaphoreDelete(tap->line_ready);
+  }
+  if (tap->wait_done != NULL)
+  {
+    vSemaphoreDelete(tap->wait_done);
+  }
+  memset(tap, 0, sizeof(*tap));
+}
+
+esp_err_t bg95_urc_tap_add_handler(bg95_urc_tap_t* tap, bg95_urc_handler_t fn, void* ctx)
+{
+  if (tap == NULL || fn == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  if (tap->num_handlers >= BG95_URC_TAP_MAX_HANDLERS)
+  {
+    xSemaphoreGive(tap->lock);
+    return ESP_ERR_NO_MEM;
+  }
+  tap->handlers[tap->num_handlers].fn  = fn;
+  tap->handlers[tap->num_handlers].ctx = ctx;
+  tap->num_handlers++;
+  xSemaphoreGive(tap->lock);
+
+  return ESP_OK;
+}
+
+esp_err_t bg95_urc_tap_add_cmd_observer(bg95_urc_tap_t* tap, bg95_urc_tap_cmd_fn_t fn, void* ctx)
+{
+  if (tap == NULL || fn == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(tap->lock, portMAX_DELAY);
+  if (tap->num_cmd_observers >= BG95_URC_TAP_MAX_CMD_OBSERVERS)
+  {
+    xSemaphoreGive(tap->lock);
+    return ESP_ERR_NO_MEM;
+  }
+  tap->cmd_observers[tap->num_cmd_observers].fn  = fn;
+  tap->cmd_observers[tap->num_cmd_observers].ctx = ctx;
+  tap->num_cmd_observers++;
+  xSemaphoreGive(tap->lock);
+
+  return ESP_OK;
+}
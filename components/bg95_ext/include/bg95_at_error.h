@@ -0,0 +1,55 @@
+#ifndef BG95_AT_ERROR_H
+#define BG95_AT_ERROR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Structured decoding of AT error result codes.
+// "+CME ERROR: <n>" and "+CMS ERROR: <n>" are looked up in a compact table built from
+// 3GPP TS 27.007/27.005 and the Quectel TCP/IP error list, so callers can tell "SIM busy"
+// from "operation not allowed" instead of both being ESP_FAIL. Both numeric (AT+CMEE=1) and
+// verbose (AT+CMEE=2) error reports are understood.
+//
+// Every code carries a retry class:
+//  - IMMEDIATE: the modem is momentarily busy, repeating the command shortly is expected to work
+//  - BACKOFF: network or resource condition, retry with a growing delay
+//  - NEVER: the request itself is wrong or needs user action (SIM, credentials, parameters)
+// A plain "ERROR" and codes missing from the table are BACKOFF.
+
+typedef enum
+{
+  BG95_AT_ERROR_NONE = 0,
+  BG95_AT_ERROR_GENERIC, // Plain "ERROR" or numeric 4
+  BG95_AT_ERROR_CME,
+  BG95_AT_ERROR_CMS,
+} bg95_at_error_kind_t;
+
+typedef enum
+{
+  BG95_AT_RETRY_IMMEDIATE = 0,
+  BG95_AT_RETRY_BACKOFF,
+  BG95_AT_RETRY_NEVER,
+} bg95_at_retry_t;
+
+typedef struct
+{
+  bg95_at_error_kind_t kind;
+  int                  code; // -1 when not known (GENERIC or unknown verbose text)
+  bg95_at_retry_t      retry;
+} bg95_at_error_t;
+
+// Find the error final result code in a response. Returns false and sets 'error' to
+// BG95_AT_ERROR_NONE when the response holds none.
+bool bg95_at_error_parse(const char* response, bg95_at_error_t* error);
+
+// Decode a single line without its "\r\n" ("ERROR", "+CME ERROR: 14", "+CMS ERROR: SIM busy")
+bool bg95_at_error_parse_line(const char* line, bg95_at_error_t* error);
+
+bg95_at_retry_t bg95_at_error_retry_class(bg95_at_error_kind_t kind, int code);
+
+// Table description of the error, "unknown" when not in the table
+const char* bg95_at_error_to_str(const bg95_at_error_t* error);
+
+const char* bg95_at_retry_to_str(bg95_at_retry_t retry);
+
+#endif /* BG95_AT_ERROR_H */
@@ -0,0 +1,80 @@
+#ifndef BG95_BAUD_H
+#define BG95_BAUD_H
+
+#include "bg95_uart_interface.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Runtime UART rate negotiation with AT+IPR.
+// bg95_uart_config_t has no rate field, so the host side is switched through a callback
+// (uart_set_baudrate() on target). Every switch is verified with a burst of "AT" probes; a
+// failed probe falls back to the previous rate, and when even that is lost every other known
+// rate is hunted with the same probe burst. The working rate is stored in NVS so the next boot
+// starts at it.
+//
+// 'uart' is a metering wrapper around the physical interface that counts bytes per direction,
+// giving the effective link throughput next to the nominal rate.
+
+#define BG95_BAUD_NVS_NAMESPACE "bg95"
+#define BG95_BAUD_NVS_KEY "baud"
+
+#define BG95_BAUD_DEFAULT 115200
+#define BG95_BAUD_MAX 921600
+#define BG95_BAUD_PROBE_COUNT 3
+#define BG95_BAUD_PROBE_TIMEOUT_MS 300
+#define BG95_BAUD_SWITCH_DELAY_MS 50 // Modem applies AT+IPR after its OK
+#define BG95_BAUD_CMD_TIMEOUT_MS 1000
+
+// Called to change the host UART rate
+typedef esp_err_t (*bg95_baud_set_fn_t)(uint32_t baud, void* ctx);
+
+typedef struct
+{
+  uint32_t baud;           // Current rate on both ends
+  uint32_t negotiations;   // Successful rate changes
+  uint32_t fallbacks;      // Switches undone because the probe failed
+  uint32_t hunts;          // Link lost, every rate tried
+  uint32_t probe_failures; // Individual "AT" probes without OK
+  uint64_t bytes_tx;
+  uint64_t bytes_rx;
+  int64_t  since_us; // Byte counters start
+} bg95_baud_stats_t;
+
+typedef struct
+{
+  bg95_uart_interface_t  uart; // Metered interface, hand this one to the next layer
+  bg95_uart_interface_t* phys;
+
+  bg95_baud_set_fn_t set_baud;
+  void*              set_baud_ctx;
+
+  bg95_baud_stats_t stats;
+} bg95_baud_t;
+
+// 'initial_baud' is the rate the host UART is currently configured for
+esp_err_t bg95_baud_init(bg95_baud_t*           link,
+                         bg95_uart_interface_t* phys,
+                         uint32_t               initial_baud,
+                         bg95_baud_set_fn_t     set_baud,
+                         void*                  set_baud_ctx);
+
+// Move host and modem to the stored rate, hunting for the modem when it does not answer there.
+// Call before anything else talks to the modem.
+esp_err_t bg95_baud_sync(bg95_baud_t* link);
+
+// Step up to the fastest supported rate <= 'target_baud' that passes the probe and store it.
+// Returns ESP_ERR_NOT_SUPPORTED when no faster rate worked, the link stays usable either way.
+esp_err_t bg95_baud_negotiate(bg95_baud_t* link, uint32_t target_baud);
+
+// Send BG95_BAUD_PROBE_COUNT "AT" commands, all must answer OK
+esp_err_t bg95_baud_probe(bg95_baud_t* link);
+
+// Effective bits per second over both directions since the counters were reset
+uint32_t bg95_baud_throughput_bps(const bg95_baud_t* link, int64_t now_us);
+void     bg95_baud_reset_counters(bg95_baud_t* link);
+
+void bg95_baud_log_stats(const bg95_baud_t* link);
+
+#endif /* BG95_BAUD_H */
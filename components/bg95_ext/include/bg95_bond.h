@@ -0,0 +1,182 @@
+#ifndef BG95_BOND_H
+#define BG95_BOND_H
+
+#include "bg95_driver.h"
+#include "bg95_rtt_estimator.h"
+#include "bg95_sched.h"
+#include "bg95_task.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Publish bonding over several modems, e.g. the two BG95s of a gateway board.
+// Each link is one modem with its own driver handle and MQTT client, served by its own worker
+// task. bg95_bond_publish() copies the message into a fixed pool and queues it on the up link
+// with the lowest expected wait: queue depth (in flight included) weighted by the link's signal
+// quality, ties going to the better signal.
+//
+// A link goes down on "+QMTSTAT: <client_idx>,..." (feed bg95_bond_urc_handler() from the link's
+// URC tap), after BG95_BOND_LINK_DOWN_FAILURES failed publishes in a row, or through
+// bg95_bond_set_link_up(). Its queued messages move to the remaining up links, and a publish
+// that fails on the way down is queued again instead of being released, so a failover never
+// drops a message. Without any link up, messages stay queued until one comes back.
+//
+// bg95_bond_publish_by() gives a message an absolute esp_timer_get_time() deadline. Queues run
+// earliest deadline first, messages without one behind them in arrival order. A message past its
+// deadline is dropped before it reaches a modem and counted in 'expired'; one submitted late is
+// rejected right away, and a full pool first makes room by dropping expired messages.
+//
+// With a scheduler in the link config the default publish queues in the lane for the message
+// size (bg95_sched_publish_lane()), carrying the message deadline. A message whose deadline
+// passes while it waits for the modem is dropped as expired, not counted against the link.
+// An 'rtt' estimator per link learns that modem's QMTPUB round trips from the same publishes.
+//
+// A message is only released once a publish returned success. A publish that reached the broker
+// but failed afterwards is sent again, QoS 1 and 2 messages can therefore arrive twice.
+//
+// The exceptions are messages the bond gives up on, released and counted in 'failed': one a link
+// rejects (the publish returned ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_SIZE, which does not count
+// against the link), and one that failed BG95_BOND_MAX_ATTEMPTS times. The cap is below what it
+// takes to bring every link down, so a message that fails everywhere cannot stall the bond.
+//
+// All state lives in bg95_bond_t and the handles of the links, any number of bonds and driver
+// handles can be used side by side.
+
+#define BG95_BOND_MAX_LINKS 2
+#define BG95_BOND_MAX_MSGS 16
+#define BG95_BOND_TOPIC_MAX_LEN 128
+#define BG95_BOND_PAYLOAD_MAX_LEN 512
+#define BG95_BOND_LINK_DOWN_FAILURES 3
+#define BG95_BOND_MAX_ATTEMPTS (BG95_BOND_LINK_DOWN_FAILURES * BG95_BOND_MAX_LINKS - 1)
+#define BG95_BOND_QUALITY_UNKNOWN 99 // AT+CSQ "not known or not detectable"
+#define BG95_BOND_NO_DEADLINE 0
+#define BG95_BOND_POLL_MS 100
+#define BG95_BOND_TASK_STACK_SIZE CONFIG_BG95_EXT_BOND_TASK_STACK_SIZE
+#define BG95_BOND_TASK_PRIORITY CONFIG_BG95_EXT_BOND_TASK_PRIORITY
+#define BG95_BOND_TASK_CORE CONFIG_BG95_EXT_APP_TASK_CORE
+
+typedef struct
+{
+  char            topic[BG95_BOND_TOPIC_MAX_LEN];
+  char            payload[BG95_BOND_PAYLOAD_MAX_LEN];
+  size_t          len;
+  qmtpub_qos_t    qos;
+  qmtpub_retain_t retain;
+  uint32_t        attempts;    // Failed publishes so far, over all links
+  int64_t         deadline_us; // BG95_BOND_NO_DEADLINE or esp_timer_get_time() based
+} bg95_bond_msg_t;
+
+// Publishes one message on a link, ESP_OK only when the modem reported success.
+// ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_SIZE when the message itself was refused, any other
+// error is taken as a link failure.
+typedef esp_err_t (*bg95_bond_publish_fn_t)(const bg95_bond_msg_t* msg, void* ctx);
+
+typedef struct
+{
+  bg95_handle_t*        handle; // Driver handle of this modem, not owned
+  bg95_sched_t*         sched;  // Scheduler shared with the modem's other users, optional
+  bg95_rtt_estimator_t* rtt;    // Learns this modem's QMTPUB round trips, optional
+  int                   client_idx;
+
+  // NULL publishes through bg95_mqtt_publish_fixed_length() on 'handle'
+  bg95_bond_publish_fn_t publish;
+  void*                  publish_ctx;
+} bg95_bond_link_config_t;
+
+typedef struct
+{
+  uint32_t published;
+  uint32_t failures;  // Link failures, see BG95_BOND_LINK_DOWN_FAILURES
+  uint32_t rejected;  // Messages this link refused
+  uint32_t downs;     // Up to down transitions
+  uint32_t failovers; // Messages moved away from this link
+} bg95_bond_link_stats_t;
+
+struct bg95_bond;
+
+typedef struct
+{
+  struct bg95_bond*       bond;
+  int                     index;
+  bg95_bond_link_config_t config;
+
+  bool     up;
+  int      quality; // AT+CSQ <rssi>, 0..31 or BG95_BOND_QUALITY_UNKNOWN
+  uint32_t failures_in_row;
+  uint16_t next_msgid; // Driver publishes with QoS > 0
+
+  // Queued message indices into the pool, guarded by the bond's lock
+  uint8_t queue[BG95_BOND_MAX_MSGS];
+  size_t  head;
+  size_t  count;
+  int     in_flight; // Pool index being published, -1 when idle
+
+  SemaphoreHandle_t wake;
+  SemaphoreHandle_t stopped;
+  TaskHandle_t      task;
+
+  bg95_bond_link_stats_t stats;
+} bg95_bond_link_t;
+
+typedef struct bg95_bond
+{
+  bg95_bond_link_t links[BG95_BOND_MAX_LINKS];
+  size_t           num_links;
+
+  SemaphoreHandle_t lock; // Guards the pool and every link's queue and state
+  SemaphoreHandle_t idle; // Given when the last pending message was released
+  volatile bool     running;
+
+  bg95_bond_msg_t msgs[BG95_BOND_MAX_MSGS];
+  bool            used[BG95_BOND_MAX_MSGS];
+  size_t          pending; // Messages taken from the pool, queued or in flight
+  uint32_t        expired; // Dropped or rejected past their deadline, never published
+  uint32_t        failed;  // Given up on after a rejection or BG95_BOND_MAX_ATTEMPTS failures
+} bg95_bond_t;
+
+// Start one worker per link, all links start up with unknown quality
+esp_err_t bg95_bond_init(bg95_bond_t*                   bond,
+                         const bg95_bond_link_config_t* links,
+                         size_t                         num_links);
+void      bg95_bond_deinit(bg95_bond_t* bond);
+
+// Copy and queue a message. ESP_ERR_NO_MEM when the pool is full, ESP_ERR_INVALID_SIZE when the
+// topic or payload does not fit.
+esp_err_t bg95_bond_publish(bg95_bond_t*    bond,
+                            const char*     topic,
+                            const char*     payload,
+                            size_t          len,
+                            qmtpub_qos_t    qos,
+                            qmtpub_retain_t retain);
+
+// Same, dropped instead of published once esp_timer_get_time() reaches 'deadline_us'.
+// ESP_ERR_TIMEOUT when the deadline already passed.
+esp_err_t bg95_bond_publish_by(bg95_bond_t*    bond,
+                               const char*     topic,
+                               const char*     payload,
+                               size_t          len,
+                               qmtpub_qos_t    qos,
+                               qmtpub_retain_t retain,
+                               int64_t         deadline_us);
+
+// Mark a link up or down, e.g. after the application reconnected its MQTT client
+esp_err_t bg95_bond_set_link_up(bg95_bond_t* bond, int link, bool up);
+
+// Signal quality as reported by AT+CSQ, e.g. from a status snapshot
+esp_err_t bg95_bond_set_quality(bg95_bond_t* bond, int link, int csq_rssi);
+
+// Queued plus in flight messages of a link
+size_t bg95_bond_link_depth(bg95_bond_t* bond, int link);
+
+// Wait until every queued message was published, ESP_ERR_TIMEOUT otherwise
+esp_err_t bg95_bond_wait_idle(bg95_bond_t* bond, uint32_t timeout_ms);
+
+// bg95_urc_handler_t for the URC tap of a link, ctx is &bond->links[i]
+void bg95_bond_urc_handler(const char* line, bool solicited, void* ctx);
+
+#endif /* BG95_BOND_H */
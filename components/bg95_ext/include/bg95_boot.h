@@ -0,0 +1,98 @@
+#ifndef BG95_BOOT_H
+#define BG95_BOOT_H
+
+#include "bg95_driver.h"
+#include "bg95_net_reg.h"
+#include "bg95_sched.h"
+#include "bg95_uart_interface.h"
+#include "bg95_urc_tap.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Boot orchestrator optimised for time-to-first-publish.
+// Runs the minimal ordered program from a freshly initialised driver to a connected MQTT
+// client, and records how long every phase took:
+//   URC_SETUP    enable registration URCs and seed the registration state
+//   STATUS       one round trip status snapshot (SIM, PDP address, MQTT client state)
+//   CONFIG       optional caller supplied configuration, overlapped with network attach
+//   ATTACH       wait for the registration URC (no polling, no fixed delay)
+//   PDP          activate the PDP context, skipped when the snapshot shows an address
+//   MQTT_OPEN    QMTOPEN up to its +QMTOPEN result, skipped when the client is already connected
+//   MQTT_CONNECT QMTCONN up to its +QMTCONN result, skipped when the client is already connected
+// UART and DRIVER_INIT are marked by the caller around bg95_uart_interface_init_hw and
+// bg95_init, FIRST_PUBLISH once the first publish succeeds.
+// The driver can return on the "OK" of QMTOPEN/QMTCONN before the result URC. With 'urc_tap' set
+// the phase then ends on that URC, bounded by result_timeout_ms, instead of a fixed pause.
+// With 'sched' set every phase that talks to the modem runs as one transaction in the normal
+// lane, QMTOPEN/QMTCONN including the wait for their result URC. 'configure' runs outside of
+// it and takes the scheduler itself if it needs one.
+
+typedef enum
+{
+  BG95_BOOT_PHASE_UART = 0,
+  BG95_BOOT_PHASE_DRIVER_INIT,
+  BG95_BOOT_PHASE_URC_SETUP,
+  BG95_BOOT_PHASE_STATUS,
+  BG95_BOOT_PHASE_CONFIG,
+  BG95_BOOT_PHASE_ATTACH,
+  BG95_BOOT_PHASE_PDP,
+  BG95_BOOT_PHASE_MQTT_OPEN,
+  BG95_BOOT_PHASE_MQTT_CONNECT,
+  BG95_BOOT_PHASE_FIRST_PUBLISH,
+  BG95_BOOT_PHASE_MAX,
+} bg95_boot_phase_t;
+
+typedef struct
+{
+  int64_t last_mark_us;                       // esp_timer time of the previous mark
+  int64_t phase_us[BG95_BOOT_PHASE_MAX];      // Time spent in each phase
+  bool    skipped[BG95_BOOT_PHASE_MAX];       // Phase was not needed on this boot
+  bool    done[BG95_BOOT_PHASE_MAX];          // Phase was marked
+  int64_t first_publish_us;                   // esp_timer time of the first publish, 0 if none
+} bg95_boot_timing_t;
+
+typedef struct
+{
+  bg95_handle_t*         handle;
+  bg95_uart_interface_t* uart; // Interface the driver uses, for the helpers' raw commands
+  bg95_net_reg_t*        net_reg;
+  bg95_urc_tap_t*        urc_tap; // Tap the driver sits on, NULL to not wait for result URCs
+  bg95_sched_t*          sched;   // Shared with the other users of the modem, may be NULL
+
+  int         cid;
+  int         client_idx;
+  const char* host;
+  int         port;
+  const char* client_id;
+  const char* username;
+  const char* password;
+
+  uint32_t attach_timeout_ms;
+  uint32_t result_timeout_ms; // Longest wait for the +QMTOPEN/+QMTCONN result URC
+
+  // Runs while the modem attaches. Return ESP_OK or an error to abort the boot.
+  esp_err_t (*configure)(void* ctx);
+  void* configure_ctx;
+} bg95_boot_config_t;
+
+// Start timing. esp_timer counts from reset, so the first phase also covers the ROM/IDF boot.
+void bg95_boot_timing_init(bg95_boot_timing_t* timing);
+
+// Close 'phase' at the current time. 'skipped' records that the phase had nothing to do.
+void bg95_boot_mark(bg95_boot_timing_t* timing, bg95_boot_phase_t phase, bool skipped);
+
+// Run URC_SETUP through MQTT_CONNECT. Stops at the first failing phase and returns its error,
+// callers fall back to their regular reconnect handling from there.
+esp_err_t bg95_boot_run(const bg95_boot_config_t* config, bg95_boot_timing_t* timing);
+
+// Time from reset to the first publish in milliseconds, 0 until FIRST_PUBLISH is marked
+uint32_t bg95_boot_time_to_first_publish_ms(const bg95_boot_timing_t* timing);
+
+// Log the per-phase breakdown at info level
+void bg95_boot_log(const bg95_boot_timing_t* timing);
+
+const char* bg95_boot_phase_to_str(bg95_boot_phase_t phase);
+
+#endif /* BG95_BOOT_H */
@@ -0,0 +1,76 @@
+#ifndef BG95_CAPS_H
+#define BG95_CAPS_H
+
+#include "at_cmd_csq.h"
+#include "at_cmd_qmtcfg.h"
+#include "at_cmd_qmtconn.h"
+#include "at_cmd_qmtsub.h"
+#include "bg95_uart_interface.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Modem capability cache built from the TEST command responses (AT+QMTCFG=?, AT+CSQ=?,
+// AT+QMTSUB=?, AT+QMTCONN=?). Probed once per firmware revision (AT+CGMR) and persisted in
+// NVS, so later boots with the same firmware skip every test command.
+//
+// The bg95_caps_check_* helpers validate parameters against the probed ranges and only fall
+// back to the driver's compile-time *_MIN/*_MAX constants while nothing has been probed.
+
+#define BG95_CAPS_NVS_NAMESPACE "bg95"
+#define BG95_CAPS_NVS_KEY "caps"
+#define BG95_CAPS_MAGIC 0x42394341 // "B9CA"
+#define BG95_CAPS_BLOB_VERSION 1
+
+#define BG95_CAPS_FW_REV_MAX_LEN 48
+#define BG95_CAPS_TIMEOUT_MS 1000
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+
+  char fw_rev[BG95_CAPS_FW_REV_MAX_LEN]; // AT+CGMR, the cache key
+
+  qmtcfg_test_response_t  qmtcfg;
+  csq_test_response_t     csq;
+  qmtsub_test_response_t  qmtsub;
+  qmtconn_test_response_t qmtconn;
+  struct
+  {
+    bool has_qmtcfg;
+    bool has_csq;
+    bool has_qmtsub;
+    bool has_qmtconn;
+  } present;
+} bg95_caps_t;
+
+// Read AT+CGMR into 'fw_rev'
+esp_err_t bg95_caps_read_fw_rev(bg95_uart_interface_t* uart, char* fw_rev, size_t fw_rev_size);
+
+// Load the cached capabilities for the modem's current firmware, probing and storing them
+// when the cache is missing or was built for another revision. Only a complete probe is stored,
+// a partial one is returned for this boot and probed again on the next. 'probed' (may be NULL)
+// reports whether test commands were sent. Requires nvs_flash_init.
+esp_err_t bg95_caps_load_or_probe(bg95_uart_interface_t* uart, bg95_caps_t* caps, bool* probed);
+
+// Run every test command and fill 'caps', nothing is loaded or stored
+esp_err_t bg95_caps_probe(bg95_uart_interface_t* uart, const char* fw_rev, bg95_caps_t* caps);
+
+// True when magic, version and size match this build
+bool bg95_caps_is_valid(const bg95_caps_t* caps);
+
+// True when every test command was answered
+bool bg95_caps_is_complete(const bg95_caps_t* caps);
+
+// Range checks against the probed capabilities. 'caps' may be NULL or unprobed.
+bool bg95_caps_check_client_idx(const bg95_caps_t* caps, int client_idx);
+bool bg95_caps_check_keepalive(const bg95_caps_t* caps, uint16_t keep_alive_s);
+bool bg95_caps_check_pdp_cid(const bg95_caps_t* caps, int pdp_cid);
+bool bg95_caps_check_mqtt_version(const bg95_caps_t* caps, qmtcfg_version_t version);
+bool bg95_caps_check_msgid(const bg95_caps_t* caps, int msgid);
+bool bg95_caps_check_sub_qos(const bg95_caps_t* caps, int qos);
+
+#endif /* BG95_CAPS_H */
@@ -0,0 +1,191 @@
+#ifndef BG95_CMUX_H
+#define BG95_CMUX_H
+
+#include "bg95_task.h"
+#include "bg95_uart_interface.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 3GPP TS 27.010 basic-mode multiplexer over the single modem UART.
+// After AT+CMUX the physical link only carries frames:
+//   F9 | address | control | length | info | FCS | F9
+// Each DLCI >= 1 is exposed as its own bg95_uart_interface_t, so a long QMTPUB on one channel
+// no longer blocks status queries or URCs on another. DLCI 0 is the mux control channel.
+//
+// A reader task owns the physical read side and is the only producer of every channel's RX ring;
+// each channel has a single reader, so dispatch is a lock-free SPSC ring push. Writes from
+// different channels are serialized per frame on the physical UART.
+//
+// DLCI 0 control messages from the modem are answered: MSC carries its V.24 signals per DLCI
+// (readable with bg95_cmux_modem_signals()), and its FC bit, like FCoff for the whole mux,
+// holds writes back until the modem lifts it again. Other commands get an NSC.
+//
+// Closing sends CLD and a DISC on DLCI 0, so the modem also leaves mux mode when the control
+// channel never opened, and then checks that plain AT answers on the physical link again.
+
+#define BG95_CMUX_MAX_DLCI 3 // Virtual channels 1..3
+#define BG95_CMUX_N1 127     // Max info bytes per frame, one length octet
+#define BG95_CMUX_FRAME_MAX_LEN (BG95_CMUX_N1 + 7)
+#define BG95_CMUX_RING_SIZE 1024 // Per channel, power of two
+#define BG95_CMUX_READ_CHUNK 128
+#define BG95_CMUX_POLL_MS 20
+#define BG95_CMUX_CTRL_TIMEOUT_MS 1000
+#define BG95_CMUX_CTRL_VALUE_MAX_LEN 8 // Value octets of the control messages we send
+#define BG95_CMUX_FLOW_TIMEOUT_MS 5000 // Longest a write waits for the modem to lift flow control
+#define BG95_CMUX_TASK_STACK_SIZE CONFIG_BG95_EXT_CMUX_TASK_STACK_SIZE
+#define BG95_CMUX_TASK_PRIORITY CONFIG_BG95_EXT_CMUX_TASK_PRIORITY
+#define BG95_CMUX_TASK_CORE CONFIG_BG95_EXT_UART_TASK_CORE
+
+#define BG95_CMUX_FLAG 0xF9
+#define BG95_CMUX_EA 0x01
+#define BG95_CMUX_CR 0x02
+#define BG95_CMUX_PF 0x10
+
+typedef enum
+{
+  BG95_CMUX_SABM = 0x2F,
+  BG95_CMUX_UA   = 0x63,
+  BG95_CMUX_DM   = 0x0F,
+  BG95_CMUX_DISC = 0x43,
+  BG95_CMUX_UIH  = 0xEF,
+  BG95_CMUX_UI   = 0x03,
+} bg95_cmux_frame_type_t;
+
+// DLCI 0 control message types, command form (C/R set). The response clears BG95_CMUX_CR.
+#define BG95_CMUX_MSG_CLD 0xC3   // Multiplexer close-down
+#define BG95_CMUX_MSG_MSC 0xE3   // Modem status command
+#define BG95_CMUX_MSG_FCON 0xA3  // Flow control on, all DLCIs
+#define BG95_CMUX_MSG_FCOFF 0x63 // Flow control off, all DLCIs
+#define BG95_CMUX_MSG_NSC 0x11   // Non supported command response
+
+// V.24 signal octet of an MSC
+#define BG95_CMUX_V24_FC 0x02  // Flow control, the sender cannot accept frames
+#define BG95_CMUX_V24_RTC 0x04 // Ready to communicate (DSR/DTR)
+#define BG95_CMUX_V24_RTR 0x08 // Ready to receive (CTS/RTS)
+#define BG95_CMUX_V24_IC 0x40  // Incoming call (RI)
+#define BG95_CMUX_V24_DV 0x80  // Data valid (DCD)
+
+typedef void (*bg95_cmux_frame_cb_t)(
+    uint8_t dlci, uint8_t control, const uint8_t* info, size_t len, void* ctx);
+
+// Byte-wise frame decoder, shared by the mux reader task and the mock modem
+typedef struct
+{
+  enum
+  {
+    BG95_CMUX_RX_FLAG,
+    BG95_CMUX_RX_ADDR,
+    BG95_CMUX_RX_CTRL,
+    BG95_CMUX_RX_LEN,
+    BG95_CMUX_RX_LEN2,
+    BG95_CMUX_RX_INFO,
+    BG95_CMUX_RX_FCS,
+    BG95_CMUX_RX_END,
+  } state;
+
+  uint8_t  addr;
+  uint8_t  control;
+  uint8_t  fcs;
+  size_t   len;
+  size_t   pos;
+  uint8_t  info[BG95_CMUX_N1];
+  uint32_t fcs_errors;
+  uint32_t oversized;
+
+  bg95_cmux_frame_cb_t on_frame;
+  void*                ctx;
+} bg95_cmux_decoder_t;
+
+typedef struct
+{
+  uint32_t frames_rx;
+  uint32_t frames_tx;
+  uint32_t dropped_bytes; // Lost because a channel ring was full
+  uint32_t unknown_dlci;
+  uint32_t control_msgs; // DLCI 0 control messages received
+  uint32_t flow_waits;   // Writes held back by modem flow control
+} bg95_cmux_stats_t;
+
+struct bg95_cmux;
+
+typedef struct
+{
+  bg95_uart_interface_t uart; // Virtual interface for this DLCI
+  struct bg95_cmux*     mux;
+  uint8_t               dlci;
+  atomic_bool           open;
+
+  // SPSC ring: head advanced by the reader task only, tail by the channel reader only
+  uint8_t       ring[BG95_CMUX_RING_SIZE];
+  atomic_size_t head;
+  atomic_size_t tail;
+
+  SemaphoreHandle_t rx_ready;   // Data pushed
+  SemaphoreHandle_t ctrl_reply; // UA/DM received for this DLCI, CLD response on DLCI 0
+  atomic_int        ctrl_type;
+
+  atomic_uint       modem_v24; // Last V.24 signals the modem sent for this DLCI in an MSC
+  SemaphoreHandle_t tx_ready;  // Flow control lifted
+} bg95_cmux_channel_t;
+
+typedef struct bg95_cmux
+{
+  bg95_uart_interface_t* phys;
+  bg95_cmux_channel_t    channels[BG95_CMUX_MAX_DLCI + 1]; // [0] is the control channel
+
+  SemaphoreHandle_t tx_lock; // One frame on the wire at a time
+  SemaphoreHandle_t stopped;
+  TaskHandle_t      task;
+  volatile bool     running;
+  bool              muxing;   // Modem accepted AT+CMUX and was not closed down yet
+  atomic_bool       flow_off; // FCoff received, no DLCI may send
+
+  bg95_cmux_decoder_t decoder; // Reader task only
+  bg95_cmux_stats_t   stats;
+} bg95_cmux_t;
+
+// Switch the modem into basic-mode CMUX with AT+CMUX and open the control channel.
+// 'baud' is the rate the link already runs at (see bg95_baud), AT+CMUX must not change it.
+// 'phys' must not be used directly afterwards. When the control channel does not open the mux
+// is closed down again; ESP_ERR_INVALID_STATE means the modem still does not answer plain AT
+// after that, so 'phys' is unusable until the modem is power cycled.
+esp_err_t bg95_cmux_init(bg95_cmux_t* mux, bg95_uart_interface_t* phys, uint32_t baud);
+
+// Close all channels, send the close-down messages and stop the reader task.
+// ESP_OK once the modem answers plain AT on 'phys' again, ESP_ERR_INVALID_STATE when it does not
+// (do not fall back to plain AT then).
+esp_err_t bg95_cmux_deinit(bg95_cmux_t* mux);
+
+// Open 'dlci' (1..BG95_CMUX_MAX_DLCI) and return its interface, ready for bg95_init() or
+// bg95_raw_at_send()
+esp_err_t bg95_cmux_open_channel(bg95_cmux_t* mux, uint8_t dlci, bg95_uart_interface_t** uart);
+
+esp_err_t bg95_cmux_close_channel(bg95_cmux_t* mux, uint8_t dlci);
+
+// V.24 signals (BG95_CMUX_V24_*) the modem last reported for 'dlci', 0 before its first MSC
+uint8_t bg95_cmux_modem_signals(const bg95_cmux_t* mux, uint8_t dlci);
+
+// Encode one frame into 'out', returns the frame length or 0 when it does not fit
+size_t bg95_cmux_encode_frame(uint8_t        dlci,
+                              bool           cr,
+                              uint8_t        control,
+                              const uint8_t* info,
+                              size_t         len,
+                              uint8_t*       out,
+                              size_t         out_size);
+
+uint8_t bg95_cmux_fcs(const uint8_t* data, size_t len);
+
+void bg95_cmux_decoder_init(bg95_cmux_decoder_t* decoder, bg95_cmux_frame_cb_t on_frame, void* ctx);
+
+// Decode raw link bytes, calling 'on_frame' for every frame with a valid FCS
+void bg95_cmux_decoder_feed(bg95_cmux_decoder_t* decoder, const uint8_t* data, size_t len);
+
+#endif /* BG95_CMUX_H */
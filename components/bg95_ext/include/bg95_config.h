@@ -0,0 +1,78 @@
+#ifndef BG95_CONFIG_H
+#define BG95_CONFIG_H
+
+#include "at_cmd_cgdcont.h"
+#include "at_cmd_qmtcfg.h"
+#include "bg95_uart_interface.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Desired modem configuration (AT+QMTCFG settings of one MQTT client plus one AT+CGDCONT
+// context). The code builds the desired configuration, NVS keeps a versioned blob of the one
+// last applied successfully.
+//
+// bg95_config_apply reads the modem's current values back in a single concatenated query line
+// and only sends the writes whose value differs, so a boot costs one round trip. When the host
+// reset while the modem stayed up and bg95_config_is_stored() shows the desired configuration
+// as the last applied one, callers can skip even that.
+
+#define BG95_CONFIG_NVS_NAMESPACE "bg95"
+#define BG95_CONFIG_NVS_KEY "config"
+#define BG95_CONFIG_MAGIC 0x42394346 // "B9CF"
+#define BG95_CONFIG_BLOB_VERSION 1
+
+#define BG95_CONFIG_VALUE_MAX_LEN 160
+#define BG95_CONFIG_TIMEOUT_MS 2000
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size; // sizeof(bg95_config_t), catches layout changes of the driver structs
+
+  qmtcfg_write_params_t  qmtcfg[QMTCFG_TYPE_MAX]; // Indexed by qmtcfg_type_t
+  bool                   has_qmtcfg[QMTCFG_TYPE_MAX];
+  cgdcont_write_params_t cgdcont;
+  bool                   has_cgdcont;
+} bg95_config_t;
+
+typedef struct
+{
+  uint32_t read_back;     // Settings the modem reported a value for
+  uint32_t writes_sent;   // Settings that differed and were written
+  uint32_t writes_failed; // Writes the modem rejected
+  uint32_t unchanged;     // Settings already matching, no write needed
+} bg95_config_apply_stats_t;
+
+// Empty configuration with a valid header
+void bg95_config_init(bg95_config_t* config);
+
+// Add or replace the QMTCFG setting of 'params->type'
+esp_err_t bg95_config_set_qmtcfg(bg95_config_t* config, const qmtcfg_write_params_t* params);
+
+// Set the PDP context definition, params must at least have cid and pdp_type
+esp_err_t bg95_config_set_cgdcont(bg95_config_t* config, const cgdcont_write_params_t* params);
+
+// True when magic, version and size match this build
+bool bg95_config_is_valid(const bg95_config_t* config);
+
+// Load the stored configuration. ESP_ERR_NOT_FOUND if none is stored or it was written by an
+// incompatible build. Requires nvs_flash_init.
+esp_err_t bg95_config_load(bg95_config_t* config);
+
+// Store 'config' in NVS as the last applied configuration, only written when it differs from
+// what is stored
+esp_err_t bg95_config_save(const bg95_config_t* config);
+
+// True when NVS holds exactly 'config'
+bool bg95_config_is_stored(const bg95_config_t* config);
+
+// Bring the modem in line with 'config': one batched read back, then only the differing
+// writes. 'stats' may be NULL.
+esp_err_t bg95_config_apply(bg95_uart_interface_t*     uart,
+                            const bg95_config_t*       config,
+                            bg95_config_apply_stats_t* stats);
+
+#endif /* BG95_CONFIG_H */
@@ -0,0 +1,95 @@
+#ifndef BG95_FLOW_H
+#define BG95_FLOW_H
+
+#include "bg95_task.h"
+#include "bg95_uart_interface.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// RTS/CTS hardware flow control plus UART error accounting.
+// bg95_flow_enable switches the modem with AT+IFC=2,2, then the host UART through a callback
+// (uart_set_pin()/uart_set_hw_flow_ctrl() on target) and probes the link. When the probe fails,
+// for example because the handshake lines are not wired, both ends go back to no flow control.
+//
+// Overrun and framing errors are counted from the ESP-IDF UART event queue of whoever installed
+// the UART driver, so lost bytes show up in the stats instead of only as parse failures. That
+// needs the queue handle from uart_driver_install(). bg95_uart_interface_init_hw() does not hand
+// it out, bg95_uart_hw_init() does. The watcher is then the queue's only reader, so it passes
+// every event on to an optional callback (bg95_uart_hw_on_event() to wake event driven reads).
+// On an overrun the events still queued are dropped, the callback flushes the input they
+// describe (bg95_uart_hw_on_event() does).
+//
+// Not built for the linux target, which has no UART driver.
+
+#define BG95_FLOW_CMD_TIMEOUT_MS 1000
+#define BG95_FLOW_EVENT_POLL_MS 100
+#define BG95_FLOW_TASK_STACK_SIZE CONFIG_BG95_EXT_FLOW_TASK_STACK_SIZE
+#define BG95_FLOW_TASK_PRIORITY CONFIG_BG95_EXT_FLOW_TASK_PRIORITY
+#define BG95_FLOW_TASK_CORE CONFIG_BG95_EXT_UART_TASK_CORE
+
+// Called to switch RTS/CTS on the host UART
+typedef esp_err_t (*bg95_flow_set_fn_t)(bool enable, void* ctx);
+
+// Called by the watcher task for every UART event after it is counted
+typedef void (*bg95_flow_event_fn_t)(const uart_event_t* event, void* ctx);
+
+typedef struct
+{
+  uint32_t fifo_overflows; // UART_FIFO_OVF, bytes lost in hardware
+  uint32_t buffer_full;    // UART_BUFFER_FULL, driver ring buffer full
+  uint32_t framing_errors; // UART_FRAME_ERR
+  uint32_t parity_errors;  // UART_PARITY_ERR
+  uint32_t breaks;         // UART_BREAK
+} bg95_flow_stats_t;
+
+typedef struct
+{
+  bool enabled;
+
+  QueueHandle_t        event_queue; // Not owned
+  bg95_flow_event_fn_t on_event;
+  void*                on_event_ctx;
+  SemaphoreHandle_t    stopped;
+  TaskHandle_t         task;
+  volatile bool        running;
+
+  bg95_flow_stats_t stats;
+} bg95_flow_t;
+
+esp_err_t bg95_flow_init(bg95_flow_t* flow);
+void      bg95_flow_deinit(bg95_flow_t* flow);
+
+// Enable RTS/CTS on both ends, falls back to no flow control when the link stops answering
+esp_err_t bg95_flow_enable(bg95_flow_t*           flow,
+                           bg95_uart_interface_t* uart,
+                           bg95_flow_set_fn_t     set_flow,
+                           void*                  set_flow_ctx);
+
+esp_err_t bg95_flow_disable(bg95_flow_t*           flow,
+                            bg95_uart_interface_t* uart,
+                            bg95_flow_set_fn_t     set_flow,
+                            void*                  set_flow_ctx);
+
+// Count one UART driver event, data events are ignored
+void bg95_flow_record_event(bg95_flow_t* flow, uart_event_type_t type);
+
+// Start a task draining 'event_queue' (from uart_driver_install) into the stats.
+// Only for a queue nobody else reads.
+esp_err_t bg95_flow_watch_events(bg95_flow_t* flow, QueueHandle_t event_queue);
+
+// Pass every watched event on to 'fn', set before bg95_flow_watch_events()
+esp_err_t bg95_flow_set_event_fn(bg95_flow_t* flow, bg95_flow_event_fn_t fn, void* ctx);
+
+// Bytes were lost on the RX path since init
+bool bg95_flow_has_rx_loss(const bg95_flow_t* flow);
+
+void bg95_flow_log_stats(const bg95_flow_t* flow);
+
+#endif /* BG95_FLOW_H */
@@ -0,0 +1,91 @@
+#ifndef BG95_NET_REG_H
+#define BG95_NET_REG_H
+
+#include "bg95_uart_interface.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// URC driven network registration tracker.
+// Enables +CREG/+CGREG/+CEREG URCs with location info (<n>=2) plus +CGEV packet domain events,
+// keeps a live copy of <stat>,<tac/lac>,<ci>,<AcT> per domain and lets tasks block until the
+// modem reports "registered" or "PDP active" instead of polling on a fixed retry tick.
+// Feed it lines through bg95_net_reg_handle_line (matches bg95_urc_handler_t).
+
+#define BG95_NET_REG_REGISTERED_BIT (1 << 0)
+#define BG95_NET_REG_PDP_ACTIVE_BIT (1 << 1)
+
+#define BG95_NET_REG_AREA_MAX_LEN 9
+#define BG95_NET_REG_CELL_MAX_LEN 9
+#define BG95_NET_REG_TIMEOUT_MS 1000
+
+typedef enum
+{
+  BG95_NET_REG_STAT_NOT_REGISTERED = 0,
+  BG95_NET_REG_STAT_REGISTERED_HOME,
+  BG95_NET_REG_STAT_SEARCHING,
+  BG95_NET_REG_STAT_DENIED,
+  BG95_NET_REG_STAT_UNKNOWN,
+  BG95_NET_REG_STAT_REGISTERED_ROAMING,
+} bg95_net_reg_stat_t;
+
+typedef enum
+{
+  BG95_NET_REG_DOMAIN_CS = 0, // +CREG
+  BG95_NET_REG_DOMAIN_PS,     // +CGREG
+  BG95_NET_REG_DOMAIN_EPS,    // +CEREG
+  BG95_NET_REG_DOMAIN_MAX,
+} bg95_net_reg_domain_t;
+
+typedef struct
+{
+  bg95_net_reg_stat_t stat;
+  char                area[BG95_NET_REG_AREA_MAX_LEN]; // <lac> or <tac>, hex string
+  char                cell[BG95_NET_REG_CELL_MAX_LEN]; // <ci>, hex string
+  int                 act;
+  struct
+  {
+    bool has_stat;
+    bool has_area;
+    bool has_cell;
+    bool has_act;
+  } present;
+} bg95_net_reg_domain_state_t;
+
+typedef struct
+{
+  bg95_net_reg_domain_state_t domains[BG95_NET_REG_DOMAIN_MAX];
+  bool                        registered; // PS or EPS domain registered (home or roaming)
+  bool                        pdp_active;
+  int64_t                     changed_at_us; // Last registered/pdp_active transition
+} bg95_net_reg_state_t;
+
+typedef struct
+{
+  bg95_net_reg_state_t state;
+  SemaphoreHandle_t    lock;
+  EventGroupHandle_t   events;
+} bg95_net_reg_t;
+
+esp_err_t bg95_net_reg_init(bg95_net_reg_t* reg);
+void      bg95_net_reg_deinit(bg95_net_reg_t* reg);
+
+// Enable registration/packet domain URCs and seed the state from the current read values
+esp_err_t bg95_net_reg_enable_urcs(bg95_net_reg_t* reg, bg95_uart_interface_t* uart);
+
+// Parse one line, both URC ("+CEREG: 1,...") and read ("+CEREG: 2,1,...") forms are accepted
+void bg95_net_reg_handle_line(const char* line, bool solicited, void* ctx);
+
+// For PDP state learned elsewhere, e.g. a +CGPADDR address or a successful activation
+void bg95_net_reg_set_pdp_active(bg95_net_reg_t* reg, bool active);
+
+void bg95_net_reg_get_state(bg95_net_reg_t* reg, bg95_net_reg_state_t* state);
+
+// Block until all 'bits' (BG95_NET_REG_*_BIT) are set. Returns ESP_ERR_TIMEOUT otherwise.
+esp_err_t bg95_net_reg_wait(bg95_net_reg_t* reg, EventBits_t bits, uint32_t timeout_ms);
+
+#endif /* BG95_NET_REG_H */
@@ -0,0 +1,175 @@
+#ifndef BG95_POLL_H
+#define BG95_POLL_H
+
+#include "at_cmd_structure.h"
+#include "bg95_raw_at.h"
+#include "bg95_sched.h"
+#include "bg95_uart_interface.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cooperative, non-blocking AT command engine for a superloop without tasks.
+// Submitting a command only queues it and returns. bg95_poll() does all the work: it writes the
+// next queued command, reads whatever the UART already holds (every read has a zero timeout),
+// writes a command's data once the "> " prompt arrived and completes the command through its
+// 'done' callback. Nothing here waits, sleeps or reads a clock, time only comes in through
+// 'now_ms', so a host test can drive it with a virtual clock. The only lock is the scheduler's
+// (see below): a grant only tries it, releasing a grant takes it for a few bookkeeping steps.
+//
+// A command completes with the same semantics as the blocking API: bg95_raw_at_send() and
+// bg95_raw_at_execute() for plain AT commands, the driver's bg95_mqtt_* calls for MQTT commands.
+// That is ESP_OK on "OK", ESP_FAIL on an error result code, ESP_ERR_TIMEOUT when the command was
+// not finished 'timeout_ms' after it was written, ESP_ERR_INVALID_SIZE when the response did not
+// fit. Verbose and numeric result codes are both understood, typed commands are parsed with the
+// command's own parser.
+//
+// MQTT writes (AT+QMTOPEN, AT+QMTCLOSE, AT+QMTCONN, AT+QMTDISC, AT+QMTSUB, AT+QMTUNS, AT+QMTPUB,
+// AT+QMTPUBEX) answer "OK" once the modem accepted them and report their outcome later in a
+// "+QMTxxx:" line with the same client index (and message id). They stay in flight until that line
+// arrived, which is appended to the response. Its result codes decide the result: ESP_FAIL unless
+// they are all 0. A retransmission report (result 1 of QMTCONN, QMTSUB, QMTUNS and QMTPUB) is not
+// the outcome yet. A failed outcome of a typed command is still parsed into 'parsed_out'. As with
+// bg95_mqtt_open_network(), "+QMTOPEN: <idx>,2" (client index already open) fails with ESP_FAIL;
+// bg95_reconnect_classify_qmtopen() on the parsed result treats it as open.
+//
+// Lines received while no command is in flight are handed to the URC callback, and so are URCs
+// that arrive during a command: a "+NAME:" line whose name is none of the command's, and after
+// the "OK" of an MQTT write every line but its result. They are cut out of the response. Other
+// unsolicited text (e.g. "RDY") cannot be told apart and stays in the response.
+//
+// With a scheduler set (bg95_poll_set_sched()), a command is only written once the scheduler
+// granted its lane, bg95_sched_cmd_lane() for plain commands and bg95_sched_publish_lane() for
+// commands with data. The engine queues in the scheduler's pending slot with
+// bg95_sched_acquire_pending(), ranked against the blocked tasks by lane, deadline and starvation
+// like any of them. A busy modem leaves the command queued for a later bg95_poll() instead of
+// blocking, a grant that came in meanwhile is collected there and held until the command
+// completes.
+//
+// One engine owns its UART. It is not thread safe, call everything from the loop that polls it.
+
+#define BG95_POLL_MAX_CMDS 8
+#define BG95_POLL_LINE_MAX_LEN 128
+#define BG95_POLL_MAX_READS 8 // UART reads per bg95_poll() call, bounds the time spent in one pass
+
+// Runs from bg95_poll() once the command finished. 'response' holds everything received for it
+// except URCs and is only valid during the call. Submitting from here is allowed.
+typedef void (*bg95_poll_done_fn_t)(esp_err_t result, const char* response, void* ctx);
+
+// Runs from bg95_poll() for every unsolicited line (without its "\r\n")
+typedef void (*bg95_poll_urc_fn_t)(const char* line, void* ctx);
+
+typedef enum
+{
+  BG95_POLL_STATE_IDLE,
+  BG95_POLL_STATE_WAIT_PROMPT, // Command written, its data goes out after "> "
+  BG95_POLL_STATE_WAIT_RESULT,
+  BG95_POLL_STATE_WAIT_URC, // MQTT write accepted, waiting for its "+QMTxxx:" result line
+} bg95_poll_state_t;
+
+typedef struct
+{
+  char        cmd_line[BG95_RAW_AT_CMD_MAX_LEN]; // Including "\r\n"
+  size_t      cmd_len;
+  const char* data; // Written after the prompt, not copied, NULL for plain commands
+  size_t      data_len;
+  uint32_t    timeout_ms;
+
+  // Typed commands only, 'parsed_out' is filled before 'done' runs
+  const at_cmd_t* cmd;
+  at_cmd_type_t   type;
+  void*           parsed_out;
+
+  bg95_poll_done_fn_t done; // Optional
+  void*               done_ctx;
+} bg95_poll_cmd_t;
+
+typedef struct
+{
+  uint32_t completed; // Finished with ESP_OK
+  uint32_t failed;    // Error result code, parse or UART error
+  uint32_t timeouts;
+  uint32_t urc_lines;
+  uint32_t long_lines; // URC lines truncated to BG95_POLL_LINE_MAX_LEN
+} bg95_poll_stats_t;
+
+typedef struct
+{
+  bg95_uart_interface_t* uart; // Not owned
+  bg95_poll_urc_fn_t     urc;
+  void*                  urc_ctx;
+
+  // FIFO of submitted commands, queue[head] is in flight unless the state is idle
+  bg95_poll_cmd_t queue[BG95_POLL_MAX_CMDS];
+  size_t          head;
+  size_t          count;
+
+  bg95_sched_t*     sched;      // Optional, not owned
+  bool              sched_held; // The in flight command holds a grant from 'sched'
+  bool              closing;    // Set by bg95_poll_deinit(), refuses new submits
+  bg95_poll_state_t state;
+  uint32_t          started_ms; // 'now_ms' the in flight command was written at
+  char              response[BG95_RAW_AT_RESPONSE_MAX_LEN];
+  size_t            response_len;
+  size_t            scan_len; // Response bytes already split into lines
+
+  // Partial line received while idle
+  char   line[BG95_POLL_LINE_MAX_LEN];
+  size_t line_len;
+
+  bg95_poll_stats_t stats;
+} bg95_poll_t;
+
+// 'urc' may be NULL, URC lines are dropped then
+esp_err_t bg95_poll_init(bg95_poll_t*           poll,
+                         bg95_uart_interface_t* uart,
+                         bg95_poll_urc_fn_t     urc,
+                         void*                  urc_ctx);
+
+// Grant commands through 'sched' (NULL to stop). ESP_ERR_INVALID_STATE while a command is in
+// flight.
+esp_err_t bg95_poll_set_sched(bg95_poll_t* poll, bg95_sched_t* sched);
+
+// Complete every queued and in flight command with ESP_ERR_INVALID_STATE. Submits from their
+// 'done' callbacks fail with ESP_ERR_INVALID_STATE.
+void bg95_poll_deinit(bg95_poll_t* poll);
+
+// Queue 'cmd' (without the trailing "\r\n"). ESP_ERR_NO_MEM when the queue is full,
+// ESP_ERR_INVALID_SIZE when the command line is too long, ESP_ERR_INVALID_STATE during
+// bg95_poll_deinit().
+esp_err_t bg95_poll_submit(bg95_poll_t*        poll,
+                           const char*         cmd,
+                           uint32_t            timeout_ms,
+                           bg95_poll_done_fn_t done,
+                           void*               done_ctx);
+
+// Queue a command that answers with a "> " prompt, e.g. AT+QMTPUB with a length, followed by
+// 'len' bytes of 'data'. 'data' is not copied and has to stay valid until 'done' ran.
+esp_err_t bg95_poll_submit_data(bg95_poll_t*        poll,
+                                const char*         cmd,
+                                const char*         data,
+                                size_t              len,
+                                uint32_t            timeout_ms,
+                                bg95_poll_done_fn_t done,
+                                void*               done_ctx);
+
+// Queue 'cmd' formatted as bg95_raw_at_execute() does, with the command's timeout_ms. 'params'
+// is only read here, 'parsed_out' (may be NULL) has to stay valid until 'done' ran.
+esp_err_t bg95_poll_submit_cmd(bg95_poll_t*        poll,
+                               const at_cmd_t*     cmd,
+                               at_cmd_type_t       type,
+                               const void*         params,
+                               void*               parsed_out,
+                               bg95_poll_done_fn_t done,
+                               void*               done_ctx);
+
+// Advance all work without blocking, 'now_ms' is any millisecond clock (wrapping is fine).
+// Returns true while commands are queued or in flight.
+bool bg95_poll(bg95_poll_t* poll, uint32_t now_ms);
+
+// Queued plus in flight commands
+size_t bg95_poll_pending(const bg95_poll_t* poll);
+
+#endif /* BG95_POLL_H */
@@ -0,0 +1,125 @@
+#ifndef BG95_PUB_RING_H
+#define BG95_PUB_RING_H
+
+#include "bg95_driver.h"
+#include "bg95_rtt_estimator.h"
+#include "bg95_sched.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Multi-producer, single-consumer publish ring.
+// Any number of tasks hand publishes to the one task that owns the driver handle without taking
+// a lock or waiting for the AT transaction: bg95_pub_ring_try_enqueue() claims a slot with one
+// compare-and-swap and copies a small descriptor (topic id from the table given at init, payload
+// pointer and length). The owning task drains the ring between its other work.
+//
+// The payload is not copied. It has to stay valid until the descriptor's 'done' callback ran on
+// the consumer, which reports the publish result.
+//
+// Bounded array queue with a sequence number per cell (D. Vyukov), so producers never wait on
+// each other and a full ring is reported instead of blocking. bg95_pub_ring_enqueue() retries
+// once per tick up to a timeout for callers that prefer backpressure to a dropped sample.
+
+#define BG95_PUB_RING_SIZE 32 // Power of two
+
+struct bg95_pub_desc;
+
+// Runs on the consumer once the publish finished, 'result' is the publish result
+typedef void (*bg95_pub_ring_done_fn_t)(const struct bg95_pub_desc* desc,
+                                        esp_err_t                   result,
+                                        void*                       ctx);
+
+typedef struct bg95_pub_desc
+{
+  uint16_t        topic_id; // Index into the ring's topic table
+  qmtpub_qos_t    qos;
+  qmtpub_retain_t retain;
+  const char*     payload; // Not copied, see 'done'
+  size_t          len;
+
+  bg95_pub_ring_done_fn_t done; // Optional
+  void*                   done_ctx;
+} bg95_pub_desc_t;
+
+// Publishes one drained descriptor, 'topic' is resolved from its topic id
+typedef esp_err_t (*bg95_pub_ring_publish_fn_t)(const char*            topic,
+                                                const bg95_pub_desc_t* desc,
+                                                void*                  ctx);
+
+typedef struct
+{
+  atomic_uint     seq; // Position this cell is free for (seq == pos) or filled at (pos + 1)
+  bg95_pub_desc_t desc;
+} bg95_pub_ring_cell_t;
+
+typedef struct
+{
+  uint32_t enqueued;  // Producers, descriptors accepted
+  uint32_t full;      // Producers, enqueue attempts that found the ring full
+  uint32_t published; // Consumer, publish returned ESP_OK
+  uint32_t failed;    // Consumer, publish failed or unknown topic id
+} bg95_pub_ring_stats_t;
+
+typedef struct
+{
+  const char* const* topics; // Not owned
+  size_t             num_topics;
+
+  bg95_pub_ring_cell_t cells[BG95_PUB_RING_SIZE];
+  atomic_uint          tail; // Next enqueue position, claimed by producers
+  uint32_t             head; // Next dequeue position, consumer only
+
+  // Consumer wakeup, producers only touch 'ready' while the consumer sleeps
+  atomic_bool       consumer_waiting;
+  SemaphoreHandle_t ready;
+
+  atomic_uint enqueued;
+  atomic_uint full;
+  uint32_t    published;
+  uint32_t    failed;
+  uint16_t    next_msgid; // Consumer, driver publishes with QoS > 0
+} bg95_pub_ring_t;
+
+esp_err_t bg95_pub_ring_init(bg95_pub_ring_t* ring, const char* const* topics, size_t num_topics);
+void      bg95_pub_ring_deinit(bg95_pub_ring_t* ring);
+
+// Producers, any task. ESP_ERR_NO_MEM when the ring is full.
+esp_err_t bg95_pub_ring_try_enqueue(bg95_pub_ring_t* ring, const bg95_pub_desc_t* desc);
+
+// Producers, retry a full ring once per tick for up to 'timeout_ms', ESP_ERR_TIMEOUT after that
+esp_err_t bg95_pub_ring_enqueue(bg95_pub_ring_t*       ring,
+                                const bg95_pub_desc_t* desc,
+                                uint32_t               timeout_ms);
+
+// Consumer only. Take the oldest descriptor, false when the ring is empty.
+bool bg95_pub_ring_dequeue(bg95_pub_ring_t* ring, bg95_pub_desc_t* desc);
+
+// Consumer only. Block until something is queued or 'timeout_ms' passed, true when not empty.
+bool bg95_pub_ring_wait(bg95_pub_ring_t* ring, uint32_t timeout_ms);
+
+// Consumer only. Publish up to 'max' queued descriptors through 'publish', calling each 'done'.
+// Returns the number drained.
+size_t bg95_pub_ring_drain(bg95_pub_ring_t*           ring,
+                           bg95_pub_ring_publish_fn_t publish,
+                           void*                      ctx,
+                           size_t                     max);
+
+// Consumer only. bg95_pub_ring_drain() through bg95_mqtt_publish_fixed_length(), each publish
+// queued in 'sched' (optional) in the lane for its payload size and its round trip fed to
+// 'rtt' (optional).
+size_t bg95_pub_ring_drain_to_driver(bg95_pub_ring_t*      ring,
+                                     bg95_handle_t*        handle,
+                                     bg95_sched_t*         sched,
+                                     bg95_rtt_estimator_t* rtt,
+                                     int                   client_idx,
+                                     size_t                max);
+
+void bg95_pub_ring_get_stats(bg95_pub_ring_t* ring, bg95_pub_ring_stats_t* stats);
+
+#endif /* BG95_PUB_RING_H */
@@ -0,0 +1,33 @@
+#ifndef BG95_PUBLISH_H
+#define BG95_PUBLISH_H
+
+#include "bg95_driver.h"
+#include "bg95_rtt_estimator.h"
+#include "bg95_sched.h"
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// QMTPUB path shared by the publish queues (bg95_bond, bg95_pub_ring).
+// Message ids count 1..65535 and wrap back to 1, 0 is what QoS 0 publishes carry.
+
+// Publish through bg95_mqtt_publish_fixed_length(). QoS > 0 takes the next message id from
+// '*next_msgid'. ESP_OK only when the modem reported QMTPUB_RESULT_SUCCESS, ESP_FAIL for any
+// other result, otherwise the driver's error.
+// With 'sched' set the publish waits its turn in the lane for its size, until 'deadline_us'
+// (BG95_SCHED_NO_DEADLINE waits without limit); ESP_ERR_TIMEOUT when that passed first.
+// With 'rtt' set the driver call's round trip is fed to it as an AT+QMTPUB write.
+esp_err_t bg95_publish_fixed_length(bg95_handle_t*        handle,
+                                    bg95_sched_t*         sched,
+                                    bg95_rtt_estimator_t* rtt,
+                                    int64_t               deadline_us,
+                                    int                   client_idx,
+                                    uint16_t*             next_msgid,
+                                    qmtpub_qos_t          qos,
+                                    qmtpub_retain_t       retain,
+                                    const char*           topic,
+                                    const char*           payload,
+                                    size_t                len);
+
+#endif /* BG95_PUBLISH_H */
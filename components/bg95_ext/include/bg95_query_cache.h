@@ -0,0 +1,115 @@
+#ifndef BG95_QUERY_CACHE_H
+#define BG95_QUERY_CACHE_H
+
+#include "at_cmd_cgdcont.h"
+#include "at_cmd_cops.h"
+#include "at_cmd_cpin.h"
+#include "at_cmd_qmtcfg.h"
+#include "at_cmd_qmtconn.h"
+#include "at_cmd_qmtopen.h"
+#include "bg95_single_flight.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// TTL result cache for slowly changing modem read queries. Kept next to the bg95_handle_t
+// that owns the UART. Hits are served without any modem I/O; misses go through single-flight
+// so concurrent misses still cost one round trip.
+//
+// Entries are invalidated when their TTL expires, when a related URC is seen
+// (bg95_query_cache_handle_urc registered on the URC tap), when a write to the same command goes
+// out (bg95_query_cache_handle_cmd registered as a command observer on the same tap) or when the
+// caller reports such a write itself (bg95_query_cache_invalidate). Writes only show up on the tap
+// when they go through its 'uart'; code writing on another link has to invalidate.
+
+typedef enum
+{
+  BG95_QUERY_CACHE_CPIN_READ = 0,
+  BG95_QUERY_CACHE_COPS_READ,
+  BG95_QUERY_CACHE_CGDCONT_READ,
+  BG95_QUERY_CACHE_QMTCFG_TEST,
+  BG95_QUERY_CACHE_QMTOPEN_READ,
+  BG95_QUERY_CACHE_QMTCONN_READ,
+  BG95_QUERY_CACHE_ENTRY_MAX,
+} bg95_query_cache_entry_id_t;
+
+// TTL per entry in milliseconds, 0 disables caching for that entry
+typedef struct
+{
+  uint32_t ttl_ms[BG95_QUERY_CACHE_ENTRY_MAX];
+} bg95_query_cache_config_t;
+
+#define BG95_QUERY_CACHE_DEFAULT_CONFIG()                                                          \
+  {                                                                                                \
+    .ttl_ms = {                                                                                    \
+      [BG95_QUERY_CACHE_CPIN_READ]    = 60000,                                                     \
+      [BG95_QUERY_CACHE_COPS_READ]    = 30000,                                                     \
+      [BG95_QUERY_CACHE_CGDCONT_READ] = 300000,                                                    \
+      [BG95_QUERY_CACHE_QMTCFG_TEST]  = UINT32_MAX,                                                \
+      [BG95_QUERY_CACHE_QMTOPEN_READ] = 5000,                                                      \
+      [BG95_QUERY_CACHE_QMTCONN_READ] = 5000,                                                      \
+    }                                                                                              \
+  }
+
+typedef union
+{
+  cpin_read_response_t    cpin;
+  cops_read_response_t    cops;
+  cgdcont_read_response_t cgdcont;
+  qmtcfg_test_response_t  qmtcfg_test;
+  qmtopen_read_response_t qmtopen;
+  qmtconn_read_response_t qmtconn;
+} bg95_query_cache_value_t;
+
+typedef struct
+{
+  bg95_query_cache_value_t value;
+  int64_t                  stored_at_us;
+  uint32_t                 generation; // Bumped on every invalidation, guards in-flight fills
+  bool                     valid;
+} bg95_query_cache_entry_t;
+
+typedef struct
+{
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t invalidations;
+} bg95_query_cache_stats_t;
+
+typedef struct
+{
+  bg95_single_flight_t*     sf;
+  bg95_query_cache_config_t config;
+  SemaphoreHandle_t         lock;
+  bg95_query_cache_entry_t  entries[BG95_QUERY_CACHE_ENTRY_MAX];
+  bg95_query_cache_stats_t  stats;
+} bg95_query_cache_t;
+
+esp_err_t bg95_query_cache_init(bg95_query_cache_t*              cache,
+                                bg95_single_flight_t*            sf,
+                                const bg95_query_cache_config_t* config);
+void      bg95_query_cache_deinit(bg95_query_cache_t* cache);
+
+// Serve 'cmd'/'type' from the cache when fresh, otherwise query the modem and store the result.
+// Commands without a cache entry are passed straight to single-flight.
+esp_err_t bg95_query_cache_execute(bg95_query_cache_t* cache,
+                                   const at_cmd_t*     cmd,
+                                   at_cmd_type_t       type,
+                                   void*               parsed_out,
+                                   size_t              parsed_size);
+
+// Drop every cached result of 'cmd', call after any write to the same command
+void bg95_query_cache_invalidate(bg95_query_cache_t* cache, const at_cmd_t* cmd);
+
+// bg95_urc_tap_cmd_fn_t for bg95_urc_tap_add_cmd_observer() with the cache as 'ctx'. Drops the
+// cached results of every command written in the line ("AT+CGDCONT=1,..." drops CGDCONT?), and
+// everything after ATZ or AT&F. Reads and tests ("AT+CGDCONT?", "AT+QMTCFG=?") keep them.
+void bg95_query_cache_handle_cmd(const char* cmd_line, size_t len, void* ctx);
+
+// bg95_urc_handler_t for bg95_urc_tap_add_handler() with the cache as 'ctx'. Drops cached
+// results made stale by an unsolicited result code line (e.g. "+CEREG: 1"), solicited lines are
+// ignored.
+void bg95_query_cache_handle_urc(const char* urc_line, bool solicited, void* ctx);
+
+#endif /* BG95_QUERY_CACHE_H */
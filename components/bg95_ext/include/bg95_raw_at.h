@@ -0,0 +1,137 @@
+#ifndef BG95_RAW_AT_H
+#define BG95_RAW_AT_H
+
+#include "at_cmd_structure.h"
+#include "bg95_uart_interface.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw AT line transport used by the bg95_ext helpers for command lines the
+// driver's single-command path cannot express (e.g. ';' concatenated commands).
+// Callers must serialize these calls with any other driver use of the same UART.
+//
+// Both result code formats are understood. Verbose (ATV1) finals are whole "\r\n" framed lines,
+// numeric (ATV0) finals are a single digit at the start of a line followed by a lone "\r",
+// e.g. "+CSQ: 20,99\r\n0\r". bg95_raw_at_set_numeric() switches a link to ATE0/ATV0 with
+// numeric CMEE, which saves the echo and the "\r\nOK\r\n" framing on every command. Information
+// text that is a single digit line can look like a numeric final while its "\n" is in flight,
+// so the numeric detector only runs on links marked numeric, and only links whose commands never
+// answer with such a line should be switched.
+//
+// The result code format is per link state. A bg95_raw_at_link_t wraps the interface of one link
+// and carries its flag; every helper taking the wrapped 'uart' picks the flag up from there.
+// Any other interface is verbose. There is no shared registry, so links and the instances built
+// on them can be created and torn down independently.
+//
+// Before each command the input already buffered is read off. Everything up to its last final
+// result code is the late answer to an earlier command and is dropped. Complete "+<name>:" lines
+// after it are unsolicited and go to the link's URC handler (bg95_raw_at_link_set_urc_handler()),
+// which matters on links no URC tap reads, e.g. a CMUX channel. Without a handler they are
+// dropped too.
+
+#define BG95_RAW_AT_CMD_MAX_LEN 256
+#define BG95_RAW_AT_RESPONSE_MAX_LEN 1024
+#define BG95_RAW_AT_READ_CHUNK_MS 50
+#define BG95_RAW_AT_SETUP_TIMEOUT_MS 300
+#define BG95_RAW_AT_FLUSH_MAX_READS 16 // Bounds the pre-command discard on a chatty link
+
+// ATV0 result codes used by the BG95
+#define BG95_RAW_AT_NUMERIC_OK 0
+#define BG95_RAW_AT_NUMERIC_ERROR 4
+
+// Returns true once the response holds a complete final result code: one of the verbose lines
+// "OK", "ERROR", "+CME ERROR: <n>" or "+CMS ERROR: <n>", or with 'numeric' also a numeric one
+bool bg95_raw_at_has_final_result(const char* response, bool numeric);
+
+// Numeric terminator detector only: true when the first 'len' bytes hold a "<digit>\r" final
+// result code, which is stored in 'code' (may be NULL)
+bool bg95_raw_at_has_numeric_result(const char* response, size_t len, int* code);
+
+// Called with a complete URC line read off before a command (NUL terminated, without "\r\n") on
+// the sending task
+typedef void (*bg95_raw_at_urc_fn_t)(const char* line, void* ctx);
+
+typedef struct
+{
+  bg95_uart_interface_t  uart; // Wrapped interface, use this one for the link
+  bg95_uart_interface_t* inner;
+  bool                   numeric;
+  bg95_raw_at_urc_fn_t   urc_fn;
+  void*                  urc_ctx;
+} bg95_raw_at_link_t;
+
+// Wrap 'inner' in a verbose link. Reads and writes pass straight through.
+esp_err_t bg95_raw_at_link_init(bg95_raw_at_link_t* link, bg95_uart_interface_t* inner);
+
+// Switch the link to numeric result codes with echo off ("ATE0V0+CMEE=1"), or back to verbose
+// result codes with verbose CME errors ("ATV1+CMEE=2"), and mark it accordingly. The modem keeps
+// its previous format when the command fails, so callers can simply stay on the verbose path.
+esp_err_t bg95_raw_at_set_numeric(bg95_raw_at_link_t* link, bool numeric);
+
+// Mark the link as numeric without sending anything, for a modem already in ATV0 (e.g. from a
+// stored profile)
+esp_err_t bg95_raw_at_mark_numeric(bg95_raw_at_link_t* link, bool numeric);
+
+// Pass URC lines found in the stale input before a command to 'fn', NULL to drop them
+esp_err_t bg95_raw_at_link_set_urc_handler(bg95_raw_at_link_t*  link,
+                                           bg95_raw_at_urc_fn_t fn,
+                                           void*                ctx);
+
+// True when 'uart' is the interface of a link marked numeric
+bool bg95_raw_at_is_numeric(const bg95_uart_interface_t* uart);
+
+// ESP_OK when the final result code of a complete response is "OK" (numeric only with
+// 'numeric'), ESP_FAIL for any error result code
+esp_err_t bg95_raw_at_final_result(const char* response, bool numeric);
+
+// Write 'cmd' (without the trailing "\r\n") and read until a final result code or timeout.
+// Input already buffered before the write is read off first (see above), so the late answer to
+// a command that timed out is not taken for this command's result. 'response' doubles as the
+// buffer for it.
+// Returns ESP_OK on "OK", ESP_FAIL on an error result code, ESP_ERR_TIMEOUT if no final result
+// arrived in time and ESP_ERR_INVALID_SIZE if the response did not fit in 'response'.
+// 'response' is always NUL terminated and holds whatever was received.
+esp_err_t bg95_raw_at_send(bg95_uart_interface_t* uart,
+                           const char*            cmd,
+                           char*                  response,
+                           size_t                 response_size,
+                           uint32_t               timeout_ms);
+
+// Build the full command line ("AT+<name>" plus "=?", "?", formatter output or nothing) for
+// 'cmd' and 'type'. 'params' is only used for AT_CMD_TYPE_WRITE.
+esp_err_t bg95_raw_at_format_cmd(const at_cmd_t* cmd,
+                                 at_cmd_type_t   type,
+                                 const void*     params,
+                                 char*           cmd_line,
+                                 size_t          cmd_line_size);
+
+// Parse a complete response to 'cmd' and 'type' into 'parsed_out' with the command's own parser.
+// A numeric result code is rewritten in place to its verbose line first. ESP_OK without parsing
+// when 'parsed_out' is NULL or the command has no parser for 'type'.
+esp_err_t bg95_raw_at_parse(const at_cmd_t* cmd,
+                            at_cmd_type_t   type,
+                            char*           response,
+                            size_t          response_size,
+                            void*           parsed_out);
+
+// Format, send and parse a single command using the command's own formatter and parser.
+// Numeric result codes are rewritten to their verbose lines before parsing.
+// Uses the command's timeout_ms. 'parsed_out' may be NULL when no parsed data is wanted.
+esp_err_t bg95_raw_at_execute(bg95_uart_interface_t* uart,
+                              const at_cmd_t*        cmd,
+                              at_cmd_type_t          type,
+                              const void*            params,
+                              void*                  parsed_out);
+
+// Same as bg95_raw_at_execute with an explicit timeout instead of the command's timeout_ms
+esp_err_t bg95_raw_at_execute_with_timeout(bg95_uart_interface_t* uart,
+                                           const at_cmd_t*        cmd,
+                                           at_cmd_type_t          type,
+                                           const void*            params,
+                                           void*                  parsed_out,
+                                           uint32_t               timeout_ms);
+
+#endif /* BG95_RAW_AT_H */
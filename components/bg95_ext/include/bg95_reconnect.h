@@ -0,0 +1,83 @@
+#ifndef BG95_RECONNECT_H
+#define BG95_RECONNECT_H
+
+#include "at_cmd_qmtconn.h"
+#include "at_cmd_qmtopen.h"
+#include "bg95_at_error.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Reconnect scheduler for the network/MQTT bring-up steps.
+// Failures are classified from the QMTOPEN result and QMTCONN result/return codes:
+//  - TRANSIENT failures are retried right away, up to 'fast_retries' times in a row
+//  - BACKOFF failures wait an exponentially growing, fully jittered delay
+//  - NETWORK failures (PDP/registration) wait the same delay, callers should cut it short as
+//    soon as the modem reports attach
+//  - FATAL failures (rejected credentials, bad parameters) wait a fully jittered delay capped at
+//    'max_delay_ms', without the exponential ramp
+// Jitter spreads a fleet's reconnects out after a broker outage instead of hitting it in step.
+
+typedef enum
+{
+  BG95_RECONNECT_CLASS_NONE = 0, // Not a failure
+  BG95_RECONNECT_CLASS_TRANSIENT,
+  BG95_RECONNECT_CLASS_BACKOFF,
+  BG95_RECONNECT_CLASS_NETWORK,
+  BG95_RECONNECT_CLASS_FATAL,
+} bg95_reconnect_class_t;
+
+typedef struct
+{
+  uint32_t base_delay_ms; // Backoff cap for the first failure, doubles per failure
+  uint32_t min_delay_ms;  // Lower bound of the jittered delay
+  uint32_t max_delay_ms;  // Backoff cap, also the jitter cap for FATAL failures
+  uint8_t  fast_retries;  // Immediate retries allowed before TRANSIENT falls back to backoff
+} bg95_reconnect_config_t;
+
+#define BG95_RECONNECT_DEFAULT_CONFIG()                                                            \
+  {                                                                                                \
+    .base_delay_ms = 1000, .min_delay_ms = 250, .max_delay_ms = 120000, .fast_retries = 1,         \
+  }
+
+typedef struct
+{
+  uint32_t failures;
+  uint32_t immediate_retries;
+  uint32_t total_delay_ms;
+} bg95_reconnect_stats_t;
+
+typedef struct
+{
+  bg95_reconnect_config_t config;
+  uint8_t                 backoff_exp;       // Consecutive backed off failures
+  uint8_t                 fast_retries_used; // Consecutive immediate retries
+  bg95_reconnect_stats_t  stats;
+} bg95_reconnect_t;
+
+esp_err_t bg95_reconnect_init(bg95_reconnect_t* sched, const bg95_reconnect_config_t* config);
+
+// Classify the outcome of bg95_mqtt_open_network, 'err' is the call's return value.
+// QMTOPEN_RESULT_MQTT_ID_OCCUPIED is NONE: the network of that client index is already open.
+bg95_reconnect_class_t bg95_reconnect_classify_qmtopen(esp_err_t                       err,
+                                                       const qmtopen_write_response_t* response);
+
+// Classify the outcome of bg95_mqtt_connect, 'err' is the call's return value
+bg95_reconnect_class_t bg95_reconnect_classify_qmtconn(esp_err_t                       err,
+                                                       const qmtconn_write_response_t* response);
+
+// Classify a command that failed with an AT error result code. IMMEDIATE errors map to
+// TRANSIENT, BACKOFF to BACKOFF and NEVER to FATAL.
+bg95_reconnect_class_t bg95_reconnect_classify_at_error(const bg95_at_error_t* error);
+
+// Record a failure of class 'cls' and return how long to wait before the next attempt (0 means
+// retry now)
+uint32_t bg95_reconnect_next_delay_ms(bg95_reconnect_t* sched, bg95_reconnect_class_t cls);
+
+// Record a successful connection, resets the backoff
+void bg95_reconnect_success(bg95_reconnect_t* sched);
+
+const char* bg95_reconnect_class_to_str(bg95_reconnect_class_t cls);
+
+#endif /* BG95_RECONNECT_H */
@@ -0,0 +1,132 @@
+#ifndef BG95_RTT_ESTIMATOR_H
+#define BG95_RTT_ESTIMATOR_H
+
+#include "at_cmd_structure.h"
+#include "bg95_uart_interface.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Adaptive per-command timeouts learned from observed round trip times, in the style of
+// TCP's retransmission timer (RFC 6298): SRTT and RTTVAR per command, command type and
+// network condition, timeout = SRTT + max(G, 4 * RTTVAR).
+//
+// The command's static timeout_ms is always the ceiling. Until 'min_samples' responses have
+// been seen for a key the ceiling is used as is. A timeout doubles the learned timeout for
+// that key (Karn's algorithm, the timed out sample itself is not used) until the next
+// successful response.
+//
+// Only commands run through bg95_rtt_execute() or an opted-in single-flight use the learned
+// timeouts. The driver's own command path, and with it every bg95_mqtt_* call, keeps its
+// static timeouts; bg95_publish_fixed_length() and the application time those calls and feed
+// them in with bg95_rtt_estimator_observe(), so their round trips are learned all the same.
+
+#define BG95_RTT_ESTIMATOR_MAX_ENTRIES 16
+
+// Coarse radio conditions, RTTs are learned separately for each
+typedef enum
+{
+  BG95_RTT_COND_UNKNOWN = 0,
+  BG95_RTT_COND_GOOD,
+  BG95_RTT_COND_FAIR,
+  BG95_RTT_COND_POOR,
+  BG95_RTT_COND_MAX,
+} bg95_rtt_condition_t;
+
+typedef struct
+{
+  uint32_t min_timeout_ms; // Floor for learned timeouts
+  uint32_t granularity_ms; // G in RFC 6298, lower bound of the variance term
+  uint32_t min_samples;    // Samples needed before the learned timeout is used
+} bg95_rtt_estimator_config_t;
+
+#define BG95_RTT_ESTIMATOR_DEFAULT_CONFIG()                                                        \
+  {                                                                                                \
+    .min_timeout_ms = 300, .granularity_ms = 100, .min_samples = 3,                                \
+  }
+
+// Learned values for one command/type/condition, exposed for diagnostics
+typedef struct
+{
+  uint32_t srtt_ms;
+  uint32_t rttvar_ms;
+  uint32_t last_rtt_ms;
+  uint32_t max_rtt_ms;
+  uint32_t samples;
+  uint32_t timeouts;
+  uint8_t  backoff_shift; // Timeout is doubled this many times after consecutive timeouts
+} bg95_rtt_stats_t;
+
+typedef struct
+{
+  const at_cmd_t*  cmd;
+  at_cmd_type_t    type;
+  bg95_rtt_stats_t stats[BG95_RTT_COND_MAX];
+} bg95_rtt_entry_t;
+
+typedef struct
+{
+  bg95_rtt_estimator_config_t config;
+  bg95_rtt_condition_t        condition;
+  SemaphoreHandle_t           lock;
+  bg95_rtt_entry_t            entries[BG95_RTT_ESTIMATOR_MAX_ENTRIES];
+  size_t                      entry_count;
+} bg95_rtt_estimator_t;
+
+// An estimator that is not initialised (zeroed or after a failed init) learns nothing and
+// hands out the static timeouts
+esp_err_t bg95_rtt_estimator_init(bg95_rtt_estimator_t*              est,
+                                  const bg95_rtt_estimator_config_t* config);
+void      bg95_rtt_estimator_deinit(bg95_rtt_estimator_t* est);
+
+// Map an AT+CSQ <rssi> value (0-31, 99 unknown) to a condition bucket
+bg95_rtt_condition_t bg95_rtt_condition_from_csq(int rssi);
+
+// Select which condition new samples and timeouts belong to
+void bg95_rtt_estimator_set_condition(bg95_rtt_estimator_t* est, bg95_rtt_condition_t cond);
+
+// Effective timeout for 'cmd'/'type' under the current condition, never above cmd->timeout_ms
+uint32_t bg95_rtt_estimator_timeout_ms(bg95_rtt_estimator_t* est,
+                                       const at_cmd_t*       cmd,
+                                       at_cmd_type_t         type);
+
+// Feed one observation. 'timed_out' samples only back the timeout off, see above.
+void bg95_rtt_estimator_record(bg95_rtt_estimator_t* est,
+                               const at_cmd_t*       cmd,
+                               at_cmd_type_t         type,
+                               uint32_t              rtt_ms,
+                               bool                  timed_out);
+
+// Feed the outcome 'err' of a round trip the caller timed itself, e.g. a driver call that
+// cannot take the learned timeout. ESP_ERR_TIMEOUT backs the timeout off, argument and size
+// errors never reached the modem and are dropped, anything else is a sample.
+void bg95_rtt_estimator_observe(bg95_rtt_estimator_t* est,
+                                const at_cmd_t*       cmd,
+                                at_cmd_type_t         type,
+                                esp_err_t             err,
+                                uint32_t              rtt_ms);
+
+// Copy the learned values for 'cmd'/'type' under 'cond'. ESP_ERR_NOT_FOUND if never seen.
+esp_err_t bg95_rtt_estimator_get(bg95_rtt_estimator_t* est,
+                                 const at_cmd_t*       cmd,
+                                 at_cmd_type_t         type,
+                                 bg95_rtt_condition_t  cond,
+                                 bg95_rtt_stats_t*     stats);
+
+// Log every learned entry at info level
+void bg95_rtt_estimator_log(bg95_rtt_estimator_t* est);
+
+// bg95_raw_at_execute with the learned timeout, recording the observed round trip.
+// A command that times out here may still answer later, callers that retry non-idempotent
+// commands must account for that.
+esp_err_t bg95_rtt_execute(bg95_rtt_estimator_t*  est,
+                           bg95_uart_interface_t* uart,
+                           const at_cmd_t*        cmd,
+                           at_cmd_type_t          type,
+                           const void*            params,
+                           void*                  parsed_out);
+
+#endif /* BG95_RTT_ESTIMATOR_H */
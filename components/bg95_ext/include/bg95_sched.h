@@ -0,0 +1,127 @@
+#ifndef BG95_SCHED_H
+#define BG95_SCHED_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Priority lanes for the tasks sharing one modem.
+// Every AT transaction on a driver handle runs between bg95_sched_acquire() and
+// bg95_sched_release(). When the current transaction ends, the modem goes to the oldest waiter
+// of the highest lane, so a QMTDISC or a CSQ for a link decision overtakes queued bulk work at
+// the next command boundary instead of waiting behind it. A transaction in progress is never
+// interrupted.
+//
+// Starvation protection: a waiter passed over BG95_SCHED_MAX_BYPASS times by higher lanes is
+// served next, ahead of every lane.
+//
+// Deadlines: bg95_sched_acquire_by() takes the absolute esp_timer_get_time() after which the
+// result is useless. Within a lane the earliest deadline goes first, waiters without one after
+// them in arrival order. Work past its deadline is never granted, the caller gets
+// ESP_ERR_TIMEOUT without the modem being touched and the miss is counted.
+//
+// Callers that must not block (bg95_poll) queue through the one pending slot instead:
+// bg95_sched_acquire_pending() registers a waiter that is ranked and promoted like any other, and
+// a grant to it is kept until the next call collects it.
+//
+// Users: bg95_publish_fixed_length() (and with it bg95_bond and bg95_pub_ring), bg95_poll,
+// bg95_status_snapshot_read(), bg95_boot and the application's own driver calls all take an
+// optional scheduler, bg95_single_flight (and with it bg95_query_cache) requires one. Hand the
+// same one to every user of a modem. A publish picks its lane from the payload size, a raw
+// command line from bg95_sched_cmd_lane().
+
+typedef enum
+{
+  BG95_SCHED_LANE_CONTROL, // Short latency-critical commands: QMTDISC, CSQ, state queries
+  BG95_SCHED_LANE_NORMAL,  // Regular publishes and configuration
+  BG95_SCHED_LANE_BULK,    // Large publishes, file uploads, QMTRECV drains
+  BG95_SCHED_NUM_LANES,
+} bg95_sched_lane_t;
+
+#define BG95_SCHED_MAX_WAITERS 8 // Blocked in bg95_sched_acquire()
+#define BG95_SCHED_PENDING_SLOT BG95_SCHED_MAX_WAITERS
+#define BG95_SCHED_NUM_SLOTS (BG95_SCHED_MAX_WAITERS + 1)
+#define BG95_SCHED_MAX_BYPASS 4
+#define BG95_SCHED_WAIT_FOREVER UINT32_MAX
+#define BG95_SCHED_NO_DEADLINE 0
+#define BG95_SCHED_BULK_PUBLISH_LEN 256 // Publishes with a longer payload queue in the bulk lane
+
+typedef struct
+{
+  uint32_t granted;         // Transactions started
+  uint32_t timeouts;        // Waiters that gave up
+  uint32_t deadline_misses; // Rejected or dropped past their deadline
+  uint32_t promoted;        // Grants forced by the starvation protection
+  uint32_t depth;           // Waiting right now
+  uint32_t depth_max;
+  uint64_t wait_ms_total; // From acquire to grant, over 'granted'
+  uint32_t wait_ms_max;
+} bg95_sched_lane_stats_t;
+
+typedef struct
+{
+  bool              used;
+  bool              granted;
+  bg95_sched_lane_t lane;
+  uint32_t          seq;         // Arrival order
+  int64_t           deadline_us; // BG95_SCHED_NO_DEADLINE or esp_timer_get_time() based
+  uint32_t          bypassed;
+  TickType_t        since;
+  SemaphoreHandle_t grant; // NULL for the pending slot
+} bg95_sched_waiter_t;
+
+typedef struct
+{
+  SemaphoreHandle_t   lock; // Guards everything below
+  bool                busy;
+  uint32_t            next_seq;
+  bg95_sched_waiter_t waiters[BG95_SCHED_NUM_SLOTS]; // The last one is the pending slot
+
+  bg95_sched_lane_stats_t stats[BG95_SCHED_NUM_LANES];
+} bg95_sched_t;
+
+esp_err_t bg95_sched_init(bg95_sched_t* sched);
+void      bg95_sched_deinit(bg95_sched_t* sched);
+
+// Wait for the modem in 'lane'. ESP_ERR_TIMEOUT after 'timeout_ms' (BG95_SCHED_WAIT_FOREVER
+// waits without limit), ESP_ERR_NO_MEM when BG95_SCHED_MAX_WAITERS tasks are waiting already.
+esp_err_t bg95_sched_acquire(bg95_sched_t* sched, bg95_sched_lane_t lane, uint32_t timeout_ms);
+
+// Same, but give up once esp_timer_get_time() reaches 'deadline_us'. Rejected right away when
+// the deadline already passed.
+esp_err_t bg95_sched_acquire_by(bg95_sched_t* sched, bg95_sched_lane_t lane, int64_t deadline_us);
+
+// Take the modem only when it is idle, without queueing; ESP_ERR_TIMEOUT while anyone holds it.
+// Polling callers that need their turn use bg95_sched_acquire_pending() instead.
+esp_err_t bg95_sched_try_acquire(bg95_sched_t* sched, bg95_sched_lane_t lane);
+
+// Non-blocking acquire for a single polling caller. ESP_OK when the modem is idle or a grant to
+// the pending slot came in since the last call, otherwise ESP_ERR_TIMEOUT with the request
+// queued in 'lane' (or still queued): call again later. The lock is only tried, never waited for.
+esp_err_t bg95_sched_acquire_pending(bg95_sched_t* sched, bg95_sched_lane_t lane);
+
+// Drop the pending request. A grant it got but never collected is released.
+void bg95_sched_cancel_pending(bg95_sched_t* sched);
+
+// End the current transaction and hand the modem to the next waiter
+void bg95_sched_release(bg95_sched_t* sched);
+
+// Lane for a publish of 'len' payload bytes, bulk above BG95_SCHED_BULK_PUBLISH_LEN
+bg95_sched_lane_t bg95_sched_publish_lane(size_t len);
+
+// Lane for a raw AT command line: QMTRECV drains are bulk, QMTDISC and the state queries
+// (CSQ, CPIN?, COPS?, CREG?/CEREG?/CGREG?, QMTCONN?, QMTOPEN?) control, everything else normal
+bg95_sched_lane_t bg95_sched_cmd_lane(const char* cmd_line);
+
+// Snapshot of one lane's counters
+esp_err_t bg95_sched_get_stats(bg95_sched_t*            sched,
+                               bg95_sched_lane_t        lane,
+                               bg95_sched_lane_stats_t* stats);
+
+void bg95_sched_log_stats(bg95_sched_t* sched);
+
+#endif /* BG95_SCHED_H */
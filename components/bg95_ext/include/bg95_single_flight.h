@@ -0,0 +1,73 @@
+#ifndef BG95_SINGLE_FLIGHT_H
+#define BG95_SINGLE_FLIGHT_H
+
+#include "at_cmd_structure.h"
+#include "bg95_rtt_estimator.h"
+#include "bg95_sched.h"
+#include "bg95_uart_interface.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Single-flight de-duplication of idempotent read/test commands.
+// Concurrent requests for the same command line join the one already on the UART and all
+// receive a copy of its parsed response. Only one task talks to the modem per command line.
+//
+// Idempotent commands: every AT_CMD_TYPE_TEST command, plus AT+CSQ, AT+COPS?, AT+CPIN?,
+// AT+CGDCONT?, AT+QMTOPEN? and AT+QMTCONN?. Anything else is passed straight through.
+//
+// Every round trip, shared or not, is one transaction on the scheduler the rest of the modem's
+// users queue on, in the lane bg95_sched_cmd_lane() picks for its command line. A flight never
+// talks to the UART next to the driver or another module.
+
+#define BG95_SINGLE_FLIGHT_MAX_CALLS 4
+#define BG95_SINGLE_FLIGHT_KEY_MAX_LEN 32
+#define BG95_SINGLE_FLIGHT_RESULT_MAX_LEN 512
+
+typedef struct
+{
+  char      key[BG95_SINGLE_FLIGHT_KEY_MAX_LEN];
+  uint8_t   result[BG95_SINGLE_FLIGHT_RESULT_MAX_LEN];
+  size_t    result_size;
+  esp_err_t err;
+  uint8_t   refs; // Leader plus joined waiters, slot is free when 0
+  bool      done;
+
+  EventGroupHandle_t done_event;
+} bg95_single_flight_call_t;
+
+typedef struct
+{
+  bg95_uart_interface_t*    uart;
+  bg95_rtt_estimator_t*     rtt;   // Optional, adaptive timeouts when set
+  bg95_sched_t*             sched; // Shared with the other users of the modem, not owned
+  SemaphoreHandle_t         lock;  // Guards 'calls'
+  bg95_single_flight_call_t calls[BG95_SINGLE_FLIGHT_MAX_CALLS];
+  uint32_t                  joined_count; // Requests answered without their own round trip
+} bg95_single_flight_t;
+
+esp_err_t bg95_single_flight_init(bg95_single_flight_t*  sf,
+                                  bg95_uart_interface_t* uart,
+                                  bg95_sched_t*          sched);
+void      bg95_single_flight_deinit(bg95_single_flight_t* sf);
+
+// Use learned timeouts from 'rtt' for every command sent through 'sf', NULL restores the
+// static per-command timeouts
+void bg95_single_flight_set_rtt_estimator(bg95_single_flight_t* sf, bg95_rtt_estimator_t* rtt);
+
+// Returns true if 'cmd'/'type' is safe to share between concurrent callers
+bool bg95_single_flight_is_idempotent(const at_cmd_t* cmd, at_cmd_type_t type);
+
+// Execute 'cmd' (no params, so READ, TEST or EXECUTE) and parse into 'parsed_out'.
+// 'parsed_size' must be the size of the command's response struct.
+esp_err_t bg95_single_flight_execute(bg95_single_flight_t* sf,
+                                     const at_cmd_t*       cmd,
+                                     at_cmd_type_t         type,
+                                     void*                 parsed_out,
+                                     size_t                parsed_size);
+
+#endif /* BG95_SINGLE_FLIGHT_H */
@@ -0,0 +1,57 @@
+#ifndef BG95_STATUS_H
+#define BG95_STATUS_H
+
+#include "at_cmd_cops.h"
+#include "at_cmd_cpin.h"
+#include "at_cmd_csq.h"
+#include "at_cmd_qmtconn.h"
+#include "bg95_sched.h"
+#include "bg95_uart_interface.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+
+// One round trip health snapshot. Sends
+//   AT+CPIN?;+CSQ;+COPS?;+CGPADDR=<cid>;+QMTCONN?
+// as a single command line and demultiplexes the combined response into each
+// command's existing parser and response struct.
+
+#define BG95_STATUS_PDP_ADDR_MAX_LEN 64
+#define BG95_STATUS_SECTION_MAX_LEN 256
+#define BG95_STATUS_TIMEOUT_MS 5000
+
+typedef struct
+{
+  cpin_read_response_t    cpin;
+  csq_execute_response_t  csq;
+  cops_read_response_t    cops;
+  qmtconn_read_response_t qmtconn; // Only present when the requested client reports a state
+  char                    pdp_addr[BG95_STATUS_PDP_ADDR_MAX_LEN];
+  bool                    pdp_active;
+  struct
+  {
+    bool has_cpin;
+    bool has_csq;
+    bool has_cops;
+    bool has_pdp_addr;
+    bool has_qmtconn;
+  } present;
+} bg95_status_snapshot_t;
+
+// Read a full status snapshot for PDP context 'cid' and MQTT client 'client_idx'.
+// The modem aborts a concatenated line at the first failing command, so on ESP_FAIL the
+// sections that came back before the error are still parsed and flagged in 'present'.
+// With 'sched' set the round trip queues in the control lane.
+esp_err_t bg95_status_snapshot_read(bg95_uart_interface_t*  uart,
+                                    bg95_sched_t*           sched,
+                                    int                     cid,
+                                    int                     client_idx,
+                                    bg95_status_snapshot_t* snapshot);
+
+// Demultiplex an already received combined response into 'snapshot'. Of the +QMTCONN lines,
+// one per active client, only the one for 'client_idx' is used.
+esp_err_t bg95_status_snapshot_parse(const char*             response,
+                                     int                     client_idx,
+                                     bg95_status_snapshot_t* snapshot);
+
+#endif /* BG95_STATUS_H */
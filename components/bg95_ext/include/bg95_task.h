@@ -0,0 +1,78 @@
+#ifndef BG95_TASK_H
+#define BG95_TASK_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include <stdint.h>
+
+// Task layout of the bg95_ext tasks, set in menuconfig under "BG95 extensions".
+// UART servicing (URC tap reader, CMUX demultiplexer, UART events) runs on one core, work done
+// on behalf of the application (URC handlers, bond publishes) on the other, so a busy
+// application task cannot delay finding the end of a response. The defaults below apply to
+// builds without the component's Kconfig, e.g. host tests.
+
+#define BG95_TASK_NO_AFFINITY -1
+
+#ifndef CONFIG_BG95_EXT_UART_TASK_CORE
+#define CONFIG_BG95_EXT_UART_TASK_CORE BG95_TASK_NO_AFFINITY
+#endif
+#ifndef CONFIG_BG95_EXT_APP_TASK_CORE
+#define CONFIG_BG95_EXT_APP_TASK_CORE BG95_TASK_NO_AFFINITY
+#endif
+
+#ifndef CONFIG_BG95_EXT_URC_TAP_TASK_PRIORITY
+#define CONFIG_BG95_EXT_URC_TAP_TASK_PRIORITY 6
+#endif
+#ifndef CONFIG_BG95_EXT_URC_TAP_TASK_STACK_SIZE
+#define CONFIG_BG95_EXT_URC_TAP_TASK_STACK_SIZE 4096
+#endif
+
+// Without Kconfig the URC handlers keep running on the reader
+#ifndef CONFIG_BG95_EXT_URC_DISPATCH_TASK_PRIORITY
+#define CONFIG_BG95_EXT_URC_DISPATCH_TASK_PRIORITY 5
+#endif
+#ifndef CONFIG_BG95_EXT_URC_DISPATCH_TASK_STACK_SIZE
+#define CONFIG_BG95_EXT_URC_DISPATCH_TASK_STACK_SIZE 4096
+#endif
+#ifndef CONFIG_BG95_EXT_URC_DISPATCH_QUEUE_LEN
+#define CONFIG_BG95_EXT_URC_DISPATCH_QUEUE_LEN 8
+#endif
+
+#ifndef CONFIG_BG95_EXT_CMUX_TASK_PRIORITY
+#define CONFIG_BG95_EXT_CMUX_TASK_PRIORITY 6
+#endif
+#ifndef CONFIG_BG95_EXT_CMUX_TASK_STACK_SIZE
+#define CONFIG_BG95_EXT_CMUX_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef CONFIG_BG95_EXT_FLOW_TASK_PRIORITY
+#define CONFIG_BG95_EXT_FLOW_TASK_PRIORITY 7
+#endif
+#ifndef CONFIG_BG95_EXT_FLOW_TASK_STACK_SIZE
+#define CONFIG_BG95_EXT_FLOW_TASK_STACK_SIZE 3072
+#endif
+
+#ifndef CONFIG_BG95_EXT_BOND_TASK_PRIORITY
+#define CONFIG_BG95_EXT_BOND_TASK_PRIORITY 5
+#endif
+#ifndef CONFIG_BG95_EXT_BOND_TASK_STACK_SIZE
+#define CONFIG_BG95_EXT_BOND_TASK_STACK_SIZE 4096
+#endif
+
+typedef struct
+{
+  uint32_t    stack_size;
+  UBaseType_t priority;
+  int         core; // 0, 1 or BG95_TASK_NO_AFFINITY
+} bg95_task_config_t;
+
+// xTaskCreatePinnedToCore() with 'config'. The core is ignored on single core builds.
+BaseType_t bg95_task_create(TaskFunction_t            fn,
+                            const char*               name,
+                            const bg95_task_config_t* config,
+                            void*                     arg,
+                            TaskHandle_t*             task);
+
+#endif /* BG95_TASK_H */
@@ -0,0 +1,66 @@
+#ifndef BG95_UART_HW_H
+#define BG95_UART_HW_H
+
+#include "bg95_uart_interface.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// ESP-IDF UART backend for the driver that keeps the UART event queue.
+// Does the same as the driver's bg95_uart_interface_init_hw() (8N1 at BG95_UART_HW_BAUD on the
+// given pins), but installs the UART driver with an event queue and hands it out, so
+// bg95_flow_watch_events() can count overrun and framing errors. 'event_queue' must have
+// exactly one reader.
+//
+// Reads are event driven. UART pattern detection on '\n' raises UART_PATTERN_DET as soon as a
+// line end is received, next to the UART_DATA the driver raises per RX burst. Whoever reads
+// 'event_queue' passes the events on to bg95_uart_hw_on_event() (bg95_flow_set_event_fn() does
+// that for the flow watcher), and a read waits for one of them instead of blocking in
+// uart_read_bytes() until its buffer is full or the timeout runs out. The reader then gets the
+// complete line at once rather than after the timeout. Without events fed in, a read hands out
+// what is buffered when its timeout expires, like a plain polling read.
+//
+// On UART_FIFO_OVF and UART_BUFFER_FULL bg95_uart_hw_on_event() flushes the RX buffer, whatever
+// is left of it has a hole, and the next read fails with ESP_ERR_INVALID_RESPONSE so the
+// command being answered fails instead of parsing a damaged response.
+//
+// Not built for the linux target, which has no UART driver.
+
+#define BG95_UART_HW_BAUD 115200
+#define BG95_UART_HW_RX_BUFFER_SIZE 4096
+#define BG95_UART_HW_TX_BUFFER_SIZE 0 // Writes block until the bytes are in the TX FIFO
+#define BG95_UART_HW_EVENT_QUEUE_LEN 20
+#define BG95_UART_HW_PATTERN_QUEUE_LEN 16 // Line end positions the driver tracks
+#define BG95_UART_HW_PATTERN_CHR_TOUT 9   // Baud cycles, unused for a single character pattern
+
+typedef struct
+{
+  uart_port_t port_num;
+  int         tx_gpio_num;
+  int         rx_gpio_num;
+} bg95_uart_hw_config_t;
+
+typedef struct
+{
+  bg95_uart_interface_t uart; // Hand this one to the next layer
+  uart_port_t           port_num;
+  QueueHandle_t         event_queue; // Owned by the UART driver
+  SemaphoreHandle_t     rx_ready;    // Given per RX event, see bg95_uart_hw_on_event()
+  atomic_bool           rx_lost;     // Input flushed after an overflow, fails the next read
+  bool                  installed;
+} bg95_uart_hw_t;
+
+esp_err_t bg95_uart_hw_init(bg95_uart_hw_t* hw, const bg95_uart_hw_config_t* config);
+void      bg95_uart_hw_deinit(bg95_uart_hw_t* hw);
+
+// Wake a pending read on UART_DATA, UART_PATTERN_DET and RX overflow events, 'ctx' is the
+// bg95_uart_hw_t. Overflows flush the RX buffer first. Matches bg95_flow_event_fn_t.
+void bg95_uart_hw_on_event(const uart_event_t* event, void* ctx);
+
+#endif /* BG95_UART_HW_H */
@@ -0,0 +1,183 @@
+#ifndef BG95_URC_TAP_H
+#define BG95_URC_TAP_H
+
+#include "bg95_at_error.h"
+#include "bg95_task.h"
+#include "bg95_uart_interface.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// URC tap between the physical UART and the driver.
+// A reader task drains the physical interface continuously, forwards every byte to the
+// wrapped 'uart' interface handed to bg95_init() and splits the stream into lines for the
+// registered handlers. Unsolicited result codes are therefore seen the moment they arrive
+// instead of when the next command happens to read them.
+//
+// Reads on 'uart' wake only once a complete "\r\n" terminated line or a "> " prompt is buffered
+// (or the timeout expires, handing out whatever partial data there is), so the driver parses
+// once per line instead of once per UART chunk. bg95_urc_tap_set_wake_on_line(tap, false)
+// restores the wake-on-any-byte behaviour.
+//
+// The reader task reads the physical interface with a BG95_URC_TAP_POLL_MS timeout. On the
+// bg95_uart_hw backend that read returns on the UART line (pattern detection on '\n') and data
+// events, so a line reaches the driver side as soon as its "\r\n" is received and the timeout
+// only bounds how long deinit waits. On a backend that polls, bytes that arrive just after a read
+// started can wait up to that long.
+//
+// A line is 'solicited' when it carries the prefix of a command currently in flight
+// (e.g. "+CPIN: READY" after "AT+CPIN?"). Stale input is flushed when a new command is written,
+// like a UART input flush would do. When a physical read fails with ESP_ERR_INVALID_RESPONSE
+// (input lost, see bg95_uart_hw) the buffered input is flushed too and the next driver side
+// read of the command in flight fails the same way.
+//
+// Command observers (bg95_urc_tap_add_cmd_observer()) see every "AT" line written through 'uart'
+// before it goes out, e.g. so bg95_query_cache can drop results a write makes stale.
+//
+// Final result codes are not dispatched, but the last one is decoded so the CME/CMS error behind
+// a driver call that failed with ESP_FAIL can be read back with bg95_urc_tap_last_error(). It is
+// decoded before the bytes reach the driver side, so it is current once the driver sees them.
+//
+// With CONFIG_BG95_EXT_URC_DISPATCH_TASK the reader only classifies a line and queues it for a
+// dispatch task on the application core, which runs the handlers. Handler work then never holds
+// up the next read. Lines are never dropped or reordered: when the queue is full the reader waits
+// for room, counted in 'queue_waits', and the physical UART buffers behind it. The driver side
+// is not held up by that wait, its bytes are pushed before the line is queued. Without the
+// dispatch task the reader calls the handlers itself.
+
+#define BG95_URC_TAP_MAX_HANDLERS 4
+#define BG95_URC_TAP_MAX_CMD_OBSERVERS 2
+#define BG95_URC_TAP_LINE_MAX_LEN 256
+#define BG95_URC_TAP_RESULT_MAX_LEN 32 // Longest final result line decoded, e.g. "+CME ERROR: 10"
+#define BG95_URC_TAP_STREAM_SIZE 2048
+#define BG95_URC_TAP_READ_CHUNK 128
+#define BG95_URC_TAP_POLL_MS 20
+#define BG95_URC_TAP_MAX_CMD_NAMES 8
+#define BG95_URC_TAP_CMD_NAME_MAX_LEN 16
+#define BG95_URC_TAP_WAIT_PREFIX_MAX_LEN 16
+#define BG95_URC_TAP_TASK_STACK_SIZE CONFIG_BG95_EXT_URC_TAP_TASK_STACK_SIZE
+#define BG95_URC_TAP_TASK_PRIORITY CONFIG_BG95_EXT_URC_TAP_TASK_PRIORITY
+#define BG95_URC_TAP_TASK_CORE CONFIG_BG95_EXT_UART_TASK_CORE
+#define BG95_URC_TAP_DISPATCH_TASK_STACK_SIZE CONFIG_BG95_EXT_URC_DISPATCH_TASK_STACK_SIZE
+#define BG95_URC_TAP_DISPATCH_TASK_PRIORITY CONFIG_BG95_EXT_URC_DISPATCH_TASK_PRIORITY
+#define BG95_URC_TAP_DISPATCH_TASK_CORE CONFIG_BG95_EXT_APP_TASK_CORE
+#define BG95_URC_TAP_DISPATCH_QUEUE_LEN CONFIG_BG95_EXT_URC_DISPATCH_QUEUE_LEN
+#define BG95_URC_TAP_DISPATCH_WAIT_MS 10 // Slice of the reader wait for room in the queue
+
+typedef void (*bg95_urc_handler_t)(const char* line, bool solicited, void* ctx);
+
+typedef struct
+{
+  bg95_urc_handler_t fn;
+  void*              ctx;
+} bg95_urc_tap_handler_t;
+
+// Called with a written command line ("AT..." including its "\r\n", not NUL terminated) on the
+// writing task
+typedef void (*bg95_urc_tap_cmd_fn_t)(const char* cmd_line, size_t len, void* ctx);
+
+typedef struct
+{
+  bg95_urc_tap_cmd_fn_t fn;
+  void*                 ctx;
+} bg95_urc_tap_cmd_observer_t;
+
+typedef struct
+{
+  uint32_t urc_lines;      // Unsolicited lines dispatched
+  uint32_t response_lines; // Solicited lines dispatched
+  uint32_t dropped_bytes;  // Bytes lost because the driver side stream was full
+  uint32_t long_lines;     // Lines truncated to BG95_URC_TAP_LINE_MAX_LEN
+  uint32_t queue_waits;    // Lines the reader had to wait on a full dispatch queue for
+  uint32_t read_wakeups;   // Driver side reads that returned data
+  uint32_t empty_wakeups;  // Driver side reads that returned nothing
+} bg95_urc_tap_stats_t;
+
+typedef struct
+{
+  bg95_uart_interface_t  uart; // Wrapped interface, pass this one to bg95_init()
+  bg95_uart_interface_t* phys;
+
+  StreamBufferHandle_t rx_stream;
+  SemaphoreHandle_t    lock; // Guards handlers and command state
+  SemaphoreHandle_t    stopped;
+  TaskHandle_t         task;
+  volatile bool        running;
+
+  // URC dispatch task, NULL when the reader calls the handlers
+  QueueHandle_t     dispatch_queue;
+  SemaphoreHandle_t dispatch_lock; // Serializes handler calls of the task and bg95_urc_tap_feed()
+  SemaphoreHandle_t dispatch_stopped;
+  TaskHandle_t      dispatch_task;
+
+  bg95_urc_tap_handler_t      handlers[BG95_URC_TAP_MAX_HANDLERS];
+  size_t                      num_handlers;
+  bg95_urc_tap_cmd_observer_t cmd_observers[BG95_URC_TAP_MAX_CMD_OBSERVERS];
+  size_t                      num_cmd_observers;
+
+  // Line-triggered wakeups, guarded by 'lock'
+  SemaphoreHandle_t line_ready;
+  bool              wake_on_line;
+  size_t            ready_bytes;   // Buffered bytes up to the last line end or prompt
+  size_t            partial_bytes; // Buffered bytes after it
+  char              last_byte;
+
+  bool            in_command;
+  bool            rx_lost; // Input of the command in flight was dropped, fails its next read
+  char            cmd_names[BG95_URC_TAP_MAX_CMD_NAMES][BG95_URC_TAP_CMD_NAME_MAX_LEN];
+  size_t          num_cmd_names;
+  bg95_at_error_t last_error; // Decoded from the last final result code
+
+  // One-shot line wait, guarded by 'lock'
+  SemaphoreHandle_t wait_done;
+  bool              wait_armed;
+  bool              wait_hit;
+  char              wait_prefix[BG95_URC_TAP_WAIT_PREFIX_MAX_LEN];
+  char              wait_line[BG95_URC_TAP_LINE_MAX_LEN];
+
+  // Reader task only
+  char   line[BG95_URC_TAP_LINE_MAX_LEN];
+  size_t line_len;
+  bool   line_truncated;
+  char   result_line[BG95_URC_TAP_RESULT_MAX_LEN]; // Line being pushed, for push_chunk()
+  size_t result_len;
+
+  bg95_urc_tap_stats_t stats;
+} bg95_urc_tap_t;
+
+esp_err_t bg95_urc_tap_init(bg95_urc_tap_t* tap, bg95_uart_interface_t* phys);
+void      bg95_urc_tap_deinit(bg95_urc_tap_t* tap);
+
+esp_err_t bg95_urc_tap_add_handler(bg95_urc_tap_t* tap, bg95_urc_handler_t fn, void* ctx);
+
+// ESP_ERR_NO_MEM once BG95_URC_TAP_MAX_CMD_OBSERVERS are registered
+esp_err_t bg95_urc_tap_add_cmd_observer(bg95_urc_tap_t* tap, bg95_urc_tap_cmd_fn_t fn, void* ctx);
+
+// Wake driver side reads per complete line (default) or per received chunk
+void bg95_urc_tap_set_wake_on_line(bg95_urc_tap_t* tap, bool enable);
+
+// Error reported by the last final result code, false when it was "OK"
+bool bg95_urc_tap_last_error(bg95_urc_tap_t* tap, bg95_at_error_t* error);
+
+// Arm a one-shot wait for the next line starting with 'prefix' (e.g. "+QMTOPEN:"). Arm it
+// before sending the command, so a result arriving with or right after the "OK" is not missed.
+// A new arm replaces the previous one.
+esp_err_t bg95_urc_tap_arm_wait(bg95_urc_tap_t* tap, const char* prefix);
+
+// Block until the armed line arrives, at most 'timeout_ms', and disarm. The line is copied to
+// 'line' when not NULL. ESP_ERR_TIMEOUT when it did not arrive, ESP_ERR_INVALID_STATE when
+// nothing was armed.
+esp_err_t bg95_urc_tap_wait(bg95_urc_tap_t* tap, char* line, size_t line_size, uint32_t timeout_ms);
+
+// Split a line stream exactly like the reader task does, but call the handlers on the calling
+// task. Exposed so host tests and other transports can feed bytes without a task.
+void bg95_urc_tap_feed(bg95_urc_tap_t* tap, const char* data, size_t len);
+
+#endif /* BG95_URC_TAP_H */
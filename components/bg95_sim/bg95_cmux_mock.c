@@ -0,0 +1,231 @@
+#include "bg95_cmux_mock.h"
+
+#include <string.h>
+
+// Caller holds mock->lock
+static void queue_bytes(bg95_cmux_mock_t* mock, const uint8_t* data, size_t len)
+{
+  if (mock->out_len + len > sizeof(mock->out))
+  {
+    mock->overflows++;
+    return;
+  }
+  memcpy(mock->out + mock->out_len, data, len);
+  mock->out_len += len;
+}
+
+static void queue_frame(
+    bg95_cmux_mock_t* mock, uint8_t dlci, uint8_t control, const uint8_t* info, size_t len)
+{
+  uint8_t frame[BG95_CMUX_FRAME_MAX_LEN];
+  size_t  frame_len = bg95_cmux_encode_frame(dlci, false, control, info, len, frame, sizeof(frame));
+  if (frame_len > 0)
+  {
+    queue_bytes(mock, frame, frame_len);
+  }
+}
+
+static void mock_on_frame(uint8_t dlci, uint8_t control, const uint8_t* info, size_t len, void* ctx)
+{
+  bg95_cmux_mock_t* mock = (bg95_cmux_mock_t*) ctx;
+
+  mock->frames_rx++;
+  if (dlci > BG95_CMUX_MAX_DLCI)
+  {
+    return;
+  }
+
+  switch (control & ~BG95_CMUX_PF)
+  {
+    case BG95_CMUX_SABM:
+      if ((dlci == 0 && !mock->refuse_control) || (dlci > 0 && mock->backends[dlci] != NULL))
+      {
+        mock->dlci_open[dlci] = true;
+        queue_frame(mock, dlci, BG95_CMUX_UA | BG95_CMUX_PF, NULL, 0);
+      }
+      else
+      {
+        queue_frame(mock, dlci, BG95_CMUX_DM | BG95_CMUX_PF, NULL, 0);
+      }
+      break;
+
+    case BG95_CMUX_DISC:
+      mock->dlci_open[dlci] = false;
+      queue_frame(mock, dlci, BG95_CMUX_UA | BG95_CMUX_PF, NULL, 0);
+      if (dlci == 0)
+      {
+        memset(mock->dlci_open, 0, sizeof(mock->dlci_open)); // Closes the whole mux
+        mock->muxing = false;
+      }
+      break;
+
+    case BG95_CMUX_UIH:
+      if (dlci == 0)
+      {
+        if (len > 0)
+        {
+          mock->last_ctrl_msg = info[0];
+        }
+        if (len > 0 && info[0] == BG95_CMUX_MSG_CLD)
+        {
+          const uint8_t cld_response[] = {BG95_CMUX_MSG_CLD & ~BG95_CMUX_CR, BG95_CMUX_EA};
+          queue_frame(mock, 0, BG95_CMUX_UIH, cld_response, sizeof(cld_response));
+          memset(mock->dlci_open, 0, sizeof(mock->dlci_open));
+          mock->muxing = false;
+        }
+        break;
+      }
+      if (mock->dlci_open[dlci])
+      {
+        bg95_uart_interface_t* backend = mock->backends[dlci];
+        backend->write((const char*) info, len, backend->context);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+static esp_err_t mock_write(const char* data, size_t len, void* context)
+{
+  bg95_cmux_mock_t* mock = (bg95_cmux_mock_t*) context;
+
+  xSemaphoreTake(mock->lock, portMAX_DELAY);
+  if (mock->muxing)
+  {
+    bg95_cmux_decoder_feed(&mock->decoder, (const uint8_t*) data, len);
+  }
+  else if (len >= 8 && strncmp(data, "AT+CMUX=", 8) == 0)
+  {
+    const char* ok = "\r\nOK\r\n";
+    queue_bytes(mock, (const uint8_t*) ok, strlen(ok));
+    bg95_cmux_decoder_init(&mock->decoder, mock_on_frame, mock);
+    mock->muxing = true;
+  }
+  else
+  {
+    const char* error = "\r\nERROR\r\n";
+    queue_bytes(mock, (const uint8_t*) error, strlen(error));
+  }
+  xSemaphoreGive(mock->lock);
+  return ESP_OK;
+}
+
+// Frame whatever the open DLCIs' backends have to say, caller holds mock->lock
+static void poll_backends(bg95_cmux_mock_t* mock)
+{
+  uint8_t buf[BG95_CMUX_MOCK_BACKEND_CHUNK];
+
+  for (uint8_t dlci = 1; dlci <= BG95_CMUX_MAX_DLCI; dlci++)
+  {
+    bg95_uart_interface_t* backend = mock->backends[dlci];
+    if (backend == NULL || !mock->dlci_open[dlci])
+    {
+      continue;
+    }
+
+    size_t bytes_read = 0;
+    backend->read((char*) buf, sizeof(buf), &bytes_read, 0, backend->context);
+    for (size_t off = 0; off < bytes_read; off += BG95_CMUX_N1)
+    {
+      size_t chunk = bytes_read - off > BG95_CMUX_N1 ? BG95_CMUX_N1 : bytes_read - off;
+      queue_frame(mock, dlci, BG95_CMUX_UIH, buf + off, chunk);
+    }
+  }
+}
+
+static esp_err_t mock_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  bg95_cmux_mock_t* mock = (bg95_cmux_mock_t*) context;
+
+  xSemaphoreTake(mock->lock, portMAX_DELAY);
+  if (mock->muxing)
+  {
+    poll_backends(mock);
+  }
+  size_t n = mock->out_len < max_len ? mock->out_len : max_len;
+  memcpy(data, mock->out, n);
+  memmove(mock->out, mock->out + n, mock->out_len - n);
+  mock->out_len -= n;
+  xSemaphoreGive(mock->lock);
+
+  *bytes_read = n;
+  if (n == 0 && timeout_ms > 0)
+  {
+    vTaskDelay(1); // Nothing pending, do not let the reader task spin
+  }
+  return ESP_OK;
+}
+
+esp_err_t bg95_cmux_mock_init(bg95_cmux_mock_t* mock)
+{
+  if (mock == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(mock, 0, sizeof(*mock));
+  mock->lock = xSemaphoreCreateMutex();
+  if (mock->lock == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  mock->uart.write   = mock_write;
+  mock->uart.read    = mock_read;
+  mock->uart.context = mock;
+  return ESP_OK;
+}
+
+void bg95_cmux_mock_deinit(bg95_cmux_mock_t* mock)
+{
+  if (mock == NULL)
+  {
+    return;
+  }
+  if (mock->lock != NULL)
+  {
+    vSemaphoreDelete(mock->lock);
+  }
+  memset(mock, 0, sizeof(*mock));
+}
+
+esp_err_t bg95_cmux_mock_attach(bg95_cmux_mock_t*      mock,
+                                uint8_t                dlci,
+                                bg95_uart_interface_t* backend)
+{
+  if (mock == NULL || backend == NULL || dlci == 0 || dlci > BG95_CMUX_MAX_DLCI)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(mock->lock, portMAX_DELAY);
+  mock->backends[dlci] = backend;
+  xSemaphoreGive(mock->lock);
+  return ESP_OK;
+}
+
+esp_err_t bg95_cmux_mock_send_control(bg95_cmux_mock_t* mock,
+                                      uint8_t           type,
+                                      const uint8_t*    value,
+                                      size_t            len)
+{
+  uint8_t msg[2 + BG95_CMUX_CTRL_VALUE_MAX_LEN];
+  if (mock == NULL || len > BG95_CMUX_CTRL_VALUE_MAX_LEN || (value == NULL && len > 0))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  msg[0] = type;
+  msg[1] = (uint8_t) ((len << 1) | BG95_CMUX_EA);
+  if (len > 0)
+  {
+    memcpy(msg + 2, value, len);
+  }
+  xSemaphoreTake(mock->lock, portMAX_DELAY);
+  queue_frame(mock, 0, BG95_CMUX_UIH, msg, 2 + len);
+  xSemaphoreGive(mock->lock);
+  return ESP_OK;
+}
@@ -0,0 +1,245 @@
+#include "bg95_mqtt_wire.h"
+
+#include <string.h>
+
+#define MQTT_MAX_REMAINING_LEN 268435455 // Four length bytes
+#define MQTT_PROTOCOL_LEVEL 4            // 3.1.1
+
+#define CONNECT_FLAG_CLEAN_SESSION 0x02
+#define CONNECT_FLAG_PASSWORD 0x40
+#define CONNECT_FLAG_USERNAME 0x80
+
+typedef struct
+{
+  uint8_t* buf;
+  size_t   size;
+  size_t   pos;
+  bool     overflow;
+} wire_writer_t;
+
+static void put_byte(wire_writer_t* w, uint8_t b)
+{
+  if (w->pos >= w->size)
+  {
+    w->overflow = true;
+    return;
+  }
+  w->buf[w->pos++] = b;
+}
+
+static void put_u16(wire_writer_t* w, uint16_t v)
+{
+  put_byte(w, (uint8_t) (v >> 8));
+  put_byte(w, (uint8_t) v);
+}
+
+// Length-prefixed UTF-8 string
+static void put_string(wire_writer_t* w, const char* s)
+{
+  size_t len = strlen(s);
+  put_u16(w, (uint16_t) len);
+  if (w->pos + len > w->size)
+  {
+    w->overflow = true;
+    return;
+  }
+  memcpy(w->buf + w->pos, s, len);
+  w->pos += len;
+}
+
+static void put_fixed_header(wire_writer_t* w, uint8_t first, size_t remaining)
+{
+  put_byte(w, first);
+  do
+  {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    put_byte(w, remaining > 0 ? digit | 0x80 : digit);
+  } while (remaining > 0);
+}
+
+static size_t finish(const wire_writer_t* w)
+{
+  return w->overflow ? 0 : w->pos;
+}
+
+static size_t string_len(const char* s)
+{
+  return 2 + strlen(s);
+}
+
+size_t bg95_mqtt_wire_connect(uint8_t*    buf,
+                              size_t      size,
+                              const char* client_id,
+                              const char* username,
+                              const char* password,
+                              uint16_t    keepalive_s)
+{
+  wire_writer_t w     = {.buf = buf, .size = size};
+  uint8_t       flags = CONNECT_FLAG_CLEAN_SESSION;
+  size_t        len   = string_len("MQTT") + 1 + 1 + 2 + string_len(client_id);
+
+  if (username != NULL)
+  {
+    flags |= CONNECT_FLAG_USERNAME;
+    len += string_len(username);
+  }
+  if (password != NULL)
+  {
+    flags |= CONNECT_FLAG_PASSWORD;
+    len += string_len(password);
+  }
+
+  put_fixed_header(&w, BG95_MQTT_CONNECT << 4, len);
+  put_string(&w, "MQTT");
+  put_byte(&w, MQTT_PROTOCOL_LEVEL);
+  put_byte(&w, flags);
+  put_u16(&w, keepalive_s);
+  put_string(&w, client_id);
+  if (username != NULL)
+  {
+    put_string(&w, username);
+  }
+  if (password != NULL)
+  {
+    put_string(&w, password);
+  }
+  return finish(&w);
+}
+
+size_t bg95_mqtt_wire_publish_header(uint8_t*    buf,
+                                     size_t      size,
+                                     const char* topic,
+                                     int         qos,
+                                     bool        retain,
+                                     uint16_t    packet_id,
+                                     size_t      payload_len)
+{
+  wire_writer_t w     = {.buf = buf, .size = size};
+  uint8_t       first = (BG95_MQTT_PUBLISH << 4) | ((qos & 0x03) << 1) | (retain ? 1 : 0);
+  size_t        len   = string_len(topic) + (qos > 0 ? 2 : 0) + payload_len;
+
+  if (len > MQTT_MAX_REMAINING_LEN)
+  {
+    return 0;
+  }
+  put_fixed_header(&w, first, len);
+  put_string(&w, topic);
+  if (qos > 0)
+  {
+    put_u16(&w, packet_id);
+  }
+  return finish(&w);
+}
+
+size_t bg95_mqtt_wire_ack(uint8_t* buf, size_t size, bg95_mqtt_packet_type_t type, uint16_t id)
+{
+  wire_writer_t w = {.buf = buf, .size = size};
+
+  // PUBREL is the one ack with reserved flags 0010
+  put_fixed_header(&w, (type << 4) | (type == BG95_MQTT_PUBREL ? 0x02 : 0), 2);
+  put_u16(&w, id);
+  return finish(&w);
+}
+
+size_t bg95_mqtt_wire_subscribe(
+    uint8_t* buf, size_t size, uint16_t packet_id, const char* topic, int qos)
+{
+  wire_writer_t w = {.buf = buf, .size = size};
+
+  put_fixed_header(&w, (BG95_MQTT_SUBSCRIBE << 4) | 0x02, 2 + string_len(topic) + 1);
+  put_u16(&w, packet_id);
+  put_string(&w, topic);
+  put_byte(&w, (uint8_t) (qos & 0x03));
+  return finish(&w);
+}
+
+size_t bg95_mqtt_wire_unsubscribe(uint8_t* buf, size_t size, uint16_t packet_id, const char* topic)
+{
+  wire_writer_t w = {.buf = buf, .size = size};
+
+  put_fixed_header(&w, (BG95_MQTT_UNSUBSCRIBE << 4) | 0x02, 2 + string_len(topic));
+  put_u16(&w, packet_id);
+  put_string(&w, topic);
+  return finish(&w);
+}
+
+size_t bg95_mqtt_wire_empty(uint8_t* buf, size_t size, bg95_mqtt_packet_type_t type)
+{
+  wire_writer_t w = {.buf = buf, .size = size};
+
+  put_fixed_header(&w, type << 4, 0);
+  return finish(&w);
+}
+
+esp_err_t bg95_mqtt_wire_parse_header(const uint8_t*           buf,
+                                      size_t                   len,
+                                      bg95_mqtt_wire_header_t* header)
+{
+  if (buf == NULL || header == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  size_t remaining  = 0;
+  size_t multiplier = 1;
+  for (size_t i = 1; i < BG95_MQTT_WIRE_MAX_HEADER_LEN; i++)
+  {
+    if (i >= len)
+    {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    remaining += (buf[i] & 0x7F) * multiplier;
+    multiplier *= 128;
+    if ((buf[i] & 0x80) == 0)
+    {
+      header->type       = (bg95_mqtt_packet_type_t) (buf[0] >> 4);
+      header->flags      = buf[0] & 0x0F;
+      header->header_len = i + 1;
+      header->body_len   = remaining;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_INVALID_RESPONSE;
+}
+
+esp_err_t bg95_mqtt_wire_parse_publish(const bg95_mqtt_wire_header_t* header,
+                                       const uint8_t*                 body,
+                                       bg95_mqtt_wire_publish_t*      publish)
+{
+  if (header == NULL || body == NULL || publish == NULL || header->type != BG95_MQTT_PUBLISH)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  publish->qos    = (header->flags >> 1) & 0x03;
+  publish->retain = (header->flags & 0x01) != 0;
+  if (header->body_len < 2)
+  {
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+
+  size_t topic_len = ((size_t) body[0] << 8) | body[1];
+  size_t pos       = 2 + topic_len;
+  if (publish->qos == 3 || pos + (publish->qos > 0 ? 2 : 0) > header->body_len)
+  {
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+
+  publish->topic     = (const char*) body + 2;
+  publish->topic_len = topic_len;
+  publish->packet_id = 0;
+  if (publish->qos > 0)
+  {
+    publish->packet_id = bg95_mqtt_wire_packet_id(body + pos);
+    pos += 2;
+  }
+  publish->payload     = body + pos;
+  publish->payload_len = header->body_len - pos;
+  return ESP_OK;
+}
+
+uint16_t bg95_mqtt_wire_packet_id(const uint8_t* body)
+{
+  return (uint16_t) ((body[0] << 8) | body[1]);
+}
@@ -0,0 +1,863 @@
+#include "bg95_sim.h"
+
+#include "at_cmd_qmtconn.h"
+#include "at_cmd_qmtopen.h"
+#include "at_cmd_qmtpub.h"
+#include "at_cmd_qmtsub.h"
+#include "bg95_mqtt_wire.h"
+#include "freertos/task.h"
+
+#include <errno.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const char* TAG = "BG95_SIM";
+
+#define CTRL_Z 0x1A
+#define SIM_MAX_SLEEP_MS 10 // Re-check for new output at least this often while a read waits
+#define SIM_URC_MAX_LEN 64
+#define SIM_CREDENTIAL_MAX_LEN 64
+
+// +QMTSTAT <err_code>, the driver has no type for this URC
+#define SIM_QMTSTAT_CLOSED_BY_PEER 1
+
+// Canned answers of a registered modem with an open, connected MQTT client. 'urc' is a format
+// taking the first two integers of the command's parameters.
+typedef struct
+{
+  const char* prefix;
+  const char* response;
+  const char* urc;
+} sim_canned_t;
+
+static const sim_canned_t canned[] = {
+    {"AT+CPIN?", "\r\n+CPIN: READY\r\n\r\nOK\r\n", NULL},
+    {"AT+CSQ", "\r\n+CSQ: 24,99\r\n\r\nOK\r\n", NULL},
+    {"AT+CREG?", "\r\n+CREG: 0,1\r\n\r\nOK\r\n", NULL},
+    {"AT+CEREG?", "\r\n+CEREG: 0,1\r\n\r\nOK\r\n", NULL},
+    {"AT+CGATT?", "\r\n+CGATT: 1\r\n\r\nOK\r\n", NULL},
+    {"AT+COPS?", "\r\n+COPS: 0,0,\"SIM\",8\r\n\r\nOK\r\n", NULL},
+    {"AT+CGPADDR", "\r\n+CGPADDR: 1,\"10.0.0.2\"\r\n\r\nOK\r\n", NULL},
+    {"AT+QIACT?", "\r\n+QIACT: 1,1,1,\"10.0.0.2\"\r\n\r\nOK\r\n", NULL},
+    {"AT+QMTOPEN?", "\r\n+QMTOPEN: 0,\"sim\",1883\r\n\r\nOK\r\n", NULL},
+    {"AT+QMTCONN?", "\r\n+QMTCONN: 0,3\r\n\r\nOK\r\n", NULL},
+    {"AT+QMTOPEN=", "\r\nOK\r\n", "\r\n+QMTOPEN: %d,0\r\n"},
+    {"AT+QMTCONN=", "\r\nOK\r\n", "\r\n+QMTCONN: %d,0,0\r\n"},
+    {"AT+QMTSUB=", "\r\nOK\r\n", "\r\n+QMTSUB: %d,%d,0,1\r\n"},
+    {"AT+QMTUNS=", "\r\nOK\r\n", "\r\n+QMTUNS: %d,%d,0\r\n"},
+    {"AT+QMTDISC=", "\r\nOK\r\n", "\r\n+QMTDISC: %d,0\r\n"},
+    {"AT+QMTCLOSE=", "\r\nOK\r\n", "\r\n+QMTCLOSE: %d,0\r\n"},
+};
+
+typedef struct
+{
+  const char* data;
+  size_t      len;
+} sim_part_t;
+
+static int64_t wire_us(const bg95_sim_t* sim, size_t len)
+{
+  return sim->config.baud == 0 ? 0 : (int64_t) len * 10 * 1000000 / sim->config.baud;
+}
+
+static int64_t rtt_us(const bg95_sim_t* sim)
+{
+  return (int64_t) sim->config.rtt_ms * 1000;
+}
+
+static size_t events_needed(size_t len)
+{
+  return (len + BG95_SIM_EVENT_MAX_LEN - 1) / BG95_SIM_EVENT_MAX_LEN;
+}
+
+// Queue modem output that starts going out at 'ready_us', split over as many events as it
+// needs. They all share one due time, so output queued later cannot land in between. Must be
+// called with sim->lock held.
+static bool queue_parts(bg95_sim_t* sim, int64_t ready_us, const sim_part_t* parts, size_t count)
+{
+  size_t len = 0;
+  for (size_t p = 0; p < count; p++)
+  {
+    len += parts[p].len;
+  }
+  size_t needed = events_needed(len);
+  if (sim->num_events + needed > BG95_SIM_MAX_EVENTS)
+  {
+    ESP_LOGW(TAG, "Output queue full, dropping %u bytes", (unsigned) len);
+    return false;
+  }
+
+  int64_t due_us = ready_us + wire_us(sim, len); // Readable once it is completely received
+  size_t  at     = sim->num_events;
+  while (at > 0 && sim->events[at - 1].due_us > due_us)
+  {
+    at--;
+  }
+  memmove(&sim->events[at + needed],
+          &sim->events[at],
+          (sim->num_events - at) * sizeof(sim->events[0]));
+  sim->num_events += needed;
+
+  bg95_sim_event_t* event = &sim->events[at];
+  event->len              = 0;
+  for (size_t p = 0; p < count; p++)
+  {
+    for (size_t done = 0; done < parts[p].len;)
+    {
+      if (event->len == BG95_SIM_EVENT_MAX_LEN)
+      {
+        event++;
+        event->len = 0;
+      }
+      size_t room = BG95_SIM_EVENT_MAX_LEN - event->len;
+      size_t n    = parts[p].len - done;
+      n           = n < room ? n : room;
+      memcpy(event->data + event->len, parts[p].data + done, n);
+      event->len += n;
+      done += n;
+    }
+  }
+  for (size_t i = at; i < at + needed; i++)
+  {
+    sim->events[i].due_us = due_us;
+    sim->events[i].pos    = 0;
+  }
+
+  sim->stats.bytes_from_modem += len;
+  sim->stats.wire_busy_us += wire_us(sim, len);
+  return true;
+}
+
+static void queue_output(bg95_sim_t* sim, int64_t ready_us, const char* text)
+{
+  sim_part_t part = {.data = text, .len = strlen(text)};
+  queue_parts(sim, ready_us, &part, 1);
+}
+
+// Parameter 'index' of the command with quotes removed (AT+QMTSUB=0,1,"a,b",1 -> "0", "1",
+// "a,b", "1"). False when the command has fewer parameters.
+static bool command_param(const char* line, int index, char* out, size_t size)
+{
+  const char* p = strchr(line, '=');
+  if (p == NULL)
+  {
+    return false;
+  }
+  p++;
+
+  for (int param = 0;; param++)
+  {
+    bool   quoted = false;
+    size_t n      = 0;
+    for (; *p != '\0' && (quoted || *p != ','); p++)
+    {
+      if (*p == '"')
+      {
+        quoted = !quoted;
+      }
+      else if (param == index && n + 1 < size)
+      {
+        out[n++] = *p;
+      }
+    }
+    if (param == index)
+    {
+      out[n] = '\0';
+      return true;
+    }
+    if (*p == '\0')
+    {
+      return false;
+    }
+    p++;
+  }
+}
+
+// Integer parameter, missing ones are 0
+static int command_int(const char* line, int index)
+{
+  char param[16];
+  return command_param(line, index, param, sizeof(param)) ? atoi(param) : 0;
+}
+
+// ----------- Broker bridge -------------------
+
+static bool bridged(const bg95_sim_t* sim)
+{
+  return sim->config.broker_host != NULL;
+}
+
+static void bridge_close(bg95_sim_t* sim)
+{
+  if (sim->sock >= 0)
+  {
+    close(sim->sock);
+  }
+  sim->sock           = -1;
+  sim->mqtt_connected = false;
+  sim->rx_len         = 0;
+}
+
+static bool bridge_send(bg95_sim_t* sim, const void* data, size_t len)
+{
+  const uint8_t* p = (const uint8_t*) data;
+  while (len > 0 && sim->sock >= 0)
+  {
+    ssize_t n = send(sim->sock, p, len, 0);
+    if (n <= 0)
+    {
+      ESP_LOGW(TAG, "Broker send failed: errno %d", errno);
+      bridge_close(sim);
+      return false;
+    }
+    p += n;
+    len -= (size_t) n;
+  }
+  return len == 0;
+}
+
+// Returns the QMTOPEN result code
+static qmtopen_result_t bridge_open(bg95_sim_t* sim)
+{
+  struct addrinfo  hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM};
+  struct addrinfo* res   = NULL;
+  char             port[8];
+
+  if (sim->sock >= 0)
+  {
+    return QMTOPEN_RESULT_MQTT_ID_OCCUPIED;
+  }
+  snprintf(port, sizeof(port), "%u", (unsigned) sim->config.broker_port);
+  if (getaddrinfo(sim->config.broker_host, port, &hints, &res) != 0 || res == NULL)
+  {
+    ESP_LOGW(TAG, "Cannot resolve broker %s", sim->config.broker_host);
+    return QMTOPEN_RESULT_FAILED_PARSE_DOMAIN;
+  }
+
+  int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (sock < 0 || connect(sock, res->ai_addr, res->ai_addrlen) != 0)
+  {
+    ESP_LOGW(TAG, "Cannot connect to broker %s:%s: errno %d", sim->config.broker_host, port, errno);
+    if (sock >= 0)
+    {
+      close(sock);
+    }
+    freeaddrinfo(res);
+    return QMTOPEN_RESULT_NETWORK_CONN_ERROR;
+  }
+  freeaddrinfo(res);
+
+  int nodelay = 1; // Publishes are small and their latency is what gets measured
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+  sim->sock = sock;
+  return QMTOPEN_RESULT_OPEN_SUCCESS;
+}
+
+// Broker answers are due as soon as they arrive, but not before the last command's OK
+static int64_t bridge_ready_us(const bg95_sim_t* sim)
+{
+  int64_t now_us = esp_timer_get_time();
+  return now_us > sim->urc_not_before_us ? now_us : sim->urc_not_before_us;
+}
+
+static void bridge_urc(bg95_sim_t* sim, const char* format, int a, int b, int c)
+{
+  char urc[SIM_URC_MAX_LEN];
+  snprintf(urc, sizeof(urc), format, a, b, c);
+  queue_output(sim, bridge_ready_us(sim), urc);
+}
+
+// The broker connection is gone, the client has to open it again
+static void bridge_lost(bg95_sim_t* sim)
+{
+  bridge_close(sim);
+  bridge_urc(sim, "\r\n+QMTSTAT: %d,%d\r\n", sim->bridge_client_idx, SIM_QMTSTAT_CLOSED_BY_PEER, 0);
+}
+
+// +QMTRECV for a message from the broker. False when the output queue has no room for it yet.
+static bool bridge_deliver(bg95_sim_t* sim, const bg95_mqtt_wire_publish_t* publish)
+{
+  char       head[SIM_URC_MAX_LEN];
+  sim_part_t parts[] = {
+      {head, 0},
+      {publish->topic, publish->topic_len},
+      {"\",\"", 3},
+      {(const char*) publish->payload, publish->payload_len},
+      {"\"\r\n", 3},
+  };
+  size_t     count = sizeof(parts) / sizeof(parts[0]);
+
+  parts[0].len = (size_t) snprintf(head,
+                                   sizeof(head),
+                                   "\r\n+QMTRECV: %d,%u,\"",
+                                   sim->bridge_client_idx,
+                                   (unsigned) publish->packet_id);
+
+  size_t len = 0;
+  for (size_t p = 0; p < count; p++)
+  {
+    len += parts[p].len;
+  }
+  if (sim->num_events + events_needed(len) > BG95_SIM_MAX_EVENTS)
+  {
+    return false;
+  }
+  queue_parts(sim, bridge_ready_us(sim), parts, count);
+  sim->stats.received++;
+  return true;
+}
+
+// Handle one packet from the broker. False when it has to wait for room in the output queue.
+static bool bridge_handle_packet(bg95_sim_t*                    sim,
+                                 const bg95_mqtt_wire_header_t* header,
+                                 const uint8_t*                 body)
+{
+  uint8_t  ack[4];
+  int      idx = sim->bridge_client_idx;
+  uint16_t id  = header->body_len >= 2 ? bg95_mqtt_wire_packet_id(body) : 0;
+
+  switch (header->type)
+  {
+  case BG95_MQTT_CONNACK:
+  {
+    int return_code     = header->body_len >= 2 ? body[1] : 0;
+    sim->mqtt_connected = return_code == 0;
+    bridge_urc(sim, "\r\n+QMTCONN: %d,0,%d\r\n", idx, return_code, 0);
+    break;
+  }
+  case BG95_MQTT_PUBACK:
+  case BG95_MQTT_PUBCOMP:
+    bridge_urc(sim, "\r\n+QMTPUB: %d,%d,0\r\n", idx, id, 0);
+    break;
+  case BG95_MQTT_PUBREC:
+    bridge_send(sim, ack, bg95_mqtt_wire_ack(ack, sizeof(ack), BG95_MQTT_PUBREL, id));
+    break;
+  case BG95_MQTT_PUBREL:
+    bridge_send(sim, ack, bg95_mqtt_wire_ack(ack, sizeof(ack), BG95_MQTT_PUBCOMP, id));
+    break;
+  case BG95_MQTT_SUBACK:
+  {
+    int granted = header->body_len >= 3 ? body[2] : 0x80;
+    if (granted == 0x80)
+    {
+      bridge_urc(sim, "\r\n+QMTSUB: %d,%d,%d\r\n", idx, id, QMTSUB_RESULT_FAILED_TO_SEND);
+    }
+    else
+    {
+      bridge_urc(sim, "\r\n+QMTSUB: %d,%d,0,%d\r\n", idx, id, granted);
+    }
+    break;
+  }
+  case BG95_MQTT_UNSUBACK:
+    bridge_urc(sim, "\r\n+QMTUNS: %d,%d,0\r\n", idx, id, 0);
+    break;
+  case BG95_MQTT_PUBLISH:
+  {
+    bg95_mqtt_wire_publish_t publish;
+    if (bg95_mqtt_wire_parse_publish(header, body, &publish) != ESP_OK)
+    {
+      ESP_LOGW(TAG, "Malformed PUBLISH from broker");
+      break;
+    }
+    if (!bridge_deliver(sim, &publish))
+    {
+      return false;
+    }
+    if (publish.qos > 0)
+    {
+      bg95_mqtt_packet_type_t type = publish.qos == 1 ? BG95_MQTT_PUBACK : BG95_MQTT_PUBREC;
+      bridge_send(sim, ack, bg95_mqtt_wire_ack(ack, sizeof(ack), type, publish.packet_id));
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  return true;
+}
+
+// Pull what the broker sent and turn complete packets into URCs. Must be called with sim->lock
+// held.
+static void bridge_poll(bg95_sim_t* sim)
+{
+  if (sim->sock < 0)
+  {
+    return;
+  }
+
+  while (sim->rx_len < sizeof(sim->rx))
+  {
+    size_t  room = sizeof(sim->rx) - sim->rx_len;
+    ssize_t n    = recv(sim->sock, sim->rx + sim->rx_len, room, MSG_DONTWAIT);
+    if (n > 0)
+    {
+      sim->rx_len += (size_t) n;
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+      ESP_LOGW(TAG, "Broker closed the connection");
+      bridge_lost(sim);
+      return;
+    }
+    break;
+  }
+
+  bg95_mqtt_wire_header_t header;
+  while (bg95_mqtt_wire_parse_header(sim->rx, sim->rx_len, &header) == ESP_OK)
+  {
+    size_t total = header.header_len + header.body_len;
+    if (total > sizeof(sim->rx))
+    {
+      ESP_LOGW(TAG, "Broker packet of %u bytes does not fit, closing", (unsigned) total);
+      bridge_close(sim);
+      return;
+    }
+    if (total > sim->rx_len || !bridge_handle_packet(sim, &header, sim->rx + header.header_len))
+    {
+      return;
+    }
+    sim->rx_len -= total;
+    memmove(sim->rx, sim->rx + total, sim->rx_len);
+  }
+}
+
+static void bridge_publish(bg95_sim_t* sim, int64_t ok_us)
+{
+  uint8_t header[BG95_MQTT_WIRE_MAX_HEADER_LEN + 2 + BG95_SIM_TOPIC_MAX_LEN + 2];
+  char    urc[SIM_URC_MAX_LEN];
+  size_t  len = bg95_mqtt_wire_publish_header(header,
+                                             sizeof(header),
+                                             sim->pub_topic,
+                                             sim->pub_qos,
+                                             sim->pub_retain,
+                                             (uint16_t) sim->pub_msgid,
+                                             sim->payload_len);
+
+  queue_output(sim, ok_us, "\r\nOK\r\n");
+  sim->urc_not_before_us = ok_us;
+  if (!sim->mqtt_connected || len == 0 || !bridge_send(sim, header, len) ||
+      !bridge_send(sim, sim->payload, sim->payload_len))
+  {
+    snprintf(urc,
+             sizeof(urc),
+             "\r\n+QMTPUB: %d,%d,%d\r\n",
+             sim->pub_client_idx,
+             sim->pub_msgid,
+             QMTPUB_RESULT_FAILED_TO_SEND);
+    queue_output(sim, ok_us, urc);
+  }
+  else if (sim->pub_qos == 0)
+  {
+    // No broker ack for QoS 0, the modem reports success once the packet is out
+    snprintf(urc, sizeof(urc), "\r\n+QMTPUB: %d,0,0\r\n", sim->pub_client_idx);
+    queue_output(sim, ok_us, urc);
+  }
+}
+
+static void bridge_subscription(bg95_sim_t* sim, const char* line, int64_t ready_us)
+{
+  uint8_t  packet[BG95_MQTT_WIRE_MAX_HEADER_LEN + 5 + BG95_SIM_TOPIC_MAX_LEN];
+  char     topic[BG95_SIM_TOPIC_MAX_LEN];
+  uint16_t id  = (uint16_t) command_int(line, 1);
+  size_t   len = 0;
+
+  command_param(line, 2, topic, sizeof(topic));
+  if (strncmp(line, "AT+QMTSUB=", 10) == 0)
+  {
+    len = bg95_mqtt_wire_subscribe(packet, sizeof(packet), id, topic, command_int(line, 3));
+  }
+  else
+  {
+    len = bg95_mqtt_wire_unsubscribe(packet, sizeof(packet), id, topic);
+  }
+
+  bool sent = sim->mqtt_connected && len > 0 && bridge_send(sim, packet, len);
+  queue_output(sim, ready_us, sent ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+}
+
+// AT+QMTCONN=<idx>,"<client id>"[,"<username>"[,"<password>"]]
+static void bridge_connect(bg95_sim_t* sim, const char* line, int64_t ready_us)
+{
+  uint8_t packet[BG95_MQTT_WIRE_MAX_HEADER_LEN + 16 + 3 * SIM_CREDENTIAL_MAX_LEN];
+  char    client_id[SIM_CREDENTIAL_MAX_LEN];
+  char    username[SIM_CREDENTIAL_MAX_LEN];
+  char    password[SIM_CREDENTIAL_MAX_LEN];
+  bool    has_username = command_param(line, 2, username, sizeof(username));
+  bool    has_password = command_param(line, 3, password, sizeof(password));
+
+  command_param(line, 1, client_id, sizeof(client_id));
+  size_t len = bg95_mqtt_wire_connect(packet,
+                                      sizeof(packet),
+                                      client_id,
+                                      has_username ? username : NULL,
+                                      has_password ? password : NULL,
+                                      0); // Keep alive off, the simulator sends no PINGREQ
+
+  bool sent = sim->sock >= 0 && len > 0 && bridge_send(sim, packet, len);
+  queue_output(sim, ready_us, sent ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+}
+
+// MQTT commands forwarded to the broker. False for anything the canned table answers.
+static bool bridge_command(bg95_sim_t* sim, const char* line, int64_t ready_us)
+{
+  char urc[SIM_URC_MAX_LEN];
+  int  idx = command_int(line, 0);
+
+  sim->urc_not_before_us = ready_us;
+  if (strncmp(line, "AT+QMTOPEN=", 11) == 0)
+  {
+    queue_output(sim, ready_us, "\r\nOK\r\n");
+    qmtopen_result_t result = bridge_open(sim);
+    if (result == QMTOPEN_RESULT_OPEN_SUCCESS)
+    {
+      sim->bridge_client_idx = idx;
+    }
+    snprintf(urc, sizeof(urc), "\r\n+QMTOPEN: %d,%d\r\n", idx, result);
+    queue_output(sim, ready_us, urc);
+  }
+  else if (strncmp(line, "AT+QMTCONN=", 11) == 0)
+  {
+    bridge_connect(sim, line, ready_us);
+  }
+  else if (strncmp(line, "AT+QMTCONN?", 11) == 0)
+  {
+    if (sim->sock >= 0)
+    {
+      snprintf(urc,
+               sizeof(urc),
+               "\r\n+QMTCONN: %d,%d\r\n",
+               sim->bridge_client_idx,
+               sim->mqtt_connected ? QMTCONN_STATE_CONNECTED : QMTCONN_STATE_INITIALIZING);
+      queue_output(sim, ready_us, urc);
+    }
+    queue_output(sim, ready_us, "\r\nOK\r\n");
+  }
+  else if (strncmp(line, "AT+QMTSUB=", 10) == 0 || strncmp(line, "AT+QMTUNS=", 10) == 0)
+  {
+    bridge_subscription(sim, line, ready_us);
+  }
+  else if (strncmp(line, "AT+QMTDISC=", 11) == 0 || strncmp(line, "AT+QMTCLOSE=", 12) == 0)
+  {
+    uint8_t packet[2];
+    if (sim->mqtt_connected)
+    {
+      bridge_send(sim, packet, bg95_mqtt_wire_empty(packet, sizeof(packet), BG95_MQTT_DISCONNECT));
+    }
+    bridge_close(sim);
+    queue_output(sim, ready_us, "\r\nOK\r\n");
+    snprintf(urc,
+             sizeof(urc),
+             strncmp(line, "AT+QMTDISC=", 11) == 0 ? "\r\n+QMTDISC: %d,0\r\n"
+                                                   : "\r\n+QMTCLOSE: %d,0\r\n",
+             idx);
+    queue_output(sim, ready_us, urc);
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+// ----------- Command handling -------------------
+
+static void finish_publish(bg95_sim_t* sim, int64_t now_us)
+{
+  char    urc[SIM_URC_MAX_LEN];
+  int64_t ok_us = now_us + rtt_us(sim);
+
+  sim->in_payload = false;
+  sim->stats.publishes++;
+  if (bridged(sim))
+  {
+    bridge_publish(sim, ok_us);
+    return;
+  }
+  queue_output(sim, ok_us, "\r\nOK\r\n");
+  snprintf(urc, sizeof(urc), "\r\n+QMTPUB: %d,%d,0\r\n", sim->pub_client_idx, sim->pub_msgid);
+  queue_output(sim, ok_us + (int64_t) sim->config.urc_delay_ms * 1000, urc);
+}
+
+// AT+QMTPUB[EX]=<idx>,<msgid>,<qos>,<retain>,"<topic>"[,<length>]
+static void start_publish(bg95_sim_t* sim, const char* line, int64_t now_us)
+{
+  char length[16];
+
+  sim->pub_client_idx = command_int(line, 0);
+  sim->pub_msgid      = command_int(line, 1);
+  sim->pub_qos        = command_int(line, 2);
+  sim->pub_retain     = command_int(line, 3) != 0;
+  command_param(line, 4, sim->pub_topic, sizeof(sim->pub_topic));
+
+  sim->in_payload        = true;
+  sim->payload_len       = 0;
+  sim->ctrl_z_terminated = !command_param(line, 5, length, sizeof(length));
+  sim->payload_left      = sim->ctrl_z_terminated ? 0 : (size_t) strtoul(length, NULL, 10);
+  queue_output(sim, now_us + rtt_us(sim), "\r\n> ");
+  if (!sim->ctrl_z_terminated && sim->payload_left == 0)
+  {
+    finish_publish(sim, now_us);
+  }
+}
+
+static void handle_command(bg95_sim_t* sim, const char* line, int64_t now_us)
+{
+  int64_t ready_us = now_us + rtt_us(sim);
+
+  sim->stats.commands++;
+  if (strncmp(line, "AT+QMTPUB=", 10) == 0 || strncmp(line, "AT+QMTPUBEX=", 12) == 0)
+  {
+    start_publish(sim, line, now_us);
+    return;
+  }
+  if (bridged(sim) && bridge_command(sim, line, ready_us))
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < sizeof(canned) / sizeof(canned[0]); i++)
+  {
+    if (strncmp(line, canned[i].prefix, strlen(canned[i].prefix)) == 0)
+    {
+      queue_output(sim, ready_us, canned[i].response);
+      if (canned[i].urc != NULL)
+      {
+        char urc[SIM_URC_MAX_LEN];
+        snprintf(urc, sizeof(urc), canned[i].urc, command_int(line, 0), command_int(line, 1));
+        queue_output(sim, ready_us + (int64_t) sim->config.urc_delay_ms * 1000, urc);
+      }
+      return;
+    }
+  }
+  queue_output(sim, ready_us, "\r\nOK\r\n");
+}
+
+static void payload_byte(bg95_sim_t* sim, char c, int64_t arrived_us)
+{
+  if (sim->ctrl_z_terminated && c == CTRL_Z)
+  {
+    finish_publish(sim, arrived_us);
+    return;
+  }
+
+  sim->stats.payload_bytes++;
+  if (bridged(sim) && sim->payload_len < BG95_SIM_PAYLOAD_MAX_LEN)
+  {
+    sim->payload[sim->payload_len++] = c;
+  }
+  if (!sim->ctrl_z_terminated && --sim->payload_left == 0)
+  {
+    finish_publish(sim, arrived_us);
+  }
+}
+
+static esp_err_t sim_write(const char* data, size_t len, void* context)
+{
+  bg95_sim_t* sim = (bg95_sim_t*) context;
+
+  xSemaphoreTake(sim->lock, portMAX_DELAY);
+  int64_t now_us = esp_timer_get_time();
+  sim->stats.bytes_to_modem += len;
+  sim->stats.wire_busy_us += wire_us(sim, len);
+
+  for (size_t i = 0; i < len; i++)
+  {
+    // Byte i has fully arrived at the modem after i + 1 byte times
+    int64_t arrived_us = now_us + wire_us(sim, i + 1);
+    char    c          = data[i];
+    bool    after_cr   = sim->after_cr;
+
+    sim->after_cr = false;
+    if (c == '\n' && after_cr)
+    {
+      continue;
+    }
+    if (sim->in_payload)
+    {
+      payload_byte(sim, c, arrived_us);
+      continue;
+    }
+
+    if (c == '\r' || c == '\n')
+    {
+      sim->after_cr = c == '\r';
+      if (sim->line_len > 0)
+      {
+        sim->line[sim->line_len] = '\0';
+        handle_command(sim, sim->line, arrived_us);
+        sim->line_len = 0;
+      }
+    }
+    else if (sim->line_len < BG95_SIM_LINE_MAX_LEN - 1)
+    {
+      sim->line[sim->line_len++] = c;
+    }
+  }
+  xSemaphoreGive(sim->lock);
+  return ESP_OK;
+}
+
+// Sleep with sim->lock released until 'wait_ms' passed or, when bridged, the broker sent data
+static void sim_wait(bg95_sim_t* sim, uint32_t wait_ms)
+{
+  int sock = sim->sock;
+
+  xSemaphoreGive(sim->lock);
+  if (sock >= 0)
+  {
+    fd_set         readable;
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = (long) wait_ms * 1000};
+    FD_ZERO(&readable);
+    FD_SET(sock, &readable);
+    select(sock + 1, &readable, NULL, NULL, &timeout);
+  }
+  else
+  {
+    TickType_t ticks = pdMS_TO_TICKS(wait_ms);
+    vTaskDelay(ticks > 0 ? ticks : 1);
+  }
+  xSemaphoreTake(sim->lock, portMAX_DELAY);
+}
+
+static esp_err_t sim_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  bg95_sim_t* sim         = (bg95_sim_t*) context;
+  int64_t     deadline_us = esp_timer_get_time() + (int64_t) timeout_ms * 1000;
+
+  *bytes_read = 0;
+  xSemaphoreTake(sim->lock, portMAX_DELAY);
+  for (;;)
+  {
+    bridge_poll(sim);
+
+    int64_t now_us = esp_timer_get_time();
+    if (sim->num_events > 0 && sim->events[0].due_us <= now_us)
+    {
+      bg95_sim_event_t* event = &sim->events[0];
+      size_t            n     = event->len - event->pos;
+      n                       = n < max_len ? n : max_len;
+      memcpy(data, event->data + event->pos, n);
+      event->pos += n;
+      *bytes_read = n;
+      if (event->pos == event->len)
+      {
+        sim->num_events--;
+        memmove(&sim->events[0], &sim->events[1], sim->num_events * sizeof(sim->events[0]));
+      }
+      xSemaphoreGive(sim->lock);
+      return ESP_OK;
+    }
+    if (now_us >= deadline_us)
+    {
+      xSemaphoreGive(sim->lock);
+      return ESP_ERR_TIMEOUT;
+    }
+
+    int64_t wait_us = deadline_us - now_us;
+    if (sim->num_events > 0 && sim->events[0].due_us - now_us < wait_us)
+    {
+      wait_us = sim->events[0].due_us - now_us;
+    }
+    uint32_t wait_ms = (uint32_t) ((wait_us + 999) / 1000);
+    sim_wait(sim, wait_ms < SIM_MAX_SLEEP_MS ? wait_ms : SIM_MAX_SLEEP_MS);
+  }
+}
+
+esp_err_t bg95_sim_init(bg95_sim_t* sim, const bg95_sim_config_t* config)
+{
+  if (sim == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(sim, 0, sizeof(*sim));
+  if (config != NULL)
+  {
+    sim->config = *config;
+  }
+  else
+  {
+    bg95_sim_config_t defaults = BG95_SIM_DEFAULT_CONFIG();
+    sim->config                = defaults;
+  }
+
+  sim->lock = xSemaphoreCreateMutex();
+  if (sim->lock == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+
+  sim->sock           = -1;
+  sim->uart.write     = sim_write;
+  sim->uart.read      = sim_read;
+  sim->uart.context   = sim;
+  sim->stats.since_us = esp_timer_get_time();
+  return ESP_OK;
+}
+
+void bg95_sim_deinit(bg95_sim_t* sim)
+{
+  if (sim == NULL)
+  {
+    return;
+  }
+  if (sim->lock != NULL)
+  {
+    bridge_close(sim);
+    vSemaphoreDelete(sim->lock);
+  }
+  memset(sim, 0, sizeof(*sim));
+  sim->sock = -1;
+}
+
+void bg95_sim_reset_stats(bg95_sim_t* sim)
+{
+  if (sim == NULL)
+  {
+    return;
+  }
+  xSemaphoreTake(sim->lock, portMAX_DELAY);
+  memset(&sim->stats, 0, sizeof(sim->stats));
+  sim->stats.since_us = esp_timer_get_time();
+  xSemaphoreGive(sim->lock);
+}
+
+void bg95_sim_drop_link(bg95_sim_t* sim)
+{
+  if (sim == NULL || sim->lock == NULL)
+  {
+    return;
+  }
+  xSemaphoreTake(sim->lock, portMAX_DELAY);
+  if (sim->sock >= 0)
+  {
+    bridge_lost(sim);
+  }
+  xSemaphoreGive(sim->lock);
+}
+
+float bg95_sim_uart_utilization(const bg95_sim_t* sim)
+{
+  if (sim == NULL)
+  {
+    return 0.0f;
+  }
+  int64_t elapsed_us = esp_timer_get_time() - sim->stats.since_us;
+  if (elapsed_us <= 0)
+  {
+    return 0.0f;
+  }
+  // Full duplex: both directions together can be busy for twice the elapsed time
+  return (float) sim->stats.wire_busy_us / (float) (2 * elapsed_us);
+}
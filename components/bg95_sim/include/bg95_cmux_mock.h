@@ -0,0 +1,55 @@
+#ifndef BG95_CMUX_MOCK_H
+#define BG95_CMUX_MOCK_H
+
+#include "bg95_cmux.h"
+#include "bg95_uart_interface.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Modem side of a CMUX link for host tests.
+// 'uart' is the physical interface handed to bg95_cmux_init(). It answers AT+CMUX, then
+// decodes frames, acknowledges SABM/DISC/CLD and routes every DLCI's UIH payload to a plain
+// backend interface (usually a mock_uart). Backend responses are framed back as UIH.
+// Set 'refuse_control' to answer the DLCI 0 SABM with DM.
+// Each frame's payload is forwarded as one backend write, so commands must fit in N1 bytes.
+
+#define BG95_CMUX_MOCK_OUT_SIZE 2048
+#define BG95_CMUX_MOCK_BACKEND_CHUNK 512
+
+typedef struct
+{
+  bg95_uart_interface_t  uart;
+  bg95_uart_interface_t* backends[BG95_CMUX_MAX_DLCI + 1]; // [0] unused
+  bool                   dlci_open[BG95_CMUX_MAX_DLCI + 1];
+  bool                   muxing;
+  bool                   refuse_control;
+  uint8_t                last_ctrl_msg; // Type of the last DLCI 0 message the host sent
+
+  SemaphoreHandle_t   lock;
+  bg95_cmux_decoder_t decoder;
+  uint8_t             out[BG95_CMUX_MOCK_OUT_SIZE];
+  size_t              out_len;
+  uint32_t            frames_rx;
+  uint32_t            overflows;
+} bg95_cmux_mock_t;
+
+esp_err_t bg95_cmux_mock_init(bg95_cmux_mock_t* mock);
+void      bg95_cmux_mock_deinit(bg95_cmux_mock_t* mock);
+
+// Route DLCI 'dlci' to 'backend'. A SABM for a DLCI without backend is refused with DM.
+esp_err_t bg95_cmux_mock_attach(bg95_cmux_mock_t*      mock,
+                                uint8_t                dlci,
+                                bg95_uart_interface_t* backend);
+
+// Queue a DLCI 0 control message from the modem, e.g. an MSC
+esp_err_t bg95_cmux_mock_send_control(bg95_cmux_mock_t* mock,
+                                      uint8_t           type,
+                                      const uint8_t*    value,
+                                      size_t            len);
+
+#endif /* BG95_CMUX_MOCK_H */
@@ -0,0 +1,95 @@
+#ifndef BG95_MQTT_WIRE_H
+#define BG95_MQTT_WIRE_H
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal MQTT 3.1.1 packet codec, just what the simulator's broker bridge needs to stand in
+// for the modem's MQTT stack: CONNECT, PUBLISH with all three QoS flows, SUBSCRIBE and
+// UNSUBSCRIBE with a single topic, PINGREQ and DISCONNECT.
+//
+// Encoders write into a caller buffer and return the packet length, 0 when it does not fit.
+
+#define BG95_MQTT_WIRE_MAX_HEADER_LEN 5 // Fixed header: type byte + up to 4 length bytes
+
+typedef enum
+{
+  BG95_MQTT_CONNECT     = 1,
+  BG95_MQTT_CONNACK     = 2,
+  BG95_MQTT_PUBLISH     = 3,
+  BG95_MQTT_PUBACK      = 4,
+  BG95_MQTT_PUBREC      = 5,
+  BG95_MQTT_PUBREL      = 6,
+  BG95_MQTT_PUBCOMP     = 7,
+  BG95_MQTT_SUBSCRIBE   = 8,
+  BG95_MQTT_SUBACK      = 9,
+  BG95_MQTT_UNSUBSCRIBE = 10,
+  BG95_MQTT_UNSUBACK    = 11,
+  BG95_MQTT_PINGREQ     = 12,
+  BG95_MQTT_PINGRESP    = 13,
+  BG95_MQTT_DISCONNECT  = 14,
+} bg95_mqtt_packet_type_t;
+
+typedef struct
+{
+  bg95_mqtt_packet_type_t type;
+  uint8_t                 flags;      // Low nibble of the first byte
+  size_t                  header_len; // Fixed header length
+  size_t                  body_len;   // Remaining length
+} bg95_mqtt_wire_header_t;
+
+typedef struct
+{
+  const char*    topic; // Not NUL terminated
+  size_t         topic_len;
+  const uint8_t* payload;
+  size_t         payload_len;
+  int            qos;
+  bool           retain;
+  uint16_t       packet_id; // 0 for QoS 0
+} bg95_mqtt_wire_publish_t;
+
+// 'username' and 'password' may be NULL
+size_t bg95_mqtt_wire_connect(uint8_t*    buf,
+                              size_t      size,
+                              const char* client_id,
+                              const char* username,
+                              const char* password,
+                              uint16_t    keepalive_s);
+
+// Everything of a PUBLISH up to the payload, which the caller sends right after
+size_t bg95_mqtt_wire_publish_header(uint8_t*    buf,
+                                     size_t      size,
+                                     const char* topic,
+                                     int         qos,
+                                     bool        retain,
+                                     uint16_t    packet_id,
+                                     size_t      payload_len);
+
+// PUBACK, PUBREC, PUBREL or PUBCOMP
+size_t bg95_mqtt_wire_ack(uint8_t* buf, size_t size, bg95_mqtt_packet_type_t type, uint16_t id);
+
+size_t bg95_mqtt_wire_subscribe(
+    uint8_t* buf, size_t size, uint16_t packet_id, const char* topic, int qos);
+size_t bg95_mqtt_wire_unsubscribe(uint8_t* buf, size_t size, uint16_t packet_id, const char* topic);
+
+// Packets without variable header, PINGREQ and DISCONNECT
+size_t bg95_mqtt_wire_empty(uint8_t* buf, size_t size, bg95_mqtt_packet_type_t type);
+
+// ESP_ERR_INVALID_SIZE while the fixed header is incomplete, ESP_ERR_INVALID_RESPONSE when
+// the remaining length is malformed
+esp_err_t bg95_mqtt_wire_parse_header(const uint8_t*           buf,
+                                      size_t                   len,
+                                      bg95_mqtt_wire_header_t* header);
+
+// 'body' holds header->body_len bytes. Topic and payload point into it.
+esp_err_t bg95_mqtt_wire_parse_publish(const bg95_mqtt_wire_header_t* header,
+                                       const uint8_t*                 body,
+                                       bg95_mqtt_wire_publish_t*      publish);
+
+// Packet identifier leading the body of acks, SUBACK and UNSUBACK
+uint16_t bg95_mqtt_wire_packet_id(const uint8_t* body);
+
+#endif /* BG95_MQTT_WIRE_H */
@@ -0,0 +1,126 @@
+#ifndef BG95_SIM_H
+#define BG95_SIM_H
+
+#include "bg95_uart_interface.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Simulated BG95 behind a bg95_uart_interface_t, for hardware-free benchmarks.
+// Unlike the mock UART it follows the modem's timing: every response becomes readable only
+// after the configured round trip, MQTT publish results arrive as +QMTPUB URCs after
+// 'urc_delay_ms', and each byte occupies the wire for 10 bit times at 'baud'.
+//
+// Understood commands:
+//   AT+QMTPUB / AT+QMTPUBEX with a length: "> " prompt, <length> payload bytes, OK, then
+//                                          +QMTPUB: <idx>,<msgid>,0
+//   AT+QMTPUB without a length:            same, payload terminated by Ctrl-Z
+//   AT+QMTOPEN=, AT+QMTCONN=:              OK, then the success result URC
+//   AT+CPIN?, AT+CSQ, AT+QMTCONN?, ...:    canned connected-modem answers
+// Anything else is answered with OK, so driver init sequences run unchanged.
+//
+// With 'broker_host' set, the MQTT commands are bridged to a real broker over TCP instead
+// (e.g. a mosquitto started next to a Linux build): QMTOPEN connects to the broker whatever
+// host the command names, QMTCONN/QMTPUB/QMTSUB/QMTUNS/QMTDISC go out as MQTT 3.1.1 packets,
+// and their result URCs are raised when the broker answers. Messages the broker delivers come
+// back as "+QMTRECV: <idx>,<msgid>,"<topic>","<payload>"". One MQTT client is bridged at a time.
+//
+// Responses are queued with their due time and handed out by read(), so no task is needed.
+// read() also polls the broker connection.
+
+#define BG95_SIM_MAX_EVENTS 64
+#define BG95_SIM_EVENT_MAX_LEN 96
+#define BG95_SIM_LINE_MAX_LEN 256
+#define BG95_SIM_TOPIC_MAX_LEN 128
+#define BG95_SIM_PAYLOAD_MAX_LEN 4096                           // QMTPUB_MSG_MAX_LEN
+#define BG95_SIM_BRIDGE_RX_LEN (BG95_SIM_PAYLOAD_MAX_LEN + 256) // Largest broker packet
+
+typedef struct
+{
+  uint32_t rtt_ms;       // Command written to first response byte readable
+  uint32_t urc_delay_ms; // Publish OK to +QMTPUB result URC (broker ack)
+  uint32_t baud;         // Wire time model, 0 means infinitely fast
+
+  const char* broker_host; // MQTT broker to bridge to, NULL for canned answers
+  uint16_t    broker_port;
+} bg95_sim_config_t;
+
+#define BG95_SIM_DEFAULT_CONFIG()                                                                  \
+  {                                                                                                \
+    .rtt_ms = 40, .urc_delay_ms = 120, .baud = 115200, .broker_host = NULL, .broker_port = 1883,   \
+  }
+
+typedef struct
+{
+  uint32_t commands;
+  uint32_t publishes;
+  uint32_t payload_bytes;
+  uint32_t received; // +QMTRECV from the broker
+  uint32_t bytes_to_modem;
+  uint32_t bytes_from_modem;
+  uint64_t wire_busy_us; // Time the wire spent carrying bytes, both directions
+  int64_t  since_us;
+} bg95_sim_stats_t;
+
+typedef struct
+{
+  int64_t due_us;
+  size_t  len;
+  size_t  pos;
+  char    data[BG95_SIM_EVENT_MAX_LEN];
+} bg95_sim_event_t;
+
+typedef struct
+{
+  bg95_uart_interface_t uart; // Modem side, pass to bg95_init()
+  bg95_sim_config_t     config;
+  SemaphoreHandle_t     lock;
+
+  bg95_sim_event_t events[BG95_SIM_MAX_EVENTS]; // Pending output, ordered by due time
+  size_t           num_events;
+
+  // Command parser
+  char   line[BG95_SIM_LINE_MAX_LEN];
+  size_t line_len;
+  bool   after_cr; // An LF right after the command's CR is part of its terminator
+
+  // Publish payload in flight
+  bool   in_payload;
+  bool   ctrl_z_terminated;
+  size_t payload_left;
+  int    pub_client_idx;
+  int    pub_msgid;
+  int    pub_qos;
+  bool   pub_retain;
+  char   pub_topic[BG95_SIM_TOPIC_MAX_LEN];
+  char   payload[BG95_SIM_PAYLOAD_MAX_LEN]; // Kept only when bridged
+  size_t payload_len;
+
+  // Broker bridge
+  int     sock; // -1 while not connected to the broker
+  int     bridge_client_idx;
+  bool    mqtt_connected;
+  int64_t urc_not_before_us; // Broker results never overtake the OK of their command
+  uint8_t rx[BG95_SIM_BRIDGE_RX_LEN];
+  size_t  rx_len;
+
+  bg95_sim_stats_t stats;
+} bg95_sim_t;
+
+esp_err_t bg95_sim_init(bg95_sim_t* sim, const bg95_sim_config_t* config);
+void      bg95_sim_deinit(bg95_sim_t* sim);
+
+void bg95_sim_reset_stats(bg95_sim_t* sim);
+
+// Lose the broker connection as a cell handover or NAT timeout would: the socket is closed and
+// +QMTSTAT: <idx>,1 reported, the client has to QMTOPEN again. No-op unless bridged and open.
+void bg95_sim_drop_link(bg95_sim_t* sim);
+
+// Share of the full duplex wire capacity used since the last stats reset, 0..1
+float bg95_sim_uart_utilization(const bg95_sim_t* sim);
+
+#endif /* BG95_SIM_H */
@@ -0,0 +1,202 @@
+#include "fleet_device.h"
+
+#include "freertos/task.h"
+
+#include <esp_log.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "FLEET_DEVICE";
+
+#define FLEET_CLIENT_IDX 0
+#define FLEET_TASK_STACK_SIZE (6144)
+#define FLEET_TASK_PRIORITY (5)
+
+static uint32_t elapsed_ms(int64_t since_us)
+{
+  return (uint32_t) ((esp_timer_get_time() - since_us) / 1000);
+}
+
+// QMTOPEN then QMTCONN through the driver, classified like the application does
+static bg95_reconnect_class_t connect_device(fleet_device_t* device)
+{
+  const fleet_profile_t*   profile = device->profile;
+  qmtopen_write_response_t open    = {0};
+  qmtconn_write_response_t conn    = {0};
+
+  // The simulator bridges every QMTOPEN to the profile's broker, the host name is cosmetic
+  esp_err_t err = bg95_mqtt_open_network(
+      &device->handle, FLEET_CLIENT_IDX, "broker", profile->modem.broker_port, &open);
+  bg95_reconnect_class_t failure = bg95_reconnect_classify_qmtopen(err, &open);
+  if (failure != BG95_RECONNECT_CLASS_NONE)
+  {
+    return failure;
+  }
+
+  err = bg95_mqtt_connect(&device->handle, FLEET_CLIENT_IDX, device->client_id, NULL, NULL, &conn);
+  return bg95_reconnect_classify_qmtconn(err, &conn);
+}
+
+// Drop whatever is left of the MQTT session so the next QMTOPEN starts clean
+static void reset_link(fleet_device_t* device)
+{
+  qmtdisc_write_response_t disc = {0};
+  bg95_mqtt_disconnect(&device->handle, FLEET_CLIENT_IDX, &disc);
+}
+
+static bool publish(fleet_device_t* device, const char* payload)
+{
+  const fleet_profile_t*  profile  = device->profile;
+  qmtpub_write_response_t response = {0};
+  int                     msgid    = profile->qos == QMTPUB_QOS_AT_MOST_ONCE ? 0 : 1;
+  int64_t                 start_us = esp_timer_get_time();
+
+  esp_err_t err = bg95_mqtt_publish_fixed_length(&device->handle,
+                                                 FLEET_CLIENT_IDX,
+                                                 msgid,
+                                                 profile->qos,
+                                                 QMTPUB_RETAIN_DISABLED,
+                                                 device->topic,
+                                                 payload,
+                                                 profile->payload_len,
+                                                 &response);
+  if (err != ESP_OK || !response.present.has_result || response.result != QMTPUB_RESULT_SUCCESS)
+  {
+    device->stats.publish_failures++;
+    return false;
+  }
+
+  uint32_t latency_us = (uint32_t) (esp_timer_get_time() - start_us);
+  device->stats.published++;
+  device->stats.latency_us_total += latency_us;
+  if (latency_us > device->stats.latency_us_max)
+  {
+    device->stats.latency_us_max = latency_us;
+  }
+  return true;
+}
+
+static void run_device(fleet_device_t* device, const char* payload)
+{
+  const fleet_profile_t* profile   = device->profile;
+  int64_t                end_us    = esp_timer_get_time() + (int64_t) profile->duration_ms * 1000;
+  bool                   connected = false;
+  bool                   was_up    = false;
+  int64_t                down_us   = 0;
+
+  while (esp_timer_get_time() < end_us)
+  {
+    if (!connected)
+    {
+      bg95_reconnect_class_t failure = connect_device(device);
+      if (failure != BG95_RECONNECT_CLASS_NONE)
+      {
+        device->stats.connect_failures++;
+        reset_link(device);
+        uint32_t delay_ms = bg95_reconnect_next_delay_ms(&device->reconnect, failure);
+        vTaskDelay(delay_ms > 0 ? pdMS_TO_TICKS(delay_ms) : 1);
+        continue;
+      }
+
+      bg95_reconnect_success(&device->reconnect);
+      connected = true;
+      device->stats.connects++;
+      if (was_up)
+      {
+        uint32_t outage_ms = elapsed_ms(down_us);
+        device->stats.reconnects++;
+        device->stats.reconnect_ms_total += outage_ms;
+        if (outage_ms > device->stats.reconnect_ms_max)
+        {
+          device->stats.reconnect_ms_max = outage_ms;
+        }
+      }
+      was_up = true;
+    }
+
+    if (profile->link_drop_per_mille > 0 && esp_random() % 1000 < profile->link_drop_per_mille)
+    {
+      bg95_sim_drop_link(&device->sim);
+      device->stats.link_drops++;
+    }
+
+    if (!publish(device, payload))
+    {
+      connected = false;
+      down_us   = esp_timer_get_time();
+      reset_link(device);
+      continue;
+    }
+    vTaskDelay(pdMS_TO_TICKS(profile->publish_interval_ms));
+  }
+
+  if (connected)
+  {
+    reset_link(device);
+  }
+}
+
+static void fleet_device_task(void* pvParameters)
+{
+  fleet_device_t* device  = (fleet_device_t*) pvParameters;
+  char*           payload = malloc(device->profile->payload_len + 1);
+
+  if (payload == NULL)
+  {
+    ESP_LOGE(TAG, "Device %d: no memory for the payload", device->id);
+  }
+  else if (bg95_sim_init(&device->sim, &device->profile->modem) != ESP_OK ||
+           bg95_init(&device->handle, &device->sim.uart) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Device %d: modem or driver init failed", device->id);
+  }
+  else
+  {
+    memset(payload, 'a' + device->id % 26, device->profile->payload_len);
+    payload[device->profile->payload_len] = '\0';
+    run_device(device, payload);
+  }
+
+  bg95_sim_deinit(&device->sim);
+  free(payload);
+  xSemaphoreGive(device->done);
+  vTaskDelete(NULL);
+}
+
+esp_err_t fleet_device_start(fleet_device_t*        device,
+                             int                    id,
+                             const fleet_profile_t* profile,
+                             SemaphoreHandle_t      done)
+{
+  if (device == NULL || profile == NULL || done == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(device, 0, sizeof(*device));
+  device->id      = id;
+  device->profile = profile;
+  device->done    = done;
+  snprintf(device->client_id, sizeof(device->client_id), "bg95-fleet-%05d", id);
+  snprintf(device->topic, sizeof(device->topic), "fleet/%05d/telemetry", id);
+
+  esp_err_t err = bg95_reconnect_init(&device->reconnect, NULL);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  if (xTaskCreate(fleet_device_task,
+                  "fleet_device",
+                  FLEET_TASK_STACK_SIZE,
+                  device,
+                  FLEET_TASK_PRIORITY,
+                  NULL) != pdPASS)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
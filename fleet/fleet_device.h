@@ -0,0 +1,65 @@
+#ifndef FLEET_DEVICE_H
+#define FLEET_DEVICE_H
+
+#include "bg95_driver.h"
+#include "bg95_reconnect.h"
+#include "bg95_sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <esp_err.h>
+#include <stdint.h>
+
+// One simulated device of the fleet load generator: its own simulated modem bridged to the
+// broker, its own driver handle and reconnect scheduler, and a task running the application's
+// connect-then-publish loop. Nothing is shared between devices, so any number of them can run
+// side by side in one host process.
+
+typedef struct
+{
+  uint32_t     duration_ms;         // Publishing time per device, ramp-up not included
+  uint32_t     ramp_ms;             // Device starts are spread evenly over this window
+  uint32_t     publish_interval_ms; // Pause after each publish
+  size_t       payload_len;
+  qmtpub_qos_t qos;
+  uint16_t     link_drop_per_mille; // Chance per publish that the device loses its broker link
+
+  bg95_sim_config_t modem; // Timing of every device's modem and the broker to bridge to
+} fleet_profile_t;
+
+typedef struct
+{
+  uint32_t published;
+  uint32_t publish_failures;
+  uint32_t connects;
+  uint32_t connect_failures; // QMTOPEN or QMTCONN attempts that did not get through
+  uint32_t link_drops;       // Injected through link_drop_per_mille
+  uint32_t reconnects;       // Connects after having been connected
+  uint32_t reconnect_ms_total;
+  uint32_t reconnect_ms_max; // Longest time from losing the link to being connected again
+  uint64_t latency_us_total;
+  uint32_t latency_us_max;
+} fleet_device_stats_t;
+
+typedef struct
+{
+  int                    id;
+  const fleet_profile_t* profile;
+  char                   client_id[24];
+  char                   topic[48];
+
+  bg95_sim_t       sim;
+  bg95_handle_t    handle;
+  bg95_reconnect_t reconnect;
+
+  fleet_device_stats_t stats;
+  SemaphoreHandle_t    done; // Given once when the device task finished
+} fleet_device_t;
+
+// Start device 'id' in its own task. 'profile' must outlive the device.
+esp_err_t fleet_device_start(fleet_device_t*        device,
+                             int                    id,
+                             const fleet_profile_t* profile,
+                             SemaphoreHandle_t      done);
+
+#endif /* FLEET_DEVICE_H */
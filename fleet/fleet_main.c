@@ -0,0 +1,128 @@
+#include "esp_log.h"
+#include "fleet_device.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* TAG = "Fleet";
+
+// Fleet load generator: FLEET_DEVICES simulated devices, each with its own simulated modem
+// bridged to the broker below, publishing through the real driver. Meant for the linux target
+// (run_fleet.sh) next to a local broker, e.g. 'mosquitto -p 1883'.
+//
+// Aggregates are printed one per line:
+//   FLEET_METRIC,<name>,<value>,<unit>
+
+#define FLEET_DEVICES 200
+#define FLEET_BROKER_HOST "127.0.0.1"
+#define FLEET_BROKER_PORT 1883
+
+static const fleet_profile_t profile = {
+    .duration_ms         = 60000,
+    .ramp_ms             = 10000,
+    .publish_interval_ms = 1000,
+    .payload_len         = 256,
+    .qos                 = QMTPUB_QOS_AT_LEAST_ONCE,
+    .link_drop_per_mille = 5,
+    .modem =
+        {
+            .rtt_ms       = 40,
+            .urc_delay_ms = 0, // Acks come from the broker
+            .baud         = 115200,
+            .broker_host  = FLEET_BROKER_HOST,
+            .broker_port  = FLEET_BROKER_PORT,
+        },
+};
+
+static void print_metric(const char* name, double value, const char* unit)
+{
+  printf("FLEET_METRIC,%s,%.3f,%s\n", name, value, unit);
+}
+
+static void print_report(const fleet_device_t* devices, size_t count, uint32_t elapsed_ms)
+{
+  fleet_device_stats_t total = {0};
+  uint32_t             idle  = 0; // Devices that never connected
+
+  for (size_t i = 0; i < count; i++)
+  {
+    const fleet_device_stats_t* s = &devices[i].stats;
+    total.published += s->published;
+    total.publish_failures += s->publish_failures;
+    total.connects += s->connects;
+    total.connect_failures += s->connect_failures;
+    total.link_drops += s->link_drops;
+    total.reconnects += s->reconnects;
+    total.reconnect_ms_total += s->reconnect_ms_total;
+    total.latency_us_total += s->latency_us_total;
+    total.reconnect_ms_max =
+        s->reconnect_ms_max > total.reconnect_ms_max ? s->reconnect_ms_max : total.reconnect_ms_max;
+    total.latency_us_max =
+        s->latency_us_max > total.latency_us_max ? s->latency_us_max : total.latency_us_max;
+    idle += s->connects == 0 ? 1 : 0;
+  }
+
+  print_metric("devices", (double) count, "devices");
+  print_metric("devices_never_connected", idle, "devices");
+  print_metric("elapsed", elapsed_ms, "ms");
+  print_metric("published", total.published, "msgs");
+  print_metric("throughput", total.published * 1000.0 / (elapsed_ms ? elapsed_ms : 1), "msg/s");
+  print_metric("publish_failures", total.publish_failures, "msgs");
+  print_metric("publish_latency_avg",
+               total.published ? (double) total.latency_us_total / total.published / 1000.0 : 0,
+               "ms");
+  print_metric("publish_latency_max", total.latency_us_max / 1000.0, "ms");
+  print_metric("connects", total.connects, "connects");
+  print_metric("connect_failures", total.connect_failures, "attempts");
+  print_metric("link_drops", total.link_drops, "drops");
+  print_metric("reconnects", total.reconnects, "reconnects");
+  print_metric("reconnect_time_avg",
+               total.reconnects ? (double) total.reconnect_ms_total / total.reconnects : 0,
+               "ms");
+  print_metric("reconnect_time_max", total.reconnect_ms_max, "ms");
+}
+
+void app_main(void)
+{
+  fleet_device_t*   devices = calloc(FLEET_DEVICES, sizeof(fleet_device_t));
+  SemaphoreHandle_t done    = xSemaphoreCreateCounting(FLEET_DEVICES, 0);
+  size_t            started = 0;
+
+  if (devices == NULL || done == NULL)
+  {
+    ESP_LOGE(TAG, "Failed to allocate %d devices", FLEET_DEVICES);
+    return;
+  }
+
+  printf("\n======== FLEET: %d DEVICES -> %s:%d ========\n",
+         FLEET_DEVICES,
+         FLEET_BROKER_HOST,
+         FLEET_BROKER_PORT);
+  int64_t start_us = esp_timer_get_time();
+
+  // Spread the starts like devices powering up over a window, not all in the same tick
+  for (int i = 0; i < FLEET_DEVICES; i++)
+  {
+    if (fleet_device_start(&devices[i], i, &profile, done) != ESP_OK)
+    {
+      ESP_LOGE(TAG, "Failed to start device %d", i);
+      break;
+    }
+    started++;
+    vTaskDelay(pdMS_TO_TICKS(profile.ramp_ms / FLEET_DEVICES));
+  }
+
+  for (size_t i = 0; i < started; i++)
+  {
+    xSemaphoreTake(done, portMAX_DELAY);
+  }
+
+  print_report(devices, started, (uint32_t) ((esp_timer_get_time() - start_us) / 1000));
+  printf("\n======== FLEET COMPLETED ========\n");
+  vSemaphoreDelete(done);
+  free(devices);
+}
@@ -1,29 +1,107 @@
 #include "at_cmd_cgpaddr.h"
 #include "at_cmd_cops.h"
+#include "at_cmd_cpin.h"
+#include "at_cmd_csq.h"
 #include "at_cmd_qmtcfg.h"
 #include "at_cmd_qmtclose.h"
 #include "at_cmd_qmtconn.h"
 #include "at_cmd_qmtdisc.h"
 #include "at_cmd_qmtopen.h"
 #include "at_cmd_qmtpub.h"
+#include "bg95_baud.h"
+#include "bg95_boot.h"
+#include "bg95_caps.h"
+#include "bg95_cmux.h"
+#include "bg95_config.h"
 #include "bg95_driver.h"
+#include "bg95_flow.h"
+#include "bg95_net_reg.h"
+#include "bg95_query_cache.h"
+#include "bg95_raw_at.h"
+#include "bg95_reconnect.h"
+#include "bg95_rtt_estimator.h"
+#include "bg95_sched.h"
+#include "bg95_single_flight.h"
+#include "bg95_status.h"
+#include "bg95_task.h"
+#include "bg95_uart_hw.h"
+#include "bg95_urc_tap.h"
+#include "driver/uart.h"
 #include "freertos/projdefs.h"
 
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <nvs_flash.h>
 #include <stdio.h>
 #include <stdlib.h> // For rand()
 #include <string.h>
 
 static const char* TAG = "Main";
 
-// static global references to UART and BG95 handles used as Singletons
-static bg95_uart_interface_t uart   = {0};
-static bg95_handle_t         handle = {0};
+// static global references to UART and BG95 handles used as Singletons. The UART is installed
+// here instead of through bg95_uart_interface_init_hw() so its event queue reaches uart_flow.
+static bg95_uart_hw_t uart_hw = {0};
+static bg95_handle_t  handle  = {0};
+
+// Meters the physical UART and moves it to the fastest rate the line carries
+static bg95_baud_t baud_link = {0};
+
+// RTS/CTS state and UART error counters, fed from the UART event queue
+static bg95_flow_t uart_flow = {0};
+
+// CMUX splits the UART into a driver channel and a query channel, so status reads do not
+// queue behind a long QMTPUB. Falls back to the plain UART when the modem refuses AT+CMUX.
+static bg95_cmux_t            cmux       = {0};
+static bg95_uart_interface_t* query_uart = NULL;
+
+// Query channel with its own result code format, numeric when USE_NUMERIC_QUERY_RESULTS is set
+static bg95_raw_at_link_t query_link = {0};
+
+// URC tap sits between the driver and the physical UART so registration URCs reach net_reg
+static bg95_urc_tap_t urc_tap = {0};
+static bg95_net_reg_t net_reg = {0};
+
+// Orders every transaction on the driver channel: state queries and QMTDISC ahead of publishes
+// and bring-up commands, large publishes last. The boot sequence takes its turns here too.
+static bg95_sched_t modem_sched = {0};
+
+// State queries on the driver channel: concurrent reads share one round trip, QMTOPEN?/QMTCONN?
+// and CPIN? answers are reused until a URC or one of our own writes makes them stale
+static bg95_single_flight_t query_sf    = {0};
+static bg95_query_cache_t   query_cache = {0};
+
+// Round trips learned per signal condition: the state queries above time out on what the modem
+// actually takes, publishes through the driver only feed their samples in
+static bg95_rtt_estimator_t modem_rtt = {0};
+
+// Paces retries after failed network/MQTT bring-up steps
+static bg95_reconnect_t reconnect = {0};
+
+// Per-phase time-to-first-publish breakdown
+static bg95_boot_timing_t boot_timing = {0};
+
+// Desired modem configuration, built from the code and applied as a diff at boot. NVS keeps the
+// last one applied successfully, so a warm reset with an unchanged config skips the read back.
+static bg95_config_t modem_config         = {0};
+static bool          modem_config_applied = false;
+
+// Test command ranges, probed once per modem firmware and cached in NVS
+static bg95_caps_t modem_caps = {0};
 
 #define UART_TX_GPIO 32
 #define UART_RX_GPIO 33
 #define UART_PORT_NUM 2
+#define UART_RTS_GPIO 25
+#define UART_CTS_GPIO 26
+#define UART_RX_FLOW_THRESH 100 // RX FIFO level that deasserts RTS
+#define USE_HW_FLOW_CTRL 1
+#define UART_TARGET_BAUD BG95_BAUD_MAX
+#define USE_CMUX 1
+#define CMUX_DRIVER_DLCI 1
+#define CMUX_QUERY_DLCI 2
+#define USE_NUMERIC_QUERY_RESULTS 1 // ATV0 on the status channel, the driver channel stays verbose
 
 // MQTT Configuration Parameters
 #define MQTT_CLIENT_IDX 0 // Use client index 0
@@ -36,13 +114,15 @@ static bg95_handle_t         handle = {0};
 #define MQTT_PUBLISH_QOS QMTPUB_QOS_AT_LEAST_ONCE
 #define MQTT_PUBLISH_RETAIN QMTPUB_RETAIN_DISABLED
 #define MQTT_PUBLISH_MSGID 1 // Message ID (used for QoS > 0)
+#define MQTT_KEEPALIVE_S 120
+#define MQTT_RESULT_TIMEOUT_MS 2000 // Longest wait for the +QMTOPEN/+QMTCONN/+QMTSUB result URC
 
 static void config_and_init_uart(void)
 {
-  bg95_uart_config_t uart_config = {
-      .tx_gpio_num = UART_TX_GPIO, .rx_gpio_num = UART_RX_GPIO, .port_num = UART_PORT_NUM};
+  const bg95_uart_hw_config_t uart_config = {
+      .port_num = UART_PORT_NUM, .tx_gpio_num = UART_TX_GPIO, .rx_gpio_num = UART_RX_GPIO};
 
-  esp_err_t err = bg95_uart_interface_init_hw(&uart, uart_config);
+  esp_err_t err = bg95_uart_hw_init(&uart_hw, &uart_config);
 
   if (err != ESP_OK)
   {
@@ -50,23 +130,406 @@ static void config_and_init_uart(void)
     return;
   }
 
-  if (!uart.write || !uart.read)
+  // Count overrun and framing errors from the start, whether or not RTS/CTS comes up. The
+  // watcher also passes data and line events on, so UART reads wake per line instead of polling.
+  err = bg95_flow_init(&uart_flow);
+  if (err == ESP_OK)
+  {
+    err = bg95_flow_set_event_fn(&uart_flow, bg95_uart_hw_on_event, &uart_hw);
+  }
+  if (err == ESP_OK)
+  {
+    err = bg95_flow_watch_events(&uart_flow, uart_hw.event_queue);
+  }
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "UART events not watched, reads fall back to polling: %s", esp_err_to_name(err));
+  }
+}
+
+static esp_err_t set_uart_baud(uint32_t baud, void* ctx)
+{
+  return uart_set_baudrate(UART_PORT_NUM, baud);
+}
+
+static esp_err_t set_uart_flow(bool enable, void* ctx)
+{
+  if (enable)
   {
-    ESP_LOGE(TAG, "UART functions not properly initialized");
+    esp_err_t err = uart_set_pin(
+        UART_PORT_NUM, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_RTS_GPIO, UART_CTS_GPIO);
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+  }
+  return uart_set_hw_flow_ctrl(UART_PORT_NUM,
+                               enable ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE,
+                               UART_RX_FLOW_THRESH);
+}
+
+static void init_baud_link(void)
+{
+  esp_err_t err = bg95_baud_init(&baud_link, &uart_hw.uart, BG95_BAUD_DEFAULT, set_uart_baud, NULL);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to init baud link: %s", esp_err_to_name(err));
+    return;
+  }
+
+  err = bg95_baud_sync(&baud_link);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Modem not answering on UART: %s", esp_err_to_name(err));
     return;
   }
+
+  // Flow control first, so the faster rate does not overrun the RX FIFO
+  if (USE_HW_FLOW_CTRL)
+  {
+    bg95_flow_enable(&uart_flow, &baud_link.uart, set_uart_flow, NULL);
+  }
+
+  err = bg95_baud_negotiate(&baud_link, UART_TARGET_BAUD);
+  if (err != ESP_OK && err != ESP_ERR_NOT_SUPPORTED)
+  {
+    ESP_LOGW(TAG, "Baud negotiation failed: %s", esp_err_to_name(err));
+  }
+}
+
+// Returns the interface the driver should sit on, the physical UART if CMUX is unavailable.
+// NULL when the modem is stuck in mux mode and answers neither, only a power cycle helps then.
+static bg95_uart_interface_t* init_cmux(void)
+{
+  bg95_uart_interface_t* driver_uart = NULL;
+
+  if (!USE_CMUX)
+  {
+    return &baud_link.uart;
+  }
+  esp_err_t err = bg95_cmux_init(&cmux, &baud_link.uart, baud_link.stats.baud);
+  if (err != ESP_OK)
+  {
+    return err == ESP_ERR_INVALID_STATE ? NULL : &baud_link.uart;
+  }
+  if (bg95_cmux_open_channel(&cmux, CMUX_DRIVER_DLCI, &driver_uart) != ESP_OK)
+  {
+    ESP_LOGW(TAG, "CMUX channel setup failed, using the plain UART");
+    return bg95_cmux_deinit(&cmux) == ESP_OK ? &baud_link.uart : NULL;
+  }
+  if (bg95_cmux_open_channel(&cmux, CMUX_QUERY_DLCI, &query_uart) != ESP_OK)
+  {
+    query_uart = NULL; // Status reads share the driver channel
+  }
+  else if (bg95_raw_at_link_init(&query_link, query_uart) == ESP_OK)
+  {
+    query_uart = &query_link.uart;
+    if (USE_NUMERIC_QUERY_RESULTS)
+    {
+      bg95_raw_at_set_numeric(&query_link, true); // Stays verbose on failure
+    }
+  }
+  return driver_uart;
 }
 
 static void init_bg95(void)
 {
   ESP_LOGI(TAG, "Initializing BG95 driver");
-  esp_err_t err = bg95_init(&handle, &uart);
+  bg95_uart_interface_t* link = init_cmux();
+  if (link == NULL)
+  {
+    ESP_LOGE(TAG, "Modem left in CMUX mode and not answering, it needs a power cycle");
+    return;
+  }
+  esp_err_t err = bg95_urc_tap_init(&urc_tap, link);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to init URC tap: %s", esp_err_to_name(err));
+    return;
+  }
+  if (query_uart == NULL)
+  {
+    query_uart = &urc_tap.uart;
+  }
+
+  err = bg95_init(&handle, &urc_tap.uart);
   if (err != ESP_OK)
   {
     ESP_LOGE(TAG, "Failed to init driver");
   }
 }
 
+static void init_modem_sched(void)
+{
+  esp_err_t err = bg95_sched_init(&modem_sched);
+  if (err != ESP_OK)
+  {
+    // Acquire and release do nothing on an uninitialised scheduler, the calls just run unordered
+    ESP_LOGE(TAG, "Failed to init modem scheduler: %s", esp_err_to_name(err));
+  }
+}
+
+// One scheduler turn around a transaction on the driver channel. MQTT commands keep the turn
+// until their result URC, the modem does not take the next one before.
+static void modem_begin(bg95_sched_lane_t lane)
+{
+  bg95_sched_acquire(&modem_sched, lane, BG95_SCHED_WAIT_FOREVER);
+}
+
+static void modem_end(void)
+{
+  bg95_sched_release(&modem_sched);
+}
+
+// The CMUX query channel has its own DLCI and does not wait for the driver's turn
+static bg95_sched_t* query_sched(void)
+{
+  return query_uart == &urc_tap.uart ? &modem_sched : NULL;
+}
+
+// The CMUX query channel has no URC tap reading it. URCs bg95_raw_at reads off it before a
+// command go to the handlers the tap feeds.
+static void handle_query_link_urc(const char* line, void* ctx)
+{
+  bg95_net_reg_handle_line(line, false, &net_reg);
+  bg95_query_cache_handle_urc(line, false, &query_cache);
+}
+
+static void init_query_cache(void)
+{
+  esp_err_t err = bg95_single_flight_init(&query_sf, &urc_tap.uart, &modem_sched);
+  if (err == ESP_OK)
+  {
+    err = bg95_query_cache_init(&query_cache, &query_sf, NULL);
+  }
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to init query cache: %s", esp_err_to_name(err));
+    return;
+  }
+
+  if (bg95_rtt_estimator_init(&modem_rtt, NULL) == ESP_OK)
+  {
+    bg95_single_flight_set_rtt_estimator(&query_sf, &modem_rtt);
+  }
+  else
+  {
+    ESP_LOGW(TAG, "No RTT estimator, state queries keep their static timeouts");
+  }
+
+  bg95_urc_tap_add_handler(&urc_tap, bg95_query_cache_handle_urc, &query_cache);
+  bg95_urc_tap_add_cmd_observer(&urc_tap, bg95_query_cache_handle_cmd, &query_cache);
+  if (query_uart == &query_link.uart)
+  {
+    bg95_raw_at_link_set_urc_handler(&query_link, handle_query_link_urc, NULL);
+  }
+}
+
+// The write observer drops the MQTT state when the command goes out, but its outcome arrives
+// later as a solicited line the URC rules skip. Drop it again once the operation finished.
+static void invalidate_mqtt_state(void)
+{
+  bg95_query_cache_invalidate(&query_cache, &AT_CMD_QMTOPEN);
+  bg95_query_cache_invalidate(&query_cache, &AT_CMD_QMTCONN);
+}
+
+static void init_net_reg(void)
+{
+  esp_err_t err = bg95_net_reg_init(&net_reg);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to init registration tracker: %s", esp_err_to_name(err));
+    return;
+  }
+
+  bg95_urc_tap_add_handler(&urc_tap, bg95_net_reg_handle_line, &net_reg);
+}
+
+static void init_nvs(void)
+{
+  esp_err_t err = nvs_flash_init();
+  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+  {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    err = nvs_flash_init();
+  }
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to init NVS: %s", esp_err_to_name(err));
+  }
+}
+
+static void build_default_modem_config(bg95_config_t* config)
+{
+  bg95_config_init(config);
+
+  qmtcfg_write_params_t version              = {.type = QMTCFG_TYPE_VERSION};
+  version.params.version.client_idx          = MQTT_CLIENT_IDX;
+  version.params.version.version             = QMTCFG_VERSION_MQTT_3_1_1;
+  version.params.version.present.has_version = true;
+  bg95_config_set_qmtcfg(config, &version);
+
+  qmtcfg_write_params_t pdpcid             = {.type = QMTCFG_TYPE_PDPCID};
+  pdpcid.params.pdpcid.client_idx          = MQTT_CLIENT_IDX;
+  pdpcid.params.pdpcid.pdp_cid             = 1;
+  pdpcid.params.pdpcid.present.has_pdp_cid = true;
+  bg95_config_set_qmtcfg(config, &pdpcid);
+
+  qmtcfg_write_params_t keepalive                        = {.type = QMTCFG_TYPE_KEEPALIVE};
+  keepalive.params.keepalive.client_idx                  = MQTT_CLIENT_IDX;
+  keepalive.params.keepalive.keep_alive_time             = MQTT_KEEPALIVE_S;
+  keepalive.params.keepalive.present.has_keep_alive_time = true;
+  bg95_config_set_qmtcfg(config, &keepalive);
+
+  qmtcfg_write_params_t session                    = {.type = QMTCFG_TYPE_SESSION};
+  session.params.session.client_idx                = MQTT_CLIENT_IDX;
+  session.params.session.clean_session             = QMTCFG_CLEAN_SESSION_ENABLE;
+  session.params.session.present.has_clean_session = true;
+  bg95_config_set_qmtcfg(config, &session);
+}
+
+// True when the ESP32 reset on its own and the modem, powered separately, kept its state
+static bool is_warm_reset(void)
+{
+  switch (esp_reset_reason())
+  {
+    case ESP_RST_SW:
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The code defaults are the desired configuration. The NVS record only tells whether exactly
+// that was applied before; on a power-on reset the modem may have lost it, so it is checked.
+static void init_modem_config(void)
+{
+  build_default_modem_config(&modem_config);
+  modem_config_applied = is_warm_reset() && bg95_config_is_stored(&modem_config);
+}
+
+static esp_err_t apply_modem_config(void* ctx)
+{
+  const bg95_config_t* config = (const bg95_config_t*) ctx;
+
+  if (modem_config_applied)
+  {
+    ESP_LOGI(TAG, "Modem config unchanged since it was last applied, skipping the read back");
+    return ESP_OK;
+  }
+
+  modem_begin(BG95_SCHED_LANE_NORMAL);
+  esp_err_t err = bg95_config_apply(&urc_tap.uart, config, NULL);
+  modem_end();
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  modem_config_applied = true;
+  err                  = bg95_config_save(config);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Failed to record the applied modem config: %s", esp_err_to_name(err));
+  }
+  return ESP_OK;
+}
+
+static void load_modem_caps(void)
+{
+  bool probed = false;
+  modem_begin(BG95_SCHED_LANE_NORMAL);
+  esp_err_t err = bg95_caps_load_or_probe(&urc_tap.uart, &modem_caps, &probed);
+  modem_end();
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Capability probe failed, using default ranges: %s", esp_err_to_name(err));
+    return;
+  }
+  ESP_LOGI(TAG,
+           "Modem firmware %s, capabilities %s",
+           modem_caps.fw_rev,
+           probed ? "probed" : "cached");
+
+  if (!bg95_caps_check_client_idx(&modem_caps, MQTT_CLIENT_IDX))
+  {
+    ESP_LOGE(TAG, "MQTT client index %d not supported by this modem", MQTT_CLIENT_IDX);
+  }
+  if (!bg95_caps_check_keepalive(&modem_caps, MQTT_KEEPALIVE_S))
+  {
+    ESP_LOGE(TAG, "MQTT keepalive %ds not supported by this modem", MQTT_KEEPALIVE_S);
+  }
+  if (!bg95_caps_check_msgid(&modem_caps, MQTT_PUBLISH_MSGID))
+  {
+    ESP_LOGE(TAG, "MQTT publish msgid %d not supported by this modem", MQTT_PUBLISH_MSGID);
+  }
+}
+
+// Minimal bring-up to a connected MQTT client, the registration URCs are enabled in here
+static esp_err_t boot_to_connected(bg95_handle_t* bg95_handle)
+{
+  bg95_boot_config_t boot_config = {.handle            = bg95_handle,
+                                    .uart              = &urc_tap.uart,
+                                    .net_reg           = &net_reg,
+                                    .urc_tap           = &urc_tap,
+                                    .sched             = &modem_sched,
+                                    .cid               = 1,
+                                    .client_idx        = MQTT_CLIENT_IDX,
+                                    .host              = MQTT_BROKER_HOST,
+                                    .port              = MQTT_BROKER_PORT,
+                                    .client_id         = MQTT_CLIENT_ID,
+                                    .username          = MQTT_USERNAME,
+                                    .password          = MQTT_PASSWORD,
+                                    .attach_timeout_ms = 30000,
+                                    .result_timeout_ms = MQTT_RESULT_TIMEOUT_MS,
+                                    .configure         = apply_modem_config,
+                                    .configure_ctx     = &modem_config};
+
+  esp_err_t err = bg95_boot_run(&boot_config, &boot_timing);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Boot sequence stopped early: %s", esp_err_to_name(err));
+  }
+  return err;
+}
+
+// The driver reports AT error result codes as ESP_FAIL, the URC tap still saw which one it was.
+// Replaces 'failure' with the class of that error when there is one.
+static bg95_reconnect_class_t refine_failure(esp_err_t err, bg95_reconnect_class_t failure)
+{
+  bg95_at_error_t at_error;
+  if (err != ESP_FAIL || !bg95_urc_tap_last_error(&urc_tap, &at_error))
+  {
+    return failure;
+  }
+
+  ESP_LOGW(TAG,
+           "Modem error %d (%s), retry %s",
+           at_error.code,
+           bg95_at_error_to_str(&at_error),
+           bg95_at_retry_to_str(at_error.retry));
+  return bg95_reconnect_classify_at_error(&at_error);
+}
+
+// The modem takes the next MQTT command only once the result URC of the previous one is out, and
+// the driver may return on the "OK" before it. Wakes on that URC, armed with
+// bg95_urc_tap_arm_wait() before the command; the timeout only bounds a URC that never comes.
+static void wait_mqtt_result(const char* prefix)
+{
+  char line[BG95_URC_TAP_LINE_MAX_LEN];
+  if (bg95_urc_tap_wait(&urc_tap, line, sizeof(line), MQTT_RESULT_TIMEOUT_MS) == ESP_OK)
+  {
+    ESP_LOGI(TAG, "%s", line);
+  }
+  else
+  {
+    ESP_LOGW(TAG, "No %s URC within %d ms", prefix, MQTT_RESULT_TIMEOUT_MS);
+  }
+}
+
 // This function demonstrates how to publish a message via MQTT
 static esp_err_t publish_mqtt_message(bg95_handle_t* bg95_handle, const char* message)
 {
@@ -81,6 +544,9 @@ static esp_err_t publish_mqtt_message(bg95_handle_t* bg95_handle, const char* me
   ESP_LOGI(TAG, "Publishing message to topic '%s': %s", MQTT_PUBLISH_TOPIC, message);
   qmtpub_write_response_t pub_response = {0};
 
+  modem_begin(bg95_sched_publish_lane(strlen(message)));
+  int64_t start_us = esp_timer_get_time();
+
   err = bg95_mqtt_publish_fixed_length(bg95_handle,
                                        MQTT_CLIENT_IDX,
                                        MQTT_PUBLISH_MSGID,
@@ -90,6 +556,12 @@ static esp_err_t publish_mqtt_message(bg95_handle_t* bg95_handle, const char* me
                                        message,
                                        strlen(message),
                                        &pub_response);
+  modem_end();
+  bg95_rtt_estimator_observe(&modem_rtt,
+                             &AT_CMD_QMTPUB,
+                             AT_CMD_TYPE_WRITE,
+                             err,
+                             (uint32_t) ((esp_timer_get_time() - start_us) / 1000));
 
   if (err != ESP_OK)
   {
@@ -135,37 +607,134 @@ static void connect_and_publish_task(void* pvParams)
   int            msg_count       = 0;
   char           message_buffer[128];
 
+  bg95_reconnect_init(&reconnect, NULL);
+  load_modem_caps();
+  boot_to_connected(bg95_handle);
+
 // Define variables for subscription
 #define MQTT_SUBSCRIBE_TOPIC "testbucket1/response"
 #define MQTT_SUBSCRIBE_QOS QMTSUB_QOS_AT_LEAST_ONCE
 #define MQTT_SUBSCRIBE_MSGID 2 // Different from publish msgid
 #define MQTT_UNSUBSCRIBE_MSGID 3
 
+  if (!bg95_caps_check_msgid(&modem_caps, MQTT_SUBSCRIBE_MSGID) ||
+      !bg95_caps_check_sub_qos(&modem_caps, MQTT_SUBSCRIBE_QOS))
+  {
+    ESP_LOGE(TAG, "Subscribe msgid/QoS outside the modem's supported ranges");
+  }
+
   // Main connection and publishing loop
   for (;;)
   {
+    // 0. One round trip status snapshot (CPIN, CSQ, COPS, CGPADDR, QMTCONN) instead of one
+    // query per check below. Falls back to the individual queries if the snapshot fails.
+    bg95_status_snapshot_t snapshot     = {0};
+    bool                   snapshot_ok  = false;
+    bool                   link_changed = false;
+    esp_err_t              snapshot_err =
+        bg95_status_snapshot_read(query_uart, query_sched(), cid, mqtt_client_idx, &snapshot);
+    if (snapshot_err == ESP_OK)
+    {
+      snapshot_ok = true;
+      if (snapshot.present.has_csq)
+      {
+        ESP_LOGI(TAG, "Signal: %d dBm", csq_rssi_to_dbm(snapshot.csq.rssi));
+        bg95_rtt_estimator_set_condition(&modem_rtt,
+                                         bg95_rtt_condition_from_csq(snapshot.csq.rssi));
+      }
+      if (snapshot.present.has_cops && snapshot.cops.present.has_operator)
+      {
+        ESP_LOGI(TAG, "Operator: %s", snapshot.cops.operator_name);
+      }
+    }
+    else
+    {
+      ESP_LOGW(TAG, "Status snapshot failed: %s", esp_err_to_name(snapshot_err));
+
+      cpin_read_response_t   cpin = {0};
+      csq_execute_response_t csq  = {0};
+      if (bg95_query_cache_execute(
+              &query_cache, &AT_CMD_CPIN, AT_CMD_TYPE_READ, &cpin, sizeof(cpin)) == ESP_OK &&
+          cpin.status != CPIN_STATUS_READY)
+      {
+        ESP_LOGW(TAG, "SIM not ready");
+      }
+      if (bg95_single_flight_execute(
+              &query_sf, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, &csq, sizeof(csq)) == ESP_OK)
+      {
+        ESP_LOGI(TAG, "Signal: %d dBm", csq_rssi_to_dbm(csq.rssi));
+        bg95_rtt_estimator_set_condition(&modem_rtt, bg95_rtt_condition_from_csq(csq.rssi));
+      }
+    }
+
     // 1. Check if already connected to the network
     bool is_pdp_context_active = false;
-    err = bg95_is_pdp_context_active(bg95_handle, cid, &is_pdp_context_active);
+    if (snapshot_ok)
+    {
+      is_pdp_context_active = snapshot.pdp_active;
+      err                   = ESP_OK;
+      bg95_net_reg_set_pdp_active(&net_reg, is_pdp_context_active);
+    }
+    else
+    {
+      modem_begin(BG95_SCHED_LANE_CONTROL);
+      err = bg95_is_pdp_context_active(bg95_handle, cid, &is_pdp_context_active);
+      modem_end();
+    }
     if (err != ESP_OK || !is_pdp_context_active)
     {
       ESP_LOGI(TAG, "PDP context not active, connecting to network...");
+      modem_begin(BG95_SCHED_LANE_NORMAL);
       err = bg95_connect_to_network(bg95_handle);
+      modem_end();
       if (err != ESP_OK)
       {
         ESP_LOGE(TAG, "Failed to connect to network: %s", esp_err_to_name(err));
-        vTaskDelay(pdMS_TO_TICKS(5000)); // Wait before retrying
+        bg95_reconnect_class_t failure  = refine_failure(err, BG95_RECONNECT_CLASS_NETWORK);
+        uint32_t               delay_ms = bg95_reconnect_next_delay_ms(&reconnect, failure);
+        if (failure == BG95_RECONNECT_CLASS_FATAL)
+        {
+          vTaskDelay(pdMS_TO_TICKS(delay_ms)); // Needs a SIM or config change, attach won't help
+        }
+        else
+        {
+          // Retry as soon as the modem reports attach, at the latest after the backoff delay
+          bg95_net_reg_wait(&net_reg, BG95_NET_REG_REGISTERED_BIT, delay_ms);
+        }
         continue;
       }
 
       ESP_LOGI(TAG, "Successfully connected to cellular network");
-      // Wait a bit for connection to stabilize
-      vTaskDelay(pdMS_TO_TICKS(1000));
+      link_changed = true;
+      bg95_net_reg_set_pdp_active(&net_reg, true);
+      // Let the connection stabilize, done early once registration is reported
+      bg95_net_reg_wait(&net_reg, BG95_NET_REG_REGISTERED_BIT | BG95_NET_REG_PDP_ACTIVE_BIT, 1000);
     }
 
+    // A connected MQTT client in an up to date snapshot implies the network is open
+    bool snapshot_connected = snapshot_ok && !link_changed && snapshot.present.has_qmtconn &&
+                              snapshot.qmtconn.client_idx == mqtt_client_idx &&
+                              snapshot.qmtconn.state == QMTCONN_STATE_CONNECTED;
+
     // 2. Check if MQTT network connection is open
     qmtopen_read_response_t open_status = {0};
-    err = bg95_mqtt_network_open_status(bg95_handle, mqtt_client_idx, &open_status);
+    if (snapshot_connected)
+    {
+      err = ESP_OK;
+    }
+    else
+    {
+      err = bg95_query_cache_execute(&query_cache,
+                                     &AT_CMD_QMTOPEN,
+                                     AT_CMD_TYPE_READ,
+                                     &open_status,
+                                     sizeof(open_status));
+      if (err == ESP_OK &&
+          (!open_status.present.has_client_idx || open_status.client_idx != mqtt_client_idx))
+      {
+        err = ESP_ERR_NOT_FOUND; // No network open for our client
+      }
+    }
 
     if (err != ESP_OK)
     {
@@ -173,48 +742,105 @@ static void connect_and_publish_task(void* pvParams)
           TAG, "Opening MQTT network connection to %s:%d...", MQTT_BROKER_HOST, MQTT_BROKER_PORT);
       qmtopen_write_response_t qmtopen_response = {0};
 
+      modem_begin(BG95_SCHED_LANE_NORMAL);
+      bg95_urc_tap_arm_wait(&urc_tap, "+QMTOPEN:");
       err = bg95_mqtt_open_network(
           bg95_handle, mqtt_client_idx, MQTT_BROKER_HOST, MQTT_BROKER_PORT, &qmtopen_response);
-      if (err != ESP_OK)
+      invalidate_mqtt_state();
+      bg95_reconnect_class_t failure = bg95_reconnect_classify_qmtopen(err, &qmtopen_response);
+      if (!qmtopen_response.present.has_result)
+      {
+        failure = refine_failure(err, failure);
+      }
+      if (failure != BG95_RECONNECT_CLASS_NONE)
       {
-        ESP_LOGE(TAG, "Failed to open MQTT network connection: %s", esp_err_to_name(err));
-        vTaskDelay(pdMS_TO_TICKS(5000));
+        modem_end();
+        ESP_LOGE(TAG,
+                 "Failed to open MQTT network connection: %s (%s)",
+                 esp_err_to_name(err),
+                 bg95_reconnect_class_to_str(failure));
+        uint32_t delay_ms = bg95_reconnect_next_delay_ms(&reconnect, failure);
+        if (failure == BG95_RECONNECT_CLASS_NETWORK)
+        {
+          bg95_net_reg_wait(&net_reg, BG95_NET_REG_REGISTERED_BIT, delay_ms);
+        }
+        else if (delay_ms > 0)
+        {
+          vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        }
         continue;
       }
 
-      ESP_LOGI(TAG, "MQTT network connection request sent");
-      // Wait for connection to establish
-      vTaskDelay(pdMS_TO_TICKS(2000));
+      ESP_LOGI(TAG, "MQTT network connection opened");
+      link_changed = true;
+      wait_mqtt_result("+QMTOPEN:");
+      modem_end();
     }
 
     // 3. Check if client is connected to the MQTT broker
     qmtconn_read_response_t qmtconn_read_response = {0};
-    err = bg95_mqtt_query_connection_state(bg95_handle, mqtt_client_idx, &qmtconn_read_response);
+    if (snapshot_connected && !link_changed)
+    {
+      qmtconn_read_response = snapshot.qmtconn;
+      err                   = ESP_OK;
+    }
+    else
+    {
+      err = bg95_query_cache_execute(&query_cache,
+                                     &AT_CMD_QMTCONN,
+                                     AT_CMD_TYPE_READ,
+                                     &qmtconn_read_response,
+                                     sizeof(qmtconn_read_response));
+      if (err == ESP_OK && (!qmtconn_read_response.present.has_client_idx ||
+                            qmtconn_read_response.client_idx != mqtt_client_idx))
+      {
+        err = ESP_ERR_NOT_FOUND; // Our client is idle
+      }
+    }
 
     if (err != ESP_OK || qmtconn_read_response.state != QMTCONN_STATE_CONNECTED)
     {
       ESP_LOGI(TAG, "Connecting to MQTT broker with client ID '%s'...", MQTT_CLIENT_ID);
       qmtconn_write_response_t qmtconn_write_response = {0};
 
+      modem_begin(BG95_SCHED_LANE_NORMAL);
+      bg95_urc_tap_arm_wait(&urc_tap, "+QMTCONN:");
       err = bg95_mqtt_connect(bg95_handle,
                               mqtt_client_idx,
                               MQTT_CLIENT_ID,
                               MQTT_USERNAME,
                               MQTT_PASSWORD,
                               &qmtconn_write_response);
+      invalidate_mqtt_state();
 
-      if (err != ESP_OK)
+      bg95_reconnect_class_t failure =
+          bg95_reconnect_classify_qmtconn(err, &qmtconn_write_response);
+      if (!qmtconn_write_response.present.has_result)
+      {
+        failure = refine_failure(err, failure);
+      }
+      if (failure != BG95_RECONNECT_CLASS_NONE)
       {
-        ESP_LOGE(TAG, "Failed to connect to MQTT broker: %s", esp_err_to_name(err));
-        vTaskDelay(pdMS_TO_TICKS(5000));
+        modem_end();
+        ESP_LOGE(TAG,
+                 "Failed to connect to MQTT broker: %s (%s)",
+                 esp_err_to_name(err),
+                 bg95_reconnect_class_to_str(failure));
+        uint32_t delay_ms = bg95_reconnect_next_delay_ms(&reconnect, failure);
+        if (delay_ms > 0)
+        {
+          vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        }
         continue;
       }
 
-      ESP_LOGI(TAG, "MQTT connection request sent");
-      // Wait for connection to establish
-      vTaskDelay(pdMS_TO_TICKS(2000));
+      ESP_LOGI(TAG, "MQTT connection established");
+      wait_mqtt_result("+QMTCONN:");
+      modem_end();
     }
 
+    bg95_reconnect_success(&reconnect);
+
     // 4. Subscribe to a topic for receiving responses (NEW FUNCTIONALITY)
     ESP_LOGI(TAG,
              "Subscribing to MQTT topic '%s' with QoS %d...",
@@ -222,7 +848,9 @@ static void connect_and_publish_task(void* pvParams)
              MQTT_SUBSCRIBE_QOS);
 
     qmtsub_write_response_t sub_response = {0};
-    err                                  = bg95_mqtt_subscribe(bg95_handle,
+    modem_begin(BG95_SCHED_LANE_NORMAL);
+    bg95_urc_tap_arm_wait(&urc_tap, "+QMTSUB:");
+    err = bg95_mqtt_subscribe(bg95_handle,
                               mqtt_client_idx,
                               MQTT_SUBSCRIBE_MSGID,
                               MQTT_SUBSCRIBE_TOPIC,
@@ -253,10 +881,9 @@ static void connect_and_publish_task(void* pvParams)
     else
     {
       ESP_LOGI(TAG, "Subscription request sent, waiting for result...");
+      wait_mqtt_result("+QMTSUB:");
     }
-
-    // Wait a bit after subscription
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    modem_end();
 
     // 5. Now that we have a connection, let's publish some messages
     for (int i = 0; i < 3; i++)
@@ -278,6 +905,23 @@ static void connect_and_publish_task(void* pvParams)
         break; // Exit the publishing loop on error
       }
 
+      if (!boot_timing.done[BG95_BOOT_PHASE_FIRST_PUBLISH])
+      {
+        bg95_boot_mark(&boot_timing, BG95_BOOT_PHASE_FIRST_PUBLISH, false);
+        ESP_LOGI(TAG,
+                 "Time to first publish: %lu ms",
+                 (unsigned long) bg95_boot_time_to_first_publish_ms(&boot_timing));
+        bg95_boot_log(&boot_timing);
+        bg95_baud_log_stats(&baud_link);
+        bg95_flow_log_stats(&uart_flow);
+        bg95_sched_log_stats(&modem_sched);
+        bg95_rtt_estimator_log(&modem_rtt);
+        ESP_LOGI(TAG,
+                 "Driver RX wakeups: %lu with data, %lu empty",
+                 (unsigned long) urc_tap.stats.read_wakeups,
+                 (unsigned long) urc_tap.stats.empty_wakeups);
+      }
+
       // Wait between publications
       vTaskDelay(pdMS_TO_TICKS(5000));
     }
@@ -286,11 +930,13 @@ static void connect_and_publish_task(void* pvParams)
     ESP_LOGI(TAG, "Unsubscribing from MQTT topic '%s'...", MQTT_SUBSCRIBE_TOPIC);
 
     qmtuns_write_response_t unsub_response = {0};
-    err                                    = bg95_mqtt_unsubscribe(bg95_handle,
+    modem_begin(BG95_SCHED_LANE_NORMAL);
+    err = bg95_mqtt_unsubscribe(bg95_handle,
                                 mqtt_client_idx,
                                 MQTT_UNSUBSCRIBE_MSGID,
                                 MQTT_SUBSCRIBE_TOPIC,
                                 &unsub_response);
+    modem_end();
 
     if (err != ESP_OK)
     {
@@ -319,7 +965,10 @@ static void connect_and_publish_task(void* pvParams)
 
     // 7. Disconnect MQTT (will reconnect on next loop iteration)
     qmtdisc_write_response_t qmtdisc_write_response = {0};
+    modem_begin(BG95_SCHED_LANE_CONTROL);
     err = bg95_mqtt_disconnect(bg95_handle, mqtt_client_idx, &qmtdisc_write_response);
+    modem_end();
+    invalidate_mqtt_state();
     if (err != ESP_OK)
     {
       ESP_LOGE(TAG, "Failed to disconnect from MQTT broker: %s", esp_err_to_name(err));
@@ -338,16 +987,28 @@ void app_main(void)
 {
   ESP_LOGI(TAG, "BG95 Driver Dev Project with MQTT Publish started ...");
 
+  bg95_boot_timing_init(&boot_timing);
+  init_nvs();
+  init_modem_config();
+
   config_and_init_uart();
+  init_baud_link();
+  bg95_boot_mark(&boot_timing, BG95_BOOT_PHASE_UART, false);
+  init_modem_sched();
   init_bg95();
-
-  // Create a task with larger stack for connection and MQTT operations
-  BaseType_t ret = xTaskCreate(connect_and_publish_task,
-                               "connect_publish_task",
-                               24000, // Large stack size to prevent overflow
-                               &handle,
-                               2,
-                               NULL);
+  bg95_boot_mark(&boot_timing, BG95_BOOT_PHASE_DRIVER_INIT, false);
+  init_net_reg();
+  init_query_cache();
+
+  // Create a task with larger stack for connection and MQTT operations, on the application
+  // core so it stays off the core servicing the UART
+  const bg95_task_config_t task_config = {
+      .stack_size = 24000, // Large stack size to prevent overflow
+      .priority   = 2,
+      .core       = CONFIG_BG95_EXT_APP_TASK_CORE,
+  };
+  BaseType_t ret = bg95_task_create(
+      connect_and_publish_task, "connect_publish_task", &task_config, &handle, NULL);
 
   if (ret != pdPASS)
   {
@@ -0,0 +1,6 @@
+#!/bin/bash
+echo "Building benchmark application..."
+rm -rf build/
+idf.py -DBENCH_MODE=1 build | tee ./logs/bench_build.log
+echo "Flashing and Monitoring benchmarks..."
+idf.py flash monitor -p $1 | tee ./logs/bench_flash_monitor.log
@@ -0,0 +1,7 @@
+#!/bin/bash
+# Runs on the build host: start a broker first, e.g. 'mosquitto -p 1883 &'
+echo "Building fleet load generator for the linux target..."
+rm -rf build/
+idf.py -DFLEET_MODE=1 --preview set-target linux build | tee ./logs/fleet_build.log
+echo "Running fleet load generator..."
+./build/bg95_driver_fleet.elf | tee ./logs/fleet_run.log
@@ -0,0 +1,80 @@
+#include "bg95_at_error.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static void test_at_error_parse_numeric_cme(void)
+{
+  bg95_at_error_t error;
+
+  TEST_ASSERT_TRUE(bg95_at_error_parse("\r\n+CME ERROR: 14\r\n", &error));
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_CME, error.kind);
+  TEST_ASSERT_EQUAL(14, error.code);
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_IMMEDIATE, error.retry);
+  TEST_ASSERT_EQUAL_STRING("SIM busy", bg95_at_error_to_str(&error));
+
+  TEST_ASSERT_TRUE(bg95_at_error_parse("\r\n+CME ERROR: 3\r\n", &error));
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_NEVER, error.retry);
+
+  TEST_ASSERT_TRUE(bg95_at_error_parse("\r\n+CMS ERROR: 332\r\n", &error));
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_CMS, error.kind);
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_BACKOFF, error.retry);
+}
+
+static void test_at_error_parse_verbose_cme(void)
+{
+  bg95_at_error_t error;
+
+  // AT+CMEE=2 reports the text instead of the number
+  TEST_ASSERT_TRUE(bg95_at_error_parse_line("+CME ERROR: SIM not inserted", &error));
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_CME, error.kind);
+  TEST_ASSERT_EQUAL(10, error.code);
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_NEVER, error.retry);
+
+  TEST_ASSERT_TRUE(bg95_at_error_parse_line("+CME ERROR: something new", &error));
+  TEST_ASSERT_EQUAL(-1, error.code);
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_BACKOFF, error.retry);
+  TEST_ASSERT_EQUAL_STRING("unknown", bg95_at_error_to_str(&error));
+}
+
+static void test_at_error_parse_generic_and_none(void)
+{
+  bg95_at_error_t error;
+
+  TEST_ASSERT_TRUE(bg95_at_error_parse("\r\nERROR\r\n", &error));
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_GENERIC, error.kind);
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_BACKOFF, error.retry);
+
+  TEST_ASSERT_TRUE(bg95_at_error_parse("4\r", &error)); // ATV0 ERROR
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_GENERIC, error.kind);
+
+  TEST_ASSERT_FALSE(bg95_at_error_parse("\r\n+CSQ: 24,0\r\n\r\nOK\r\n", &error));
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_NONE, error.kind);
+  TEST_ASSERT_FALSE(bg95_at_error_parse("+CSQ: 24,0\r\n0\r", &error));
+  TEST_ASSERT_FALSE(bg95_at_error_parse(NULL, &error));
+}
+
+static void test_at_error_retry_class_table(void)
+{
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_IMMEDIATE, bg95_at_error_retry_class(BG95_AT_ERROR_CME, 568));
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_NEVER, bg95_at_error_retry_class(BG95_AT_ERROR_CME, 149));
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_BACKOFF, bg95_at_error_retry_class(BG95_AT_ERROR_CME, 30));
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_IMMEDIATE, bg95_at_error_retry_class(BG95_AT_ERROR_CMS, 314));
+
+  // Not in the table
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_BACKOFF, bg95_at_error_retry_class(BG95_AT_ERROR_CME, 9999));
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_BACKOFF, bg95_at_error_retry_class(BG95_AT_ERROR_CME, -1));
+}
+
+void run_test_bg95_at_error_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_at_error_parse_numeric_cme);
+  RUN_TEST(test_at_error_parse_verbose_cme);
+  RUN_TEST(test_at_error_parse_generic_and_none);
+  RUN_TEST(test_at_error_retry_class_table);
+
+  UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include "bg95_baud.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// Modem and host UART on one simulated line. Commands only get through when both ends run at
+// the same rate; above 'lossy_above' every second command after a host rate change is lost,
+// above 'ipr_lost_above' every AT+IPR.
+typedef struct
+{
+  uint32_t modem_baud;
+  uint32_t host_baud;
+  uint32_t lossy_above;
+  uint32_t ipr_lost_above;
+  uint32_t cmd_count;
+  char     response[32];
+} fake_line_t;
+
+static esp_err_t fake_line_write(const char* data, size_t len, void* context)
+{
+  fake_line_t* line = (fake_line_t*) context;
+
+  line->response[0] = '\0';
+  if (line->host_baud != line->modem_baud)
+  {
+    return ESP_OK; // Garbage at the modem
+  }
+  if (line->lossy_above != 0 && line->modem_baud > line->lossy_above && line->cmd_count++ % 2 == 1)
+  {
+    return ESP_OK;
+  }
+
+  if (strncmp(data, "AT+IPR=", 7) == 0)
+  {
+    if (line->ipr_lost_above != 0 && line->modem_baud > line->ipr_lost_above)
+    {
+      return ESP_OK;
+    }
+    strcpy(line->response, "\r\nOK\r\n");
+    line->modem_baud = (uint32_t) strtoul(data + 7, NULL, 10); // Applied after the OK
+  }
+  else if (len == 4 && strncmp(data, "AT\r\n", 4) == 0)
+  {
+    strcpy(line->response, "\r\nOK\r\n");
+  }
+  else
+  {
+    strcpy(line->response, "\r\nERROR\r\n");
+  }
+  return ESP_OK;
+}
+
+static esp_err_t fake_line_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  fake_line_t* line = (fake_line_t*) context;
+  size_t       n    = strlen(line->response);
+
+  if (n == 0)
+  {
+    *bytes_read = 0;
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    return ESP_ERR_TIMEOUT;
+  }
+  n = n < max_len ? n : max_len;
+  memcpy(data, line->response, n);
+  line->response[0] = '\0';
+  *bytes_read       = n;
+  return ESP_OK;
+}
+
+static esp_err_t fake_set_baud(uint32_t baud, void* ctx)
+{
+  ((fake_line_t*) ctx)->host_baud = baud;
+  ((fake_line_t*) ctx)->cmd_count = 0;
+  return ESP_OK;
+}
+
+static void erase_stored_baud(void)
+{
+  nvs_handle_t nvs;
+  TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+  if (nvs_open(BG95_BAUD_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK)
+  {
+    nvs_erase_key(nvs, BG95_BAUD_NVS_KEY);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+  }
+}
+
+static void test_baud_negotiate_to_max(void)
+{
+  fake_line_t           line = {.modem_baud = 115200, .host_baud = 115200};
+  bg95_uart_interface_t phys = {.write = fake_line_write, .read = fake_line_read};
+  bg95_baud_t           link;
+
+  phys.context = &line;
+  erase_stored_baud();
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_init(&link, &phys, 115200, fake_set_baud, &line));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_negotiate(&link, BG95_BAUD_MAX));
+  TEST_ASSERT_EQUAL(921600, link.stats.baud);
+  TEST_ASSERT_EQUAL(921600, line.modem_baud);
+  TEST_ASSERT_EQUAL(921600, line.host_baud);
+  TEST_ASSERT_EQUAL(1, link.stats.negotiations);
+  TEST_ASSERT_EQUAL(0, link.stats.fallbacks);
+
+  // Next boot: the host comes up at the default rate and picks the stored one without hunting
+  line.host_baud = 115200;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_init(&link, &phys, 115200, fake_set_baud, &line));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_sync(&link));
+  TEST_ASSERT_EQUAL(921600, link.stats.baud);
+  TEST_ASSERT_EQUAL(0, link.stats.hunts);
+
+  erase_stored_baud();
+}
+
+static void test_baud_falls_back_on_marginal_line(void)
+{
+  fake_line_t           line = {.modem_baud = 115200, .host_baud = 115200, .lossy_above = 460800};
+  bg95_uart_interface_t phys = {.write = fake_line_write, .read = fake_line_read};
+  bg95_baud_t           link;
+
+  phys.context = &line;
+  erase_stored_baud();
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_init(&link, &phys, 115200, fake_set_baud, &line));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_negotiate(&link, BG95_BAUD_MAX));
+  TEST_ASSERT_EQUAL(460800, link.stats.baud);
+  TEST_ASSERT_EQUAL(460800, line.modem_baud);
+  TEST_ASSERT_EQUAL(1, link.stats.fallbacks);
+  TEST_ASSERT_GREATER_OR_EQUAL(1, link.stats.probe_failures);
+
+  erase_stored_baud();
+}
+
+static void test_baud_hunt_skips_the_failed_rate(void)
+{
+  fake_line_t           line = {.modem_baud     = 115200,
+                                .host_baud      = 115200,
+                                .lossy_above    = 460800,
+                                .ipr_lost_above = 460800};
+  bg95_uart_interface_t phys = {.write = fake_line_write, .read = fake_line_read};
+  bg95_baud_t           link;
+
+  phys.context = &line;
+  erase_stored_baud();
+
+  // The modem stays at 921600, where single commands still pass but the probe burst does not.
+  // The hunt must not settle there again.
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_init(&link, &phys, 115200, fake_set_baud, &line));
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, bg95_baud_negotiate(&link, BG95_BAUD_MAX));
+  TEST_ASSERT_EQUAL(921600, line.modem_baud);
+  TEST_ASSERT_NOT_EQUAL(921600, link.stats.baud);
+  TEST_ASSERT_EQUAL(1, link.stats.hunts);
+
+  erase_stored_baud();
+}
+
+static void test_baud_sync_hunts_lost_modem(void)
+{
+  fake_line_t           line = {.modem_baud = 230400, .host_baud = 115200};
+  bg95_uart_interface_t phys = {.write = fake_line_write, .read = fake_line_read};
+  bg95_baud_t           link;
+
+  phys.context = &line;
+  erase_stored_baud();
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_init(&link, &phys, 115200, fake_set_baud, &line));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_sync(&link));
+  TEST_ASSERT_EQUAL(230400, link.stats.baud);
+  TEST_ASSERT_EQUAL(230400, line.host_baud);
+  TEST_ASSERT_EQUAL(1, link.stats.hunts);
+
+  // The rate found is stored, the next boot starts there
+  line.host_baud = 115200;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_init(&link, &phys, 115200, fake_set_baud, &line));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_sync(&link));
+  TEST_ASSERT_EQUAL(230400, link.stats.baud);
+  TEST_ASSERT_EQUAL(0, link.stats.hunts);
+
+  // Nobody home at any rate
+  line.modem_baud = 9600;
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, bg95_baud_sync(&link));
+
+  erase_stored_baud();
+}
+
+static void test_baud_metered_throughput(void)
+{
+  fake_line_t           line = {.modem_baud = 115200, .host_baud = 115200};
+  bg95_uart_interface_t phys = {.write = fake_line_write, .read = fake_line_read};
+  bg95_baud_t           link;
+  char                  buf[16];
+  size_t                bytes_read = 0;
+
+  phys.context = &line;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_baud_init(&link, &phys, 115200, fake_set_baud, &line));
+
+  TEST_ASSERT_EQUAL(ESP_OK, link.uart.write("AT\r\n", 4, link.uart.context));
+  TEST_ASSERT_EQUAL(ESP_OK, link.uart.read(buf, sizeof(buf), &bytes_read, 10, link.uart.context));
+  TEST_ASSERT_EQUAL(4, link.stats.bytes_tx);
+  TEST_ASSERT_EQUAL(6, link.stats.bytes_rx);
+
+  // 10 bytes in one second
+  TEST_ASSERT_EQUAL(80, bg95_baud_throughput_bps(&link, link.stats.since_us + 1000000));
+  TEST_ASSERT_EQUAL(0, bg95_baud_throughput_bps(&link, link.stats.since_us));
+
+  bg95_baud_reset_counters(&link);
+  TEST_ASSERT_EQUAL(0, link.stats.bytes_tx);
+}
+
+void run_test_bg95_baud_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_baud_negotiate_to_max);
+  RUN_TEST(test_baud_falls_back_on_marginal_line);
+  RUN_TEST(test_baud_hunt_skips_the_failed_rate);
+  RUN_TEST(test_baud_sync_hunts_lost_modem);
+  RUN_TEST(test_baud_metered_throughput);
+
+  UNITY_END();
+}
@@ -0,0 +1,441 @@
+#include "bg95_bond.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <string.h>
+#include <unity.h>
+
+// Fake modem behind one link: every publish waits for the gate, then returns 'result'
+typedef struct
+{
+  SemaphoreHandle_t gate;
+  SemaphoreHandle_t entered; // Given when a publish starts waiting on the gate
+  esp_err_t         result;
+  char              payloads[BG95_BOND_MAX_MSGS * 2][8];
+  size_t            delivered;
+} fake_link_t;
+
+static esp_err_t fake_publish(const bg95_bond_msg_t* msg, void* ctx)
+{
+  fake_link_t* fake = (fake_link_t*) ctx;
+
+  xSemaphoreGive(fake->entered);
+  xSemaphoreTake(fake->gate, portMAX_DELAY);
+  esp_err_t result = fake->result;
+  if (result == ESP_OK && fake->delivered < BG95_BOND_MAX_MSGS * 2)
+  {
+    memcpy(fake->payloads[fake->delivered], msg->payload, msg->len);
+    fake->payloads[fake->delivered][msg->len] = '\0';
+    fake->delivered++;
+  }
+  return result;
+}
+
+static void fake_init(fake_link_t* fake, bool open)
+{
+  memset(fake, 0, sizeof(*fake));
+  fake->gate    = xSemaphoreCreateCounting(64, open ? 64 : 0);
+  fake->entered = xSemaphoreCreateCounting(64, 0);
+}
+
+static void fake_open(fake_link_t* fake)
+{
+  for (int i = 0; i < 64; i++)
+  {
+    xSemaphoreGive(fake->gate);
+  }
+}
+
+static void fake_deinit(fake_link_t* fake)
+{
+  vSemaphoreDelete(fake->gate);
+  vSemaphoreDelete(fake->entered);
+}
+
+static void wait_delivered(fake_link_t* fake, size_t count)
+{
+  for (int i = 0; i < 100 && fake->delivered < count; i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  TEST_ASSERT_EQUAL(count, fake->delivered);
+}
+
+static void bond_start(bg95_bond_t* bond, fake_link_t* fakes)
+{
+  const bg95_bond_link_config_t links[] = {
+      {.client_idx = 0, .publish = fake_publish, .publish_ctx = &fakes[0]},
+      {.client_idx = 0, .publish = fake_publish, .publish_ctx = &fakes[1]},
+  };
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_init(bond, links, 2));
+}
+
+static void publish(bg95_bond_t* bond, const char* payload)
+{
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_bond_publish(bond,
+                                      "gw/telemetry",
+                                      payload,
+                                      strlen(payload),
+                                      QMTPUB_QOS_AT_LEAST_ONCE,
+                                      QMTPUB_RETAIN_DISABLED));
+}
+
+static void test_bond_spreads_by_depth_and_quality(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], false);
+  fake_init(&fakes[1], false);
+  bond_start(&bond, fakes);
+
+  // Same quality, the queues fill evenly
+  for (int i = 0; i < 4; i++)
+  {
+    publish(&bond, "m");
+  }
+  TEST_ASSERT_EQUAL(2, bg95_bond_link_depth(&bond, 0));
+  TEST_ASSERT_EQUAL(2, bg95_bond_link_depth(&bond, 1));
+
+  // rssi 30 against 5 weighs about five to one, link 0 stays the cheaper one for all of these
+  bg95_bond_set_quality(&bond, 0, 30);
+  bg95_bond_set_quality(&bond, 1, 5);
+  for (int i = 0; i < 10; i++)
+  {
+    publish(&bond, "m");
+  }
+  TEST_ASSERT_EQUAL(12, bg95_bond_link_depth(&bond, 0));
+  TEST_ASSERT_EQUAL(2, bg95_bond_link_depth(&bond, 1));
+
+  fake_open(&fakes[0]);
+  fake_open(&fakes[1]);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(12, fakes[0].delivered);
+  TEST_ASSERT_EQUAL(2, fakes[1].delivered);
+  TEST_ASSERT_EQUAL(12, bond.links[0].stats.published);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_qmtstat_fails_over_without_loss(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], false);
+  fake_init(&fakes[1], false);
+  bond_start(&bond, fakes);
+  bg95_bond_set_link_up(&bond, 1, false);
+
+  publish(&bond, "m0");
+  publish(&bond, "m1");
+  publish(&bond, "m2");
+  TEST_ASSERT_TRUE(xSemaphoreTake(fakes[0].entered, pdMS_TO_TICKS(1000))); // m0 in flight
+  TEST_ASSERT_EQUAL(3, bg95_bond_link_depth(&bond, 0));
+
+  // Link 1 back, then link 0 loses its broker. Another client's status is ignored.
+  fake_open(&fakes[1]);
+  bg95_bond_set_link_up(&bond, 1, true);
+  bg95_bond_urc_handler("+QMTSTAT: 1,1", false, &bond.links[0]);
+  TEST_ASSERT_TRUE(bond.links[0].up);
+  bg95_bond_urc_handler("+QMTSTAT: 0,1", false, &bond.links[0]);
+  TEST_ASSERT_FALSE(bond.links[0].up);
+  TEST_ASSERT_EQUAL(1, bond.links[0].stats.downs);
+  wait_delivered(&fakes[1], 2);
+
+  // The in flight publish fails on the dead link and is sent again on link 1
+  fakes[0].result = ESP_FAIL;
+  xSemaphoreGive(fakes[0].gate);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(0, fakes[0].delivered);
+  TEST_ASSERT_EQUAL(3, fakes[1].delivered);
+  TEST_ASSERT_EQUAL_STRING("m1", fakes[1].payloads[0]);
+  TEST_ASSERT_EQUAL_STRING("m2", fakes[1].payloads[1]);
+  TEST_ASSERT_EQUAL_STRING("m0", fakes[1].payloads[2]);
+  TEST_ASSERT_EQUAL(3, bond.links[0].stats.failovers);
+  TEST_ASSERT_EQUAL(1, bond.links[0].stats.failures);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_holds_messages_while_all_links_down(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], true);
+  fake_init(&fakes[1], true);
+  bond_start(&bond, fakes);
+  bg95_bond_set_link_up(&bond, 0, false);
+  bg95_bond_set_link_up(&bond, 1, false);
+
+  publish(&bond, "a");
+  publish(&bond, "b");
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_bond_wait_idle(&bond, 200));
+  TEST_ASSERT_EQUAL(0, fakes[0].delivered + fakes[1].delivered);
+
+  bg95_bond_set_link_up(&bond, 1, true);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(2, fakes[1].delivered);
+  TEST_ASSERT_EQUAL_STRING("a", fakes[1].payloads[0]);
+  TEST_ASSERT_EQUAL_STRING("b", fakes[1].payloads[1]);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_failures_take_link_down(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], true);
+  fake_init(&fakes[1], false);
+  fakes[0].result = ESP_FAIL;
+  bond_start(&bond, fakes);
+  bg95_bond_set_link_up(&bond, 1, false);
+
+  publish(&bond, "x");
+  for (int i = 0; i < 50 && bond.links[0].up; i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+  TEST_ASSERT_FALSE(bond.links[0].up);
+  TEST_ASSERT_EQUAL(BG95_BOND_LINK_DOWN_FAILURES, bond.links[0].stats.failures);
+  TEST_ASSERT_EQUAL(BG95_BOND_LINK_DOWN_FAILURES, bond.msgs[0].attempts);
+
+  // Still pending, delivered once the other link is up
+  fake_open(&fakes[1]);
+  bg95_bond_set_link_up(&bond, 1, true);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(1, fakes[1].delivered);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_rejected_message_is_released(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], true);
+  fake_init(&fakes[1], false);
+  fakes[0].result = ESP_ERR_INVALID_SIZE;
+  bond_start(&bond, fakes);
+  bg95_bond_set_link_up(&bond, 1, false);
+
+  // Refused by the modem: dropped at once, the link stays up for the next one
+  publish(&bond, "bad");
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(1, bond.failed);
+  TEST_ASSERT_EQUAL(1, bond.links[0].stats.rejected);
+  TEST_ASSERT_EQUAL(0, bond.links[0].stats.failures);
+  TEST_ASSERT_TRUE(bond.links[0].up);
+
+  fakes[0].result = ESP_OK;
+  publish(&bond, "good");
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(1, fakes[0].delivered);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_gives_up_before_every_link_is_down(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], true);
+  fake_init(&fakes[1], true);
+  fakes[0].result = ESP_FAIL;
+  fakes[1].result = ESP_FAIL;
+  bond_start(&bond, fakes);
+
+  publish(&bond, "x");
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 3000));
+  TEST_ASSERT_EQUAL(1, bond.failed);
+  TEST_ASSERT_EQUAL(BG95_BOND_MAX_ATTEMPTS,
+                    bond.links[0].stats.failures + bond.links[1].stats.failures);
+  TEST_ASSERT_TRUE(bond.links[0].up || bond.links[1].up);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void publish_by(bg95_bond_t* bond, const char* payload, int64_t deadline_us)
+{
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_bond_publish_by(bond,
+                                         "gw/telemetry",
+                                         payload,
+                                         strlen(payload),
+                                         QMTPUB_QOS_AT_LEAST_ONCE,
+                                         QMTPUB_RETAIN_DISABLED,
+                                         deadline_us));
+}
+
+static void test_bond_deadlines(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], false);
+  fake_init(&fakes[1], false);
+  bond_start(&bond, fakes);
+  bg95_bond_set_link_up(&bond, 1, false);
+
+  publish(&bond, "a");
+  TEST_ASSERT_TRUE(xSemaphoreTake(fakes[0].entered, pdMS_TO_TICKS(1000)));
+
+  int64_t now_us = esp_timer_get_time();
+  publish_by(&bond, "late", now_us + 3000000);
+  publish_by(&bond, "soon", now_us + 50000);
+  publish(&bond, "none");
+  publish_by(&bond, "early", now_us + 2000000);
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT,
+                    bg95_bond_publish_by(&bond, "t", "p", 1, QMTPUB_QOS_AT_MOST_ONCE, 0, now_us));
+  TEST_ASSERT_EQUAL(1, bond.expired);
+
+  // "soon" misses its deadline behind the stuck publish and is dropped without being sent
+  vTaskDelay(pdMS_TO_TICKS(100));
+  fake_open(&fakes[0]);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(4, fakes[0].delivered);
+  TEST_ASSERT_EQUAL_STRING("a", fakes[0].payloads[0]);
+  TEST_ASSERT_EQUAL_STRING("early", fakes[0].payloads[1]);
+  TEST_ASSERT_EQUAL_STRING("late", fakes[0].payloads[2]);
+  TEST_ASSERT_EQUAL_STRING("none", fakes[0].payloads[3]);
+  TEST_ASSERT_EQUAL(2, bond.expired);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_timeout_past_deadline_is_expiry(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], false);
+  fake_init(&fakes[1], false);
+  fakes[0].result = ESP_ERR_TIMEOUT; // What a scheduled publish returns once its deadline passed
+  bond_start(&bond, fakes);
+  bg95_bond_set_link_up(&bond, 1, false);
+
+  publish_by(&bond, "queued", esp_timer_get_time() + 50000);
+  TEST_ASSERT_TRUE(xSemaphoreTake(fakes[0].entered, pdMS_TO_TICKS(1000)));
+  vTaskDelay(pdMS_TO_TICKS(100));
+  fake_open(&fakes[0]);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(1, bond.expired);
+  TEST_ASSERT_EQUAL(0, bond.links[0].stats.failures);
+  TEST_ASSERT_TRUE(bond.links[0].up);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_full_pool_drops_expired(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+
+  fake_init(&fakes[0], false);
+  fake_init(&fakes[1], false);
+  bond_start(&bond, fakes);
+
+  int64_t deadline_us = esp_timer_get_time() + 50000;
+  for (int i = 0; i < BG95_BOND_MAX_MSGS; i++)
+  {
+    publish_by(&bond, "old", deadline_us);
+  }
+  TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM,
+                    bg95_bond_publish(&bond, "t", "p", 1, QMTPUB_QOS_AT_MOST_ONCE, 0));
+
+  // Two are stuck in flight, the other expired ones make room
+  vTaskDelay(pdMS_TO_TICKS(100));
+  publish(&bond, "new");
+  TEST_ASSERT_EQUAL(BG95_BOND_MAX_MSGS - 2, bond.expired);
+
+  fake_open(&fakes[0]);
+  fake_open(&fakes[1]);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(3, fakes[0].delivered + fakes[1].delivered);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+}
+
+static void test_bond_limits(void)
+{
+  static bg95_bond_t bond;
+  fake_link_t        fakes[2];
+  char               big[BG95_BOND_PAYLOAD_MAX_LEN + 1];
+
+  fake_init(&fakes[0], false);
+  fake_init(&fakes[1], false);
+  bond_start(&bond, fakes);
+
+  memset(big, 'p', sizeof(big));
+  TEST_ASSERT_EQUAL(
+      ESP_ERR_INVALID_SIZE,
+      bg95_bond_publish(&bond, "t", big, sizeof(big), QMTPUB_QOS_AT_MOST_ONCE, 0));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG,
+                    bg95_bond_publish(&bond, NULL, "p", 1, QMTPUB_QOS_AT_MOST_ONCE, 0));
+
+  for (int i = 0; i < BG95_BOND_MAX_MSGS; i++)
+  {
+    publish(&bond, "m");
+  }
+  TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM,
+                    bg95_bond_publish(&bond, "t", "p", 1, QMTPUB_QOS_AT_MOST_ONCE, 0));
+
+  fake_open(&fakes[0]);
+  fake_open(&fakes[1]);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_bond_wait_idle(&bond, 2000));
+  TEST_ASSERT_EQUAL(BG95_BOND_MAX_MSGS, fakes[0].delivered + fakes[1].delivered);
+
+  bg95_bond_deinit(&bond);
+  fake_deinit(&fakes[0]);
+  fake_deinit(&fakes[1]);
+
+  const bg95_bond_link_config_t no_handle = {0};
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_bond_init(&bond, &no_handle, 1));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_bond_init(&bond, &no_handle, 0));
+}
+
+void run_test_bg95_bond_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_bond_spreads_by_depth_and_quality);
+  RUN_TEST(test_bond_qmtstat_fails_over_without_loss);
+  RUN_TEST(test_bond_holds_messages_while_all_links_down);
+  RUN_TEST(test_bond_failures_take_link_down);
+  RUN_TEST(test_bond_rejected_message_is_released);
+  RUN_TEST(test_bond_gives_up_before_every_link_is_down);
+  RUN_TEST(test_bond_deadlines);
+  RUN_TEST(test_bond_timeout_past_deadline_is_expiry);
+  RUN_TEST(test_bond_full_pool_drops_expired);
+  RUN_TEST(test_bond_limits);
+
+  UNITY_END();
+}
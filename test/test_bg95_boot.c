@@ -0,0 +1,266 @@
+#include "bg95_boot.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+// Modem that is already registered, has an address and a connected MQTT client, as after an
+// ESP32 reset that left the modem running
+static const mock_uart_response_t warm_boot_responses[] = {
+    {.expected_cmd = "AT+CREG=2", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CGEREP", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CREG?",
+     .cmd_response = "\r\n+CREG: 2,0\r\n\r\n+CGREG: 2,0\r\n\r\n+CEREG: 2,1\r\n\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+CPIN?;",
+     .cmd_response = "\r\n+CPIN: READY\r\n"
+                     "\r\n+CSQ: 24,0\r\n"
+                     "\r\n+COPS: 0,0,\"Operator Name\",8\r\n"
+                     "\r\n+CGPADDR: 1,\"10.20.30.40\"\r\n"
+                     "\r\n+QMTCONN: 0,3\r\n"
+                     "\r\nOK\r\n",
+     .delay_ms     = 0}};
+
+static const mock_uart_response_t sim_locked_responses[] = {
+    {.expected_cmd = "AT+CREG=2", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CGEREP", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CREG?",
+     .cmd_response = "\r\n+CREG: 2,0\r\n\r\n+CGREG: 2,0\r\n\r\n+CEREG: 2,0\r\n\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+CPIN?;",
+     .cmd_response = "\r\n+CPIN: SIM PIN\r\n\r\n+CSQ: 99,99\r\n\r\n+COPS: 0\r\n"
+                     "\r\n+CGPADDR: 1\r\n\r\nOK\r\n",
+     .delay_ms     = 0}};
+
+// Registered modem with an address whose MQTT client is not connected yet. QMTOPEN only answers
+// "OK", its result URC follows later (see delayed_urc_uart_t).
+static const mock_uart_response_t open_occupied_responses[] = {
+    {.expected_cmd = "AT+CREG=2", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CGEREP", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CREG?",
+     .cmd_response = "\r\n+CREG: 2,0\r\n\r\n+CGREG: 2,0\r\n\r\n+CEREG: 2,1\r\n\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+CPIN?;",
+     .cmd_response = "\r\n+CPIN: READY\r\n"
+                     "\r\n+CSQ: 24,0\r\n"
+                     "\r\n+COPS: 0,0,\"Operator Name\",8\r\n"
+                     "\r\n+CGPADDR: 1,\"10.20.30.40\"\r\n"
+                     "\r\n+QMTCONN: 0,1\r\n"
+                     "\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+QMTOPEN=", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+QMTCONN=",
+     .cmd_response = "\r\nOK\r\n\r\n+QMTCONN: 0,0,0\r\n",
+     .delay_ms     = 0}};
+
+#define RESPONSES_COUNT(r) (sizeof(r) / sizeof((r)[0]))
+
+static int configure_calls = 0;
+
+static esp_err_t count_configure(void* ctx)
+{
+  configure_calls++;
+  return ESP_OK;
+}
+
+// Mock UART that also raises 'urc' 'delay_ms' after a command starting with 'trigger' went out,
+// once the driver has read the command's own response
+typedef struct
+{
+  bg95_uart_interface_t mock;
+  const char*           trigger;
+  const char*           urc;
+  uint32_t              delay_ms;
+  TickType_t            urc_due;
+  bool                  urc_armed;
+} delayed_urc_uart_t;
+
+static esp_err_t delayed_urc_write(const char* data, size_t len, void* context)
+{
+  delayed_urc_uart_t* ctx = (delayed_urc_uart_t*) context;
+  if (len >= strlen(ctx->trigger) && strncmp(data, ctx->trigger, strlen(ctx->trigger)) == 0)
+  {
+    ctx->urc_due   = xTaskGetTickCount() + pdMS_TO_TICKS(ctx->delay_ms);
+    ctx->urc_armed = true;
+  }
+  return ctx->mock.write(data, len, ctx->mock.context);
+}
+
+static esp_err_t delayed_urc_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  delayed_urc_uart_t* ctx = (delayed_urc_uart_t*) context;
+  esp_err_t           err = ESP_OK;
+
+  err      = ctx->mock.read(data, max_len, bytes_read, timeout_ms, ctx->mock.context);
+  bool due = ctx->urc_armed && (int32_t) (xTaskGetTickCount() - ctx->urc_due) >= 0;
+  if (*bytes_read == 0 && due && strlen(ctx->urc) <= max_len)
+  {
+    memcpy(data, ctx->urc, strlen(ctx->urc));
+    *bytes_read    = strlen(ctx->urc);
+    ctx->urc_armed = false;
+    return ESP_OK;
+  }
+  return err;
+}
+
+static void test_boot_phase_names(void)
+{
+  TEST_ASSERT_EQUAL_STRING("attach", bg95_boot_phase_to_str(BG95_BOOT_PHASE_ATTACH));
+  TEST_ASSERT_EQUAL_STRING("first_publish", bg95_boot_phase_to_str(BG95_BOOT_PHASE_FIRST_PUBLISH));
+  TEST_ASSERT_EQUAL_STRING("unknown", bg95_boot_phase_to_str(BG95_BOOT_PHASE_MAX));
+}
+
+static void test_boot_marks_record_phases(void)
+{
+  bg95_boot_timing_t timing = {0};
+  bg95_boot_timing_init(&timing);
+  TEST_ASSERT_EQUAL(0, bg95_boot_time_to_first_publish_ms(&timing));
+
+  bg95_boot_mark(&timing, BG95_BOOT_PHASE_UART, false);
+  bg95_boot_mark(&timing, BG95_BOOT_PHASE_PDP, true);
+  bg95_boot_mark(&timing, BG95_BOOT_PHASE_FIRST_PUBLISH, false);
+
+  TEST_ASSERT_TRUE(timing.done[BG95_BOOT_PHASE_UART]);
+  TEST_ASSERT_TRUE(timing.skipped[BG95_BOOT_PHASE_PDP]);
+  TEST_ASSERT_FALSE(timing.done[BG95_BOOT_PHASE_ATTACH]);
+  TEST_ASSERT_TRUE(timing.first_publish_us > 0);
+
+  // Phases add up to the time from reset to the first publish
+  int64_t sum_us = 0;
+  for (int phase = 0; phase < BG95_BOOT_PHASE_MAX; phase++)
+  {
+    sum_us += timing.phase_us[phase];
+  }
+  TEST_ASSERT_TRUE(sum_us == timing.first_publish_us);
+}
+
+static void test_boot_warm_modem_skips_bring_up(void)
+{
+  bg95_uart_interface_t uart    = {0};
+  bg95_handle_t         handle  = {0};
+  bg95_net_reg_t        net_reg = {0};
+  bg95_boot_timing_t    timing  = {0};
+
+  TEST_ASSERT_EQUAL(
+      ESP_OK, mock_uart_init(&uart, warm_boot_responses, RESPONSES_COUNT(warm_boot_responses)));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&net_reg));
+
+  bg95_boot_config_t config = {.handle            = &handle,
+                               .uart              = &uart,
+                               .net_reg           = &net_reg,
+                               .cid               = 1,
+                               .client_idx        = 0,
+                               .attach_timeout_ms = 1000,
+                               .configure         = count_configure};
+  configure_calls           = 0;
+
+  bg95_boot_timing_init(&timing);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_boot_run(&config, &timing));
+
+  // Nothing left to do: no configuration, no PDP activation, no QMTOPEN/QMTCONN
+  TEST_ASSERT_EQUAL(0, configure_calls);
+  TEST_ASSERT_TRUE(timing.skipped[BG95_BOOT_PHASE_CONFIG]);
+  TEST_ASSERT_TRUE(timing.skipped[BG95_BOOT_PHASE_ATTACH]);
+  TEST_ASSERT_TRUE(timing.skipped[BG95_BOOT_PHASE_PDP]);
+  TEST_ASSERT_TRUE(timing.skipped[BG95_BOOT_PHASE_MQTT_OPEN]);
+  TEST_ASSERT_TRUE(timing.skipped[BG95_BOOT_PHASE_MQTT_CONNECT]);
+  TEST_ASSERT_FALSE(timing.skipped[BG95_BOOT_PHASE_STATUS]);
+
+  bg95_net_reg_deinit(&net_reg);
+  mock_uart_deinit(&uart);
+}
+
+static void test_boot_stops_when_sim_not_ready(void)
+{
+  bg95_uart_interface_t uart    = {0};
+  bg95_handle_t         handle  = {0};
+  bg95_net_reg_t        net_reg = {0};
+  bg95_boot_timing_t    timing  = {0};
+
+  TEST_ASSERT_EQUAL(
+      ESP_OK, mock_uart_init(&uart, sim_locked_responses, RESPONSES_COUNT(sim_locked_responses)));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&net_reg));
+
+  bg95_boot_config_t config = {
+      .handle = &handle, .uart = &uart, .net_reg = &net_reg, .cid = 1, .attach_timeout_ms = 10};
+
+  bg95_boot_timing_init(&timing);
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, bg95_boot_run(&config, &timing));
+  TEST_ASSERT_TRUE(timing.done[BG95_BOOT_PHASE_STATUS]);
+  TEST_ASSERT_FALSE(timing.done[BG95_BOOT_PHASE_ATTACH]);
+
+  bg95_net_reg_deinit(&net_reg);
+  mock_uart_deinit(&uart);
+}
+
+// "+QMTOPEN: 0,2" (client index already open) arriving after the driver returned on "OK" is not
+// a failure, the boot carries on with QMTCONN
+static void test_boot_delayed_open_occupied_continues(void)
+{
+  delayed_urc_uart_t link = {
+      .trigger = "AT+QMTOPEN=", .urc = "\r\n+QMTOPEN: 0,2\r\n", .delay_ms = 50};
+  bg95_uart_interface_t phys = {
+      .write = delayed_urc_write, .read = delayed_urc_read, .context = &link};
+
+  bg95_urc_tap_t     tap     = {0};
+  bg95_handle_t      handle  = {0};
+  bg95_net_reg_t     net_reg = {0};
+  bg95_boot_timing_t timing  = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    mock_uart_init(&link.mock,
+                                   open_occupied_responses,
+                                   RESPONSES_COUNT(open_occupied_responses)));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_init(&handle, &tap.uart));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&net_reg));
+
+  bg95_boot_config_t config = {.handle            = &handle,
+                               .uart              = &tap.uart,
+                               .net_reg           = &net_reg,
+                               .urc_tap           = &tap,
+                               .cid               = 1,
+                               .client_idx        = 0,
+                               .host              = "broker.example.com",
+                               .port              = 1883,
+                               .client_id         = "boot-test",
+                               .attach_timeout_ms = 1000,
+                               .result_timeout_ms = 1000};
+
+  bg95_boot_timing_init(&timing);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_boot_run(&config, &timing));
+  TEST_ASSERT_FALSE(link.urc_armed); // The URC did go out after the "OK"
+  TEST_ASSERT_TRUE(timing.done[BG95_BOOT_PHASE_MQTT_CONNECT]);
+  TEST_ASSERT_FALSE(timing.skipped[BG95_BOOT_PHASE_MQTT_OPEN]);
+  TEST_ASSERT_FALSE(timing.skipped[BG95_BOOT_PHASE_MQTT_CONNECT]);
+
+  bg95_net_reg_deinit(&net_reg);
+  bg95_urc_tap_deinit(&tap);
+  mock_uart_deinit(&link.mock);
+}
+
+static void test_boot_invalid_args(void)
+{
+  bg95_boot_config_t config = {0};
+  bg95_boot_timing_t timing = {0};
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_boot_run(NULL, &timing));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_boot_run(&config, &timing));
+}
+
+void run_test_bg95_boot_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_boot_phase_names);
+  RUN_TEST(test_boot_marks_record_phases);
+  RUN_TEST(test_boot_warm_modem_skips_bring_up);
+  RUN_TEST(test_boot_stops_when_sim_not_ready);
+  RUN_TEST(test_boot_delayed_open_occupied_continues);
+  RUN_TEST(test_boot_invalid_args);
+
+  UNITY_END();
+}
@@ -0,0 +1,214 @@
+#include "bg95_caps.h"
+
+#include <esp_err.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <string.h>
+#include <unity.h>
+
+#define CAPS_QMTCFG_TEST_RESPONSE                                                                 \
+  "\r\n+QMTCFG: \"version\",(0-5),(3,4)\r\n"                                                       \
+  "+QMTCFG: \"pdpcid\",(0-5),(1-16)\r\n"                                                           \
+  "+QMTCFG: \"keepalive\",(0-5),(0-3600)\r\n"                                                      \
+  "OK\r\n"
+
+static const mock_uart_response_t caps_fw_a_responses[] = {
+    {.expected_cmd = "AT+CGMR", .cmd_response = "\r\nBG95M3LAR02A03\r\n\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+QMTCFG=?", .cmd_response = CAPS_QMTCFG_TEST_RESPONSE, .delay_ms = 0},
+    {.expected_cmd = "AT+CSQ=?",
+     .cmd_response = "\r\n+CSQ: (0-31,99),(0-7,99)\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+QMTSUB=?",
+     .cmd_response = "\r\n+QMTSUB: (0-5),(1-65535),\"<topic>\",(0-2)\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+QMTCONN=?",
+     .cmd_response = "\r\n+QMTCONN: (0-5),<clientID>,<username>,<password>\r\nOK\r\n",
+     .delay_ms     = 0}};
+
+// Same tables behind a different firmware revision
+static const mock_uart_response_t caps_fw_b_responses[] = {
+    {.expected_cmd = "AT+CGMR", .cmd_response = "\r\nBG95M3LAR02A04\r\n\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+QMTCFG=?", .cmd_response = CAPS_QMTCFG_TEST_RESPONSE, .delay_ms = 0},
+    {.expected_cmd = "AT+CSQ=?",
+     .cmd_response = "\r\n+CSQ: (0-31,99),(0-7,99)\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+QMTSUB=?",
+     .cmd_response = "\r\n+QMTSUB: (0-5),(1-65535),\"<topic>\",(0-2)\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+QMTCONN=?",
+     .cmd_response = "\r\n+QMTCONN: (0-5),<clientID>,<username>,<password>\r\nOK\r\n",
+     .delay_ms     = 0}};
+
+// Firmware whose QMTSUB test command fails, e.g. a busy modem during the probe
+static const mock_uart_response_t caps_partial_responses[] = {
+    {.expected_cmd = "AT+CGMR", .cmd_response = "\r\nBG95M3LAR02A05\r\n\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+QMTCFG=?", .cmd_response = CAPS_QMTCFG_TEST_RESPONSE, .delay_ms = 0},
+    {.expected_cmd = "AT+CSQ=?",
+     .cmd_response = "\r\n+CSQ: (0-31,99),(0-7,99)\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+QMTSUB=?", .cmd_response = "\r\nERROR\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+QMTCONN=?",
+     .cmd_response = "\r\n+QMTCONN: (0-5),<clientID>,<username>,<password>\r\nOK\r\n",
+     .delay_ms     = 0}};
+
+#define RESPONSES_COUNT(r) (sizeof(r) / sizeof((r)[0]))
+
+// Counts the command lines that actually hit the wire
+typedef struct
+{
+  bg95_uart_interface_t mock;
+  uint32_t              write_count;
+} counting_uart_ctx_t;
+
+static esp_err_t counting_write(const char* data, size_t len, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  ctx->write_count++;
+  return ctx->mock.write(data, len, ctx->mock.context);
+}
+
+static esp_err_t counting_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  return ctx->mock.read(data, max_len, bytes_read, timeout_ms, ctx->mock.context);
+}
+
+static void erase_stored_caps(void)
+{
+  nvs_handle_t nvs;
+  TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+  if (nvs_open(BG95_CAPS_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK)
+  {
+    nvs_erase_key(nvs, BG95_CAPS_NVS_KEY);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+  }
+}
+
+static void test_caps_read_fw_rev(void)
+{
+  bg95_uart_interface_t uart                             = {0};
+  char                  fw_rev[BG95_CAPS_FW_REV_MAX_LEN] = {0};
+
+  TEST_ASSERT_EQUAL(
+      ESP_OK, mock_uart_init(&uart, caps_fw_a_responses, RESPONSES_COUNT(caps_fw_a_responses)));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_caps_read_fw_rev(&uart, fw_rev, sizeof(fw_rev)));
+  TEST_ASSERT_EQUAL_STRING("BG95M3LAR02A03", fw_rev);
+  mock_uart_deinit(&uart);
+}
+
+static void test_caps_fallback_ranges_before_probe(void)
+{
+  TEST_ASSERT_TRUE(bg95_caps_check_client_idx(NULL, 0));
+  TEST_ASSERT_FALSE(bg95_caps_check_client_idx(NULL, -1));
+  TEST_ASSERT_TRUE(bg95_caps_check_sub_qos(NULL, 2));
+  TEST_ASSERT_FALSE(bg95_caps_check_sub_qos(NULL, 3));
+  TEST_ASSERT_TRUE(bg95_caps_check_mqtt_version(NULL, QMTCFG_VERSION_MQTT_3_1_1));
+}
+
+static void test_caps_probe_once_per_firmware(void)
+{
+  counting_uart_ctx_t   ctx    = {0};
+  bg95_uart_interface_t uart   = {.write = counting_write, .read = counting_read};
+  bg95_caps_t           caps   = {0};
+  bool                  probed = false;
+
+  uart.context = &ctx;
+  erase_stored_caps();
+
+  // First boot: CGMR plus the four test commands
+  TEST_ASSERT_EQUAL(
+      ESP_OK, mock_uart_init(&ctx.mock, caps_fw_a_responses, RESPONSES_COUNT(caps_fw_a_responses)));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_caps_load_or_probe(&uart, &caps, &probed));
+  TEST_ASSERT_TRUE(probed);
+  TEST_ASSERT_EQUAL(5, ctx.write_count);
+  TEST_ASSERT_TRUE(caps.present.has_qmtcfg);
+  TEST_ASSERT_EQUAL(3600, caps.qmtcfg.keep_alive_max);
+  TEST_ASSERT_EQUAL(2, caps.qmtsub.qos_max);
+
+  // Same firmware: only CGMR
+  ctx.write_count = 0;
+  memset(&caps, 0, sizeof(caps));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_caps_load_or_probe(&uart, &caps, &probed));
+  TEST_ASSERT_FALSE(probed);
+  TEST_ASSERT_EQUAL(1, ctx.write_count);
+  TEST_ASSERT_EQUAL_STRING("BG95M3LAR02A03", caps.fw_rev);
+  TEST_ASSERT_EQUAL(3600, caps.qmtcfg.keep_alive_max);
+  mock_uart_deinit(&ctx.mock);
+
+  // Firmware update invalidates the cache
+  ctx.write_count = 0;
+  TEST_ASSERT_EQUAL(
+      ESP_OK, mock_uart_init(&ctx.mock, caps_fw_b_responses, RESPONSES_COUNT(caps_fw_b_responses)));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_caps_load_or_probe(&uart, &caps, &probed));
+  TEST_ASSERT_TRUE(probed);
+  TEST_ASSERT_EQUAL_STRING("BG95M3LAR02A04", caps.fw_rev);
+  mock_uart_deinit(&ctx.mock);
+
+  erase_stored_caps();
+}
+
+static void test_caps_partial_probe_is_not_cached(void)
+{
+  counting_uart_ctx_t   ctx    = {0};
+  bg95_uart_interface_t uart   = {.write = counting_write, .read = counting_read};
+  bg95_caps_t           caps   = {0};
+  bool                  probed = false;
+
+  uart.context = &ctx;
+  erase_stored_caps();
+
+  TEST_ASSERT_EQUAL(
+      ESP_OK,
+      mock_uart_init(&ctx.mock, caps_partial_responses, RESPONSES_COUNT(caps_partial_responses)));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_caps_load_or_probe(&uart, &caps, &probed));
+  TEST_ASSERT_TRUE(probed);
+  TEST_ASSERT_FALSE(bg95_caps_is_complete(&caps));
+  TEST_ASSERT_FALSE(caps.present.has_qmtsub);
+
+  // The missing section falls back to the driver limits
+  TEST_ASSERT_TRUE(bg95_caps_check_sub_qos(&caps, 2));
+  TEST_ASSERT_FALSE(bg95_caps_check_sub_qos(&caps, 3));
+
+  // Nothing was stored, so the next boot probes again
+  ctx.write_count = 0;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_caps_load_or_probe(&uart, &caps, &probed));
+  TEST_ASSERT_TRUE(probed);
+  TEST_ASSERT_EQUAL(5, ctx.write_count);
+  mock_uart_deinit(&ctx.mock);
+
+  erase_stored_caps();
+}
+
+static void test_caps_checks_use_probed_ranges(void)
+{
+  bg95_caps_t caps = {0};
+
+  caps.present.has_qmtcfg            = true;
+  caps.qmtcfg.client_idx_min         = 0;
+  caps.qmtcfg.client_idx_max         = 2;
+  caps.qmtcfg.keep_alive_min         = 0;
+  caps.qmtcfg.keep_alive_max         = 600;
+  caps.qmtcfg.num_supported_versions = 1;
+  caps.qmtcfg.supported_versions[0]  = QMTCFG_VERSION_MQTT_3_1_1;
+
+  TEST_ASSERT_TRUE(bg95_caps_check_client_idx(&caps, 2));
+  TEST_ASSERT_FALSE(bg95_caps_check_client_idx(&caps, 3));
+  TEST_ASSERT_TRUE(bg95_caps_check_keepalive(&caps, 600));
+  TEST_ASSERT_FALSE(bg95_caps_check_keepalive(&caps, 601));
+  TEST_ASSERT_FALSE(bg95_caps_check_mqtt_version(&caps, QMTCFG_VERSION_MQTT_3_1));
+}
+
+void run_test_bg95_caps_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_caps_read_fw_rev);
+  RUN_TEST(test_caps_fallback_ranges_before_probe);
+  RUN_TEST(test_caps_probe_once_per_firmware);
+  RUN_TEST(test_caps_partial_probe_is_not_cached);
+  RUN_TEST(test_caps_checks_use_probed_ranges);
+
+  UNITY_END();
+}
@@ -0,0 +1,298 @@
+#include "bg95_cmux.h"
+#include "bg95_cmux_mock.h"
+#include "bg95_raw_at.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static const mock_uart_response_t cmux_control_responses[] = {
+    {.expected_cmd = "AT+CSQ", .cmd_response = "\r\n+CSQ: 24,0\r\n\r\nOK\r\n", .delay_ms = 0}};
+
+static const mock_uart_response_t cmux_bulk_responses[] = {
+    {.expected_cmd = "AT+CPIN?", .cmd_response = "\r\n+CPIN: READY\r\n\r\nOK\r\n", .delay_ms = 0}};
+
+#define CMUX_CONCURRENT_ROUNDS 20
+
+typedef struct
+{
+  bg95_uart_interface_t* uart;
+  const char*            cmd;
+  const char*            expected;
+  SemaphoreHandle_t      done;
+  int                    ok_count;
+} cmux_caller_ctx_t;
+
+static void cmux_caller_task(void* pvParameters)
+{
+  cmux_caller_ctx_t* caller = (cmux_caller_ctx_t*) pvParameters;
+  char               response[128];
+
+  for (int i = 0; i < CMUX_CONCURRENT_ROUNDS; i++)
+  {
+    if (bg95_raw_at_send(caller->uart, caller->cmd, response, sizeof(response), 1000) == ESP_OK &&
+        strstr(response, caller->expected) != NULL)
+    {
+      caller->ok_count++;
+    }
+  }
+  xSemaphoreGive(caller->done);
+  vTaskDelete(NULL);
+}
+
+typedef struct
+{
+  uint8_t dlci;
+  uint8_t control;
+  uint8_t info[BG95_CMUX_N1];
+  size_t  len;
+  int     count;
+} captured_frame_t;
+
+static void capture_frame(uint8_t dlci, uint8_t control, const uint8_t* info, size_t len, void* ctx)
+{
+  captured_frame_t* captured = (captured_frame_t*) ctx;
+  captured->dlci             = dlci;
+  captured->control          = control;
+  captured->len              = len;
+  memcpy(captured->info, info, len);
+  captured->count++;
+}
+
+static void test_cmux_encode_reference_frames(void)
+{
+  // SABM and UA on DLCI 0 as given in 27.010
+  const uint8_t sabm[] = {0xF9, 0x03, 0x3F, 0x01, 0x1C, 0xF9};
+  const uint8_t ua[]   = {0xF9, 0x03, 0x73, 0x01, 0xD7, 0xF9};
+  uint8_t       frame[BG95_CMUX_FRAME_MAX_LEN];
+
+  TEST_ASSERT_EQUAL(sizeof(sabm),
+                    bg95_cmux_encode_frame(
+                        0, true, BG95_CMUX_SABM | BG95_CMUX_PF, NULL, 0, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_MEMORY(sabm, frame, sizeof(sabm));
+
+  TEST_ASSERT_EQUAL(
+      sizeof(ua),
+      bg95_cmux_encode_frame(0, true, BG95_CMUX_UA | BG95_CMUX_PF, NULL, 0, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_MEMORY(ua, frame, sizeof(ua));
+
+  // Our UA answering a DISC from the modem on DLCI 1 is a response, C/R = 0
+  const uint8_t ua_response[] = {0xF9, 0x05, 0x73, 0x01, 0x74, 0xF9};
+  TEST_ASSERT_EQUAL(
+      sizeof(ua_response),
+      bg95_cmux_encode_frame(1, false, BG95_CMUX_UA | BG95_CMUX_PF, NULL, 0, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_MEMORY(ua_response, frame, sizeof(ua_response));
+
+  // Does not fit
+  TEST_ASSERT_EQUAL(0, bg95_cmux_encode_frame(0, true, BG95_CMUX_SABM, NULL, 0, frame, 5));
+}
+
+static void test_cmux_decoder_byte_by_byte(void)
+{
+  const char*         payload  = "AT+CSQ\r\n";
+  captured_frame_t    captured = {0};
+  bg95_cmux_decoder_t decoder;
+  uint8_t             frame[BG95_CMUX_FRAME_MAX_LEN];
+
+  size_t frame_len = bg95_cmux_encode_frame(
+      2, true, BG95_CMUX_UIH, (const uint8_t*) payload, strlen(payload), frame, sizeof(frame));
+  TEST_ASSERT_GREATER_THAN(0, frame_len);
+
+  bg95_cmux_decoder_init(&decoder, capture_frame, &captured);
+  const uint8_t extra_flag = BG95_CMUX_FLAG;
+  bg95_cmux_decoder_feed(&decoder, &extra_flag, 1);
+  for (size_t i = 0; i < frame_len; i++)
+  {
+    bg95_cmux_decoder_feed(&decoder, &frame[i], 1);
+  }
+
+  TEST_ASSERT_EQUAL(1, captured.count);
+  TEST_ASSERT_EQUAL(2, captured.dlci);
+  TEST_ASSERT_EQUAL(BG95_CMUX_UIH, captured.control);
+  TEST_ASSERT_EQUAL(strlen(payload), captured.len);
+  TEST_ASSERT_EQUAL_MEMORY(payload, captured.info, captured.len);
+
+  // Corrupted FCS is counted and dropped
+  frame[frame_len - 2] ^= 0x55;
+  bg95_cmux_decoder_feed(&decoder, frame, frame_len);
+  TEST_ASSERT_EQUAL(1, captured.count);
+  TEST_ASSERT_EQUAL(1, decoder.fcs_errors);
+}
+
+static void test_cmux_channels_over_mock(void)
+{
+  bg95_uart_interface_t  control_backend = {0};
+  bg95_uart_interface_t  bulk_backend    = {0};
+  bg95_uart_interface_t* control         = NULL;
+  bg95_uart_interface_t* bulk            = NULL;
+  bg95_cmux_mock_t       mock;
+  bg95_cmux_t            mux;
+  char                   response[128];
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&control_backend, cmux_control_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&bulk_backend, cmux_bulk_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_init(&mock));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_attach(&mock, 1, &control_backend));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_attach(&mock, 2, &bulk_backend));
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_init(&mux, &mock.uart, 115200));
+  TEST_ASSERT_TRUE(mock.muxing);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_open_channel(&mux, 1, &control));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_open_channel(&mux, 2, &bulk));
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_send(bulk, "AT+CPIN?", response, sizeof(response), 1000));
+  TEST_ASSERT_NOT_NULL(strstr(response, "+CPIN: READY"));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_send(control, "AT+CSQ", response, sizeof(response), 1000));
+  TEST_ASSERT_NOT_NULL(strstr(response, "+CSQ: 24,0"));
+
+  // No backend behind DLCI 3, the modem answers DM
+  bg95_uart_interface_t* unused = NULL;
+  TEST_ASSERT_EQUAL(ESP_FAIL, bg95_cmux_open_channel(&mux, 3, &unused));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_cmux_open_channel(&mux, 0, &unused));
+  TEST_ASSERT_EQUAL(0, mux.decoder.fcs_errors);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_deinit(&mux));
+  TEST_ASSERT_FALSE(mock.muxing);
+
+  bg95_cmux_mock_deinit(&mock);
+  mock_uart_deinit(&bulk_backend);
+  mock_uart_deinit(&control_backend);
+}
+
+static void test_cmux_channels_run_concurrently(void)
+{
+  bg95_uart_interface_t control_backend = {0};
+  bg95_uart_interface_t bulk_backend    = {0};
+  bg95_cmux_mock_t      mock;
+  bg95_cmux_t           mux;
+  cmux_caller_ctx_t     callers[2] = {{.cmd = "AT+CSQ", .expected = "+CSQ: 24,0"},
+                                      {.cmd = "AT+CPIN?", .expected = "+CPIN: READY"}};
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&control_backend, cmux_control_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&bulk_backend, cmux_bulk_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_init(&mock));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_attach(&mock, 1, &control_backend));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_attach(&mock, 2, &bulk_backend));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_init(&mux, &mock.uart, 115200));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_open_channel(&mux, 1, &callers[0].uart));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_open_channel(&mux, 2, &callers[1].uart));
+
+  SemaphoreHandle_t done = xSemaphoreCreateCounting(2, 0);
+  for (int i = 0; i < 2; i++)
+  {
+    callers[i].done = done;
+    TEST_ASSERT_EQUAL(pdPASS,
+                      xTaskCreate(cmux_caller_task, "cmux_caller", 4096, &callers[i], 5, NULL));
+  }
+  for (int i = 0; i < 2; i++)
+  {
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(10000)));
+  }
+
+  // Neither channel saw the other's responses
+  TEST_ASSERT_EQUAL(CMUX_CONCURRENT_ROUNDS, callers[0].ok_count);
+  TEST_ASSERT_EQUAL(CMUX_CONCURRENT_ROUNDS, callers[1].ok_count);
+  TEST_ASSERT_EQUAL(0, mux.stats.dropped_bytes);
+
+  vSemaphoreDelete(done);
+  bg95_cmux_deinit(&mux);
+  bg95_cmux_mock_deinit(&mock);
+  mock_uart_deinit(&bulk_backend);
+  mock_uart_deinit(&control_backend);
+}
+
+static void test_cmux_refused_control_channel_leaves_mux_mode(void)
+{
+  bg95_cmux_mock_t mock;
+  bg95_cmux_t      mux;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_init(&mock));
+  mock.refuse_control = true;
+
+  // AT+CMUX went through, so the mux must be closed down again before plain AT is used
+  TEST_ASSERT_EQUAL(ESP_FAIL, bg95_cmux_init(&mux, &mock.uart, 115200));
+  TEST_ASSERT_FALSE(mock.muxing);
+  TEST_ASSERT_EQUAL(BG95_CMUX_MSG_CLD, mock.last_ctrl_msg);
+
+  bg95_cmux_mock_deinit(&mock);
+}
+
+typedef struct
+{
+  bg95_cmux_mock_t* mock;
+  uint8_t           dlci;
+} flow_release_ctx_t;
+
+static void flow_release_task(void* pvParameters)
+{
+  flow_release_ctx_t* ctx   = (flow_release_ctx_t*) pvParameters;
+  const uint8_t       msc[] = {(uint8_t) ((ctx->dlci << 2) | BG95_CMUX_CR | BG95_CMUX_EA),
+                               BG95_CMUX_V24_RTC | BG95_CMUX_V24_RTR | BG95_CMUX_EA};
+
+  vTaskDelay(pdMS_TO_TICKS(100));
+  bg95_cmux_mock_send_control(ctx->mock, BG95_CMUX_MSG_MSC, msc, sizeof(msc));
+  vTaskDelete(NULL);
+}
+
+static void test_cmux_modem_status_holds_writes(void)
+{
+  bg95_uart_interface_t  backend = {0};
+  bg95_uart_interface_t* channel = NULL;
+  bg95_cmux_mock_t       mock;
+  bg95_cmux_t            mux;
+  char                   response[128];
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&backend, cmux_control_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_init(&mock));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_attach(&mock, 1, &backend));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_init(&mux, &mock.uart, 115200));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_open_channel(&mux, 1, &channel));
+
+  // MSC with FC set: recorded, acknowledged, and writes on DLCI 1 wait until it is lifted
+  const uint8_t fc_msc[] = {(1 << 2) | BG95_CMUX_CR | BG95_CMUX_EA,
+                            BG95_CMUX_V24_FC | BG95_CMUX_V24_RTC | BG95_CMUX_EA};
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_cmux_mock_send_control(&mock, BG95_CMUX_MSG_MSC, fc_msc, sizeof(fc_msc)));
+  for (int i = 0; i < 100 && !(bg95_cmux_modem_signals(&mux, 1) & BG95_CMUX_V24_FC); i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  TEST_ASSERT_EQUAL(fc_msc[1], bg95_cmux_modem_signals(&mux, 1));
+  TEST_ASSERT_EQUAL(BG95_CMUX_MSG_MSC & ~BG95_CMUX_CR, mock.last_ctrl_msg);
+
+  flow_release_ctx_t release = {.mock = &mock, .dlci = 1};
+  TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(flow_release_task, "flow_release", 2048, &release, 5, NULL));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_send(channel, "AT+CSQ", response, sizeof(response), 1000));
+  TEST_ASSERT_NOT_NULL(strstr(response, "+CSQ: 24,0"));
+  TEST_ASSERT_EQUAL(1, mux.stats.flow_waits);
+  TEST_ASSERT_FALSE(bg95_cmux_modem_signals(&mux, 1) & BG95_CMUX_V24_FC);
+
+  // Unknown commands are answered with NSC
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_mock_send_control(&mock, 0x23, NULL, 0)); // TEST
+  for (int i = 0; i < 100 && mock.last_ctrl_msg != BG95_CMUX_MSG_NSC; i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  TEST_ASSERT_EQUAL(BG95_CMUX_MSG_NSC, mock.last_ctrl_msg);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_cmux_deinit(&mux));
+  bg95_cmux_mock_deinit(&mock);
+  mock_uart_deinit(&backend);
+}
+
+void run_test_bg95_cmux_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_cmux_encode_reference_frames);
+  RUN_TEST(test_cmux_decoder_byte_by_byte);
+  RUN_TEST(test_cmux_channels_over_mock);
+  RUN_TEST(test_cmux_channels_run_concurrently);
+  RUN_TEST(test_cmux_refused_control_channel_leaves_mux_mode);
+  RUN_TEST(test_cmux_modem_status_holds_writes);
+
+  UNITY_END();
+}
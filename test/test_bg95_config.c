@@ -0,0 +1,192 @@
+#include "bg95_config.h"
+
+#include <esp_err.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <string.h>
+#include <unity.h>
+
+// Batched read back, keepalive differs from the desired 60 s
+static const mock_uart_response_t config_responses[] = {
+    {.expected_cmd = "AT+QMTCFG=\"version\",0;",
+     .cmd_response = "\r\n+QMTCFG: \"version\",4\r\n"
+                     "\r\n+QMTCFG: \"keepalive\",120\r\n"
+                     "\r\n+QMTCFG: \"session\",1\r\n"
+                     "\r\n+CGDCONT: 1,\"IP\",\"internet\",\"0.0.0.0\",0,0,0\r\n"
+                     "\r\nOK\r\n",
+     .delay_ms     = 0},
+    {.expected_cmd = "AT+QMTCFG=\"keepalive\",0,60", .cmd_response = "\r\nOK\r\n", .delay_ms = 0}};
+
+// Modem already holds every desired value
+static const mock_uart_response_t config_in_sync_responses[] = {
+    {.expected_cmd = "AT+QMTCFG=\"version\",0;",
+     .cmd_response = "\r\n+QMTCFG: \"version\",4\r\n"
+                     "\r\n+QMTCFG: \"keepalive\",60\r\n"
+                     "\r\n+QMTCFG: \"session\",1\r\n"
+                     "\r\n+CGDCONT: 1,\"IP\",\"internet\",\"10.1.2.3\",0,0,0\r\n"
+                     "\r\nOK\r\n",
+     .delay_ms     = 0}};
+
+// Counts the command lines that actually hit the wire
+typedef struct
+{
+  bg95_uart_interface_t mock;
+  uint32_t              write_count;
+} counting_uart_ctx_t;
+
+static esp_err_t counting_write(const char* data, size_t len, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  ctx->write_count++;
+  return ctx->mock.write(data, len, ctx->mock.context);
+}
+
+static esp_err_t counting_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  return ctx->mock.read(data, max_len, bytes_read, timeout_ms, ctx->mock.context);
+}
+
+static void build_desired_config(bg95_config_t* config)
+{
+  bg95_config_init(config);
+
+  qmtcfg_write_params_t version              = {.type = QMTCFG_TYPE_VERSION};
+  version.params.version.client_idx          = 0;
+  version.params.version.version             = QMTCFG_VERSION_MQTT_3_1_1;
+  version.params.version.present.has_version = true;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_set_qmtcfg(config, &version));
+
+  qmtcfg_write_params_t keepalive                        = {.type = QMTCFG_TYPE_KEEPALIVE};
+  keepalive.params.keepalive.client_idx                  = 0;
+  keepalive.params.keepalive.keep_alive_time             = 60;
+  keepalive.params.keepalive.present.has_keep_alive_time = true;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_set_qmtcfg(config, &keepalive));
+
+  qmtcfg_write_params_t session                    = {.type = QMTCFG_TYPE_SESSION};
+  session.params.session.client_idx                = 0;
+  session.params.session.clean_session             = QMTCFG_CLEAN_SESSION_ENABLE;
+  session.params.session.present.has_clean_session = true;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_set_qmtcfg(config, &session));
+
+  cgdcont_write_params_t cgdcont = {.cid      = 1,
+                                    .pdp_type = CGDCONT_PDP_TYPE_IP,
+                                    .present  = {.has_cid = 1, .has_pdp_type = 1, .has_apn = 1}};
+  strcpy(cgdcont.apn, "internet");
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_set_cgdcont(config, &cgdcont));
+}
+
+static void test_config_header_and_setters(void)
+{
+  static bg95_config_t config;
+  bg95_config_init(&config);
+  TEST_ASSERT_TRUE(bg95_config_is_valid(&config));
+
+  config.version++;
+  TEST_ASSERT_FALSE(bg95_config_is_valid(&config));
+  TEST_ASSERT_FALSE(bg95_config_is_valid(NULL));
+
+  bg95_config_init(&config);
+  qmtcfg_write_params_t  bad_type = {.type = QMTCFG_TYPE_MAX};
+  cgdcont_write_params_t no_cid   = {.cid = 1, .pdp_type = CGDCONT_PDP_TYPE_IP};
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_config_set_qmtcfg(&config, &bad_type));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_config_set_cgdcont(&config, &no_cid));
+  TEST_ASSERT_FALSE(config.has_cgdcont);
+}
+
+static void test_config_apply_writes_only_differences(void)
+{
+  counting_uart_ctx_t       ctx   = {0};
+  bg95_uart_interface_t     uart  = {.write = counting_write, .read = counting_read};
+  bg95_config_apply_stats_t stats = {0};
+  static bg95_config_t      config;
+
+  uart.context = &ctx;
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&ctx.mock, config_responses, 2));
+  build_desired_config(&config);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_apply(&uart, &config, &stats));
+
+  // One batched read back plus the single keepalive write
+  TEST_ASSERT_EQUAL(2, ctx.write_count);
+  TEST_ASSERT_EQUAL(4, stats.read_back);
+  TEST_ASSERT_EQUAL(3, stats.unchanged);
+  TEST_ASSERT_EQUAL(1, stats.writes_sent);
+  TEST_ASSERT_EQUAL(0, stats.writes_failed);
+
+  mock_uart_deinit(&ctx.mock);
+}
+
+static void test_config_apply_in_sync_costs_one_round_trip(void)
+{
+  counting_uart_ctx_t       ctx   = {0};
+  bg95_uart_interface_t     uart  = {.write = counting_write, .read = counting_read};
+  bg95_config_apply_stats_t stats = {0};
+  static bg95_config_t      config;
+
+  uart.context = &ctx;
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&ctx.mock, config_in_sync_responses, 1));
+  build_desired_config(&config);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_apply(&uart, &config, &stats));
+  TEST_ASSERT_EQUAL(1, ctx.write_count);
+  TEST_ASSERT_EQUAL(4, stats.unchanged);
+  TEST_ASSERT_EQUAL(0, stats.writes_sent);
+
+  mock_uart_deinit(&ctx.mock);
+}
+
+static void test_config_apply_empty_config_sends_nothing(void)
+{
+  counting_uart_ctx_t   ctx  = {0};
+  bg95_uart_interface_t uart = {.write = counting_write, .read = counting_read};
+  static bg95_config_t  config;
+
+  uart.context = &ctx;
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&ctx.mock, config_in_sync_responses, 1));
+  bg95_config_init(&config);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_apply(&uart, &config, NULL));
+  TEST_ASSERT_EQUAL(0, ctx.write_count);
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_config_apply(NULL, &config, NULL));
+
+  mock_uart_deinit(&ctx.mock);
+}
+
+// NVS records the last applied config, anything else (or nothing) is "not applied"
+static void test_config_stored_record_matches_only_same_config(void)
+{
+  static bg95_config_t config;
+  nvs_handle_t         nvs;
+
+  TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+  if (nvs_open(BG95_CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK)
+  {
+    nvs_erase_key(nvs, BG95_CONFIG_NVS_KEY);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+  }
+
+  build_desired_config(&config);
+  TEST_ASSERT_FALSE(bg95_config_is_stored(&config));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_config_save(&config));
+  TEST_ASSERT_TRUE(bg95_config_is_stored(&config));
+
+  config.qmtcfg[QMTCFG_TYPE_KEEPALIVE].params.keepalive.keep_alive_time = 90;
+  TEST_ASSERT_FALSE(bg95_config_is_stored(&config));
+  TEST_ASSERT_FALSE(bg95_config_is_stored(NULL));
+}
+
+void run_test_bg95_config_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_config_header_and_setters);
+  RUN_TEST(test_config_apply_writes_only_differences);
+  RUN_TEST(test_config_apply_in_sync_costs_one_round_trip);
+  RUN_TEST(test_config_apply_empty_config_sends_nothing);
+  RUN_TEST(test_config_stored_record_matches_only_same_config);
+
+  UNITY_END();
+}
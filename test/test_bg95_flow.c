@@ -0,0 +1,228 @@
+#include "bg95_flow.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+// Modem with AT+IFC; with flow control on at the host but no handshake wires, nothing gets out
+typedef struct
+{
+  bool wired;
+  bool host_flow;
+  bool modem_flow;
+  char response[32];
+} fake_flow_line_t;
+
+static esp_err_t fake_flow_write(const char* data, size_t len, void* context)
+{
+  fake_flow_line_t* line = (fake_flow_line_t*) context;
+
+  line->response[0] = '\0';
+  if (line->host_flow && !line->wired)
+  {
+    return ESP_OK; // CTS never asserted
+  }
+
+  strcpy(line->response, "\r\nOK\r\n");
+  if (strncmp(data, "AT+IFC=2,2", 10) == 0)
+  {
+    line->modem_flow = true;
+  }
+  else if (strncmp(data, "AT+IFC=0,0", 10) == 0)
+  {
+    line->modem_flow = false;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t fake_flow_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  fake_flow_line_t* line = (fake_flow_line_t*) context;
+  size_t            n    = strlen(line->response);
+
+  if (n == 0)
+  {
+    *bytes_read = 0;
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    return ESP_ERR_TIMEOUT;
+  }
+  n = n < max_len ? n : max_len;
+  memcpy(data, line->response, n);
+  line->response[0] = '\0';
+  *bytes_read       = n;
+  return ESP_OK;
+}
+
+static esp_err_t fake_set_flow(bool enable, void* ctx)
+{
+  ((fake_flow_line_t*) ctx)->host_flow = enable;
+  return ESP_OK;
+}
+
+static void test_flow_enable_wired(void)
+{
+  fake_flow_line_t      line = {.wired = true};
+  bg95_uart_interface_t uart = {.write = fake_flow_write, .read = fake_flow_read};
+  bg95_flow_t           flow;
+
+  uart.context = &line;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_init(&flow));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_enable(&flow, &uart, fake_set_flow, &line));
+  TEST_ASSERT_TRUE(flow.enabled);
+  TEST_ASSERT_TRUE(line.host_flow);
+  TEST_ASSERT_TRUE(line.modem_flow);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_disable(&flow, &uart, fake_set_flow, &line));
+  TEST_ASSERT_FALSE(flow.enabled);
+  TEST_ASSERT_FALSE(line.host_flow);
+  TEST_ASSERT_FALSE(line.modem_flow);
+
+  bg95_flow_deinit(&flow);
+}
+
+static void test_flow_falls_back_when_not_wired(void)
+{
+  fake_flow_line_t      line = {.wired = false};
+  bg95_uart_interface_t uart = {.write = fake_flow_write, .read = fake_flow_read};
+  bg95_flow_t           flow;
+
+  uart.context = &line;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_init(&flow));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE,
+                    bg95_flow_enable(&flow, &uart, fake_set_flow, &line));
+  TEST_ASSERT_FALSE(flow.enabled);
+  TEST_ASSERT_FALSE(line.host_flow);
+  TEST_ASSERT_FALSE(line.modem_flow);
+
+  bg95_flow_deinit(&flow);
+}
+
+static void test_flow_counts_uart_events(void)
+{
+  bg95_flow_t   flow;
+  QueueHandle_t queue    = xQueueCreate(8, sizeof(uart_event_t));
+  uart_event_t  events[] = {{.type = UART_DATA, .size = 10},
+                            {.type = UART_FIFO_OVF},
+                            {.type = UART_BUFFER_FULL},
+                            {.type = UART_FRAME_ERR},
+                            {.type = UART_FRAME_ERR}};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_init(&flow));
+  TEST_ASSERT_FALSE(bg95_flow_has_rx_loss(&flow));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_watch_events(&flow, queue));
+
+  // One at a time, an overrun drops whatever is queued behind it
+  for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++)
+  {
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueSend(queue, &events[i], 0));
+    for (int j = 0; j < 50 && uxQueueMessagesWaiting(queue) > 0; j++)
+    {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  }
+  vTaskDelay(pdMS_TO_TICKS(20));
+
+  TEST_ASSERT_EQUAL(1, flow.stats.fifo_overflows);
+  TEST_ASSERT_EQUAL(1, flow.stats.buffer_full);
+  TEST_ASSERT_EQUAL(2, flow.stats.framing_errors);
+  TEST_ASSERT_EQUAL(0, flow.stats.parity_errors);
+  TEST_ASSERT_TRUE(bg95_flow_has_rx_loss(&flow));
+
+  bg95_flow_deinit(&flow);
+  vQueueDelete(queue);
+}
+
+typedef struct
+{
+  uart_event_type_t types[8];
+  size_t            count;
+} seen_events_t;
+
+static void record_seen_event(const uart_event_t* event, void* ctx)
+{
+  seen_events_t* seen = (seen_events_t*) ctx;
+  if (seen->count < sizeof(seen->types) / sizeof(seen->types[0]))
+  {
+    seen->types[seen->count++] = event->type;
+  }
+}
+
+static void test_flow_passes_events_on(void)
+{
+  bg95_flow_t   flow;
+  seen_events_t seen     = {0};
+  QueueHandle_t queue    = xQueueCreate(8, sizeof(uart_event_t));
+  uart_event_t  events[] = {{.type = UART_DATA, .size = 10},
+                            {.type = UART_PATTERN_DET},
+                            {.type = UART_FRAME_ERR}};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_init(&flow));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_set_event_fn(&flow, record_seen_event, &seen));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_watch_events(&flow, queue));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, bg95_flow_set_event_fn(&flow, NULL, NULL));
+
+  for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++)
+  {
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueSend(queue, &events[i], 0));
+  }
+  for (int i = 0; i < 50 && seen.count < 3; i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+
+  // Data events reach the callback as well, error events are counted before they do
+  TEST_ASSERT_EQUAL(3, seen.count);
+  TEST_ASSERT_EQUAL(UART_DATA, seen.types[0]);
+  TEST_ASSERT_EQUAL(UART_PATTERN_DET, seen.types[1]);
+  TEST_ASSERT_EQUAL(UART_FRAME_ERR, seen.types[2]);
+  TEST_ASSERT_EQUAL(1, flow.stats.framing_errors);
+
+  bg95_flow_deinit(&flow);
+  vQueueDelete(queue);
+}
+
+static void test_flow_overrun_drops_queued_events(void)
+{
+  bg95_flow_t   flow;
+  seen_events_t seen     = {0};
+  QueueHandle_t queue    = xQueueCreate(8, sizeof(uart_event_t));
+  uart_event_t  events[] = {{.type = UART_FIFO_OVF},
+                            {.type = UART_DATA, .size = 10},
+                            {.type = UART_PATTERN_DET}};
+
+  // Queued before the watcher starts, so the overrun is seen with the rest still waiting
+  for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++)
+  {
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueSend(queue, &events[i], 0));
+  }
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_init(&flow));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_set_event_fn(&flow, record_seen_event, &seen));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_flow_watch_events(&flow, queue));
+  vTaskDelay(pdMS_TO_TICKS(50));
+
+  // The data events describe input the callback flushes, they never reach it
+  TEST_ASSERT_EQUAL(1, seen.count);
+  TEST_ASSERT_EQUAL(UART_FIFO_OVF, seen.types[0]);
+  TEST_ASSERT_EQUAL(0, uxQueueMessagesWaiting(queue));
+  TEST_ASSERT_EQUAL(1, flow.stats.fifo_overflows);
+
+  bg95_flow_deinit(&flow);
+  vQueueDelete(queue);
+}
+
+void run_test_bg95_flow_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_flow_enable_wired);
+  RUN_TEST(test_flow_falls_back_when_not_wired);
+  RUN_TEST(test_flow_counts_uart_events);
+  RUN_TEST(test_flow_passes_events_on);
+  RUN_TEST(test_flow_overrun_drops_queued_events);
+
+  UNITY_END();
+}
@@ -0,0 +1,118 @@
+#include "bg95_mqtt_wire.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static void test_mqtt_wire_connect(void)
+{
+  uint8_t       buf[64];
+  const uint8_t expected[] = {0x10, 0x12, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00,
+                              0x3C, 0x00, 0x06, 'b',  'g', '9', '5', '-', 'x'};
+
+  size_t len = bg95_mqtt_wire_connect(buf, sizeof(buf), "bg95-x", NULL, NULL, 60);
+  TEST_ASSERT_EQUAL(sizeof(expected), len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, buf, len);
+
+  // Credentials set the username and password flags and follow the client id
+  len = bg95_mqtt_wire_connect(buf, sizeof(buf), "c", "user", "pw", 0);
+  TEST_ASSERT_EQUAL(0xC2, buf[9]);
+  TEST_ASSERT_EQUAL(2 + 10 + 3 + 6 + 4, len);
+  TEST_ASSERT_EQUAL_MEMORY("\x00\x04user\x00\x02pw", buf + len - 10, 10);
+
+  TEST_ASSERT_EQUAL(0, bg95_mqtt_wire_connect(buf, 10, "bg95-x", NULL, NULL, 60));
+}
+
+static void test_mqtt_wire_publish_roundtrip(void)
+{
+  uint8_t                  buf[16 + 4096];
+  bg95_mqtt_wire_header_t  header;
+  bg95_mqtt_wire_publish_t publish;
+
+  // 4096 byte payload needs a two byte remaining length
+  size_t len = bg95_mqtt_wire_publish_header(buf, sizeof(buf), "a/b", 1, true, 0x1234, 4096);
+  TEST_ASSERT_EQUAL(1 + 2 + 5 + 2, len);
+  TEST_ASSERT_EQUAL(0x33, buf[0]);
+  TEST_ASSERT_EQUAL(0x87, buf[1]); // 4096 + 7 = 4103 = 7 + 32 * 128
+  TEST_ASSERT_EQUAL(0x20, buf[2]);
+  memset(buf + len, 'x', 4096);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_mqtt_wire_parse_header(buf, len + 4096, &header));
+  TEST_ASSERT_EQUAL(BG95_MQTT_PUBLISH, header.type);
+  TEST_ASSERT_EQUAL(3, header.header_len);
+  TEST_ASSERT_EQUAL(4103, header.body_len);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_mqtt_wire_parse_publish(&header, buf + 3, &publish));
+  TEST_ASSERT_EQUAL(1, publish.qos);
+  TEST_ASSERT_TRUE(publish.retain);
+  TEST_ASSERT_EQUAL(0x1234, publish.packet_id);
+  TEST_ASSERT_EQUAL(3, publish.topic_len);
+  TEST_ASSERT_EQUAL_MEMORY("a/b", publish.topic, 3);
+  TEST_ASSERT_EQUAL(4096, publish.payload_len);
+  TEST_ASSERT_EQUAL('x', publish.payload[4095]);
+
+  // QoS 0 carries no packet identifier
+  len = bg95_mqtt_wire_publish_header(buf, sizeof(buf), "a/b", 0, false, 7, 2);
+  memcpy(buf + len, "hi", 2);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_mqtt_wire_parse_header(buf, len + 2, &header));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_mqtt_wire_parse_publish(&header, buf + 2, &publish));
+  TEST_ASSERT_EQUAL(0, publish.packet_id);
+  TEST_ASSERT_EQUAL(2, publish.payload_len);
+  TEST_ASSERT_EQUAL_MEMORY("hi", publish.payload, 2);
+}
+
+static void test_mqtt_wire_acks_and_subscriptions(void)
+{
+  uint8_t buf[32];
+
+  TEST_ASSERT_EQUAL(4, bg95_mqtt_wire_ack(buf, sizeof(buf), BG95_MQTT_PUBACK, 0x0102));
+  TEST_ASSERT_EQUAL_MEMORY("\x40\x02\x01\x02", buf, 4);
+  bg95_mqtt_wire_ack(buf, sizeof(buf), BG95_MQTT_PUBREL, 9);
+  TEST_ASSERT_EQUAL(0x62, buf[0]); // Reserved flags of PUBREL
+
+  TEST_ASSERT_EQUAL(10, bg95_mqtt_wire_subscribe(buf, sizeof(buf), 5, "t/#", 2));
+  TEST_ASSERT_EQUAL_MEMORY("\x82\x08\x00\x05\x00\x03t/#\x02", buf, 10);
+  TEST_ASSERT_EQUAL(9, bg95_mqtt_wire_unsubscribe(buf, sizeof(buf), 5, "t/#"));
+  TEST_ASSERT_EQUAL_MEMORY("\xA2\x07\x00\x05\x00\x03t/#", buf, 9);
+
+  TEST_ASSERT_EQUAL(2, bg95_mqtt_wire_empty(buf, sizeof(buf), BG95_MQTT_DISCONNECT));
+  TEST_ASSERT_EQUAL_MEMORY("\xE0\x00", buf, 2);
+  TEST_ASSERT_EQUAL(0, bg95_mqtt_wire_ack(buf, 3, BG95_MQTT_PUBACK, 1));
+}
+
+static void test_mqtt_wire_parse_header_errors(void)
+{
+  bg95_mqtt_wire_header_t  header;
+  bg95_mqtt_wire_publish_t publish;
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE,
+                    bg95_mqtt_wire_parse_header((const uint8_t*) "\x20", 1, &header));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE,
+                    bg95_mqtt_wire_parse_header((const uint8_t*) "\x30\x80", 2, &header));
+  TEST_ASSERT_EQUAL(
+      ESP_ERR_INVALID_RESPONSE,
+      bg95_mqtt_wire_parse_header((const uint8_t*) "\x30\xFF\xFF\xFF\xFF\x01", 6, &header));
+
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_mqtt_wire_parse_header((const uint8_t*) "\x20\x02\x00\x05", 4, &header));
+  TEST_ASSERT_EQUAL(BG95_MQTT_CONNACK, header.type);
+  TEST_ASSERT_EQUAL(2, header.body_len);
+
+  // Topic length running past the packet
+  const uint8_t bad[] = {0x32, 0x04, 0x00, 0x09, 'a', 'b'};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_mqtt_wire_parse_header(bad, sizeof(bad), &header));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE,
+                    bg95_mqtt_wire_parse_publish(&header, bad + 2, &publish));
+}
+
+void run_test_bg95_mqtt_wire_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_mqtt_wire_connect);
+  RUN_TEST(test_mqtt_wire_publish_roundtrip);
+  RUN_TEST(test_mqtt_wire_acks_and_subscriptions);
+  RUN_TEST(test_mqtt_wire_parse_header_errors);
+
+  UNITY_END();
+}
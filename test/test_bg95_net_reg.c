@@ -0,0 +1,179 @@
+#include "bg95_net_reg.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static const mock_uart_response_t net_reg_responses[] = {
+    {.expected_cmd = "AT+CREG=2", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CGEREP", .cmd_response = "\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CREG?",
+     .cmd_response = "\r\n+CREG: 2,0\r\n"
+                     "\r\n+CGREG: 2,0\r\n"
+                     "\r\n+CEREG: 2,5,\"1A2B\",\"01A2B3C4\",8\r\n"
+                     "\r\nOK\r\n",
+     .delay_ms     = 0}};
+
+#define NET_REG_RESPONSES_COUNT (sizeof(net_reg_responses) / sizeof(net_reg_responses[0]))
+
+static void test_net_reg_urc_form_with_location(void)
+{
+  bg95_net_reg_t       reg   = {0};
+  bg95_net_reg_state_t state = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&reg));
+
+  bg95_net_reg_handle_line("+CEREG: 1,\"1A2B\",\"01A2B3C4\",8", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+
+  TEST_ASSERT_TRUE(state.registered);
+  TEST_ASSERT_EQUAL(BG95_NET_REG_STAT_REGISTERED_HOME, state.domains[BG95_NET_REG_DOMAIN_EPS].stat);
+  TEST_ASSERT_EQUAL_STRING("1A2B", state.domains[BG95_NET_REG_DOMAIN_EPS].area);
+  TEST_ASSERT_EQUAL_STRING("01A2B3C4", state.domains[BG95_NET_REG_DOMAIN_EPS].cell);
+  TEST_ASSERT_TRUE(state.domains[BG95_NET_REG_DOMAIN_EPS].present.has_act);
+  TEST_ASSERT_EQUAL(8, state.domains[BG95_NET_REG_DOMAIN_EPS].act);
+
+  bg95_net_reg_deinit(&reg);
+}
+
+static void test_net_reg_read_form_and_loss(void)
+{
+  bg95_net_reg_t       reg   = {0};
+  bg95_net_reg_state_t state = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&reg));
+
+  bg95_net_reg_handle_line("+CGREG: 2,5", true, &reg);
+  bg95_net_reg_set_pdp_active(&reg, true);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_TRUE(state.registered);
+  TEST_ASSERT_TRUE(state.pdp_active);
+  TEST_ASSERT_EQUAL(BG95_NET_REG_STAT_REGISTERED_ROAMING,
+                    state.domains[BG95_NET_REG_DOMAIN_PS].stat);
+
+  // Losing registration also drops the PDP context
+  bg95_net_reg_handle_line("+CGREG: 2", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_FALSE(state.registered);
+  TEST_ASSERT_FALSE(state.pdp_active);
+
+  bg95_net_reg_deinit(&reg);
+}
+
+static void test_net_reg_cs_only_is_not_registered(void)
+{
+  bg95_net_reg_t       reg   = {0};
+  bg95_net_reg_state_t state = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&reg));
+
+  bg95_net_reg_handle_line("+CREG: 1", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_FALSE(state.registered);
+
+  bg95_net_reg_deinit(&reg);
+}
+
+static void test_net_reg_pdp_events(void)
+{
+  bg95_net_reg_t       reg   = {0};
+  bg95_net_reg_state_t state = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&reg));
+
+  bg95_net_reg_handle_line("+CEREG: 1", false, &reg);
+  bg95_net_reg_handle_line("+CGEV: ME PDN ACT 1", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_TRUE(state.pdp_active);
+
+  bg95_net_reg_handle_line("+CGEV: NW PDN DEACT 1", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_FALSE(state.pdp_active);
+
+  bg95_net_reg_handle_line("+CGEV: ME PDN ACT 1", false, &reg);
+  bg95_net_reg_handle_line("+QIURC: \"pdpdeact\",1", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_FALSE(state.pdp_active);
+
+  bg95_net_reg_deinit(&reg);
+}
+
+static void test_net_reg_pdp_active_without_registration_report(void)
+{
+  bg95_net_reg_t       reg   = {0};
+  bg95_net_reg_state_t state = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&reg));
+
+  // Activated before any registration was reported, must stay active and wake waiters
+  bg95_net_reg_set_pdp_active(&reg, true);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_TRUE(state.pdp_active);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_wait(&reg, BG95_NET_REG_PDP_ACTIVE_BIT, 0));
+
+  // A not registered report without a previous registration is no loss either
+  bg95_net_reg_handle_line("+CEREG: 2", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_TRUE(state.pdp_active);
+
+  bg95_net_reg_handle_line("+CEREG: 1", false, &reg);
+  bg95_net_reg_handle_line("+CEREG: 4", false, &reg);
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_FALSE(state.pdp_active);
+
+  bg95_net_reg_deinit(&reg);
+}
+
+static void registration_urc_task(void* pvParameters)
+{
+  vTaskDelay(pdMS_TO_TICKS(50));
+  bg95_net_reg_handle_line("+CEREG: 1", false, pvParameters);
+  vTaskDelete(NULL);
+}
+
+static void test_net_reg_wait_wakes_on_urc(void)
+{
+  bg95_net_reg_t reg = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&reg));
+
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_net_reg_wait(&reg, BG95_NET_REG_REGISTERED_BIT, 10));
+
+  TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(registration_urc_task, "reg_urc", 2048, &reg, 5, NULL));
+  TickType_t start = xTaskGetTickCount();
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_wait(&reg, BG95_NET_REG_REGISTERED_BIT, 5000));
+  TEST_ASSERT_LESS_THAN(pdMS_TO_TICKS(1000), xTaskGetTickCount() - start);
+
+  bg95_net_reg_deinit(&reg);
+}
+
+static void test_net_reg_enable_seeds_state(void)
+{
+  bg95_uart_interface_t uart  = {0};
+  bg95_net_reg_t        reg   = {0};
+  bg95_net_reg_state_t  state = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&uart, net_reg_responses, NET_REG_RESPONSES_COUNT));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_init(&reg));
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_net_reg_enable_urcs(&reg, &uart));
+  bg95_net_reg_get_state(&reg, &state);
+  TEST_ASSERT_TRUE(state.registered);
+  TEST_ASSERT_EQUAL(BG95_NET_REG_STAT_REGISTERED_ROAMING,
+                    state.domains[BG95_NET_REG_DOMAIN_EPS].stat);
+  TEST_ASSERT_EQUAL_STRING("1A2B", state.domains[BG95_NET_REG_DOMAIN_EPS].area);
+
+  bg95_net_reg_deinit(&reg);
+  mock_uart_deinit(&uart);
+}
+
+void run_test_bg95_net_reg_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_net_reg_urc_form_with_location);
+  RUN_TEST(test_net_reg_read_form_and_loss);
+  RUN_TEST(test_net_reg_cs_only_is_not_registered);
+  RUN_TEST(test_net_reg_pdp_events);
+  RUN_TEST(test_net_reg_pdp_active_without_registration_report);
+  RUN_TEST(test_net_reg_wait_wakes_on_urc);
+  RUN_TEST(test_net_reg_enable_seeds_state);
+
+  UNITY_END();
+}
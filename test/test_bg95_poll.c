@@ -0,0 +1,557 @@
+#include "at_cmd_csq.h"
+#include "at_cmd_qmtopen.h"
+#include "bg95_poll.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+// Non-blocking fake UART: reads return whatever the test queued, writes are recorded
+typedef struct
+{
+  char     rx[512];
+  size_t   rx_len;
+  char     tx[512];
+  size_t   tx_len;
+  uint32_t max_read_timeout_ms;
+} fake_uart_t;
+
+static esp_err_t fake_write(const char* data, size_t len, void* context)
+{
+  fake_uart_t* fake = (fake_uart_t*) context;
+  if (fake->tx_len + len >= sizeof(fake->tx))
+  {
+    return ESP_FAIL;
+  }
+  memcpy(fake->tx + fake->tx_len, data, len);
+  fake->tx_len += len;
+  fake->tx[fake->tx_len] = '\0';
+  return ESP_OK;
+}
+
+static esp_err_t fake_read(char*    data,
+                           size_t   max_len,
+                           size_t*  bytes_read,
+                           uint32_t timeout_ms,
+                           void*    context)
+{
+  fake_uart_t* fake = (fake_uart_t*) context;
+  size_t       n    = fake->rx_len < max_len ? fake->rx_len : max_len;
+
+  if (timeout_ms > fake->max_read_timeout_ms)
+  {
+    fake->max_read_timeout_ms = timeout_ms;
+  }
+  memcpy(data, fake->rx, n);
+  memmove(fake->rx, fake->rx + n, fake->rx_len - n);
+  fake->rx_len -= n;
+  *bytes_read = n;
+  return n > 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void fake_rx(fake_uart_t* fake, const char* data)
+{
+  size_t len = strlen(data);
+  memcpy(fake->rx + fake->rx_len, data, len);
+  fake->rx_len += len;
+}
+
+static void fake_init(fake_uart_t* fake, bg95_uart_interface_t* uart)
+{
+  memset(fake, 0, sizeof(*fake));
+  uart->write   = fake_write;
+  uart->read    = fake_read;
+  uart->context = fake;
+}
+
+typedef struct
+{
+  int       calls;
+  esp_err_t result;
+  char      response[256];
+} done_record_t;
+
+static void record_done(esp_err_t result, const char* response, void* ctx)
+{
+  done_record_t* record = (done_record_t*) ctx;
+  record->calls++;
+  record->result = result;
+  strncpy(record->response, response, sizeof(record->response) - 1);
+}
+
+// ----------- Commands -------------------
+
+static void test_poll_submit_does_not_block(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  done_record_t         done = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, NULL, NULL));
+
+  // Nothing reaches the UART before the loop polls
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT+CSQ", 300, record_done, &done));
+  TEST_ASSERT_EQUAL(0, fake.tx_len);
+  TEST_ASSERT_EQUAL(1, bg95_poll_pending(&poll));
+
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+  TEST_ASSERT_EQUAL_STRING("AT+CSQ\r\n", fake.tx);
+
+  fake_rx(&fake, "\r\n+CSQ: 20,99\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 10));
+  TEST_ASSERT_EQUAL(0, done.calls);
+
+  fake_rx(&fake, "\r\nOK\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 20));
+  TEST_ASSERT_EQUAL(1, done.calls);
+  TEST_ASSERT_EQUAL(ESP_OK, done.result);
+  TEST_ASSERT_NOT_NULL(strstr(done.response, "+CSQ: 20,99"));
+  TEST_ASSERT_EQUAL(0, fake.max_read_timeout_ms);
+  TEST_ASSERT_EQUAL(1, poll.stats.completed);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_timeout_on_virtual_clock(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  done_record_t         done = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, NULL, NULL));
+
+  // The timeout runs from the poll that wrote the command, across the clock wrapping
+  const uint32_t start = UINT32_MAX - 100;
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT+COPS?", 300, record_done, &done));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, start));
+  fake_rx(&fake, "\r\n+COPS: 0");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, start + 299));
+  TEST_ASSERT_EQUAL(0, done.calls);
+
+  TEST_ASSERT_FALSE(bg95_poll(&poll, start + 300));
+  TEST_ASSERT_EQUAL(1, done.calls);
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, done.result);
+  TEST_ASSERT_EQUAL(1, poll.stats.timeouts);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_fifo_and_result_codes(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_raw_at_link_t    link;
+  bg95_poll_t           poll;
+  done_record_t         first  = {0};
+  done_record_t         second = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_link_init(&link, &uart));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &link.uart, NULL, NULL));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT+CPIN?", 300, record_done, &first));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT+CSQ", 300, record_done, &second));
+
+  // The second command waits for the first one's final result code
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+  TEST_ASSERT_EQUAL_STRING("AT+CPIN?\r\n", fake.tx);
+
+  // Completing the first one writes the next in the same call
+  fake_rx(&fake, "\r\n+CME ERROR: 10\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 5));
+  TEST_ASSERT_EQUAL(ESP_FAIL, first.result);
+  TEST_ASSERT_EQUAL_STRING("AT+CPIN?\r\nAT+CSQ\r\n", fake.tx);
+
+  // A lone digit line is not a result code until the link is marked numeric
+  fake_rx(&fake, "+CSQ: 20,99\r\n0\r");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 6));
+  TEST_ASSERT_EQUAL(0, second.calls);
+
+  // Numeric result code, as after bg95_raw_at_set_numeric()
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_mark_numeric(&link, true));
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 7));
+  TEST_ASSERT_EQUAL(1, second.calls);
+  TEST_ASSERT_EQUAL(ESP_OK, second.result);
+  TEST_ASSERT_EQUAL(1, poll.stats.failed);
+  TEST_ASSERT_EQUAL(1, poll.stats.completed);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_typed_command(void)
+{
+  fake_uart_t            fake;
+  bg95_uart_interface_t  uart;
+  bg95_poll_t            poll;
+  done_record_t          done = {0};
+  csq_execute_response_t csq  = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, NULL, NULL));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit_cmd(
+                        &poll, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, NULL, &csq, record_done, &done));
+
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+  TEST_ASSERT_EQUAL_STRING("AT+CSQ\r\n", fake.tx);
+  fake_rx(&fake, "\r\n+CSQ: 17,3\r\n\r\nOK\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, done.result);
+  TEST_ASSERT_EQUAL(17, csq.rssi);
+  TEST_ASSERT_EQUAL(3, csq.ber);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_data_after_prompt(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  done_record_t         done = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, NULL, NULL));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit_data(&poll,
+                                          "AT+QMTPUB=0,1,1,0,\"gw/t\",5",
+                                          "hello",
+                                          5,
+                                          1000,
+                                          record_done,
+                                          &done));
+
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+  TEST_ASSERT_EQUAL_STRING("AT+QMTPUB=0,1,1,0,\"gw/t\",5\r\n", fake.tx);
+
+  // Data only goes out once the prompt arrived
+  fake_rx(&fake, "\r\n>");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 10));
+  TEST_ASSERT_NULL(strstr(fake.tx, "hello"));
+  fake_rx(&fake, " ");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 20));
+  TEST_ASSERT_EQUAL_STRING("AT+QMTPUB=0,1,1,0,\"gw/t\",5\r\nhello", fake.tx);
+
+  // Accepted is not published yet, the outcome comes with the result line
+  fake_rx(&fake, "\r\nOK\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 30));
+  TEST_ASSERT_EQUAL(0, done.calls);
+  fake_rx(&fake, "\r\n+QMTPUB: 0,1,0\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 40));
+  TEST_ASSERT_EQUAL(1, done.calls);
+  TEST_ASSERT_EQUAL(ESP_OK, done.result);
+  TEST_ASSERT_NOT_NULL(strstr(done.response, "+QMTPUB: 0,1,0"));
+
+  bg95_poll_deinit(&poll);
+}
+
+// ----------- Idle lines and queue limits -------------------
+
+typedef struct
+{
+  int  count;
+  char last[64];
+} urc_record_t;
+
+static void record_urc(const char* line, void* ctx)
+{
+  urc_record_t* record = (urc_record_t*) ctx;
+  record->count++;
+  strncpy(record->last, line, sizeof(record->last) - 1);
+}
+
+static void test_poll_idle_urcs(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  urc_record_t          urcs = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, record_urc, &urcs));
+
+  fake_rx(&fake, "\r\n+QMTSTAT: 0,1\r\n\r\n+QMTRECV: 0,1,\"gw/cmd\",");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 0));
+  TEST_ASSERT_EQUAL(1, urcs.count);
+  TEST_ASSERT_EQUAL_STRING("+QMTSTAT: 0,1", urcs.last);
+
+  fake_rx(&fake, "\"on\"\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 1));
+  TEST_ASSERT_EQUAL(2, urcs.count);
+  TEST_ASSERT_EQUAL_STRING("+QMTRECV: 0,1,\"gw/cmd\",\"on\"", urcs.last);
+  TEST_ASSERT_EQUAL(2, poll.stats.urc_lines);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_urcs_during_command(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  urc_record_t          urcs = {0};
+  done_record_t         done = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, record_urc, &urcs));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT+CSQ", 300, record_done, &done));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+
+  // Only the command's own lines end up in its response
+  fake_rx(&fake, "\r\n+CSQ: 20,99\r\n\r\n+QMTSTAT: 0,1\r\n\r\nOK\r\n\r\n+CEREG: 1\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, done.result);
+  TEST_ASSERT_EQUAL_STRING("\r\n+CSQ: 20,99\r\n\r\nOK\r\n", done.response);
+  TEST_ASSERT_EQUAL(2, urcs.count);
+  TEST_ASSERT_EQUAL_STRING("+CEREG: 1", urcs.last);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_mqtt_waits_for_result_line(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  urc_record_t          urcs = {0};
+  done_record_t         open = {0};
+  done_record_t         conn = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, record_urc, &urcs));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit(
+                        &poll, "AT+QMTOPEN=1,\"broker\",1883", 5000, record_done, &open));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit(&poll, "AT+QMTCONN=1,\"gw\"", 5000, record_done, &conn));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+
+  // The next command waits until the result of the first one arrived, lines of other clients
+  // are URCs
+  fake_rx(&fake, "\r\nOK\r\n\r\n+QMTOPEN: 0,0\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 10));
+  TEST_ASSERT_EQUAL(0, open.calls);
+  TEST_ASSERT_EQUAL_STRING("AT+QMTOPEN=1,\"broker\",1883\r\n", fake.tx);
+  TEST_ASSERT_EQUAL_STRING("+QMTOPEN: 0,0", urcs.last);
+
+  fake_rx(&fake, "\r\n+QMTOPEN: 1,0\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 20));
+  TEST_ASSERT_EQUAL(ESP_OK, open.result);
+  TEST_ASSERT_EQUAL_STRING("\r\nOK\r\n\r\n+QMTOPEN: 1,0\r\n", open.response);
+  TEST_ASSERT_NOT_NULL(strstr(fake.tx, "AT+QMTCONN=1,\"gw\"\r\n"));
+
+  // A refused connection fails like the blocking call
+  fake_rx(&fake, "\r\nOK\r\n\r\n+QMTCONN: 1,0,5\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 30));
+  TEST_ASSERT_EQUAL(ESP_FAIL, conn.result);
+  TEST_ASSERT_EQUAL(1, poll.stats.completed);
+  TEST_ASSERT_EQUAL(1, poll.stats.failed);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_mqtt_retransmission_and_timeout(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  urc_record_t          urcs = {0};
+  done_record_t         sub  = {0};
+  done_record_t         pub  = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, record_urc, &urcs));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit(&poll, "AT+QMTSUB=0,7,\"gw/cmd\",1", 1000, record_done, &sub));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+
+  // A retransmission report and the result of another message id are not the outcome
+  fake_rx(&fake, "\r\nOK\r\n\r\n+QMTSUB: 0,7,1,1\r\n\r\n+QMTSUB: 0,6,0,1\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 10));
+  TEST_ASSERT_EQUAL(0, sub.calls);
+  TEST_ASSERT_EQUAL(2, urcs.count);
+  fake_rx(&fake, "\r\n+QMTSUB: 0,7,0,1\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 20));
+  TEST_ASSERT_EQUAL(ESP_OK, sub.result);
+
+  // The timeout still runs while the result line is missing
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit(&poll, "AT+QMTPUB=0,8,1,0,\"gw/t\"", 300, record_done, &pub));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 100));
+  fake_rx(&fake, "\r\nOK\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 399));
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 400));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, pub.result);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_mqtt_conn_retransmission_and_open_occupied(void)
+{
+  fake_uart_t              fake;
+  bg95_uart_interface_t    uart;
+  bg95_poll_t              poll;
+  urc_record_t             urcs          = {0};
+  done_record_t            conn          = {0};
+  done_record_t            open          = {0};
+  qmtopen_write_response_t open_response = {0};
+  qmtopen_write_params_t   open_params   = {.client_idx = 0, .port = 1883};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, record_urc, &urcs));
+
+  // "+QMTCONN: 0,1" reports a retransmission, the outcome follows
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit(&poll, "AT+QMTCONN=0,\"gw\"", 5000, record_done, &conn));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+  fake_rx(&fake, "\r\nOK\r\n\r\n+QMTCONN: 0,1\r\n");
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 10));
+  TEST_ASSERT_EQUAL(0, conn.calls);
+  TEST_ASSERT_EQUAL_STRING("+QMTCONN: 0,1", urcs.last);
+  fake_rx(&fake, "\r\n+QMTCONN: 0,0,0\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 20));
+  TEST_ASSERT_EQUAL(ESP_OK, conn.result);
+
+  // Client index already open: ESP_FAIL as on the blocking path, with the result parsed
+  strncpy(open_params.host_name, "broker", sizeof(open_params.host_name) - 1);
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_poll_submit_cmd(&poll,
+                                         &AT_CMD_QMTOPEN,
+                                         AT_CMD_TYPE_WRITE,
+                                         &open_params,
+                                         &open_response,
+                                         record_done,
+                                         &open));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 30));
+  fake_rx(&fake, "\r\nOK\r\n\r\n+QMTOPEN: 0,2\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 40));
+  TEST_ASSERT_EQUAL(ESP_FAIL, open.result);
+  TEST_ASSERT_TRUE(open_response.present.has_result);
+  TEST_ASSERT_EQUAL(QMTOPEN_RESULT_MQTT_ID_OCCUPIED, open_response.result);
+
+  bg95_poll_deinit(&poll);
+}
+
+static void test_poll_queue_full_and_deinit(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  done_record_t         done = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, NULL, NULL));
+  for (int i = 0; i < BG95_POLL_MAX_CMDS; i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT", 300, record_done, &done));
+  }
+  TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, bg95_poll_submit(&poll, "AT", 300, record_done, &done));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+
+  // Queued and in flight commands all get their callback
+  bg95_poll_deinit(&poll);
+  TEST_ASSERT_EQUAL(BG95_POLL_MAX_CMDS, done.calls);
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, done.result);
+}
+
+typedef struct
+{
+  bg95_poll_t* poll;
+  int          calls;
+  esp_err_t    resubmit;
+} resubmit_record_t;
+
+static void resubmit_done(esp_err_t result, const char* response, void* ctx)
+{
+  resubmit_record_t* record = (resubmit_record_t*) ctx;
+  record->calls++;
+  record->resubmit = bg95_poll_submit(record->poll, "AT", 300, resubmit_done, record);
+}
+
+static void test_poll_deinit_refuses_resubmits(void)
+{
+  fake_uart_t           fake;
+  bg95_uart_interface_t uart;
+  bg95_poll_t           poll;
+  resubmit_record_t     record = {.poll = &poll};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, NULL, NULL));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT", 300, resubmit_done, &record));
+
+  // The callback keeps submitting, deinit still returns
+  bg95_poll_deinit(&poll);
+  TEST_ASSERT_EQUAL(1, record.calls);
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, record.resubmit);
+  TEST_ASSERT_EQUAL(0, bg95_poll_pending(&poll));
+}
+
+// ----------- Scheduler -------------------
+
+static void test_poll_waits_for_sched_grant(void)
+{
+  fake_uart_t             fake;
+  bg95_uart_interface_t   uart;
+  bg95_poll_t             poll;
+  bg95_sched_t            sched;
+  bg95_sched_lane_stats_t stats;
+  done_record_t           done = {0};
+
+  fake_init(&fake, &uart);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_init(&poll, &uart, NULL, NULL));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_set_sched(&poll, &sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_poll_submit(&poll, "AT+CSQ", 300, record_done, &done));
+
+  // Someone else holds the modem, the command stays queued in the scheduler
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_NORMAL, 0));
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 0));
+  TEST_ASSERT_EQUAL(0, fake.tx_len);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats));
+  TEST_ASSERT_EQUAL(1, stats.depth);
+
+  // The release hands the modem over, the next poll collects it
+  bg95_sched_release(&sched);
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_NORMAL));
+
+  // Granted on the control lane and held until the command completed
+  TEST_ASSERT_TRUE(bg95_poll(&poll, 1));
+  TEST_ASSERT_EQUAL_STRING("AT+CSQ\r\n", fake.tx);
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_NORMAL));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, bg95_poll_set_sched(&poll, NULL));
+
+  fake_rx(&fake, "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+  TEST_ASSERT_FALSE(bg95_poll(&poll, 2));
+  TEST_ASSERT_EQUAL(ESP_OK, done.result);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats));
+  TEST_ASSERT_EQUAL(1, stats.granted);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_NORMAL));
+  bg95_sched_release(&sched);
+
+  bg95_poll_deinit(&poll);
+  bg95_sched_deinit(&sched);
+}
+
+void run_test_bg95_poll_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_poll_submit_does_not_block);
+  RUN_TEST(test_poll_timeout_on_virtual_clock);
+  RUN_TEST(test_poll_fifo_and_result_codes);
+  RUN_TEST(test_poll_typed_command);
+  RUN_TEST(test_poll_data_after_prompt);
+  RUN_TEST(test_poll_idle_urcs);
+  RUN_TEST(test_poll_urcs_during_command);
+  RUN_TEST(test_poll_mqtt_waits_for_result_line);
+  RUN_TEST(test_poll_mqtt_retransmission_and_timeout);
+  RUN_TEST(test_poll_mqtt_conn_retransmission_and_open_occupied);
+  RUN_TEST(test_poll_queue_full_and_deinit);
+  RUN_TEST(test_poll_deinit_refuses_resubmits);
+  RUN_TEST(test_poll_waits_for_sched_grant);
+
+  UNITY_END();
+}
@@ -0,0 +1,222 @@
+#include "bg95_pub_ring.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+#define PRODUCERS 4
+#define PER_PRODUCER 2000
+
+static const char* const TOPICS[] = {"gw/temperature", "gw/humidity"};
+
+typedef struct
+{
+  char     topics[BG95_PUB_RING_SIZE * 2];
+  size_t   lens[BG95_PUB_RING_SIZE * 2];
+  size_t   count;
+  uint32_t done_ok;
+  uint32_t done_failed;
+} sink_t;
+
+static esp_err_t sink_publish(const char* topic, const bg95_pub_desc_t* desc, void* ctx)
+{
+  sink_t* sink = (sink_t*) ctx;
+  if (sink->count < BG95_PUB_RING_SIZE * 2)
+  {
+    sink->topics[sink->count] = topic[3]; // 't' or 'h'
+    sink->lens[sink->count]   = desc->len;
+    sink->count++;
+  }
+  return ESP_OK;
+}
+
+static void sink_done(const bg95_pub_desc_t* desc, esp_err_t result, void* ctx)
+{
+  sink_t* sink = (sink_t*) ctx;
+  if (result == ESP_OK)
+  {
+    sink->done_ok++;
+  }
+  else
+  {
+    sink->done_failed++;
+  }
+}
+
+static bg95_pub_desc_t make_desc(uint16_t topic_id, size_t len, void* done_ctx)
+{
+  bg95_pub_desc_t desc = {
+      .topic_id = topic_id,
+      .qos      = QMTPUB_QOS_AT_LEAST_ONCE,
+      .retain   = QMTPUB_RETAIN_DISABLED,
+      .payload  = "0123456789",
+      .len      = len,
+      .done     = sink_done,
+      .done_ctx = done_ctx,
+  };
+  return desc;
+}
+
+static void test_pub_ring_fifo_and_full(void)
+{
+  bg95_pub_ring_t       ring;
+  sink_t                sink = {0};
+  bg95_pub_ring_stats_t stats;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_init(&ring, TOPICS, 2));
+
+  for (int i = 0; i < BG95_PUB_RING_SIZE; i++)
+  {
+    bg95_pub_desc_t desc = make_desc(i % 2, i % 10, &sink);
+    TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_try_enqueue(&ring, &desc));
+  }
+  bg95_pub_desc_t extra = make_desc(0, 1, &sink);
+  TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, bg95_pub_ring_try_enqueue(&ring, &extra));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_pub_ring_enqueue(&ring, &extra, 20));
+
+  // Partial drain frees slots for the next lap
+  TEST_ASSERT_EQUAL(3, bg95_pub_ring_drain(&ring, sink_publish, &sink, 3));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_try_enqueue(&ring, &extra));
+  TEST_ASSERT_EQUAL(BG95_PUB_RING_SIZE - 2, bg95_pub_ring_drain(&ring, sink_publish, &sink, 64));
+  TEST_ASSERT_EQUAL(0, bg95_pub_ring_drain(&ring, sink_publish, &sink, 64));
+
+  TEST_ASSERT_EQUAL(BG95_PUB_RING_SIZE + 1, sink.count);
+  for (int i = 0; i < BG95_PUB_RING_SIZE; i++)
+  {
+    TEST_ASSERT_EQUAL(i % 2 ? 'h' : 't', sink.topics[i]);
+    TEST_ASSERT_EQUAL(i % 10, sink.lens[i]);
+  }
+  TEST_ASSERT_EQUAL(1, sink.lens[BG95_PUB_RING_SIZE]);
+  TEST_ASSERT_EQUAL(BG95_PUB_RING_SIZE + 1, sink.done_ok);
+
+  bg95_pub_ring_get_stats(&ring, &stats);
+  TEST_ASSERT_EQUAL(BG95_PUB_RING_SIZE + 1, stats.enqueued);
+  TEST_ASSERT_TRUE(stats.full >= 2);
+  TEST_ASSERT_EQUAL(BG95_PUB_RING_SIZE + 1, stats.published);
+
+  bg95_pub_ring_deinit(&ring);
+}
+
+static void test_pub_ring_unknown_topic(void)
+{
+  bg95_pub_ring_t ring;
+  sink_t          sink = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_init(&ring, TOPICS, 2));
+  bg95_pub_desc_t desc = make_desc(7, 1, &sink);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_try_enqueue(&ring, &desc));
+  TEST_ASSERT_EQUAL(1, bg95_pub_ring_drain(&ring, sink_publish, &sink, 8));
+  TEST_ASSERT_EQUAL(0, sink.count);
+  TEST_ASSERT_EQUAL(1, sink.done_failed);
+
+  desc.payload = NULL;
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_pub_ring_try_enqueue(&ring, &desc));
+  bg95_pub_ring_deinit(&ring);
+}
+
+// ----------- Concurrent producers -------------------
+
+typedef struct
+{
+  bg95_pub_ring_t*  ring;
+  int               id;
+  SemaphoreHandle_t done;
+} producer_arg_t;
+
+static void producer_task(void* pvParameters)
+{
+  producer_arg_t* arg = (producer_arg_t*) pvParameters;
+
+  for (int seq = 0; seq < PER_PRODUCER; seq++)
+  {
+    // Producer id in the topic, sequence number in the length
+    bg95_pub_desc_t desc = {.topic_id = (uint16_t) arg->id, .payload = "", .len = (size_t) seq};
+    if (bg95_pub_ring_enqueue(arg->ring, &desc, 2000) != ESP_OK)
+    {
+      break;
+    }
+  }
+  xSemaphoreGive(arg->done);
+  vTaskDelete(NULL);
+}
+
+typedef struct
+{
+  size_t next[PRODUCERS]; // Expected sequence number per producer
+  size_t out_of_order;
+} order_check_t;
+
+static esp_err_t check_order(const char* topic, const bg95_pub_desc_t* desc, void* ctx)
+{
+  order_check_t* check = (order_check_t*) ctx;
+  if (desc->len != check->next[desc->topic_id])
+  {
+    check->out_of_order++;
+  }
+  check->next[desc->topic_id] = desc->len + 1;
+  return ESP_OK;
+}
+
+static void test_pub_ring_concurrent_producers(void)
+{
+  static const char* const topics[PRODUCERS] = {"p0", "p1", "p2", "p3"};
+  bg95_pub_ring_t          ring;
+  producer_arg_t           args[PRODUCERS];
+  SemaphoreHandle_t        done  = xSemaphoreCreateCounting(PRODUCERS, 0);
+  order_check_t            check = {0};
+  size_t                   total = 0;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_init(&ring, topics, PRODUCERS));
+  for (int i = 0; i < PRODUCERS; i++)
+  {
+    args[i] = (producer_arg_t){&ring, i, done};
+    xTaskCreate(producer_task, "producer", 2048, &args[i], 5, NULL);
+  }
+
+  // Every descriptor arrives once, each producer's in its own order
+  while (total < PRODUCERS * PER_PRODUCER && bg95_pub_ring_wait(&ring, 1000))
+  {
+    total += bg95_pub_ring_drain(&ring, check_order, &check, 8);
+  }
+  for (int i = 0; i < PRODUCERS; i++)
+  {
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(PER_PRODUCER, check.next[i]);
+  }
+  TEST_ASSERT_EQUAL(PRODUCERS * PER_PRODUCER, total);
+  TEST_ASSERT_EQUAL(0, check.out_of_order);
+
+  bg95_pub_ring_deinit(&ring);
+  vSemaphoreDelete(done);
+}
+
+static void test_pub_ring_wait(void)
+{
+  bg95_pub_ring_t ring;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_init(&ring, TOPICS, 2));
+  TEST_ASSERT_FALSE(bg95_pub_ring_wait(&ring, 20));
+
+  bg95_pub_desc_t desc = {.topic_id = 0, .payload = "", .len = 0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_pub_ring_try_enqueue(&ring, &desc));
+  TEST_ASSERT_TRUE(bg95_pub_ring_wait(&ring, 0));
+  TEST_ASSERT_TRUE(bg95_pub_ring_dequeue(&ring, &desc));
+  TEST_ASSERT_FALSE(bg95_pub_ring_dequeue(&ring, &desc));
+
+  bg95_pub_ring_deinit(&ring);
+}
+
+void run_test_bg95_pub_ring_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_pub_ring_fifo_and_full);
+  RUN_TEST(test_pub_ring_unknown_topic);
+  RUN_TEST(test_pub_ring_concurrent_producers);
+  RUN_TEST(test_pub_ring_wait);
+
+  UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include "at_cmd_cpin.h"
+#include "at_cmd_csq.h"
+#include "bg95_query_cache.h"
+#include "bg95_urc_tap.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static const mock_uart_response_t query_cache_responses[] = {
+    {.expected_cmd = "AT+CPIN?", .cmd_response = "\r\n+CPIN: READY\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CSQ", .cmd_response = "\r\n+CSQ: 24,0\r\nOK\r\n", .delay_ms = 0}};
+
+#define QUERY_CACHE_RESPONSES_COUNT                                                                \
+  (sizeof(query_cache_responses) / sizeof(query_cache_responses[0]))
+
+// Wraps the mock UART to count how many commands actually hit the wire
+typedef struct
+{
+  bg95_uart_interface_t mock;
+  uint32_t              write_count;
+} counting_uart_ctx_t;
+
+static esp_err_t counting_write(const char* data, size_t len, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  ctx->write_count++;
+  return ctx->mock.write(data, len, ctx->mock.context);
+}
+
+static esp_err_t counting_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  return ctx->mock.read(data, max_len, bytes_read, timeout_ms, ctx->mock.context);
+}
+
+static counting_uart_ctx_t   uart_ctx;
+static bg95_uart_interface_t uart;
+static bg95_sched_t          sched;
+static bg95_single_flight_t  sf;
+static bg95_query_cache_t    cache;
+
+static void setup_cache(const bg95_query_cache_config_t* config)
+{
+  memset(&uart_ctx, 0, sizeof(uart_ctx));
+  uart.write   = counting_write;
+  uart.read    = counting_read;
+  uart.context = &uart_ctx;
+
+  TEST_ASSERT_EQUAL(
+      ESP_OK, mock_uart_init(&uart_ctx.mock, query_cache_responses, QUERY_CACHE_RESPONSES_COUNT));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_single_flight_init(&sf, &uart, &sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_query_cache_init(&cache, &sf, config));
+}
+
+static void teardown_cache(void)
+{
+  bg95_query_cache_deinit(&cache);
+  bg95_single_flight_deinit(&sf);
+  bg95_sched_deinit(&sched);
+  mock_uart_deinit(&uart_ctx.mock);
+}
+
+static esp_err_t read_cpin(cpin_read_response_t* response)
+{
+  return bg95_query_cache_execute(
+      &cache, &AT_CMD_CPIN, AT_CMD_TYPE_READ, response, sizeof(*response));
+}
+
+static void test_query_cache_hit_costs_no_io(void)
+{
+  cpin_read_response_t response = {0};
+  setup_cache(NULL);
+
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  memset(&response, 0, sizeof(response));
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+
+  TEST_ASSERT_EQUAL(1, uart_ctx.write_count);
+  TEST_ASSERT_EQUAL(1, cache.stats.hits);
+  TEST_ASSERT_EQUAL(1, cache.stats.misses);
+  TEST_ASSERT_TRUE(response.status_valid);
+  TEST_ASSERT_EQUAL(CPIN_STATUS_READY, response.status);
+
+  teardown_cache();
+}
+
+static void test_query_cache_ttl_expiry(void)
+{
+  bg95_query_cache_config_t config   = BG95_QUERY_CACHE_DEFAULT_CONFIG();
+  cpin_read_response_t      response = {0};
+
+  config.ttl_ms[BG95_QUERY_CACHE_CPIN_READ] = 50;
+  setup_cache(&config);
+
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  vTaskDelay(pdMS_TO_TICKS(100));
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  TEST_ASSERT_EQUAL(2, uart_ctx.write_count);
+
+  teardown_cache();
+}
+
+// The tap only needs a physical UART to wrap, everything it sees is fed by hand
+static esp_err_t idle_write(const char* data, size_t len, void* context)
+{
+  return ESP_OK;
+}
+
+static esp_err_t idle_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  *bytes_read = 0;
+  vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+  return ESP_ERR_TIMEOUT;
+}
+
+static void test_query_cache_urc_invalidates(void)
+{
+  bg95_uart_interface_t phys     = {.write = idle_write, .read = idle_read, .context = NULL};
+  static bg95_urc_tap_t tap;
+  cpin_read_response_t  response = {0};
+  setup_cache(NULL);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_add_handler(&tap, bg95_query_cache_handle_urc, &cache));
+
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  const char* unrelated = "\r\n+CEREG: 1\r\n";
+  bg95_urc_tap_feed(&tap, unrelated, strlen(unrelated));
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  TEST_ASSERT_EQUAL(1, uart_ctx.write_count);
+
+  // The answer to a read goes through the same handlers but must not invalidate
+  const char* cmd = "AT+CPIN?\r\n";
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  const char* answer = "\r\n+CPIN: READY\r\n\r\nOK\r\n";
+  bg95_urc_tap_feed(&tap, answer, strlen(answer));
+  TEST_ASSERT_EQUAL(0, cache.stats.invalidations);
+
+  const char* urc = "\r\n+CPIN: NOT READY\r\n";
+  bg95_urc_tap_feed(&tap, urc, strlen(urc));
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  TEST_ASSERT_EQUAL(2, uart_ctx.write_count);
+  TEST_ASSERT_EQUAL(1, cache.stats.invalidations);
+
+  bg95_urc_tap_deinit(&tap);
+  teardown_cache();
+}
+
+static void test_query_cache_write_invalidates(void)
+{
+  cpin_read_response_t response = {0};
+  setup_cache(NULL);
+
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  bg95_query_cache_invalidate(&cache, &AT_CMD_CPIN);
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  TEST_ASSERT_EQUAL(2, uart_ctx.write_count);
+
+  teardown_cache();
+}
+
+static void test_query_cache_tap_write_invalidates(void)
+{
+  bg95_uart_interface_t phys     = {.write = idle_write, .read = idle_read, .context = NULL};
+  static bg95_urc_tap_t tap;
+  cpin_read_response_t  response = {0};
+  setup_cache(NULL);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_urc_tap_add_cmd_observer(&tap, bg95_query_cache_handle_cmd, &cache));
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+
+  // Reads, tests and writes to other commands keep the entry
+  const char* keep[] = {"AT+CPIN?\r\n", "AT+CPIN=?\r\n", "AT+CPINX=1\r\n", "AT+CSQ;+COPS?\r\n"};
+  for (size_t i = 0; i < sizeof(keep) / sizeof(keep[0]); i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(keep[i], strlen(keep[i]), tap.uart.context));
+  }
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  TEST_ASSERT_EQUAL(1, uart_ctx.write_count);
+
+  // A write going out through the tap drops it, also inside a concatenated line
+  const char* write = "AT+CSQ;+CPIN=\"1234\"\r\n";
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(write, strlen(write), tap.uart.context));
+  TEST_ASSERT_EQUAL(1, cache.stats.invalidations);
+  TEST_ASSERT_EQUAL(ESP_OK, read_cpin(&response));
+  TEST_ASSERT_EQUAL(2, uart_ctx.write_count);
+
+  const char* reset = "ATZ\r\n";
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(reset, strlen(reset), tap.uart.context));
+  TEST_ASSERT_EQUAL(2, cache.stats.invalidations);
+
+  bg95_urc_tap_deinit(&tap);
+  teardown_cache();
+}
+
+static void test_query_cache_uncached_command_passes_through(void)
+{
+  csq_execute_response_t response = {0};
+  setup_cache(NULL);
+
+  for (int i = 0; i < 2; i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK,
+                      bg95_query_cache_execute(
+                          &cache, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, &response, sizeof(response)));
+  }
+  TEST_ASSERT_EQUAL(2, uart_ctx.write_count);
+  TEST_ASSERT_EQUAL(0, cache.stats.hits);
+
+  teardown_cache();
+}
+
+void run_test_bg95_query_cache_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_query_cache_hit_costs_no_io);
+  RUN_TEST(test_query_cache_ttl_expiry);
+  RUN_TEST(test_query_cache_urc_invalidates);
+  RUN_TEST(test_query_cache_write_invalidates);
+  RUN_TEST(test_query_cache_tap_write_invalidates);
+  RUN_TEST(test_query_cache_uncached_command_passes_through);
+
+  UNITY_END();
+}
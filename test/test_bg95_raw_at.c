@@ -0,0 +1,273 @@
+#include "at_cmd_csq.h"
+#include "bg95_raw_at.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static const mock_uart_response_t raw_at_responses[] = {
+    {.expected_cmd = "AT+CSQ", .cmd_response = "\r\n+CSQ: 24,0\r\nOK\r\n", .delay_ms = 0},
+    {.expected_cmd = "AT+CPIN?", .cmd_response = "\r\n+CME ERROR: 10\r\n", .delay_ms = 0}};
+
+#define RAW_AT_RESPONSES_COUNT (sizeof(raw_at_responses) / sizeof(raw_at_responses[0]))
+
+// Same modem after "ATE0V0+CMEE=1"
+static const mock_uart_response_t numeric_responses[] = {
+    {.expected_cmd = "ATE0V0+CMEE=1", .cmd_response = "0\r", .delay_ms = 0},
+    {.expected_cmd = "AT+CSQ", .cmd_response = "+CSQ: 24,0\r\n0\r", .delay_ms = 0},
+    {.expected_cmd = "AT+COPS=0", .cmd_response = "4\r", .delay_ms = 0},
+    {.expected_cmd = "AT+CPIN?", .cmd_response = "+CME ERROR: 10\r\n", .delay_ms = 0}};
+
+#define NUMERIC_RESPONSES_COUNT (sizeof(numeric_responses) / sizeof(numeric_responses[0]))
+
+// ----------- TEST the FINAL RESULT helper fxn -------------------
+
+static void test_raw_at_final_result_ok(void)
+{
+  TEST_ASSERT_TRUE(bg95_raw_at_has_final_result("\r\n+CSQ: 24,0\r\nOK\r\n", false));
+}
+
+static void test_raw_at_final_result_error(void)
+{
+  TEST_ASSERT_TRUE(bg95_raw_at_has_final_result("\r\nERROR\r\n", false));
+  TEST_ASSERT_TRUE(bg95_raw_at_has_final_result("\r\n+CME ERROR: 10\r\n", false));
+  TEST_ASSERT_TRUE(bg95_raw_at_has_final_result("\r\n+CMS ERROR: 500\r\n", false));
+}
+
+static void test_raw_at_final_result_incomplete(void)
+{
+  TEST_ASSERT_FALSE(bg95_raw_at_has_final_result("\r\n+CSQ: 24,0\r\nOK", false));
+  TEST_ASSERT_FALSE(bg95_raw_at_has_final_result("\r\n+CSQ: 24,0\r\n", false));
+  TEST_ASSERT_FALSE(bg95_raw_at_has_final_result("", false));
+  TEST_ASSERT_FALSE(bg95_raw_at_has_final_result(NULL, false));
+}
+
+static void test_raw_at_final_result_ok_inside_data(void)
+{
+  // "OK" must be a whole line, not a substring of a data line
+  TEST_ASSERT_FALSE(bg95_raw_at_has_final_result("\r\n+COPS: 0,0,\"OK Mobile\"\r\n", false));
+}
+
+static void test_raw_at_numeric_result(void)
+{
+  int code = -1;
+
+  TEST_ASSERT_TRUE(bg95_raw_at_has_numeric_result("0\r", 2, &code));
+  TEST_ASSERT_EQUAL(BG95_RAW_AT_NUMERIC_OK, code);
+  TEST_ASSERT_TRUE(bg95_raw_at_has_numeric_result("+CSQ: 24,0\r\n4\r", 15, &code));
+  TEST_ASSERT_EQUAL(BG95_RAW_AT_NUMERIC_ERROR, code);
+  TEST_ASSERT_TRUE(bg95_raw_at_has_final_result("+CSQ: 24,0\r\n0\r", true));
+
+  // A URC right behind the result code does not hide it
+  TEST_ASSERT_TRUE(bg95_raw_at_has_numeric_result("0\r+CEREG: 1\r\n", 14, NULL));
+}
+
+static void test_raw_at_numeric_result_on_verbose_link(void)
+{
+  // A single digit information line whose "\n" is still in flight is not a final result on a
+  // verbose link
+  TEST_ASSERT_FALSE(bg95_raw_at_has_final_result("\r\n+QMTSTAT: 0,1\r\n1\r", false));
+  TEST_ASSERT_EQUAL(ESP_FAIL, bg95_raw_at_final_result("+CSQ: 24,0\r\n0\r", false));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_final_result("+CSQ: 24,0\r\n0\r", true));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_final_result("1\r\n\r\nOK\r\n", false));
+}
+
+static void test_raw_at_numeric_result_incomplete(void)
+{
+  TEST_ASSERT_FALSE(bg95_raw_at_has_numeric_result("+CSQ: 24,0\r\n", 12, NULL));
+  TEST_ASSERT_FALSE(bg95_raw_at_has_numeric_result("+CSQ: 24,0\r", 11, NULL));
+  TEST_ASSERT_FALSE(bg95_raw_at_has_numeric_result("0", 1, NULL));
+  TEST_ASSERT_FALSE(bg95_raw_at_has_numeric_result("", 0, NULL));
+
+  // Multi digit data lines and verbose responses are not numeric results
+  TEST_ASSERT_FALSE(bg95_raw_at_has_numeric_result("867530900000000\r", 16, NULL));
+  TEST_ASSERT_FALSE(bg95_raw_at_has_numeric_result("\r\n+CGPADDR: 1\r\n\r\nOK\r\n", 23, NULL));
+}
+
+// ----------- TEST the SEND fxn against the mock UART -------------------
+
+static void test_raw_at_send_ok(void)
+{
+  bg95_uart_interface_t uart = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&uart, raw_at_responses, RAW_AT_RESPONSES_COUNT));
+
+  char response[128];
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_send(&uart, "AT+CSQ", response, sizeof(response), 100));
+  TEST_ASSERT_NOT_NULL(strstr(response, "+CSQ: 24,0"));
+
+  mock_uart_deinit(&uart);
+}
+
+static void test_raw_at_send_cme_error(void)
+{
+  bg95_uart_interface_t uart = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&uart, raw_at_responses, RAW_AT_RESPONSES_COUNT));
+
+  char response[128];
+  TEST_ASSERT_EQUAL(ESP_FAIL, bg95_raw_at_send(&uart, "AT+CPIN?", response, sizeof(response), 100));
+
+  mock_uart_deinit(&uart);
+}
+
+static void test_raw_at_send_numeric(void)
+{
+  bg95_uart_interface_t uart = {0};
+  bg95_raw_at_link_t    link;
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&uart, numeric_responses, NUMERIC_RESPONSES_COUNT));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_link_init(&link, &uart));
+  TEST_ASSERT_FALSE(bg95_raw_at_is_numeric(&link.uart));
+
+  char response[128];
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_set_numeric(&link, true));
+  TEST_ASSERT_TRUE(bg95_raw_at_is_numeric(&link.uart));
+  TEST_ASSERT_FALSE(bg95_raw_at_is_numeric(&uart)); // The flag lives on the link only
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_raw_at_send(&link.uart, "AT+CSQ", response, sizeof(response), 100));
+  TEST_ASSERT_EQUAL_STRING("+CSQ: 24,0\r\n0\r", response);
+  TEST_ASSERT_EQUAL(ESP_FAIL,
+                    bg95_raw_at_send(&link.uart, "AT+COPS=0", response, sizeof(response), 100));
+  TEST_ASSERT_EQUAL(ESP_FAIL,
+                    bg95_raw_at_send(&link.uart, "AT+CPIN?", response, sizeof(response), 100));
+
+  // Parsers still see the verbose form
+  csq_execute_response_t csq = {0};
+  TEST_ASSERT_EQUAL(
+      ESP_OK, bg95_raw_at_execute(&link.uart, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, NULL, &csq));
+  TEST_ASSERT_EQUAL(24, csq.rssi);
+
+  mock_uart_deinit(&uart);
+}
+
+static void test_raw_at_numeric_links_are_independent(void)
+{
+  bg95_uart_interface_t uart = {0};
+  bg95_raw_at_link_t    links[8];
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&uart, raw_at_responses, RAW_AT_RESPONSES_COUNT));
+
+  // More links than the old shared registry held, each with its own flag
+  for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_link_init(&links[i], &uart));
+    TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_mark_numeric(&links[i], i % 2 == 0));
+  }
+  for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++)
+  {
+    TEST_ASSERT_EQUAL(i % 2 == 0, bg95_raw_at_is_numeric(&links[i].uart));
+  }
+
+  // A link set up again at the same address starts out verbose
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_link_init(&links[0], &uart));
+  TEST_ASSERT_FALSE(bg95_raw_at_is_numeric(&links[0].uart));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_raw_at_link_init(&links[0], NULL));
+
+  mock_uart_deinit(&uart);
+}
+
+// Fake UART holding 'pending' bytes until read, every write queues 'reply' behind them
+typedef struct
+{
+  char        pending[64];
+  const char* reply;
+} late_uart_ctx_t;
+
+static esp_err_t late_write(const char* data, size_t len, void* context)
+{
+  late_uart_ctx_t* ctx = (late_uart_ctx_t*) context;
+  strncat(ctx->pending, ctx->reply, sizeof(ctx->pending) - strlen(ctx->pending) - 1);
+  return ESP_OK;
+}
+
+static esp_err_t late_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  late_uart_ctx_t* ctx = (late_uart_ctx_t*) context;
+  size_t           len = strlen(ctx->pending);
+  len                  = len < max_len ? len : max_len;
+  memcpy(data, ctx->pending, len);
+  memmove(ctx->pending, ctx->pending + len, strlen(ctx->pending + len) + 1);
+  *bytes_read = len;
+  return len > 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void test_raw_at_send_discards_late_result(void)
+{
+  // The "OK" of an earlier command that timed out is still buffered
+  late_uart_ctx_t       ctx  = {.pending = "\r\nOK\r\n", .reply = "\r\n+CME ERROR: 10\r\n"};
+  bg95_uart_interface_t uart = {.write = late_write, .read = late_read, .context = &ctx};
+
+  char response[64];
+  TEST_ASSERT_EQUAL(ESP_FAIL, bg95_raw_at_send(&uart, "AT+CPIN?", response, sizeof(response), 100));
+  TEST_ASSERT_EQUAL_STRING("\r\n+CME ERROR: 10\r\n", response);
+}
+
+static int  urc_calls = 0;
+static char urc_line[32];
+
+static void record_urc(const char* line, void* ctx)
+{
+  urc_calls++;
+  strncpy(urc_line, line, sizeof(urc_line) - 1);
+}
+
+static void test_raw_at_send_hands_on_late_urcs(void)
+{
+  // A late answer, then a URC that came in while nothing read the link
+  late_uart_ctx_t       ctx  = {.pending = "\r\n+CSQ: 20,99\r\n\r\nOK\r\n\r\n+QMTSTAT: 0,1\r\n",
+                                .reply   = "\r\nOK\r\n"};
+  bg95_uart_interface_t uart = {.write = late_write, .read = late_read, .context = &ctx};
+  bg95_raw_at_link_t    link;
+  char                  response[64];
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_link_init(&link, &uart));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_link_set_urc_handler(&link, record_urc, NULL));
+  urc_calls = 0;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_send(&link.uart, "AT", response, sizeof(response), 100));
+  TEST_ASSERT_EQUAL_STRING("\r\nOK\r\n", response);
+  // The +CSQ line belongs to the late answer, only the +QMTSTAT after it is unsolicited
+  TEST_ASSERT_EQUAL(1, urc_calls);
+  TEST_ASSERT_EQUAL_STRING("+QMTSTAT: 0,1", urc_line);
+
+  // Numeric link: the late final is "0\r" and the URC has no leading "\r\n"
+  strcpy(ctx.pending, "+CSQ: 20,99\r\n0\r+QMTSTAT: 0,2\r\n");
+  ctx.reply = "0\r";
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_mark_numeric(&link, true));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_raw_at_send(&link.uart, "AT", response, sizeof(response), 100));
+  TEST_ASSERT_EQUAL(2, urc_calls);
+  TEST_ASSERT_EQUAL_STRING("+QMTSTAT: 0,2", urc_line);
+}
+
+static void test_raw_at_send_invalid_args(void)
+{
+  bg95_uart_interface_t uart = {0};
+  char                  response[16];
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG,
+                    bg95_raw_at_send(NULL, "AT", response, sizeof(response), 100));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG,
+                    bg95_raw_at_send(&uart, "AT", response, sizeof(response), 100));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_raw_at_send(&uart, NULL, response, 1, 100));
+}
+
+void run_test_bg95_raw_at_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_raw_at_final_result_ok);
+  RUN_TEST(test_raw_at_final_result_error);
+  RUN_TEST(test_raw_at_final_result_incomplete);
+  RUN_TEST(test_raw_at_final_result_ok_inside_data);
+  RUN_TEST(test_raw_at_numeric_result);
+  RUN_TEST(test_raw_at_numeric_result_incomplete);
+  RUN_TEST(test_raw_at_numeric_result_on_verbose_link);
+
+  RUN_TEST(test_raw_at_send_ok);
+  RUN_TEST(test_raw_at_send_cme_error);
+  RUN_TEST(test_raw_at_send_numeric);
+  RUN_TEST(test_raw_at_numeric_links_are_independent);
+  RUN_TEST(test_raw_at_send_discards_late_result);
+  RUN_TEST(test_raw_at_send_hands_on_late_urcs);
+  RUN_TEST(test_raw_at_send_invalid_args);
+
+  UNITY_END();
+}
@@ -0,0 +1,158 @@
+#include "bg95_reconnect.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static void test_reconnect_classify_qmtopen(void)
+{
+  qmtopen_write_response_t response = {.client_idx = 0, .present.has_result = true};
+
+  response.result = QMTOPEN_RESULT_OPEN_SUCCESS;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_NONE, bg95_reconnect_classify_qmtopen(ESP_OK, &response));
+  response.result = QMTOPEN_RESULT_FAILED_TO_OPEN;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_TRANSIENT,
+                    bg95_reconnect_classify_qmtopen(ESP_FAIL, &response));
+  // Already open on this client index counts as opened, whatever the driver returned
+  response.result = QMTOPEN_RESULT_MQTT_ID_OCCUPIED;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_NONE,
+                    bg95_reconnect_classify_qmtopen(ESP_FAIL, &response));
+  response.result = QMTOPEN_RESULT_FAILED_ACTIVATE_PDP;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_NETWORK,
+                    bg95_reconnect_classify_qmtopen(ESP_FAIL, &response));
+  response.result = QMTOPEN_RESULT_FAILED_PARSE_DOMAIN;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_BACKOFF,
+                    bg95_reconnect_classify_qmtopen(ESP_FAIL, &response));
+  response.result = QMTOPEN_RESULT_WRONG_PARAMETER;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_FATAL,
+                    bg95_reconnect_classify_qmtopen(ESP_FAIL, &response));
+
+  // No result at all, e.g. the command timed out
+  response.present.has_result = false;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_BACKOFF,
+                    bg95_reconnect_classify_qmtopen(ESP_ERR_TIMEOUT, &response));
+}
+
+static void test_reconnect_classify_qmtconn(void)
+{
+  qmtconn_write_response_t response = {
+      .client_idx = 0, .present.has_result = true, .present.has_ret_code = true};
+
+  response.result   = QMTCONN_RESULT_SUCCESS;
+  response.ret_code = QMTCONN_RET_CODE_ACCEPTED;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_NONE, bg95_reconnect_classify_qmtconn(ESP_OK, &response));
+
+  response.result   = QMTCONN_RESULT_FAILED_TO_SEND;
+  response.ret_code = QMTCONN_RET_CODE_SERVER_UNAVAILABLE;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_BACKOFF,
+                    bg95_reconnect_classify_qmtconn(ESP_FAIL, &response));
+
+  response.ret_code = QMTCONN_RET_CODE_BAD_CREDENTIALS;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_FATAL,
+                    bg95_reconnect_classify_qmtconn(ESP_FAIL, &response));
+
+  response.present.has_ret_code = false;
+  response.result               = QMTCONN_RESULT_RETRANSMISSION;
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_TRANSIENT,
+                    bg95_reconnect_classify_qmtconn(ESP_FAIL, &response));
+}
+
+static void test_reconnect_classify_at_error(void)
+{
+  bg95_at_error_t error;
+
+  bg95_at_error_parse_line("+CME ERROR: 14", &error); // SIM busy
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_TRANSIENT, bg95_reconnect_classify_at_error(&error));
+  bg95_at_error_parse_line("+CME ERROR: 566", &error); // Socket connect failed
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_BACKOFF, bg95_reconnect_classify_at_error(&error));
+  bg95_at_error_parse_line("+CME ERROR: 10", &error); // SIM not inserted
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_FATAL, bg95_reconnect_classify_at_error(&error));
+
+  bg95_at_error_parse_line("OK", &error);
+  TEST_ASSERT_EQUAL(BG95_RECONNECT_CLASS_NONE, bg95_reconnect_classify_at_error(&error));
+}
+
+static void test_reconnect_transient_fast_path_then_backoff(void)
+{
+  bg95_reconnect_t sched = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_reconnect_init(&sched, NULL));
+
+  TEST_ASSERT_EQUAL(0, bg95_reconnect_next_delay_ms(&sched, BG95_RECONNECT_CLASS_TRANSIENT));
+
+  // Fast retry budget used up, the same failure now backs off
+  uint32_t delay = bg95_reconnect_next_delay_ms(&sched, BG95_RECONNECT_CLASS_TRANSIENT);
+  TEST_ASSERT_GREATER_OR_EQUAL(250, delay);
+  TEST_ASSERT_LESS_OR_EQUAL(1000, delay);
+  TEST_ASSERT_EQUAL(1, sched.stats.immediate_retries);
+
+  bg95_reconnect_success(&sched);
+  TEST_ASSERT_EQUAL(0, bg95_reconnect_next_delay_ms(&sched, BG95_RECONNECT_CLASS_TRANSIENT));
+}
+
+static void test_reconnect_backoff_grows_and_is_capped(void)
+{
+  bg95_reconnect_config_t config = {
+      .base_delay_ms = 1000, .min_delay_ms = 100, .max_delay_ms = 8000, .fast_retries = 0};
+  bg95_reconnect_t sched = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_reconnect_init(&sched, &config));
+
+  // Cap doubles per failure: 1000, 2000, 4000, 8000, 8000, ...
+  uint32_t caps[] = {1000, 2000, 4000, 8000, 8000, 8000};
+  for (size_t i = 0; i < sizeof(caps) / sizeof(caps[0]); i++)
+  {
+    uint32_t delay = bg95_reconnect_next_delay_ms(&sched, BG95_RECONNECT_CLASS_BACKOFF);
+    TEST_ASSERT_GREATER_OR_EQUAL(100, delay);
+    TEST_ASSERT_LESS_OR_EQUAL(caps[i], delay);
+  }
+
+  uint32_t fatal = bg95_reconnect_next_delay_ms(&sched, BG95_RECONNECT_CLASS_FATAL);
+  TEST_ASSERT_GREATER_OR_EQUAL(100, fatal);
+  TEST_ASSERT_LESS_OR_EQUAL(8000, fatal);
+  TEST_ASSERT_EQUAL(0, bg95_reconnect_next_delay_ms(&sched, BG95_RECONNECT_CLASS_NONE));
+}
+
+// A fleet restarting together must not pick the same delay for a failure of class 'cls'
+static void assert_fleet_delays_differ(bg95_reconnect_class_t cls)
+{
+  bg95_reconnect_config_t config = {
+      .base_delay_ms = 60000, .min_delay_ms = 0, .max_delay_ms = 60000, .fast_retries = 0};
+
+  uint32_t first    = 0;
+  bool     differed = false;
+  for (int device = 0; device < 8; device++)
+  {
+    bg95_reconnect_t sched = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, bg95_reconnect_init(&sched, &config));
+    uint32_t delay = bg95_reconnect_next_delay_ms(&sched, cls);
+    if (device == 0)
+    {
+      first = delay;
+    }
+    else if (delay != first)
+    {
+      differed = true;
+    }
+  }
+  TEST_ASSERT_TRUE(differed);
+}
+
+static void test_reconnect_jitter_spreads_delays(void)
+{
+  assert_fleet_delays_differ(BG95_RECONNECT_CLASS_BACKOFF);
+  // Same SIM or credential error on every device
+  assert_fleet_delays_differ(BG95_RECONNECT_CLASS_FATAL);
+}
+
+void run_test_bg95_reconnect_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_reconnect_classify_qmtopen);
+  RUN_TEST(test_reconnect_classify_qmtconn);
+  RUN_TEST(test_reconnect_classify_at_error);
+  RUN_TEST(test_reconnect_transient_fast_path_then_backoff);
+  RUN_TEST(test_reconnect_backoff_grows_and_is_capped);
+  RUN_TEST(test_reconnect_jitter_spreads_delays);
+
+  UNITY_END();
+}
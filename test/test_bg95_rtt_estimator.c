@@ -0,0 +1,216 @@
+#include "bg95_rtt_estimator.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+// Local command so the tests do not depend on the driver's timeout table
+static const at_cmd_t RTT_TEST_CMD = {
+    .name = "QRTT", .description = "RTT estimator test command", .timeout_ms = 10000};
+
+// Modem that never answers, reads just wait out their timeout
+static esp_err_t silent_write(const char* data, size_t len, void* context)
+{
+  return ESP_OK;
+}
+
+static esp_err_t silent_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  *bytes_read = 0;
+  vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+  return ESP_ERR_TIMEOUT;
+}
+
+static void test_rtt_condition_from_csq(void)
+{
+  TEST_ASSERT_EQUAL(BG95_RTT_COND_GOOD, bg95_rtt_condition_from_csq(31));
+  TEST_ASSERT_EQUAL(BG95_RTT_COND_GOOD, bg95_rtt_condition_from_csq(20));
+  TEST_ASSERT_EQUAL(BG95_RTT_COND_FAIR, bg95_rtt_condition_from_csq(12));
+  TEST_ASSERT_EQUAL(BG95_RTT_COND_POOR, bg95_rtt_condition_from_csq(3));
+  TEST_ASSERT_EQUAL(BG95_RTT_COND_UNKNOWN, bg95_rtt_condition_from_csq(99));
+}
+
+static void test_rtt_uses_static_timeout_until_min_samples(void)
+{
+  bg95_rtt_estimator_t est = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_rtt_estimator_init(&est, NULL));
+
+  TEST_ASSERT_EQUAL(10000, bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE));
+  bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 200, false);
+  bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 200, false);
+  TEST_ASSERT_EQUAL(10000, bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE));
+
+  bg95_rtt_estimator_deinit(&est);
+}
+
+static void test_rtt_rfc6298_update(void)
+{
+  bg95_rtt_estimator_t est   = {0};
+  bg95_rtt_stats_t     stats = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_rtt_estimator_init(&est, NULL));
+
+  // First sample: SRTT = R, RTTVAR = R / 2
+  bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 400, false);
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_rtt_estimator_get(
+                        &est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, BG95_RTT_COND_UNKNOWN, &stats));
+  TEST_ASSERT_EQUAL(400, stats.srtt_ms);
+  TEST_ASSERT_EQUAL(200, stats.rttvar_ms);
+
+  // Second sample 480: RTTVAR = 3/4 * 200 + 1/4 * 80 = 170, SRTT = 400 + 80 / 8 = 410
+  bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 480, false);
+  bg95_rtt_estimator_get(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, BG95_RTT_COND_UNKNOWN, &stats);
+  TEST_ASSERT_EQUAL(410, stats.srtt_ms);
+  TEST_ASSERT_EQUAL(170, stats.rttvar_ms);
+  TEST_ASSERT_EQUAL(480, stats.max_rtt_ms);
+  TEST_ASSERT_EQUAL(2, stats.samples);
+
+  // Third sample unlocks the learned timeout: SRTT + 4 * RTTVAR
+  bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 410, false);
+  bg95_rtt_estimator_get(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, BG95_RTT_COND_UNKNOWN, &stats);
+  TEST_ASSERT_EQUAL(stats.srtt_ms + 4 * stats.rttvar_ms,
+                    bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE));
+
+  bg95_rtt_estimator_deinit(&est);
+}
+
+static void test_rtt_timeout_bounds(void)
+{
+  bg95_rtt_estimator_t est = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_rtt_estimator_init(&est, NULL));
+
+  // Very fast responses are clamped to the configured floor
+  for (int i = 0; i < 10; i++)
+  {
+    bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_READ, 5, false);
+  }
+  TEST_ASSERT_EQUAL(300, bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_READ));
+
+  // Very slow responses never exceed the static timeout
+  for (int i = 0; i < 10; i++)
+  {
+    bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_EXECUTE, 9000, false);
+  }
+  TEST_ASSERT_EQUAL(10000,
+                    bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_EXECUTE));
+
+  bg95_rtt_estimator_deinit(&est);
+}
+
+static void test_rtt_timeout_backs_off_and_resets(void)
+{
+  bg95_rtt_estimator_t est = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_rtt_estimator_init(&est, NULL));
+
+  for (int i = 0; i < 3; i++)
+  {
+    bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 1000, false);
+  }
+  uint32_t base = bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE);
+  TEST_ASSERT_LESS_THAN(10000, base);
+
+  bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, base, true);
+  TEST_ASSERT_EQUAL(2 * base,
+                    bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE));
+
+  // Timed out samples must not move SRTT (Karn), a success clears the backoff
+  bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 1000, false);
+  TEST_ASSERT_LESS_OR_EQUAL(base,
+                            bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE));
+
+  bg95_rtt_estimator_deinit(&est);
+}
+
+static void test_rtt_conditions_are_learned_separately(void)
+{
+  bg95_rtt_estimator_t est   = {0};
+  bg95_rtt_stats_t     stats = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_rtt_estimator_init(&est, NULL));
+
+  bg95_rtt_estimator_set_condition(&est, BG95_RTT_COND_POOR);
+  for (int i = 0; i < 3; i++)
+  {
+    bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, 2000, false);
+  }
+
+  bg95_rtt_estimator_set_condition(&est, BG95_RTT_COND_GOOD);
+  TEST_ASSERT_EQUAL(10000, bg95_rtt_estimator_timeout_ms(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_rtt_estimator_get(
+                        &est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, BG95_RTT_COND_POOR, &stats));
+  TEST_ASSERT_EQUAL(2000, stats.srtt_ms);
+  TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND,
+                    bg95_rtt_estimator_get(
+                        &est, &RTT_TEST_CMD, AT_CMD_TYPE_TEST, BG95_RTT_COND_POOR, &stats));
+
+  bg95_rtt_estimator_deinit(&est);
+}
+
+static void test_rtt_execute_fails_fast_with_learned_timeout(void)
+{
+  bg95_uart_interface_t uart  = {.write = silent_write, .read = silent_read};
+  bg95_rtt_estimator_t  est   = {0};
+  bg95_rtt_stats_t      stats = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_rtt_estimator_init(&est, NULL));
+
+  for (int i = 0; i < 3; i++)
+  {
+    bg95_rtt_estimator_record(&est, &RTT_TEST_CMD, AT_CMD_TYPE_EXECUTE, 50, false);
+  }
+
+  // Gives up after the learned 300 ms instead of the 10 s static timeout
+  TickType_t start = xTaskGetTickCount();
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT,
+                    bg95_rtt_execute(&est, &uart, &RTT_TEST_CMD, AT_CMD_TYPE_EXECUTE, NULL, NULL));
+  TEST_ASSERT_LESS_THAN(pdMS_TO_TICKS(1000), xTaskGetTickCount() - start);
+  bg95_rtt_estimator_get(
+      &est, &RTT_TEST_CMD, AT_CMD_TYPE_EXECUTE, BG95_RTT_COND_UNKNOWN, &stats);
+  TEST_ASSERT_EQUAL(1, stats.timeouts);
+  TEST_ASSERT_EQUAL(1, stats.backoff_shift);
+
+  bg95_rtt_estimator_deinit(&est);
+}
+
+static void test_rtt_observe_classifies_results(void)
+{
+  bg95_rtt_estimator_t est   = {0};
+  bg95_rtt_stats_t     stats = {0};
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_rtt_estimator_init(&est, NULL));
+
+  // An error result code is a full round trip, a rejected call never reached the modem
+  bg95_rtt_estimator_observe(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, ESP_OK, 300);
+  bg95_rtt_estimator_observe(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, ESP_FAIL, 500);
+  bg95_rtt_estimator_observe(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, ESP_ERR_INVALID_ARG, 1);
+  bg95_rtt_estimator_observe(&est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, ESP_ERR_TIMEOUT, 10000);
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_rtt_estimator_get(
+                        &est, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, BG95_RTT_COND_UNKNOWN, &stats));
+  TEST_ASSERT_EQUAL(2, stats.samples);
+  TEST_ASSERT_EQUAL(500, stats.max_rtt_ms);
+  TEST_ASSERT_EQUAL(1, stats.timeouts);
+
+  // No estimator is a no-op
+  bg95_rtt_estimator_observe(NULL, &RTT_TEST_CMD, AT_CMD_TYPE_WRITE, ESP_OK, 300);
+
+  bg95_rtt_estimator_deinit(&est);
+}
+
+void run_test_bg95_rtt_estimator_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_rtt_condition_from_csq);
+  RUN_TEST(test_rtt_uses_static_timeout_until_min_samples);
+  RUN_TEST(test_rtt_rfc6298_update);
+  RUN_TEST(test_rtt_timeout_bounds);
+  RUN_TEST(test_rtt_timeout_backs_off_and_resets);
+  RUN_TEST(test_rtt_conditions_are_learned_separately);
+  RUN_TEST(test_rtt_execute_fails_fast_with_learned_timeout);
+  RUN_TEST(test_rtt_observe_classifies_results);
+
+  UNITY_END();
+}
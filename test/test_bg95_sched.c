@@ -0,0 +1,329 @@
+#include "bg95_sched.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <string.h>
+#include <unity.h>
+
+// Waiter task: acquires in its lane, appends its id to the shared order while holding the
+// modem, then releases. Recording under the scheduler needs no extra lock.
+typedef struct
+{
+  bg95_sched_t*     sched;
+  bg95_sched_lane_t lane;
+  char              id;
+  char*             order;
+  SemaphoreHandle_t done;
+  int64_t           deadline_us; // Acquires with bg95_sched_acquire_by() when set
+} waiter_arg_t;
+
+static void waiter_task(void* pvParameters)
+{
+  waiter_arg_t* arg = (waiter_arg_t*) pvParameters;
+  esp_err_t     err = arg->deadline_us != BG95_SCHED_NO_DEADLINE
+                          ? bg95_sched_acquire_by(arg->sched, arg->lane, arg->deadline_us)
+                          : bg95_sched_acquire(arg->sched, arg->lane, 2000);
+
+  if (err == ESP_OK)
+  {
+    arg->order[strlen(arg->order)] = arg->id;
+    bg95_sched_release(arg->sched);
+  }
+  xSemaphoreGive(arg->done);
+  vTaskDelete(NULL);
+}
+
+static uint32_t waiting(bg95_sched_t* sched)
+{
+  uint32_t total = 0;
+  for (int lane = 0; lane < BG95_SCHED_NUM_LANES; lane++)
+  {
+    bg95_sched_lane_stats_t stats;
+    bg95_sched_get_stats(sched, lane, &stats);
+    total += stats.depth;
+  }
+  return total;
+}
+
+// Start a waiter and return once it is queued, so arrival order is deterministic
+static void start_waiter(waiter_arg_t* arg)
+{
+  uint32_t before = waiting(arg->sched);
+  xTaskCreate(waiter_task, "waiter", 2048, arg, 5, NULL);
+  for (int i = 0; i < 100 && waiting(arg->sched) == before; i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  TEST_ASSERT_EQUAL(before + 1, waiting(arg->sched));
+}
+
+static void wait_done(SemaphoreHandle_t done, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(2000)));
+  }
+}
+
+static void test_sched_idle_acquire(void)
+{
+  bg95_sched_t            sched;
+  bg95_sched_lane_stats_t stats;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_BULK, 0));
+  bg95_sched_release(&sched);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_BULK, 0));
+  bg95_sched_release(&sched);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_get_stats(&sched, BG95_SCHED_LANE_BULK, &stats));
+  TEST_ASSERT_EQUAL(2, stats.granted);
+  TEST_ASSERT_EQUAL(0, stats.depth);
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG,
+                    bg95_sched_acquire(&sched, BG95_SCHED_NUM_LANES, 0));
+  bg95_sched_deinit(&sched);
+}
+
+static void test_sched_lanes_in_priority_order(void)
+{
+  bg95_sched_t      sched;
+  char              order[8] = {0};
+  SemaphoreHandle_t done     = xSemaphoreCreateCounting(8, 0);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_NORMAL, 0));
+
+  waiter_arg_t args[] = {
+      {&sched, BG95_SCHED_LANE_BULK, 'b', order, done},
+      {&sched, BG95_SCHED_LANE_NORMAL, 'n', order, done},
+      {&sched, BG95_SCHED_LANE_BULK, 'B', order, done},
+      {&sched, BG95_SCHED_LANE_CONTROL, 'c', order, done},
+      {&sched, BG95_SCHED_LANE_NORMAL, 'N', order, done},
+  };
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); i++)
+  {
+    start_waiter(&args[i]);
+  }
+
+  bg95_sched_release(&sched);
+  wait_done(done, 5);
+
+  // Control first, then normal and bulk, each lane in arrival order
+  TEST_ASSERT_EQUAL_STRING("cnNbB", order);
+
+  bg95_sched_lane_stats_t stats;
+  bg95_sched_get_stats(&sched, BG95_SCHED_LANE_BULK, &stats);
+  TEST_ASSERT_EQUAL(2, stats.granted);
+  TEST_ASSERT_EQUAL(2, stats.depth_max);
+  TEST_ASSERT_EQUAL(0, stats.depth);
+  TEST_ASSERT_TRUE(stats.wait_ms_max >= 10);
+
+  bg95_sched_deinit(&sched);
+  vSemaphoreDelete(done);
+}
+
+static void test_sched_starvation_protection(void)
+{
+  bg95_sched_t      sched;
+  char              order[8] = {0};
+  SemaphoreHandle_t done     = xSemaphoreCreateCounting(8, 0);
+  waiter_arg_t      args[6];
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_CONTROL, 0));
+
+  args[0] = (waiter_arg_t){&sched, BG95_SCHED_LANE_BULK, 'b', order, done};
+  start_waiter(&args[0]);
+  for (int i = 1; i < 6; i++)
+  {
+    args[i] = (waiter_arg_t){&sched, BG95_SCHED_LANE_CONTROL, (char) ('0' + i), order, done};
+    start_waiter(&args[i]);
+  }
+
+  bg95_sched_release(&sched);
+  wait_done(done, 6);
+
+  // Passed over BG95_SCHED_MAX_BYPASS times, then served ahead of the last control command
+  TEST_ASSERT_EQUAL_STRING("1234b5", order);
+
+  bg95_sched_lane_stats_t stats;
+  bg95_sched_get_stats(&sched, BG95_SCHED_LANE_BULK, &stats);
+  TEST_ASSERT_EQUAL(1, stats.promoted);
+
+  bg95_sched_deinit(&sched);
+  vSemaphoreDelete(done);
+}
+
+static void test_sched_timeout(void)
+{
+  bg95_sched_t            sched;
+  bg95_sched_lane_stats_t stats;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_BULK, 0));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_acquire(&sched, BG95_SCHED_LANE_CONTROL, 30));
+
+  bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats);
+  TEST_ASSERT_EQUAL(1, stats.timeouts);
+  TEST_ASSERT_EQUAL(0, stats.depth);
+  TEST_ASSERT_EQUAL(0, stats.granted);
+
+  // The slot of the waiter that gave up is free again, and nothing is left to hand over to
+  bg95_sched_release(&sched);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_CONTROL, 0));
+  bg95_sched_release(&sched);
+  bg95_sched_deinit(&sched);
+}
+
+static void test_sched_earliest_deadline_first(void)
+{
+  bg95_sched_t      sched;
+  char              order[8] = {0};
+  SemaphoreHandle_t done     = xSemaphoreCreateCounting(8, 0);
+  int64_t           now_us   = esp_timer_get_time();
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_BULK, 0));
+
+  waiter_arg_t args[] = {
+      {&sched, BG95_SCHED_LANE_NORMAL, 'x', order, done, BG95_SCHED_NO_DEADLINE},
+      {&sched, BG95_SCHED_LANE_NORMAL, 'y', order, done, now_us + 3000000},
+      {&sched, BG95_SCHED_LANE_NORMAL, 'z', order, done, now_us + 2000000},
+      {&sched, BG95_SCHED_LANE_NORMAL, 'e', order, done, now_us + 60000},
+      {&sched, BG95_SCHED_LANE_CONTROL, 'c', order, done, now_us + 2500000},
+  };
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); i++)
+  {
+    start_waiter(&args[i]);
+  }
+
+  // 'e' expires while the modem is busy and leaves without ever being granted
+  wait_done(done, 1);
+  TEST_ASSERT_EQUAL_STRING("", order);
+
+  bg95_sched_release(&sched);
+  wait_done(done, 4);
+  TEST_ASSERT_EQUAL_STRING("czyx", order);
+
+  bg95_sched_lane_stats_t stats;
+  bg95_sched_get_stats(&sched, BG95_SCHED_LANE_NORMAL, &stats);
+  TEST_ASSERT_EQUAL(1, stats.deadline_misses);
+  TEST_ASSERT_EQUAL(3, stats.granted);
+  TEST_ASSERT_EQUAL(0, stats.timeouts);
+
+  // A deadline in the past is rejected up front, even on an idle modem
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT,
+                    bg95_sched_acquire_by(&sched, BG95_SCHED_LANE_CONTROL, now_us));
+  bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats);
+  TEST_ASSERT_EQUAL(1, stats.deadline_misses);
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_sched_acquire_by(
+                        &sched, BG95_SCHED_LANE_CONTROL, esp_timer_get_time() + 1000000));
+  bg95_sched_release(&sched);
+
+  bg95_sched_deinit(&sched);
+  vSemaphoreDelete(done);
+}
+
+static void test_sched_try_acquire_and_lane_mapping(void)
+{
+  bg95_sched_t sched;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_NORMAL));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_CONTROL));
+  bg95_sched_release(&sched);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_CONTROL));
+  bg95_sched_release(&sched);
+
+  // A refused try is neither a timeout nor a waiter
+  bg95_sched_lane_stats_t stats;
+  bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats);
+  TEST_ASSERT_EQUAL(1, stats.granted);
+  TEST_ASSERT_EQUAL(0, stats.timeouts);
+  TEST_ASSERT_EQUAL(0, stats.depth_max);
+
+  TEST_ASSERT_EQUAL(BG95_SCHED_LANE_NORMAL, bg95_sched_publish_lane(BG95_SCHED_BULK_PUBLISH_LEN));
+  TEST_ASSERT_EQUAL(BG95_SCHED_LANE_BULK,
+                    bg95_sched_publish_lane(BG95_SCHED_BULK_PUBLISH_LEN + 1));
+  TEST_ASSERT_EQUAL(BG95_SCHED_LANE_BULK, bg95_sched_cmd_lane("AT+QMTRECV=0,1"));
+  TEST_ASSERT_EQUAL(BG95_SCHED_LANE_CONTROL, bg95_sched_cmd_lane("AT+QMTDISC=0"));
+  TEST_ASSERT_EQUAL(BG95_SCHED_LANE_CONTROL, bg95_sched_cmd_lane("AT+CSQ"));
+  TEST_ASSERT_EQUAL(BG95_SCHED_LANE_NORMAL, bg95_sched_cmd_lane("AT+QMTPUB=0,1,1,0,\"t\",4"));
+  TEST_ASSERT_EQUAL(BG95_SCHED_LANE_NORMAL, bg95_sched_cmd_lane("AT+CPIN=1234"));
+
+  bg95_sched_deinit(&sched);
+}
+
+static void test_sched_pending_slot_takes_its_turn(void)
+{
+  bg95_sched_t            sched;
+  bg95_sched_lane_stats_t stats;
+  char                    order[8] = {0};
+  SemaphoreHandle_t       done     = xSemaphoreCreateCounting(8, 0);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_NORMAL, 0));
+
+  waiter_arg_t args[] = {
+      {&sched, BG95_SCHED_LANE_BULK, 'b', order, done},
+      {&sched, BG95_SCHED_LANE_NORMAL, 'n', order, done},
+  };
+  start_waiter(&args[0]);
+
+  // Queued between the blocked waiters, asking again keeps the same place
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_acquire_pending(&sched, BG95_SCHED_LANE_CONTROL));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_acquire_pending(&sched, BG95_SCHED_LANE_CONTROL));
+  TEST_ASSERT_EQUAL(2, waiting(&sched));
+  start_waiter(&args[1]);
+
+  // The grant goes to the control lane and waits there until it is collected
+  bg95_sched_release(&sched);
+  vTaskDelay(pdMS_TO_TICKS(20));
+  TEST_ASSERT_EQUAL_STRING("", order);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire_pending(&sched, BG95_SCHED_LANE_CONTROL));
+  bg95_sched_release(&sched);
+  wait_done(done, 2);
+  TEST_ASSERT_EQUAL_STRING("nb", order);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats));
+  TEST_ASSERT_EQUAL(1, stats.granted);
+  TEST_ASSERT_EQUAL(0, stats.depth);
+
+  // Cancelled before and after its grant, the modem never stays held
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_NORMAL, 0));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_acquire_pending(&sched, BG95_SCHED_LANE_BULK));
+  bg95_sched_cancel_pending(&sched);
+  bg95_sched_release(&sched);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_NORMAL, 0));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_sched_acquire_pending(&sched, BG95_SCHED_LANE_BULK));
+  bg95_sched_release(&sched);
+  bg95_sched_cancel_pending(&sched);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_NORMAL));
+  bg95_sched_release(&sched);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_get_stats(&sched, BG95_SCHED_LANE_BULK, &stats));
+  TEST_ASSERT_EQUAL(1, stats.timeouts);
+  TEST_ASSERT_EQUAL(0, stats.depth);
+
+  bg95_sched_deinit(&sched);
+  vSemaphoreDelete(done);
+}
+
+void run_test_bg95_sched_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_sched_idle_acquire);
+  RUN_TEST(test_sched_lanes_in_priority_order);
+  RUN_TEST(test_sched_starvation_protection);
+  RUN_TEST(test_sched_timeout);
+  RUN_TEST(test_sched_earliest_deadline_first);
+  RUN_TEST(test_sched_try_acquire_and_lane_mapping);
+  RUN_TEST(test_sched_pending_slot_takes_its_turn);
+
+  UNITY_END();
+}
@@ -0,0 +1,117 @@
+#include "bg95_raw_at.h"
+#include "bg95_sim.h"
+
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <string.h>
+#include <unity.h>
+
+// Read until 'until' shows up or 'timeout_ms' passes, returns the elapsed time in ms
+static uint32_t read_until(
+    bg95_sim_t* sim, const char* until, char* buf, size_t size, uint32_t timeout_ms)
+{
+  int64_t start_us = esp_timer_get_time();
+  size_t  total    = 0;
+
+  buf[0] = '\0';
+  while (strstr(buf, until) == NULL &&
+         esp_timer_get_time() - start_us < (int64_t) timeout_ms * 1000)
+  {
+    size_t bytes_read = 0;
+    sim->uart.read(buf + total, size - 1 - total, &bytes_read, 10, sim->uart.context);
+    total += bytes_read;
+    buf[total] = '\0';
+  }
+  return (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+}
+
+static void test_sim_init_invalid_args(void)
+{
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_sim_init(NULL, NULL));
+}
+
+static void test_sim_answers_after_rtt(void)
+{
+  bg95_sim_config_t config = {.rtt_ms = 40, .urc_delay_ms = 0, .baud = 0};
+  static bg95_sim_t sim;
+  char              response[64];
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sim_init(&sim, &config));
+
+  int64_t start_us = esp_timer_get_time();
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_raw_at_send(&sim.uart, "AT+CSQ", response, sizeof(response), 500));
+  uint32_t elapsed_ms = (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+
+  TEST_ASSERT_NOT_NULL(strstr(response, "+CSQ: 24,99"));
+  TEST_ASSERT_GREATER_OR_EQUAL(40, elapsed_ms);
+  TEST_ASSERT_LESS_THAN(200, elapsed_ms);
+  TEST_ASSERT_EQUAL(1, sim.stats.commands);
+
+  bg95_sim_deinit(&sim);
+}
+
+static void test_sim_publish_prompt_ok_and_urc(void)
+{
+  bg95_sim_config_t config = {.rtt_ms = 10, .urc_delay_ms = 80, .baud = 0};
+  static bg95_sim_t sim;
+  char              buf[128];
+  const char*       cmd = "AT+QMTPUB=0,7,1,0,\"t/x\",5\r\n";
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sim_init(&sim, &config));
+
+  TEST_ASSERT_EQUAL(ESP_OK, sim.uart.write(cmd, strlen(cmd), sim.uart.context));
+  read_until(&sim, "> ", buf, sizeof(buf), 500);
+  TEST_ASSERT_EQUAL_STRING("\r\n> ", buf);
+
+  // Line breaks inside the payload are payload bytes, only the command's own CRLF is dropped
+  TEST_ASSERT_EQUAL(ESP_OK, sim.uart.write("a\r\nbc", 5, sim.uart.context));
+  read_until(&sim, "OK\r\n", buf, sizeof(buf), 500);
+  TEST_ASSERT_EQUAL_STRING("\r\nOK\r\n", buf);
+
+  // The broker ack follows as a URC
+  uint32_t urc_ms = read_until(&sim, "\r\n+QMTPUB:", buf, sizeof(buf), 500);
+  read_until(&sim, "\r\n", buf + strlen(buf), sizeof(buf) - strlen(buf), 100);
+  TEST_ASSERT_NOT_NULL(strstr(buf, "+QMTPUB: 0,7,0"));
+  TEST_ASSERT_GREATER_OR_EQUAL(60, urc_ms);
+
+  TEST_ASSERT_EQUAL(1, sim.stats.publishes);
+  TEST_ASSERT_EQUAL(5, sim.stats.payload_bytes);
+
+  bg95_sim_deinit(&sim);
+}
+
+static void test_sim_models_wire_time(void)
+{
+  bg95_sim_config_t config = {.rtt_ms = 0, .urc_delay_ms = 0, .baud = 9600};
+  static bg95_sim_t sim;
+  char              response[64];
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sim_init(&sim, &config));
+
+  // "AT+CSQ\r\n" out and 21 bytes back, 10 bit times per byte at 9600 baud is about 30 ms
+  int64_t start_us = esp_timer_get_time();
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_raw_at_send(&sim.uart, "AT+CSQ", response, sizeof(response), 500));
+  uint32_t elapsed_ms = (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+
+  TEST_ASSERT_GREATER_OR_EQUAL(28, elapsed_ms);
+  TEST_ASSERT_EQUAL(8, sim.stats.bytes_to_modem);
+  TEST_ASSERT_EQUAL(21, sim.stats.bytes_from_modem);
+  TEST_ASSERT_TRUE(bg95_sim_uart_utilization(&sim) > 0.0f);
+  TEST_ASSERT_TRUE(bg95_sim_uart_utilization(&sim) <= 1.0f);
+
+  bg95_sim_deinit(&sim);
+}
+
+void run_test_bg95_sim_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_sim_init_invalid_args);
+  RUN_TEST(test_sim_answers_after_rtt);
+  RUN_TEST(test_sim_publish_prompt_ok_and_urc);
+  RUN_TEST(test_sim_models_wire_time);
+
+  UNITY_END();
+}
@@ -0,0 +1,195 @@
+#include "at_cmd_cpin.h"
+#include "at_cmd_csq.h"
+#include "at_cmd_qmtcfg.h"
+#include "bg95_single_flight.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+// Slow response so concurrent callers overlap with the first one on the UART
+static const mock_uart_response_t single_flight_responses[] = {
+    {.expected_cmd = "AT+CSQ", .cmd_response = "\r\n+CSQ: 24,0\r\nOK\r\n", .delay_ms = 100}};
+
+#define CONCURRENT_CALLERS 3
+
+// Wraps the mock UART to count how many commands actually hit the wire
+typedef struct
+{
+  bg95_uart_interface_t mock;
+  uint32_t              write_count;
+} counting_uart_ctx_t;
+
+static esp_err_t counting_write(const char* data, size_t len, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  ctx->write_count++;
+  return ctx->mock.write(data, len, ctx->mock.context);
+}
+
+static esp_err_t counting_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  counting_uart_ctx_t* ctx = (counting_uart_ctx_t*) context;
+  return ctx->mock.read(data, max_len, bytes_read, timeout_ms, ctx->mock.context);
+}
+
+typedef struct
+{
+  bg95_single_flight_t*  sf;
+  SemaphoreHandle_t      done;
+  csq_execute_response_t response;
+  esp_err_t              err;
+} caller_ctx_t;
+
+static void csq_caller_task(void* pvParameters)
+{
+  caller_ctx_t* caller = (caller_ctx_t*) pvParameters;
+  caller->err          = bg95_single_flight_execute(
+      caller->sf, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, &caller->response, sizeof(caller->response));
+  xSemaphoreGive(caller->done);
+  vTaskDelete(NULL);
+}
+
+static void test_single_flight_idempotent_table(void)
+{
+  TEST_ASSERT_TRUE(bg95_single_flight_is_idempotent(&AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE));
+  TEST_ASSERT_TRUE(bg95_single_flight_is_idempotent(&AT_CMD_CPIN, AT_CMD_TYPE_READ));
+  TEST_ASSERT_TRUE(bg95_single_flight_is_idempotent(&AT_CMD_QMTCFG, AT_CMD_TYPE_TEST));
+  TEST_ASSERT_FALSE(bg95_single_flight_is_idempotent(&AT_CMD_QMTCFG, AT_CMD_TYPE_WRITE));
+  TEST_ASSERT_FALSE(bg95_single_flight_is_idempotent(NULL, AT_CMD_TYPE_READ));
+}
+
+static void test_single_flight_invalid_args(void)
+{
+  bg95_uart_interface_t  uart     = {0};
+  bg95_sched_t           sched    = {0};
+  bg95_single_flight_t   sf       = {0};
+  csq_execute_response_t response = {0};
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_single_flight_init(NULL, &uart, &sched));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_single_flight_init(&sf, NULL, &sched));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_single_flight_init(&sf, &uart, NULL));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG,
+                    bg95_single_flight_execute(
+                        NULL, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, &response, sizeof(response)));
+}
+
+static void test_single_flight_concurrent_callers_share_one_round_trip(void)
+{
+  counting_uart_ctx_t   ctx  = {0};
+  bg95_uart_interface_t uart = {.write = counting_write, .read = counting_read, .context = &ctx};
+  bg95_sched_t          sched;
+  bg95_single_flight_t  sf = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&ctx.mock, single_flight_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_single_flight_init(&sf, &uart, &sched));
+
+  SemaphoreHandle_t done                        = xSemaphoreCreateCounting(CONCURRENT_CALLERS, 0);
+  caller_ctx_t      callers[CONCURRENT_CALLERS] = {0};
+  for (int i = 0; i < CONCURRENT_CALLERS; i++)
+  {
+    callers[i].sf   = &sf;
+    callers[i].done = done;
+    TEST_ASSERT_EQUAL(pdPASS,
+                      xTaskCreate(csq_caller_task, "sf_caller", 4096, &callers[i], 5, NULL));
+  }
+  for (int i = 0; i < CONCURRENT_CALLERS; i++)
+  {
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(2000)));
+  }
+
+  TEST_ASSERT_EQUAL(1, ctx.write_count);
+  TEST_ASSERT_EQUAL(CONCURRENT_CALLERS - 1, sf.joined_count);
+  for (int i = 0; i < CONCURRENT_CALLERS; i++)
+  {
+    TEST_ASSERT_EQUAL(ESP_OK, callers[i].err);
+    TEST_ASSERT_EQUAL(24, callers[i].response.rssi);
+  }
+
+  vSemaphoreDelete(done);
+  bg95_single_flight_deinit(&sf);
+  bg95_sched_deinit(&sched);
+  mock_uart_deinit(&ctx.mock);
+}
+
+static void test_single_flight_sequential_callers_each_hit_uart(void)
+{
+  counting_uart_ctx_t    ctx      = {0};
+  bg95_uart_interface_t  uart     = {.write = counting_write, .read = counting_read};
+  bg95_sched_t           sched;
+  bg95_single_flight_t   sf       = {0};
+  csq_execute_response_t response = {0};
+
+  uart.context = &ctx;
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&ctx.mock, single_flight_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_single_flight_init(&sf, &uart, &sched));
+
+  // A finished flight must never be re-used, the next caller gets fresh data
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_single_flight_execute(
+                        &sf, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, &response, sizeof(response)));
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    bg95_single_flight_execute(
+                        &sf, &AT_CMD_CSQ, AT_CMD_TYPE_EXECUTE, &response, sizeof(response)));
+  TEST_ASSERT_EQUAL(2, ctx.write_count);
+  TEST_ASSERT_EQUAL(0, sf.joined_count);
+
+  bg95_single_flight_deinit(&sf);
+  bg95_sched_deinit(&sched);
+  mock_uart_deinit(&ctx.mock);
+}
+
+static void test_single_flight_waits_for_the_modem(void)
+{
+  counting_uart_ctx_t     ctx  = {0};
+  bg95_uart_interface_t   uart = {.write = counting_write, .read = counting_read, .context = &ctx};
+  bg95_sched_t            sched;
+  bg95_sched_lane_stats_t stats;
+  bg95_single_flight_t    sf     = {0};
+  caller_ctx_t            caller = {.sf = &sf};
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&ctx.mock, single_flight_responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_single_flight_init(&sf, &uart, &sched));
+  caller.done = xSemaphoreCreateBinary();
+
+  // Another user of the modem is mid transaction, the flight does not touch the UART
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_acquire(&sched, BG95_SCHED_LANE_BULK, 0));
+  TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(csq_caller_task, "sf_caller", 4096, &caller, 5, NULL));
+  TEST_ASSERT_EQUAL(pdFALSE, xSemaphoreTake(caller.done, pdMS_TO_TICKS(50)));
+  TEST_ASSERT_EQUAL(0, ctx.write_count);
+
+  bg95_sched_release(&sched);
+  TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(caller.done, pdMS_TO_TICKS(2000)));
+  TEST_ASSERT_EQUAL(ESP_OK, caller.err);
+  TEST_ASSERT_EQUAL(1, ctx.write_count);
+
+  // AT+CSQ is a link decision, it queued in the control lane
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats));
+  TEST_ASSERT_EQUAL(1, stats.granted);
+
+  vSemaphoreDelete(caller.done);
+  bg95_single_flight_deinit(&sf);
+  bg95_sched_deinit(&sched);
+  mock_uart_deinit(&ctx.mock);
+}
+
+void run_test_bg95_single_flight_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_single_flight_idempotent_table);
+  RUN_TEST(test_single_flight_invalid_args);
+  RUN_TEST(test_single_flight_concurrent_callers_share_one_round_trip);
+  RUN_TEST(test_single_flight_sequential_callers_each_hit_uart);
+  RUN_TEST(test_single_flight_waits_for_the_modem);
+
+  UNITY_END();
+}
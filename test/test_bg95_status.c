@@ -0,0 +1,159 @@
+#include "bg95_status.h"
+
+#include <esp_err.h>
+#include <string.h>
+#include <unity.h>
+
+static const char* STATUS_CMD = "AT+CPIN?;+CSQ;+COPS?;+CGPADDR=1;+QMTCONN?";
+
+// Full combined response, one section per concatenated command
+static const char* VALID_STATUS_RESPONSE = "\r\n+CPIN: READY\r\n"
+                                           "\r\n+CSQ: 24,0\r\n"
+                                           "\r\n+COPS: 0,0,\"Operator Name\",8\r\n"
+                                           "\r\n+CGPADDR: 1,\"10.20.30.40\"\r\n"
+                                           "\r\n+QMTCONN: 0,3\r\n"
+                                           "\r\nOK\r\n";
+
+// No MQTT client and no PDP address yet
+static const char* DETACHED_STATUS_RESPONSE = "\r\n+CPIN: READY\r\n"
+                                              "\r\n+CSQ: 99,99\r\n"
+                                              "\r\n+COPS: 0\r\n"
+                                              "\r\n+CGPADDR: 1\r\n"
+                                              "\r\nOK\r\n";
+
+// Two MQTT clients in different states
+static const char* MULTI_CLIENT_STATUS_RESPONSE = "\r\n+CPIN: READY\r\n"
+                                                  "\r\n+CSQ: 24,0\r\n"
+                                                  "\r\n+COPS: 0,0,\"Operator Name\",8\r\n"
+                                                  "\r\n+CGPADDR: 1,\"10.20.30.40\"\r\n"
+                                                  "\r\n+QMTCONN: 0,2\r\n"
+                                                  "\r\n+QMTCONN: 1,3\r\n"
+                                                  "\r\nOK\r\n";
+
+// Modem aborted the line at +COPS?
+static const char* PARTIAL_STATUS_RESPONSE = "\r\n+CPIN: READY\r\n"
+                                             "\r\n+CSQ: 10,0\r\n"
+                                             "\r\n+CME ERROR: 30\r\n";
+
+static void test_status_parse_full_response(void)
+{
+  bg95_status_snapshot_t snapshot = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_status_snapshot_parse(VALID_STATUS_RESPONSE, 0, &snapshot));
+
+  TEST_ASSERT_TRUE(snapshot.present.has_cpin);
+  TEST_ASSERT_EQUAL(CPIN_STATUS_READY, snapshot.cpin.status);
+
+  TEST_ASSERT_TRUE(snapshot.present.has_csq);
+  TEST_ASSERT_EQUAL(24, snapshot.csq.rssi);
+
+  TEST_ASSERT_TRUE(snapshot.present.has_cops);
+  TEST_ASSERT_EQUAL_STRING("Operator Name", snapshot.cops.operator_name);
+
+  TEST_ASSERT_TRUE(snapshot.present.has_pdp_addr);
+  TEST_ASSERT_TRUE(snapshot.pdp_active);
+  TEST_ASSERT_EQUAL_STRING("10.20.30.40", snapshot.pdp_addr);
+
+  TEST_ASSERT_TRUE(snapshot.present.has_qmtconn);
+  TEST_ASSERT_EQUAL(QMTCONN_STATE_CONNECTED, snapshot.qmtconn.state);
+}
+
+static void test_status_parse_detached_response(void)
+{
+  bg95_status_snapshot_t snapshot = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_status_snapshot_parse(DETACHED_STATUS_RESPONSE, 0, &snapshot));
+
+  TEST_ASSERT_TRUE(snapshot.present.has_cpin);
+  TEST_ASSERT_TRUE(snapshot.present.has_pdp_addr);
+  TEST_ASSERT_FALSE(snapshot.pdp_active);
+  TEST_ASSERT_FALSE(snapshot.present.has_qmtconn);
+}
+
+static void test_status_parse_picks_requested_client(void)
+{
+  bg95_status_snapshot_t snapshot = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_status_snapshot_parse(MULTI_CLIENT_STATUS_RESPONSE, 1, &snapshot));
+  TEST_ASSERT_TRUE(snapshot.present.has_qmtconn);
+  TEST_ASSERT_EQUAL(1, snapshot.qmtconn.client_idx);
+  TEST_ASSERT_EQUAL(QMTCONN_STATE_CONNECTED, snapshot.qmtconn.state);
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_status_snapshot_parse(MULTI_CLIENT_STATUS_RESPONSE, 0, &snapshot));
+  TEST_ASSERT_EQUAL(0, snapshot.qmtconn.client_idx);
+  TEST_ASSERT_EQUAL(QMTCONN_STATE_CONNECTING, snapshot.qmtconn.state);
+
+  // A client without a line is not reported
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_status_snapshot_parse(MULTI_CLIENT_STATUS_RESPONSE, 2, &snapshot));
+  TEST_ASSERT_FALSE(snapshot.present.has_qmtconn);
+}
+
+static void test_status_parse_null_args(void)
+{
+  bg95_status_snapshot_t snapshot = {0};
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_status_snapshot_parse(NULL, 0, &snapshot));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG,
+                    bg95_status_snapshot_parse(VALID_STATUS_RESPONSE, 0, NULL));
+}
+
+static void test_status_read_single_round_trip(void)
+{
+  const mock_uart_response_t responses[] = {
+      {.expected_cmd = STATUS_CMD, .cmd_response = VALID_STATUS_RESPONSE, .delay_ms = 0}};
+  bg95_uart_interface_t   uart     = {0};
+  bg95_status_snapshot_t  snapshot = {0};
+  bg95_sched_t            sched;
+  bg95_sched_lane_stats_t stats;
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&uart, responses, 1));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_init(&sched));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_status_snapshot_read(&uart, &sched, 1, 0, &snapshot));
+  TEST_ASSERT_TRUE(snapshot.present.has_cpin);
+  TEST_ASSERT_TRUE(snapshot.present.has_csq);
+  TEST_ASSERT_TRUE(snapshot.present.has_cops);
+  TEST_ASSERT_TRUE(snapshot.pdp_active);
+  TEST_ASSERT_TRUE(snapshot.present.has_qmtconn);
+
+  // Went through the control lane and handed the modem back
+  bg95_sched_get_stats(&sched, BG95_SCHED_LANE_CONTROL, &stats);
+  TEST_ASSERT_EQUAL(1, stats.granted);
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_sched_try_acquire(&sched, BG95_SCHED_LANE_BULK));
+  bg95_sched_release(&sched);
+
+  bg95_sched_deinit(&sched);
+  mock_uart_deinit(&uart);
+}
+
+static void test_status_read_partial_on_error(void)
+{
+  const mock_uart_response_t responses[] = {
+      {.expected_cmd = STATUS_CMD, .cmd_response = PARTIAL_STATUS_RESPONSE, .delay_ms = 0}};
+  bg95_uart_interface_t  uart     = {0};
+  bg95_status_snapshot_t snapshot = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, mock_uart_init(&uart, responses, 1));
+  TEST_ASSERT_EQUAL(ESP_FAIL, bg95_status_snapshot_read(&uart, NULL, 1, 0, &snapshot));
+  TEST_ASSERT_TRUE(snapshot.present.has_cpin);
+  TEST_ASSERT_TRUE(snapshot.present.has_csq);
+  TEST_ASSERT_EQUAL(10, snapshot.csq.rssi);
+  TEST_ASSERT_FALSE(snapshot.present.has_cops);
+  TEST_ASSERT_FALSE(snapshot.present.has_pdp_addr);
+  TEST_ASSERT_FALSE(snapshot.present.has_qmtconn);
+
+  mock_uart_deinit(&uart);
+}
+
+void run_test_bg95_status_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_status_parse_full_response);
+  RUN_TEST(test_status_parse_detached_response);
+  RUN_TEST(test_status_parse_picks_requested_client);
+  RUN_TEST(test_status_parse_null_args);
+  RUN_TEST(test_status_read_single_round_trip);
+  RUN_TEST(test_status_read_partial_on_error);
+
+  UNITY_END();
+}
@@ -0,0 +1,522 @@
+#include "bg95_urc_tap.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <esp_err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// One shot fake UART: every write queues 'reply', the next reads hand it out once
+typedef struct
+{
+  const char* reply;
+  const char* pending;
+} one_shot_uart_ctx_t;
+
+static esp_err_t one_shot_write(const char* data, size_t len, void* context)
+{
+  one_shot_uart_ctx_t* ctx = (one_shot_uart_ctx_t*) context;
+  ctx->pending             = ctx->reply;
+  return ESP_OK;
+}
+
+static esp_err_t one_shot_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  one_shot_uart_ctx_t* ctx = (one_shot_uart_ctx_t*) context;
+  *bytes_read              = 0;
+  if (ctx->pending == NULL)
+  {
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    return ESP_ERR_TIMEOUT;
+  }
+  size_t len = strlen(ctx->pending);
+  len        = len < max_len ? len : max_len;
+  memcpy(data, ctx->pending, len);
+  *bytes_read  = len;
+  ctx->pending = ctx->pending[len] != '\0' ? ctx->pending + len : NULL;
+  return ESP_OK;
+}
+
+// Chunked fake UART: hands 'reply' out a few bytes per read, like a slow line into a small FIFO
+typedef struct
+{
+  const char* reply;
+  const char* pending;
+  size_t      chunk;
+} chunked_uart_ctx_t;
+
+static esp_err_t chunked_write(const char* data, size_t len, void* context)
+{
+  chunked_uart_ctx_t* ctx = (chunked_uart_ctx_t*) context;
+  ctx->pending            = ctx->reply;
+  return ESP_OK;
+}
+
+static esp_err_t chunked_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  chunked_uart_ctx_t* ctx = (chunked_uart_ctx_t*) context;
+  *bytes_read             = 0;
+  if (ctx->pending == NULL || *ctx->pending == '\0')
+  {
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    return ESP_ERR_TIMEOUT;
+  }
+  vTaskDelay(pdMS_TO_TICKS(2));
+  size_t len = strlen(ctx->pending);
+  len        = len < ctx->chunk ? len : ctx->chunk;
+  len        = len < max_len ? len : max_len;
+  memcpy(data, ctx->pending, len);
+  *bytes_read = len;
+  ctx->pending += len;
+  return ESP_OK;
+}
+
+// Read through the tap until 'until' shows up, returns the number of reads it took
+static size_t read_until(bg95_urc_tap_t* tap, const char* until, char* buf, size_t size)
+{
+  size_t total = 0;
+  size_t reads = 0;
+
+  buf[0] = '\0';
+  while (strstr(buf, until) == NULL && reads < 100)
+  {
+    size_t bytes_read = 0;
+    tap->uart.read(buf + total, size - 1 - total, &bytes_read, 500, tap->uart.context);
+    total += bytes_read;
+    buf[total] = '\0';
+    reads++;
+  }
+  return reads;
+}
+
+#define RECORDED_LINES_MAX 8
+
+typedef struct
+{
+  char   lines[RECORDED_LINES_MAX][64];
+  bool   solicited[RECORDED_LINES_MAX];
+  size_t count;
+} recorded_lines_t;
+
+static void record_line(const char* line, bool solicited, void* ctx)
+{
+  recorded_lines_t* rec = (recorded_lines_t*) ctx;
+  if (rec->count < RECORDED_LINES_MAX)
+  {
+    strncpy(rec->lines[rec->count], line, sizeof(rec->lines[0]) - 1);
+    rec->solicited[rec->count] = solicited;
+    rec->count++;
+  }
+}
+
+// Handlers may run on the dispatch task, give it time to catch up with the reader
+static void wait_for_lines(recorded_lines_t* rec, size_t count)
+{
+  for (int i = 0; i < 200 && *(volatile size_t*) &rec->count < count; i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+}
+
+static void test_urc_tap_init_invalid_args(void)
+{
+  bg95_urc_tap_t        tap  = {0};
+  bg95_uart_interface_t phys = {0};
+
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_urc_tap_init(NULL, &phys));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_urc_tap_init(&tap, NULL));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_urc_tap_init(&tap, &phys));
+}
+
+static void test_urc_tap_forwards_response_and_classifies_lines(void)
+{
+  one_shot_uart_ctx_t   ctx  = {.reply = "\r\n+CPIN: READY\r\n\r\n+CEREG: 1\r\n\r\nOK\r\n"};
+  bg95_uart_interface_t phys = {.write = one_shot_write, .read = one_shot_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  recorded_lines_t      rec = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_add_handler(&tap, record_line, &rec));
+
+  const char* cmd = "AT+CPIN?\r\n";
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+
+  // The driver side still sees the complete response
+  char   buf[128]   = {0};
+  size_t bytes_read = 0;
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    tap.uart.read(buf, sizeof(buf) - 1, &bytes_read, 500, tap.uart.context));
+  TEST_ASSERT_EQUAL_STRING(ctx.reply, buf);
+
+  // Response line is solicited, the interleaved registration URC is not
+  wait_for_lines(&rec, 2);
+  TEST_ASSERT_EQUAL(2, rec.count);
+  TEST_ASSERT_EQUAL_STRING("+CPIN: READY", rec.lines[0]);
+  TEST_ASSERT_TRUE(rec.solicited[0]);
+  TEST_ASSERT_EQUAL_STRING("+CEREG: 1", rec.lines[1]);
+  TEST_ASSERT_FALSE(rec.solicited[1]);
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+// Fake UART whose RX path overflows mid-response when 'lose' is set: a read hands out 'reply'
+// up to 'lost_at', the next one reports the loss like bg95_uart_hw does after its flush
+typedef struct
+{
+  const char* reply;
+  size_t      lost_at;
+  bool        lose;
+  int         stage; // 0 idle, 1 first part pending, 2 loss pending, 3 whole reply pending
+} lossy_uart_ctx_t;
+
+static esp_err_t lossy_write(const char* data, size_t len, void* context)
+{
+  lossy_uart_ctx_t* ctx = (lossy_uart_ctx_t*) context;
+  ctx->stage            = ctx->lose ? 1 : 3;
+  return ESP_OK;
+}
+
+static esp_err_t lossy_read(
+    char* data, size_t max_len, size_t* bytes_read, uint32_t timeout_ms, void* context)
+{
+  lossy_uart_ctx_t* ctx   = (lossy_uart_ctx_t*) context;
+  int               stage = ctx->stage;
+  size_t            len   = stage == 1 ? ctx->lost_at : strlen(ctx->reply);
+
+  *bytes_read = 0;
+  ctx->stage  = stage == 1 ? 2 : 0;
+  if (stage == 2)
+  {
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+  if (stage == 0)
+  {
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    return ESP_ERR_TIMEOUT;
+  }
+  len = len < max_len ? len : max_len;
+  memcpy(data, ctx->reply, len);
+  *bytes_read = len;
+  return ESP_OK;
+}
+
+static void test_urc_tap_fails_read_after_input_loss(void)
+{
+  lossy_uart_ctx_t      ctx  = {.reply = "+CSQ: 20,99\r\n\r\nOK\r\n", .lost_at = 6};
+  bg95_uart_interface_t phys = {.write = lossy_write, .read = lossy_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  char                  buf[64];
+  size_t                bytes_read = 0;
+  const char*           cmd        = "AT+CSQ\r\n";
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+
+  // The half line before the loss is dropped, the read of the command in flight fails
+  ctx.lose = true;
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE,
+                    tap.uart.read(buf, sizeof(buf) - 1, &bytes_read, 500, tap.uart.context));
+  TEST_ASSERT_EQUAL(0, bytes_read);
+
+  // The next command starts clean
+  ctx.lose = false;
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  memset(buf, 0, sizeof(buf));
+  size_t total = 0;
+  for (int i = 0; i < 10 && strstr(buf, "OK\r\n") == NULL; i++)
+  {
+    TEST_ASSERT_EQUAL(
+        ESP_OK,
+        tap.uart.read(buf + total, sizeof(buf) - 1 - total, &bytes_read, 100, tap.uart.context));
+    total += bytes_read;
+  }
+  TEST_ASSERT_EQUAL_STRING(ctx.reply, buf);
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+static void test_urc_tap_lines_after_final_result_are_unsolicited(void)
+{
+  one_shot_uart_ctx_t   ctx  = {.reply = NULL};
+  bg95_uart_interface_t phys = {.write = one_shot_write, .read = one_shot_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  recorded_lines_t      rec = {0};
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_add_handler(&tap, record_line, &rec));
+
+  const char* cmd = "AT+QMTOPEN=0,\"host\",1883\r\n";
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+
+  // Result URC arrives after OK, so it must reach handlers as unsolicited
+  const char* stream = "\r\nOK\r\n\r\n+QMTOPEN: 0,0\r\n";
+  bg95_urc_tap_feed(&tap, stream, strlen(stream));
+
+  TEST_ASSERT_EQUAL(1, rec.count);
+  TEST_ASSERT_EQUAL_STRING("+QMTOPEN: 0,0", rec.lines[0]);
+  TEST_ASSERT_FALSE(rec.solicited[0]);
+  TEST_ASSERT_EQUAL(1, tap.stats.urc_lines);
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+static void test_urc_tap_keeps_last_error(void)
+{
+  one_shot_uart_ctx_t   ctx  = {.reply = NULL};
+  bg95_uart_interface_t phys = {.write = one_shot_write, .read = one_shot_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  bg95_at_error_t       error;
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_FALSE(bg95_urc_tap_last_error(&tap, &error));
+
+  const char* failed = "\r\n+CME ERROR: 14\r\n";
+  bg95_urc_tap_feed(&tap, failed, strlen(failed));
+  TEST_ASSERT_TRUE(bg95_urc_tap_last_error(&tap, &error));
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_CME, error.kind);
+  TEST_ASSERT_EQUAL(14, error.code);
+  TEST_ASSERT_EQUAL(BG95_AT_RETRY_IMMEDIATE, error.retry);
+
+  // The next successful command clears it
+  const char* ok = "\r\nOK\r\n";
+  bg95_urc_tap_feed(&tap, ok, strlen(ok));
+  TEST_ASSERT_FALSE(bg95_urc_tap_last_error(&tap, &error));
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+static void test_urc_tap_last_error_is_set_before_driver_reads(void)
+{
+  one_shot_uart_ctx_t   ctx  = {.reply = "\r\n+CME ERROR: 10\r\n"};
+  bg95_uart_interface_t phys = {.write = one_shot_write, .read = one_shot_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  bg95_at_error_t       error;
+  char                  buf[64];
+  const char*           cmd = "AT+CPIN?\r\n";
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+
+  // The driver reacts to ESP_FAIL right after reading the result, the error must be there
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  read_until(&tap, "ERROR: 10\r\n", buf, sizeof(buf));
+  TEST_ASSERT_TRUE(bg95_urc_tap_last_error(&tap, &error));
+  TEST_ASSERT_EQUAL(BG95_AT_ERROR_CME, error.kind);
+  TEST_ASSERT_EQUAL(10, error.code);
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+static void test_urc_tap_wakes_driver_per_line(void)
+{
+  chunked_uart_ctx_t    ctx  = {.reply = "\r\n+CSQ: 20,99\r\n\r\nOK\r\n", .chunk = 3};
+  bg95_uart_interface_t phys = {.write = chunked_write, .read = chunked_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  char                  buf[128];
+  const char*           cmd = "AT+CSQ\r\n";
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+
+  // Wake on every chunk
+  bg95_urc_tap_set_wake_on_line(&tap, false);
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  size_t chunk_reads = read_until(&tap, "OK\r\n", buf, sizeof(buf));
+  TEST_ASSERT_EQUAL_STRING(ctx.reply, buf);
+
+  // Wake on complete lines, same bytes with fewer wakeups
+  bg95_urc_tap_set_wake_on_line(&tap, true);
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  size_t line_reads = read_until(&tap, "OK\r\n", buf, sizeof(buf));
+  TEST_ASSERT_EQUAL_STRING(ctx.reply, buf);
+
+  TEST_ASSERT_LESS_THAN(chunk_reads, line_reads);
+  TEST_ASSERT_LESS_OR_EQUAL(4, line_reads); // One per "\r\n" at most
+  TEST_ASSERT_EQUAL(chunk_reads + line_reads, tap.stats.read_wakeups);
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+static void test_urc_tap_wakes_on_prompt_and_timeout(void)
+{
+  chunked_uart_ctx_t    ctx  = {.reply = "\r\n> ", .chunk = 2};
+  bg95_uart_interface_t phys = {.write = chunked_write, .read = chunked_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  char                  buf[32];
+  const char*           cmd = "AT+QMTPUBEX=0,1,1,0,\"t\",5\r\n";
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+
+  // "> " has no line end but must still wake the driver, well before the timeout
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  TickType_t start = xTaskGetTickCount();
+  read_until(&tap, "> ", buf, sizeof(buf));
+  TEST_ASSERT_EQUAL_STRING(ctx.reply, buf);
+  TEST_ASSERT_LESS_THAN(pdMS_TO_TICKS(200), xTaskGetTickCount() - start);
+
+  // An unterminated tail is handed out once the read times out
+  ctx.reply = "\r\nPARTIAL";
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  size_t bytes_read = 0;
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    tap.uart.read(buf, sizeof(buf) - 1, &bytes_read, 100, tap.uart.context));
+  TEST_ASSERT_EQUAL(2, bytes_read); // The leading "\r\n" counts as a line
+  TEST_ASSERT_EQUAL(ESP_OK,
+                    tap.uart.read(buf, sizeof(buf) - 1, &bytes_read, 100, tap.uart.context));
+  buf[bytes_read] = '\0';
+  TEST_ASSERT_EQUAL_STRING("PARTIAL", buf);
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+static void test_urc_tap_waits_for_result_line(void)
+{
+  chunked_uart_ctx_t    ctx  = {.reply = "\r\nOK\r\n\r\n+QMTOPEN: 0,0\r\n", .chunk = 4};
+  bg95_uart_interface_t phys = {.write = chunked_write, .read = chunked_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  char                  line[32];
+  const char*           cmd = "AT+QMTOPEN=0,\"host\",1883\r\n";
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, bg95_urc_tap_wait(&tap, NULL, 0, 10));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bg95_urc_tap_arm_wait(&tap, ""));
+
+  // Armed before the command, so the result counts even when it lands with the "OK"
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_arm_wait(&tap, "+QMTOPEN:"));
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  TickType_t start = xTaskGetTickCount();
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_wait(&tap, line, sizeof(line), 2000));
+  TEST_ASSERT_LESS_THAN(pdMS_TO_TICKS(500), xTaskGetTickCount() - start);
+  TEST_ASSERT_EQUAL_STRING("+QMTOPEN: 0,0", line);
+
+  // One-shot: nothing armed any more, and a line that never comes times out
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, bg95_urc_tap_wait(&tap, NULL, 0, 10));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_arm_wait(&tap, "+QMTCONN:"));
+  TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, bg95_urc_tap_wait(&tap, line, sizeof(line), 100));
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+#ifdef CONFIG_BG95_EXT_URC_DISPATCH_TASK
+static void slow_handler(const char* line, bool solicited, void* ctx)
+{
+  vTaskDelay(pdMS_TO_TICKS(300)); // Heavy application work, e.g. JSON decoding
+  record_line(line, solicited, ctx);
+}
+
+static void test_urc_tap_slow_handler_does_not_delay_reads(void)
+{
+  chunked_uart_ctx_t    ctx  = {.reply = "\r\n+CEREG: 5\r\n+CSQ: 20,99\r\n\r\nOK\r\n", .chunk = 8};
+  bg95_uart_interface_t phys = {.write = chunked_write, .read = chunked_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  recorded_lines_t      rec = {0};
+  char                  buf[128];
+  const char*           cmd = "AT+CSQ\r\n";
+
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_add_handler(&tap, slow_handler, &rec));
+
+  // The final result reaches the driver while the handler is still busy with the first line
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  TickType_t start = xTaskGetTickCount();
+  read_until(&tap, "OK\r\n", buf, sizeof(buf));
+  TEST_ASSERT_EQUAL_STRING(ctx.reply, buf);
+  TEST_ASSERT_LESS_THAN(pdMS_TO_TICKS(200), xTaskGetTickCount() - start);
+
+  wait_for_lines(&rec, 2);
+  TEST_ASSERT_EQUAL(2, rec.count);
+  TEST_ASSERT_EQUAL_STRING("+CEREG: 5", rec.lines[0]);
+  TEST_ASSERT_EQUAL_STRING("+CSQ: 20,99", rec.lines[1]);
+  TEST_ASSERT_TRUE(rec.solicited[1]);
+  TEST_ASSERT_EQUAL(0, tap.stats.queue_waits);
+
+  bg95_urc_tap_deinit(&tap);
+}
+
+typedef struct
+{
+  volatile int count;
+  volatile int concurrent;
+  volatile int max_concurrent;
+  int          order[BG95_URC_TAP_DISPATCH_QUEUE_LEN + 4];
+} counted_lines_t;
+
+// First call blocks long enough for the dispatch queue to fill behind it
+static void stalling_handler(const char* line, bool solicited, void* ctx)
+{
+  counted_lines_t* counted = (counted_lines_t*) ctx;
+  if (++counted->concurrent > counted->max_concurrent)
+  {
+    counted->max_concurrent = counted->concurrent;
+  }
+  if (counted->count == 0)
+  {
+    vTaskDelay(pdMS_TO_TICKS(200));
+  }
+  if (counted->count < (int) (sizeof(counted->order) / sizeof(counted->order[0])))
+  {
+    counted->order[counted->count] = atoi(line + strlen("+QMTRECV: 0,"));
+  }
+  counted->count++;
+  counted->concurrent--;
+}
+
+static void test_urc_tap_full_dispatch_queue_keeps_order(void)
+{
+  static char reply[(BG95_URC_TAP_DISPATCH_QUEUE_LEN + 4) * 17 + 1];
+  one_shot_uart_ctx_t   ctx  = {.reply = reply};
+  bg95_uart_interface_t phys = {.write = one_shot_write, .read = one_shot_read, .context = &ctx};
+  static bg95_urc_tap_t tap;
+  counted_lines_t       counted = {0};
+  const int             lines   = BG95_URC_TAP_DISPATCH_QUEUE_LEN + 4;
+
+  reply[0] = '\0';
+  for (int i = 0; i < lines; i++)
+  {
+    char line[18];
+    snprintf(line, sizeof(line), "+QMTRECV: 0,%03d\r\n", i);
+    strcat(reply, line);
+  }
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_init(&tap, &phys));
+  TEST_ASSERT_EQUAL(ESP_OK, bg95_urc_tap_add_handler(&tap, stalling_handler, &counted));
+
+  const char* cmd = "AT\r\n";
+  TEST_ASSERT_EQUAL(ESP_OK, tap.uart.write(cmd, strlen(cmd), tap.uart.context));
+  for (int i = 0; i < 200 && counted.count < lines; i++)
+  {
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  TEST_ASSERT_EQUAL(lines, counted.count);
+  TEST_ASSERT_GREATER_THAN(0, tap.stats.queue_waits);
+  TEST_ASSERT_EQUAL(1, counted.max_concurrent);
+  for (int i = 0; i < lines; i++)
+  {
+    TEST_ASSERT_EQUAL(i, counted.order[i]);
+  }
+
+  bg95_urc_tap_deinit(&tap);
+}
+#endif
+
+void run_test_bg95_urc_tap_all(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_urc_tap_init_invalid_args);
+  RUN_TEST(test_urc_tap_forwards_response_and_classifies_lines);
+  RUN_TEST(test_urc_tap_lines_after_final_result_are_unsolicited);
+  RUN_TEST(test_urc_tap_fails_read_after_input_loss);
+  RUN_TEST(test_urc_tap_keeps_last_error);
+  RUN_TEST(test_urc_tap_last_error_is_set_before_driver_reads);
+  RUN_TEST(test_urc_tap_wakes_driver_per_line);
+  RUN_TEST(test_urc_tap_wakes_on_prompt_and_timeout);
+  RUN_TEST(test_urc_tap_waits_for_result_line);
+#ifdef CONFIG_BG95_EXT_URC_DISPATCH_TASK
+  RUN_TEST(test_urc_tap_slow_handler_does_not_delay_reads);
+  RUN_TEST(test_urc_tap_full_dispatch_queue_keeps_order);
+#endif
+
+  UNITY_END();
+}
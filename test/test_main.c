@@ -25,6 +25,27 @@ void run_test_at_cmd_qmtdisc_all(void);
 void run_test_at_cmd_qmtpub_all(void);
 void run_test_at_cmd_qmtsub_all(void);
 void run_test_at_cmd_qmtuns_all(void);
+void run_test_bg95_raw_at_all(void);
+void run_test_bg95_status_all(void);
+void run_test_bg95_single_flight_all(void);
+void run_test_bg95_query_cache_all(void);
+void run_test_bg95_urc_tap_all(void);
+void run_test_bg95_net_reg_all(void);
+void run_test_bg95_rtt_estimator_all(void);
+void run_test_bg95_reconnect_all(void);
+void run_test_bg95_boot_all(void);
+void run_test_bg95_config_all(void);
+void run_test_bg95_caps_all(void);
+void run_test_bg95_cmux_all(void);
+void run_test_bg95_baud_all(void);
+void run_test_bg95_flow_all(void);
+void run_test_bg95_at_error_all(void);
+void run_test_bg95_sim_all(void);
+void run_test_bg95_mqtt_wire_all(void);
+void run_test_bg95_bond_all(void);
+void run_test_bg95_sched_all(void);
+void run_test_bg95_pub_ring_all(void);
+void run_test_bg95_poll_all(void);
 
 /* Define test suite information */
 typedef struct
@@ -50,6 +71,27 @@ static const test_suite_t test_suites[] = {
     {"AT CMD: QMTPUB Tests", run_test_at_cmd_qmtpub_all},
     {"AT CMD: QMTPUB Tests", run_test_at_cmd_qmtsub_all},
     {"AT CMD: QMTPUB Tests", run_test_at_cmd_qmtuns_all},
+    {"BG95 EXT: RAW AT Tests", run_test_bg95_raw_at_all},
+    {"BG95 EXT: STATUS SNAPSHOT Tests", run_test_bg95_status_all},
+    {"BG95 EXT: SINGLE FLIGHT Tests", run_test_bg95_single_flight_all},
+    {"BG95 EXT: QUERY CACHE Tests", run_test_bg95_query_cache_all},
+    {"BG95 EXT: URC TAP Tests", run_test_bg95_urc_tap_all},
+    {"BG95 EXT: NET REG Tests", run_test_bg95_net_reg_all},
+    {"BG95 EXT: RTT ESTIMATOR Tests", run_test_bg95_rtt_estimator_all},
+    {"BG95 EXT: RECONNECT Tests", run_test_bg95_reconnect_all},
+    {"BG95 EXT: BOOT Tests", run_test_bg95_boot_all},
+    {"BG95 EXT: CONFIG Tests", run_test_bg95_config_all},
+    {"BG95 EXT: CAPS Tests", run_test_bg95_caps_all},
+    {"BG95 EXT: CMUX Tests", run_test_bg95_cmux_all},
+    {"BG95 EXT: BAUD Tests", run_test_bg95_baud_all},
+    {"BG95 EXT: FLOW Tests", run_test_bg95_flow_all},
+    {"BG95 EXT: AT ERROR Tests", run_test_bg95_at_error_all},
+    {"BG95 EXT: SIM Tests", run_test_bg95_sim_all},
+    {"BG95 EXT: MQTT WIRE Tests", run_test_bg95_mqtt_wire_all},
+    {"BG95 EXT: BOND Tests", run_test_bg95_bond_all},
+    {"BG95 EXT: SCHED Tests", run_test_bg95_sched_all},
+    {"BG95 EXT: PUB RING Tests", run_test_bg95_pub_ring_all},
+    {"BG95 EXT: POLL Tests", run_test_bg95_poll_all},
 };
 
 #define NUM_TEST_SUITES (sizeof(test_suites) / sizeof(test_suite_t))